@@ -0,0 +1,241 @@
+#pragma once
+
+/*
+ * Score Accumulators
+ *
+ * Term-at-a-time scoring adds each query term's postings into one score per
+ * document. Keying those scores by doc ID string costs a hash lookup, and
+ * often an allocation, per posting. Here documents are dense integers
+ * (docIDs, or roaring ordinals with per-query numbers after them), and the
+ * scores are plain float arrays indexed by them:
+ *
+ * - Dense: Channels float arrays of numDocs entries, a matched-term count
+ *   per document, a bitmap of documents touched since the last reset and
+ *   the list of them. Marking a document touched is branch-free, so a term's
+ *   postings are added by two straight loops, and reset() only clears the
+ *   touched documents: O(hits), not O(numDocs).
+ * - Paged: the same arrays cut into pages of PAGE_SIZE documents, allocated
+ *   when a page gets its first posting and recycled on reset(), so memory
+ *   and reset time follow the pages touched when numDocs is too large for
+ *   dense arrays.
+ *
+ * Both keep every entry zero between queries; threadLocal() hands out one
+ * reusable accumulator per thread.
+ *
+ * A channel is one sum per document: a score, a score component, or a
+ * term's tf (floats hold integers exactly up to 2^24). Dense adds a term's
+ * values with score_kernels::scatterAdd.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "score_kernels.hpp"
+
+namespace accumulator {
+
+class Dense {
+public:
+    Dense() = default;
+    Dense(uint32_t numDocs, uint32_t channels) { resize(numDocs, channels); }
+
+    // Room for docIDs [0, numDocs) in at least `channels` channels. Must be
+    // called between queries (after reset()), when every entry is zero, so
+    // growing just reallocates.
+    void resize(uint32_t numDocs, uint32_t channels) {
+        if (numDocs <= size && channels <= numChannels) return;
+        size = std::max(size, numDocs);
+        numChannels = std::max(numChannels, channels);
+        values.assign(static_cast<size_t>(size) * numChannels, 0.0f);
+        counts.assign(size, 0);
+        seen.assign((size + 63) / 64, 0);
+    }
+
+    uint32_t capacity() const { return size; }
+    uint32_t channels() const { return numChannels; }
+
+    // Adds one term's postings: values[i] to channel `channel` of docs[i],
+    // and `matched` to its matched-term count. docs must be distinct and
+    // below capacity().
+    void addTerm(const uint32_t* docs, const float* termValues, size_t n, uint32_t channel, uint16_t matched) {
+        markTouched(docs, n);
+        score_kernels::scatterAdd(values.data() + static_cast<size_t>(channel) * size, docs, termValues, n);
+        if (matched > 0) {
+            for (size_t i = 0; i < n; i++) counts[docs[i]] += matched;
+        }
+    }
+
+    float value(uint32_t doc, uint32_t channel) const { return values[static_cast<size_t>(channel) * size + doc]; }
+    uint16_t matched(uint32_t doc) const { return counts[doc]; }
+    size_t hits() const { return touched.size(); }
+
+    // f(doc) for every touched document, in the order first touched
+    template <typename F>
+    void forEachTouched(F f) const {
+        for (uint32_t d : touched) f(d);
+    }
+
+    // Zeroes the touched documents' entries
+    void reset() {
+        for (uint32_t d : touched) {
+            for (uint32_t c = 0; c < numChannels; c++) values[static_cast<size_t>(c) * size + d] = 0.0f;
+            counts[d] = 0;
+            seen[d >> 6] = 0;
+        }
+        touched.clear();
+    }
+
+private:
+    uint32_t size = 0;
+    uint32_t numChannels = 0;
+    std::vector<float> values;     // channel-major: values[channel * size + doc]
+    std::vector<uint16_t> counts;
+    std::vector<uint64_t> seen;    // touched bits
+    std::vector<uint32_t> touched;
+
+    // Appends every doc to the touched list, then keeps it only if its bit
+    // was clear: no branch per posting
+    void markTouched(const uint32_t* docs, size_t n) {
+        size_t count = touched.size();
+        touched.resize(count + n);
+        for (size_t i = 0; i < n; i++) {
+            uint64_t& word = seen[docs[i] >> 6];
+            uint64_t bit = uint64_t(1) << (docs[i] & 63);
+            touched[count] = docs[i];
+            count += (word & bit) == 0;
+            word |= bit;
+        }
+        touched.resize(count);
+    }
+};
+
+class Paged {
+public:
+    static constexpr uint32_t PAGE_BITS = 12;
+    static constexpr uint32_t PAGE_SIZE = 1u << PAGE_BITS;  // documents per page
+
+    Paged() = default;
+    Paged(uint32_t numDocs, uint32_t channels) { resize(numDocs, channels); }
+
+    // As Dense::resize; only the page table is sized by numDocs
+    void resize(uint32_t numDocs, uint32_t channels) {
+        if (channels > numChannels) {
+            values.clear();
+            counts.clear();
+            seen.clear();
+            freePages.clear();
+            numPages = 0;
+            numChannels = channels;
+        }
+        size_t tablePages = (static_cast<size_t>(numDocs) + PAGE_SIZE - 1) / PAGE_SIZE;
+        if (tablePages > pageOf.size()) pageOf.resize(tablePages, -1);
+        size = std::max(size, numDocs);
+    }
+
+    uint32_t capacity() const { return size; }
+    uint32_t channels() const { return numChannels; }
+
+    void addTerm(const uint32_t* docs, const float* termValues, size_t n, uint32_t channel, uint16_t matched) {
+        for (size_t i = 0; i < n; i++) {
+            uint32_t d = docs[i];
+            size_t page = slot(d >> PAGE_BITS);
+            size_t low = d & (PAGE_SIZE - 1);
+            values[(page * numChannels + channel) * PAGE_SIZE + low] += termValues[i];
+            counts[page * PAGE_SIZE + low] += matched;
+            seen[page * (PAGE_SIZE / 64) + (low >> 6)] |= uint64_t(1) << (low & 63);
+        }
+    }
+
+    float value(uint32_t doc, uint32_t channel) const {
+        int32_t page = pageOf[doc >> PAGE_BITS];
+        return page < 0 ? 0.0f
+                        : values[(static_cast<size_t>(page) * numChannels + channel) * PAGE_SIZE + (doc & (PAGE_SIZE - 1))];
+    }
+    uint16_t matched(uint32_t doc) const {
+        int32_t page = pageOf[doc >> PAGE_BITS];
+        return page < 0 ? 0 : counts[static_cast<size_t>(page) * PAGE_SIZE + (doc & (PAGE_SIZE - 1))];
+    }
+    size_t hits() const {
+        size_t n = 0;
+        for (uint32_t p : touchedPages) {
+            const uint64_t* bits = &seen[static_cast<size_t>(pageOf[p]) * (PAGE_SIZE / 64)];
+            for (uint32_t w = 0; w < PAGE_SIZE / 64; w++) n += __builtin_popcountll(bits[w]);
+        }
+        return n;
+    }
+
+    // f(doc) for every touched document, in docID order within each page,
+    // pages in the order first touched
+    template <typename F>
+    void forEachTouched(F f) const {
+        for (uint32_t p : touchedPages) {
+            const uint64_t* bits = &seen[static_cast<size_t>(pageOf[p]) * (PAGE_SIZE / 64)];
+            for (uint32_t w = 0; w < PAGE_SIZE / 64; w++) {
+                uint64_t word = bits[w];
+                while (word) {
+                    f((p << PAGE_BITS) | (w * 64 + static_cast<uint32_t>(__builtin_ctzll(word))));
+                    word &= word - 1;
+                }
+            }
+        }
+    }
+
+    // Zeroes the touched pages and returns them to the free list
+    void reset() {
+        for (uint32_t p : touchedPages) {
+            size_t page = static_cast<size_t>(pageOf[p]);
+            std::fill(values.begin() + page * numChannels * PAGE_SIZE,
+                      values.begin() + (page + 1) * numChannels * PAGE_SIZE, 0.0f);
+            std::fill(counts.begin() + page * PAGE_SIZE, counts.begin() + (page + 1) * PAGE_SIZE, 0);
+            std::fill(seen.begin() + page * (PAGE_SIZE / 64), seen.begin() + (page + 1) * (PAGE_SIZE / 64), 0);
+            freePages.push_back(static_cast<uint32_t>(page));
+            pageOf[p] = -1;
+        }
+        touchedPages.clear();
+    }
+
+private:
+    uint32_t size = 0;
+    uint32_t numChannels = 0;
+    std::vector<int32_t> pageOf;       // document page -> allocated page, -1 if none
+    std::vector<uint32_t> touchedPages;
+    std::vector<uint32_t> freePages;
+    size_t numPages = 0;                // allocated pages
+    std::vector<float> values;          // per page: channel-major PAGE_SIZE floats each
+    std::vector<uint16_t> counts;
+    std::vector<uint64_t> seen;
+
+    size_t slot(uint32_t docPage) {
+        int32_t page = pageOf[docPage];
+        if (page >= 0) return static_cast<size_t>(page);
+        if (!freePages.empty()) {
+            page = static_cast<int32_t>(freePages.back());
+            freePages.pop_back();
+        } else {
+            page = static_cast<int32_t>(numPages++);
+            values.resize(numPages * numChannels * PAGE_SIZE, 0.0f);
+            counts.resize(numPages * PAGE_SIZE, 0);
+            seen.resize(numPages * (PAGE_SIZE / 64), 0);
+        }
+        pageOf[docPage] = page;
+        touchedPages.push_back(docPage);
+        return static_cast<size_t>(page);
+    }
+};
+
+// Collections up to this many documents use Dense arrays (4 bytes per
+// document and channel), larger ones Paged
+constexpr uint32_t DEFAULT_DENSE_MAX_DOCS = 1u << 24;
+
+// The calling thread's accumulator, sized for numDocs and channels and
+// zeroed; reuse across queries keeps its arrays allocated
+template <typename Accumulator>
+Accumulator& threadLocal(uint32_t numDocs, uint32_t channels) {
+    thread_local Accumulator acc;
+    acc.reset();
+    acc.resize(numDocs, channels);
+    return acc;
+}
+
+}  // namespace accumulator
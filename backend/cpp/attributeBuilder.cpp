@@ -0,0 +1,250 @@
+/*
+ * Attribute Store Builder
+ *
+ * Writes the columnar attribute store (attributes.hpp) for filtered search
+ * and facets: publication year, journal, license and first author of every
+ * indexed document, taken from CORD-19 metadata.csv and keyed by docID
+ * (line number in forward_index.txt, as in the document store).
+ *
+ * metadata.csv is looked up by name (config "metadata_csv") anywhere under
+ * data_dir. Rows are matched to documents by pmcid; the first row of a
+ * PMC ID wins. Documents without a row, or with an empty field, get value 0
+ * (unknown), which no filter matches.
+ *
+ * Output (indexes/<attributes_dir>):
+ *   attributes.json, year.col/.bitmaps, journal.col/.bitmaps/.dict,
+ *   license.col/.bitmaps/.dict, author.col/.bitmaps/.dict
+ *
+ * Usage (from backend/cpp, after forwardIndex):
+ *   ./build/attributeBuilder
+ *   ./build/attributeBuilder --metadata /path/to/metadata.csv
+ */
+
+#include "config.hpp"
+#include "attributes.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+using namespace chrono;
+
+// Reads one CSV record (RFC 4180: quoted fields may hold commas, doubled
+// quotes and line breaks). Returns false at end of input.
+bool readCsvRecord(istream& in, vector<string>& fields) {
+    fields.clear();
+    string field;
+    bool quoted = false, any = false;
+    char c;
+    while (in.get(c)) {
+        any = true;
+        if (quoted) {
+            if (c == '"') {
+                if (in.peek() == '"') {
+                    field += '"';
+                    in.get();
+                } else {
+                    quoted = false;
+                }
+            } else {
+                field += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.push_back(std::move(field));
+            field.clear();
+        } else if (c == '\n') {
+            break;
+        } else if (c != '\r') {
+            field += c;
+        }
+    }
+    if (!any) return false;
+    fields.push_back(std::move(field));
+    return true;
+}
+
+string trim(const string& s) {
+    size_t start = s.find_first_not_of(" \t");
+    if (start == string::npos) return "";
+    size_t end = s.find_last_not_of(" \t");
+    return s.substr(start, end - start + 1);
+}
+
+// "2020-05-01" or "2020" -> 2020; 0 when there is no plausible year
+uint32_t parseYear(const string& publishTime) {
+    if (publishTime.size() < 4) return 0;
+    uint32_t year = 0;
+    for (int i = 0; i < 4; i++) {
+        if (!isdigit(static_cast<unsigned char>(publishTime[i]))) return 0;
+        year = year * 10 + (publishTime[i] - '0');
+    }
+    return (year >= 1000 && year <= 9999) ? year : 0;
+}
+
+// String attribute: dictionary codes assigned in order of first appearance
+struct StringAttribute {
+    vector<string> dict{""};  // code 0 = unknown
+    unordered_map<string, uint32_t> codes;
+    vector<uint32_t> values;
+
+    uint32_t code(const string& s) {
+        if (s.empty()) return 0;
+        auto [it, inserted] = codes.emplace(s, static_cast<uint32_t>(dict.size()));
+        if (inserted) dict.push_back(s);
+        return it->second;
+    }
+};
+
+fs::path findMetadataCsv(const fs::path& dataDir, const string& name) {
+    for (auto& p : fs::recursive_directory_iterator(dataDir)) {
+        if (p.is_regular_file() && p.path().filename() == name) {
+            return p.path();
+        }
+    }
+    throw runtime_error(name + " not found under " + dataDir.string());
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        cout << "======================================" << endl;
+        cout << "  ATTRIBUTE STORE BUILDER" << endl;
+        cout << "======================================\n" << endl;
+
+        // this file is in backend/cpp
+        fs::path backendDir = fs::current_path().parent_path();
+        json config = loadConfig(backendDir);
+
+        fs::path indexesDir = backendDir / config["indexes_dir"].get<string>();
+        fs::path forwardIndexPath = indexesDir / config["forward_index_file"].get<string>();
+        fs::path outDir = indexesDir / config.value("attributes_dir", "attributes");
+        fs::path metadataPath;
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            if (arg == "--metadata" && i + 1 < argc) {
+                metadataPath = argv[++i];
+            }
+        }
+        if (metadataPath.empty()) {
+            metadataPath = findMetadataCsv(backendDir / config["data_dir"].get<string>(),
+                                           config.value("metadata_csv", "metadata.csv"));
+        }
+
+        cout << "Configuration:" << endl;
+        cout << "  Metadata: " << metadataPath.string() << endl;
+        cout << "  Forward index: " << forwardIndexPath.string() << endl;
+        cout << "  Output: " << outDir.string() << "\n" << endl;
+
+        auto startTime = high_resolution_clock::now();
+
+        // docID = forward index line number
+        unordered_map<string, uint32_t> docIds;
+        size_t numDocs = 0;
+        {
+            ifstream in(forwardIndexPath);
+            if (!in.is_open()) {
+                throw runtime_error("Cannot open forward index at " + forwardIndexPath.string());
+            }
+            string line;
+            while (getline(in, line)) {
+                docIds.emplace(line.substr(0, line.find('|')), static_cast<uint32_t>(numDocs++));
+            }
+        }
+        cout << "Documents: " << numDocs << endl;
+
+        ifstream csv(metadataPath, ios::binary);
+        if (!csv.is_open()) {
+            throw runtime_error("Cannot open " + metadataPath.string());
+        }
+        vector<string> fields;
+        if (!readCsvRecord(csv, fields)) {
+            throw runtime_error(metadataPath.string() + " is empty");
+        }
+        auto column = [&](const string& name) {
+            auto it = find(fields.begin(), fields.end(), name);
+            if (it == fields.end()) {
+                throw runtime_error(metadataPath.string() + " has no '" + name + "' column");
+            }
+            return static_cast<size_t>(it - fields.begin());
+        };
+        const size_t pmcCol = column("pmcid");
+        const size_t timeCol = column("publish_time");
+        const size_t journalCol = column("journal");
+        const size_t licenseCol = column("license");
+        const size_t authorsCol = column("authors");
+        const size_t minFields = max({pmcCol, timeCol, journalCol, licenseCol, authorsCol}) + 1;
+
+        vector<uint32_t> years(numDocs, 0);
+        StringAttribute journals, licenses, authors;
+        journals.values.assign(numDocs, 0);
+        licenses.values.assign(numDocs, 0);
+        authors.values.assign(numDocs, 0);
+        vector<bool> seen(numDocs, false);
+
+        size_t rows = 0, matched = 0;
+        while (readCsvRecord(csv, fields)) {
+            rows++;
+            if (fields.size() < minFields) continue;
+            auto it = docIds.find(trim(fields[pmcCol]));
+            if (it == docIds.end() || seen[it->second]) continue;
+
+            uint32_t docId = it->second;
+            seen[docId] = true;
+            matched++;
+            years[docId] = parseYear(trim(fields[timeCol]));
+            journals.values[docId] = journals.code(trim(fields[journalCol]));
+            licenses.values[docId] = licenses.code(trim(fields[licenseCol]));
+            // "Last, First; Last, First; ..." -> first author
+            const string& names = fields[authorsCol];
+            authors.values[docId] = authors.code(trim(names.substr(0, names.find(';'))));
+        }
+        cout << "Metadata rows: " << rows << ", matched to documents: " << matched << endl;
+
+        // Write columns, value indexes and dictionaries
+        fs::create_directories(outDir);
+        json manifest;
+        manifest["num_docs"] = numDocs;
+        manifest["attributes"] = json::array();
+
+        auto writeAttribute = [&](const string& name, const vector<uint32_t>& values, const vector<string>* dict) {
+            uint32_t maxValue = values.empty() ? 0 : *max_element(values.begin(), values.end());
+            uint32_t width = attributes::widthFor(maxValue);
+            attributes::writeColumn(outDir / (name + ".col"), values, width);
+            attributes::writeValueIndex(outDir / (name + ".bitmaps"), values);
+            if (dict) attributes::writeDictionary(outDir / (name + ".dict"), *dict);
+            manifest["attributes"].push_back({{"name", name}, {"width", width}, {"max", maxValue}, {"dict", dict != nullptr}});
+
+            size_t known = count_if(values.begin(), values.end(), [](uint32_t v) { return v != 0; });
+            cout << "  " << name << ": " << known << " known";
+            if (dict) cout << ", " << dict->size() - 1 << " distinct values";
+            cout << " (" << width << " byte" << (width > 1 ? "s" : "") << " per document)" << endl;
+        };
+        cout << "\nAttributes:" << endl;
+        writeAttribute("year", years, nullptr);
+        writeAttribute("journal", journals.values, &journals.dict);
+        writeAttribute("license", licenses.values, &licenses.dict);
+        writeAttribute("author", authors.values, &authors.dict);
+
+        ofstream manifestFile(outDir / "attributes.json");
+        if (!manifestFile.is_open()) {
+            throw runtime_error("Cannot create " + (outDir / "attributes.json").string());
+        }
+        manifestFile << manifest.dump(2) << endl;
+
+        auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - startTime).count();
+        cout << "\n=== Attribute Store Complete ===" << endl;
+        cout << "Time: " << duration << "ms" << endl;
+
+    } catch (exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
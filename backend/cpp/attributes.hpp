@@ -0,0 +1,388 @@
+#pragma once
+
+/*
+ * Document Attributes
+ *
+ * Per-document metadata (publication year, journal, license) from CORD-19
+ * metadata.csv, written by attributeBuilder into indexes/attributes/ and used
+ * by search to filter results (--year, --journal, --license). Documents are
+ * addressed by docID, their line number in forward_index.txt, as in the
+ * document store.
+ *
+ * Each attribute is stored twice:
+ * - a column: one fixed-width value per docID, memory-mapped, so checking a
+ *   document is one array load
+ * - a value index: one roaring bitmap of docIDs per distinct value, in value
+ *   order, so a year range or a set of journals is the union of a few
+ *   bitmaps and its size is known before any posting is read
+ * A Filter intersects the bitmaps of its selective conditions and checks the
+ * remaining conditions on the columns.
+ *
+ * Values are integers: the year itself, or for string attributes a code into
+ * <name>.dict. Value 0 means unknown and never matches a condition.
+ *
+ * Files (little-endian):
+ *   attributes.json  {"num_docs": N, "attributes": [{"name", "width", "max", "dict"}, ...]}
+ *   <name>.col       [magic:8 "MGCOL001"][numDocs:8][width:4][reserved:4]
+ *                    then numDocs values of width bytes (1, 2 or 4) and 4
+ *                    zero bytes, so a 4-byte load at any value stays in the file
+ *   <name>.bitmaps   [numValues:4] then per value, ascending:
+ *                    [value:4][cardinality:4][bitmap (roaring.hpp layout)]
+ *   <name>.dict      one string per line, line i = code i (line 0 empty)
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+#include "roaring.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MINIGOOGLE_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace attributes {
+
+constexpr char COLUMN_MAGIC[8] = {'M', 'G', 'C', 'O', 'L', '0', '0', '1'};
+constexpr size_t COLUMN_HEADER_SIZE = 24;
+constexpr size_t COLUMN_PADDING = 4;
+
+// A condition matching at most this fraction of the collection goes through
+// the bitmaps; broader ones are cheaper to check on the column
+constexpr uint64_t SELECTIVE_DIVISOR = 16;
+
+// Smallest width (1, 2 or 4 bytes) that holds maxValue
+inline uint32_t widthFor(uint32_t maxValue) {
+    return maxValue <= 0xFF ? 1 : (maxValue <= 0xFFFF ? 2 : 4);
+}
+
+// ---------------------- Writing ----------------------
+
+inline void writeColumn(const fs::path& path, const std::vector<uint32_t>& values, uint32_t width) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot create " + path.string());
+    }
+    uint64_t numDocs = values.size();
+    uint32_t reserved = 0;
+    out.write(COLUMN_MAGIC, sizeof(COLUMN_MAGIC));
+    out.write(reinterpret_cast<const char*>(&numDocs), sizeof(numDocs));
+    out.write(reinterpret_cast<const char*>(&width), sizeof(width));
+    out.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+    for (uint32_t v : values) {
+        out.write(reinterpret_cast<const char*>(&v), width);  // low bytes, little-endian
+    }
+    out.write(reinterpret_cast<const char*>(&reserved), COLUMN_PADDING);
+}
+
+// One bitmap per distinct non-zero value
+inline void writeValueIndex(const fs::path& path, const std::vector<uint32_t>& values) {
+    std::map<uint32_t, std::vector<uint32_t>> docsByValue;
+    for (uint32_t docId = 0; docId < values.size(); docId++) {
+        if (values[docId] != 0) docsByValue[values[docId]].push_back(docId);
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot create " + path.string());
+    }
+    uint32_t numValues = static_cast<uint32_t>(docsByValue.size());
+    out.write(reinterpret_cast<const char*>(&numValues), sizeof(numValues));
+    for (const auto& [value, docs] : docsByValue) {
+        uint32_t cardinality = static_cast<uint32_t>(docs.size());
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        out.write(reinterpret_cast<const char*>(&cardinality), sizeof(cardinality));
+        roaring::Bitmap::fromSorted(docs).write(out);
+    }
+}
+
+inline void writeDictionary(const fs::path& path, const std::vector<std::string>& strings) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot create " + path.string());
+    }
+    for (const auto& s : strings) out << s << "\n";
+}
+
+// ---------------------- Reading ----------------------
+
+// A read-only column, mapped into memory where the platform allows it
+class Column {
+public:
+    explicit Column(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) {
+            throw std::runtime_error("Cannot open attribute column " + path.string());
+        }
+        char magic[8];
+        uint32_t reserved = 0;
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char*>(&numDocs), sizeof(numDocs));
+        in.read(reinterpret_cast<char*>(&width), sizeof(width));
+        in.read(reinterpret_cast<char*>(&reserved), sizeof(reserved));
+        if (!in || std::memcmp(magic, COLUMN_MAGIC, sizeof(magic)) != 0 ||
+            (width != 1 && width != 2 && width != 4)) {
+            throw std::runtime_error("Not an attribute column: " + path.string());
+        }
+        size_t bytes = COLUMN_HEADER_SIZE + numDocs * width + COLUMN_PADDING;
+        if (fs::file_size(path) < bytes) {
+            throw std::runtime_error("Attribute column is truncated: " + path.string());
+        }
+
+#ifdef MINIGOOGLE_HAVE_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            void* p = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (p != MAP_FAILED) {
+                mapped = p;
+                mappedSize = bytes;
+                values = static_cast<const uint8_t*>(p) + COLUMN_HEADER_SIZE;
+                return;
+            }
+        }
+#endif
+        copy.resize(numDocs * width + COLUMN_PADDING);
+        in.read(reinterpret_cast<char*>(copy.data()), copy.size());
+        if (!in) {
+            throw std::runtime_error("Attribute column is truncated: " + path.string());
+        }
+        values = copy.data();
+    }
+
+    ~Column() {
+#ifdef MINIGOOGLE_HAVE_MMAP
+        if (mapped) ::munmap(mapped, mappedSize);
+#endif
+    }
+
+    Column(const Column&) = delete;
+    Column& operator=(const Column&) = delete;
+
+    uint64_t size() const { return numDocs; }
+    uint32_t bytesPerValue() const { return width; }
+
+    // The packed values, followed by COLUMN_PADDING readable bytes
+    const uint8_t* data() const { return values; }
+
+    uint32_t get(uint32_t docId) const {
+        if (docId >= numDocs) return 0;
+        switch (width) {
+            case 1: return values[docId];
+            case 2: {
+                uint16_t v;
+                std::memcpy(&v, values + docId * 2, sizeof(v));
+                return v;
+            }
+            default: {
+                uint32_t v;
+                std::memcpy(&v, values + docId * 4, sizeof(v));
+                return v;
+            }
+        }
+    }
+
+private:
+    uint64_t numDocs = 0;
+    uint32_t width = 0;
+    const uint8_t* values = nullptr;
+    void* mapped = nullptr;
+    size_t mappedSize = 0;
+    std::vector<uint8_t> copy;
+};
+
+struct Attribute {
+    std::string name;
+    uint32_t maxValue = 0;
+    std::vector<std::string> dict;  // code -> string; empty for numeric attributes
+    std::unique_ptr<Column> column;
+};
+
+// The attribute directory: manifest, dictionaries and columns. Value indexes
+// are read per condition, only for the attributes a query filters on.
+class Store {
+public:
+    explicit Store(const fs::path& dir) : dir(dir) {
+        std::ifstream manifestFile(dir / "attributes.json");
+        if (!manifestFile.is_open()) {
+            throw std::runtime_error("No attribute store at " + dir.string() + " (run attributeBuilder)");
+        }
+        json manifest;
+        manifestFile >> manifest;
+        numDocs = manifest.value("num_docs", uint64_t(0));
+
+        for (const auto& entry : manifest["attributes"]) {
+            Attribute attr;
+            attr.name = entry["name"].get<std::string>();
+            attr.column = std::make_unique<Column>(dir / (attr.name + ".col"));
+            uint32_t width = entry.value("width", uint32_t(4));
+            attr.maxValue = entry.value("max", width >= 4 ? 0xFFFFFFFFu : (1u << (8 * width)) - 1);
+            if (entry.value("dict", false)) {
+                std::ifstream dictFile(dir / (attr.name + ".dict"));
+                std::string line;
+                while (std::getline(dictFile, line)) attr.dict.push_back(line);
+            }
+            attrs.push_back(std::move(attr));
+        }
+    }
+
+    uint64_t size() const { return numDocs; }
+
+    const Attribute* find(const std::string& name) const {
+        for (const auto& a : attrs) {
+            if (a.name == name) return &a;
+        }
+        return nullptr;
+    }
+
+    // Union of the bitmaps of the values in [lo, hi]; countOut gets its size
+    roaring::Bitmap valueRange(const std::string& name, uint32_t lo, uint32_t hi, uint64_t& countOut) const {
+        return readValues(name, [&](uint32_t v) { return v >= lo && v <= hi; }, countOut);
+    }
+
+    // Union of the bitmaps of the given codes
+    roaring::Bitmap valueSet(const std::string& name, const std::vector<uint32_t>& codes, uint64_t& countOut) const {
+        return readValues(name, [&](uint32_t v) { return std::find(codes.begin(), codes.end(), v) != codes.end(); },
+                          countOut);
+    }
+
+private:
+    template <typename Match>
+    roaring::Bitmap readValues(const std::string& name, Match match, uint64_t& countOut) const {
+        std::ifstream in(dir / (name + ".bitmaps"), std::ios::binary);
+        if (!in.is_open()) {
+            throw std::runtime_error("Cannot open value index for attribute '" + name + "'");
+        }
+        roaring::Bitmap result;
+        countOut = 0;
+        uint32_t numValues = 0;
+        in.read(reinterpret_cast<char*>(&numValues), sizeof(numValues));
+        for (uint32_t i = 0; i < numValues && in; i++) {
+            uint32_t value = 0, cardinality = 0;
+            in.read(reinterpret_cast<char*>(&value), sizeof(value));
+            in.read(reinterpret_cast<char*>(&cardinality), sizeof(cardinality));
+            roaring::Bitmap docs;
+            docs.read(in);
+            if (match(value)) {
+                result = roaring::unite(result, docs);
+                countOut += cardinality;
+            }
+        }
+        return result;
+    }
+
+    fs::path dir;
+    uint64_t numDocs = 0;
+    std::vector<Attribute> attrs;
+};
+
+// ---------------------- Filters ----------------------
+
+// Codes of the dictionary strings equal to value, ignoring case
+inline std::vector<uint32_t> lookupCodes(const Attribute& attr, const std::string& value) {
+    auto lower = [](std::string s) {
+        std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+        return s;
+    };
+    std::string key = lower(value);
+    std::vector<uint32_t> codes;
+    for (uint32_t code = 1; code < attr.dict.size(); code++) {
+        if (lower(attr.dict[code]) == key) codes.push_back(code);
+    }
+    return codes;
+}
+
+// A conjunction of attribute conditions, each a value range or a value set
+class Filter {
+public:
+    bool active() const { return !conditions.empty(); }
+
+    // Documents matching every condition (exact when all conditions went
+    // through the bitmaps, otherwise an upper bound)
+    uint64_t estimate() const { return bound; }
+
+    const std::string& description() const { return text; }
+
+    void addRange(const Store& store, const std::string& name, uint32_t lo, uint32_t hi) {
+        const Attribute& attr = require(store, name);
+        uint64_t count = 0;
+        roaring::Bitmap docs = store.valueRange(name, lo, hi, count);
+        add(store, attr, std::move(docs), count, [lo, hi](uint32_t v) { return v >= lo && v <= hi; },
+            name + " " + std::to_string(lo) + (lo == hi ? "" : "-" + std::to_string(hi)));
+    }
+
+    void addValues(const Store& store, const std::string& name, const std::vector<std::string>& values) {
+        const Attribute& attr = require(store, name);
+        std::vector<uint32_t> codes;
+        std::string label;
+        for (const auto& value : values) {
+            for (uint32_t code : lookupCodes(attr, value)) codes.push_back(code);
+            label += (label.empty() ? "" : ", ") + ("'" + value + "'");
+        }
+        uint64_t count = 0;
+        roaring::Bitmap docs = store.valueSet(name, codes, count);
+        add(store, attr, std::move(docs), count,
+            [codes](uint32_t v) { return std::find(codes.begin(), codes.end(), v) != codes.end(); },
+            name + " " + label);
+    }
+
+    bool accepts(uint32_t docId) const {
+        if (useBitmap && !selected.contains(docId)) return false;
+        for (const auto& c : columnChecks) {
+            if (!c.match(c.column->get(docId))) return false;
+        }
+        return true;
+    }
+
+private:
+    struct ColumnCheck {
+        const Column* column;
+        std::function<bool(uint32_t)> match;
+    };
+
+    static const Attribute& require(const Store& store, const std::string& name) {
+        const Attribute* attr = store.find(name);
+        if (attr == nullptr) {
+            throw std::runtime_error("Attribute store has no '" + name + "' attribute");
+        }
+        return *attr;
+    }
+
+    void add(const Store& store, const Attribute& attr, roaring::Bitmap docs, uint64_t count,
+             std::function<bool(uint32_t)> match, const std::string& label) {
+        if (conditions.empty()) bound = store.size();
+        conditions.push_back(label);
+        text += (text.empty() ? "" : ", ") + label;
+
+        if (count * SELECTIVE_DIVISOR <= store.size()) {
+            selected = useBitmap ? roaring::intersect(selected, docs) : std::move(docs);
+            useBitmap = true;
+            bound = std::min<uint64_t>(bound, selected.cardinality());
+        } else {
+            columnChecks.push_back({attr.column.get(), std::move(match)});
+            bound = std::min(bound, count);
+        }
+    }
+
+    std::vector<std::string> conditions;
+    std::string text;
+    uint64_t bound = 0;
+    bool useBitmap = false;
+    roaring::Bitmap selected;  // docIDs passing every selective condition
+    std::vector<ColumnCheck> columnChecks;
+};
+
+}  // namespace attributes
@@ -9,18 +9,49 @@
  * - barrel_X.idx: Offset index (lemmaId -> offset, length)
  *
  * Posting entry format in .bin file:
- * [lemmaId:4bytes][df:4bytes][numDocs:4bytes][doc1_id_len:2bytes][doc1_id:var][doc1_tf:4bytes]...
+ * [lemmaId:4bytes][df:4bytes][numDocs:4bytes][doc1_id:20bytes][doc1_tf:4bytes]...
+ * Postings are sorted by doc ID (bytewise over the NUL-padded 20 bytes);
+ * layout.json records this so search knows it may merge and gallop over
+ * the raw records.
+ *
+ * Tier-1 index (tier1.bin / tier1.idx, same idx format):
+ * A statically pruned copy of the long posting lists: every term with more
+ * than tier1_postings_per_term postings keeps only that many, those with the
+ * highest tf (ties at the cut are all kept), highest tf first. Shorter lists
+ * are not copied; they are cheap to read from their barrel. search answers
+ * from tier 1 when it can prove the top-K is unchanged and otherwise falls
+ * back to the full barrels.
+ * [lemmaId:4][df:4][numKept:4][cutTf:4][postings...]
+ *   df      full-list document frequency
+ *   cutTf   largest tf among the postings left out
+ *
+ * Roaring index (roaring.bin / roaring.idx, same idx format):
+ * Terms with df >= roaring_min_df are also stored as a roaring bitmap of
+ * document ordinals (see roaring.hpp) with their tfs in a parallel array in
+ * ordinal order. A document's ordinal is its docID (forward_index.txt line
+ * number), so a docID order that clusters similar documents (reorderDocs)
+ * gives denser, smaller bitmaps; documents missing from the forward index
+ * are numbered after it. search intersects and unions these instead of hashing tens
+ * of thousands of doc ID strings per term. The barrel records are kept as
+ * they are, since search_semantic and the Python indexer read them directly.
+ * [lemmaId:4][df:4][numDocs:4][bitmap][numDocs x tf:2 (saturated at 65535)]
+ * roaring_docs.bin maps ordinals back to doc IDs:
+ * [numDocs:4][numDocs x docId:20]
  */
 
 #include "config.hpp"
+#include "roaring.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <chrono>
 #include <cstring>
+#include <algorithm>
+#include <memory>
 
 using namespace std;
 using namespace chrono;
@@ -33,16 +64,206 @@ struct BinaryPosting {
     int32_t tf;
 };
 
+// Writes the pruned tier-1 index alongside the barrels
+class Tier1Writer {
+private:
+    int postingsPerTerm;
+    ofstream binFile;
+    ofstream idxFile;
+    int32_t numEntries = 0;
+    int64_t keptPostings = 0;
+    int64_t totalPostings = 0;
+
+public:
+    Tier1Writer(const fs::path& dir, int postingsPerTerm)
+        : postingsPerTerm(postingsPerTerm),
+          binFile(dir / "tier1.bin", ios::binary),
+          idxFile(dir / "tier1.idx", ios::binary) {
+        if (!binFile.is_open() || !idxFile.is_open()) {
+            throw runtime_error("Cannot create tier-1 files in " + dir.string());
+        }
+        idxFile.write(reinterpret_cast<char*>(&numEntries), sizeof(numEntries));  // patched in finish()
+    }
+
+    // Writes the term's pruned list if it has more than postingsPerTerm postings
+    void addTerm(int32_t lemmaId, int32_t df, vector<BinaryPosting>& postings) {
+        totalPostings += postings.size();
+        if (postings.size() <= static_cast<size_t>(postingsPerTerm)) {
+            return;
+        }
+
+        stable_sort(postings.begin(), postings.end(),
+                    [](const BinaryPosting& a, const BinaryPosting& b) { return a.tf > b.tf; });
+
+        size_t keep = postingsPerTerm;
+        while (keep < postings.size() && postings[keep].tf == postings[keep - 1].tf) {
+            keep++;  // never split a tf tie across the cut
+        }
+        if (keep == postings.size()) {
+            return;  // one tf tie spans the whole tail: nothing to prune
+        }
+        int32_t cutTf = postings[keep].tf;
+        keptPostings += keep;
+
+        int64_t offset = binFile.tellp();
+        int32_t numKept = static_cast<int32_t>(keep);
+        binFile.write(reinterpret_cast<char*>(&lemmaId), sizeof(lemmaId));
+        binFile.write(reinterpret_cast<char*>(&df), sizeof(df));
+        binFile.write(reinterpret_cast<char*>(&numKept), sizeof(numKept));
+        binFile.write(reinterpret_cast<char*>(&cutTf), sizeof(cutTf));
+        binFile.write(reinterpret_cast<const char*>(postings.data()), keep * sizeof(BinaryPosting));
+        int64_t length = static_cast<int64_t>(binFile.tellp()) - offset;
+
+        idxFile.write(reinterpret_cast<char*>(&lemmaId), sizeof(lemmaId));
+        idxFile.write(reinterpret_cast<char*>(&offset), sizeof(offset));
+        idxFile.write(reinterpret_cast<char*>(&length), sizeof(length));
+        numEntries++;
+    }
+
+    void finish(const fs::path& dir) {
+        idxFile.seekp(0);
+        idxFile.write(reinterpret_cast<char*>(&numEntries), sizeof(numEntries));
+        idxFile.close();
+        binFile.close();
+
+        double binSize = fs::file_size(dir / "tier1.bin") / 1024.0 / 1024.0;
+        double keptPct = totalPostings > 0 ? 100.0 * keptPostings / totalPostings : 0.0;
+        cout << "Tier 1: " << numEntries << " lists pruned to ~" << postingsPerTerm << " postings, "
+             << keptPostings << " of " << totalPostings << " postings (" << keptPct << "%), "
+             << binSize << "MB" << endl;
+    }
+};
+
+// Writes the roaring-bitmap copy of the densest terms. Document ordinals are
+// handed out in order of first appearance, so only documents that occur in
+// some bitmap term get one.
+class RoaringWriter {
+private:
+    int minDf;
+    ofstream binFile;
+    ofstream idxFile;
+    int32_t numEntries = 0;
+    int64_t bitmapPostings = 0;
+    unordered_map<string, uint32_t> ordinals;
+    vector<string> docIds;
+
+public:
+    RoaringWriter(const fs::path& dir, int minDf, const fs::path& forwardIndexPath)
+        : minDf(minDf),
+          binFile(dir / "roaring.bin", ios::binary),
+          idxFile(dir / "roaring.idx", ios::binary) {
+        if (!binFile.is_open() || !idxFile.is_open()) {
+            throw runtime_error("Cannot create roaring files in " + dir.string());
+        }
+        idxFile.write(reinterpret_cast<char*>(&numEntries), sizeof(numEntries));  // patched in finish()
+
+        // Ordinal = docID
+        ifstream forward(forwardIndexPath);
+        string line;
+        while (getline(forward, line)) {
+            string docId = line.substr(0, line.find('|'));
+            if (ordinals.emplace(docId, static_cast<uint32_t>(docIds.size())).second) {
+                docIds.push_back(docId);
+            }
+        }
+    }
+
+    void addTerm(int32_t lemmaId, int32_t df, const vector<BinaryPosting>& postings) {
+        if (df < minDf || postings.empty()) {
+            return;
+        }
+
+        vector<pair<uint32_t, int32_t>> byOrdinal;
+        byOrdinal.reserve(postings.size());
+        for (const auto& p : postings) {
+            string docId(p.doc_id, find(p.doc_id, p.doc_id + DOC_ID_SIZE, '\0'));
+            auto [it, inserted] = ordinals.emplace(docId, static_cast<uint32_t>(docIds.size()));
+            if (inserted) {
+                docIds.push_back(docId);
+            }
+            byOrdinal.push_back({it->second, p.tf});
+        }
+        sort(byOrdinal.begin(), byOrdinal.end());
+        byOrdinal.erase(unique(byOrdinal.begin(), byOrdinal.end(),
+                               [](const auto& a, const auto& b) { return a.first == b.first; }),
+                        byOrdinal.end());
+
+        vector<uint32_t> members;
+        vector<uint16_t> tfs;
+        members.reserve(byOrdinal.size());
+        tfs.reserve(byOrdinal.size());
+        for (const auto& [ordinal, tf] : byOrdinal) {
+            members.push_back(ordinal);
+            tfs.push_back(static_cast<uint16_t>(min(tf, 65535)));
+        }
+
+        int64_t offset = binFile.tellp();
+        int32_t numDocs = static_cast<int32_t>(members.size());
+        binFile.write(reinterpret_cast<char*>(&lemmaId), sizeof(lemmaId));
+        binFile.write(reinterpret_cast<char*>(&df), sizeof(df));
+        binFile.write(reinterpret_cast<char*>(&numDocs), sizeof(numDocs));
+        roaring::Bitmap::fromSorted(members).write(binFile);
+        binFile.write(reinterpret_cast<const char*>(tfs.data()), tfs.size() * sizeof(uint16_t));
+        int64_t length = static_cast<int64_t>(binFile.tellp()) - offset;
+
+        idxFile.write(reinterpret_cast<char*>(&lemmaId), sizeof(lemmaId));
+        idxFile.write(reinterpret_cast<char*>(&offset), sizeof(offset));
+        idxFile.write(reinterpret_cast<char*>(&length), sizeof(length));
+        numEntries++;
+        bitmapPostings += numDocs;
+    }
+
+    void finish(const fs::path& dir) {
+        idxFile.seekp(0);
+        idxFile.write(reinterpret_cast<char*>(&numEntries), sizeof(numEntries));
+        idxFile.close();
+        binFile.close();
+
+        ofstream docsFile(dir / "roaring_docs.bin", ios::binary);
+        int32_t numDocs = static_cast<int32_t>(docIds.size());
+        docsFile.write(reinterpret_cast<char*>(&numDocs), sizeof(numDocs));
+        for (const auto& id : docIds) {
+            char buf[DOC_ID_SIZE] = {};
+            strncpy(buf, id.c_str(), DOC_ID_SIZE - 1);
+            docsFile.write(buf, DOC_ID_SIZE);
+        }
+        docsFile.close();
+
+        double binSize = fs::file_size(dir / "roaring.bin") / 1024.0 / 1024.0;
+        double arraySize = bitmapPostings * sizeof(BinaryPosting) / 1024.0 / 1024.0;
+        cout << "Roaring: " << numEntries << " terms with df >= " << minDf << ", "
+             << bitmapPostings << " postings in " << binSize << "MB (" << arraySize
+             << "MB as posting arrays), " << numDocs << " document ordinals" << endl;
+    }
+};
+
 class BinaryBarrelConverter {
 private:
     int numBarrels;
     fs::path inputDir;
     fs::path outputDir;
+    unique_ptr<Tier1Writer> tier1;
+    unique_ptr<RoaringWriter> roaringWriter;
+    unordered_set<string> allDocs;  // distinct doc IDs, for layout.json
 
 public:
-    BinaryBarrelConverter(int numBarrels, fs::path inDir, fs::path outDir)
+    BinaryBarrelConverter(int numBarrels, fs::path inDir, fs::path outDir, int tier1PostingsPerTerm,
+                          int roaringMinDf, const fs::path& forwardIndexPath)
         : numBarrels(numBarrels), inputDir(inDir), outputDir(outDir) {
         fs::create_directories(outputDir);
+        if (tier1PostingsPerTerm > 0) {
+            tier1 = make_unique<Tier1Writer>(outputDir, tier1PostingsPerTerm);
+        } else {
+            fs::remove(outputDir / "tier1.bin");
+            fs::remove(outputDir / "tier1.idx");
+        }
+        if (roaringMinDf > 0) {
+            roaringWriter = make_unique<RoaringWriter>(outputDir, roaringMinDf, forwardIndexPath);
+        } else {
+            fs::remove(outputDir / "roaring.bin");
+            fs::remove(outputDir / "roaring.idx");
+            fs::remove(outputDir / "roaring_docs.bin");
+        }
     }
 
     void convertAllBarrels() {
@@ -54,6 +275,21 @@ public:
             convertBarrel(i);
         }
 
+        if (tier1) {
+            cout << endl;
+            tier1->finish(outputDir);
+        }
+        if (roaringWriter) {
+            roaringWriter->finish(outputDir);
+        }
+
+        // What the query planner may assume about these files
+        json layout;
+        layout["postings_sorted_by_doc_id"] = true;
+        layout["num_barrels"] = numBarrels;
+        layout["num_docs"] = allDocs.size();
+        ofstream(outputDir / "layout.json") << layout.dump(4) << endl;
+
         auto endTime = high_resolution_clock::now();
         auto duration = duration_cast<seconds>(endTime - startTime).count();
 
@@ -116,16 +352,28 @@ public:
             binFile.write(reinterpret_cast<char*>(&df), sizeof(df));
             binFile.write(reinterpret_cast<char*>(&numDocs), sizeof(numDocs));
 
-            // Write each posting
+            // Postings are written in doc ID order so query-time merges and
+            // galloping searches can work on the raw records (see layout.json)
+            vector<BinaryPosting> termPostings;
+            termPostings.reserve(numDocs);
             for (const auto& doc : docs) {
                 BinaryPosting bp;
                 memset(bp.doc_id, 0, DOC_ID_SIZE);
                 string docId = doc["doc_id"].get<string>();
                 strncpy(bp.doc_id, docId.c_str(), DOC_ID_SIZE - 1);
                 bp.tf = doc["tf"].get<int>();
+                termPostings.push_back(bp);
+                allDocs.insert(docId);
+            }
+            sort(termPostings.begin(), termPostings.end(),
+                 [](const BinaryPosting& a, const BinaryPosting& b) { return memcmp(a.doc_id, b.doc_id, DOC_ID_SIZE) < 0; });
+            binFile.write(reinterpret_cast<const char*>(termPostings.data()), termPostings.size() * sizeof(BinaryPosting));
 
-                binFile.write(bp.doc_id, DOC_ID_SIZE);
-                binFile.write(reinterpret_cast<char*>(&bp.tf), sizeof(bp.tf));
+            if (roaringWriter) {
+                roaringWriter->addTerm(lemmaId, df, termPostings);
+            }
+            if (tier1) {
+                tier1->addTerm(lemmaId, df, termPostings);
             }
 
             // Calculate length
@@ -202,16 +450,22 @@ int main(int argc, char* argv[]) {
         fs::path indexesDir = backendDir / config["indexes_dir"].get<string>();
         fs::path jsonBarrelsDir = indexesDir / config["barrels_dir"].get<string>();
         fs::path binaryBarrelsDir = indexesDir / "barrels_binary";
+        fs::path forwardIndexPath = indexesDir / config["forward_index_file"].get<string>();
 
         const int numBarrels = 10;
+        int tier1PostingsPerTerm = config.value("tier1_postings_per_term", 1000);
+        int roaringMinDf = config.value("roaring_min_df", 4096);
 
         cout << "Configuration:" << endl;
         cout << "  Input (JSON barrels): " << jsonBarrelsDir.string() << endl;
         cout << "  Output (Binary barrels): " << binaryBarrelsDir.string() << endl;
-        cout << "  Number of barrels: " << numBarrels << "\n" << endl;
+        cout << "  Number of barrels: " << numBarrels << endl;
+        cout << "  Tier-1 postings per term: " << tier1PostingsPerTerm << " (0 = no tier 1)" << endl;
+        cout << "  Roaring bitmaps for df >= " << roaringMinDf << " (0 = none)\n" << endl;
 
         // Convert barrels
-        BinaryBarrelConverter converter(numBarrels, jsonBarrelsDir, binaryBarrelsDir);
+        BinaryBarrelConverter converter(numBarrels, jsonBarrelsDir, binaryBarrelsDir, tier1PostingsPerTerm, roaringMinDf,
+                                        forwardIndexPath);
         converter.convertAllBarrels();
 
         cout << "\n======================================" << endl;
@@ -0,0 +1,560 @@
+#pragma once
+
+/*
+ * Boolean Query Language
+ *
+ * Parses queries such as
+ *
+ *   covid AND (vaccine OR "booster dose") -influenza title:lung
+ *
+ * and compiles them into a tree of lazy posting cursors.
+ *
+ * Syntax, loosest binding first:
+ *   a OR b             either side
+ *   a AND b, a b       both sides (adjacent terms are ANDed)
+ *   NOT a, -a          exclude; only allowed beside a positive term in an AND
+ *   ( ... )            grouping
+ *   title:x, abstract:x   x (a word, phrase or group) must occur in that field
+ *   "a b c"            the words in this order, next to each other
+ * Operators are upper case; "and"/"or" in lower case are ordinary words.
+ * Words go through the same tokenizer as documents, so a word it splits
+ * ("covid-19") becomes a phrase and a word it drops entirely is ignored.
+ *
+ * Every cursor walks documents in doc ID order and supports next() and
+ * advance(docId) (first document >= docId). AND leapfrogs its children from
+ * the rarest one, OR keeps the smallest current document, NOT skips the
+ * documents its excluded side lands on, and phrase/field conditions filter
+ * the documents their terms' cursors agree on. No intermediate result set is
+ * built: the root is iterated once and each document it stops on is a match.
+ *
+ * Leaf lists are raw barrel records ([docId:20][tf:4], doc ID order) owned
+ * by the caller, which also supplies the phrase/field check (see search.cpp).
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace boolean_query {
+
+constexpr std::size_t ID_SIZE = 20;       // doc ID field of a barrel record
+constexpr std::size_t RECORD_SIZE = 24;   // [docId:20][tf:4]
+
+inline int compareIds(const char* a, const char* b) {
+    return std::memcmp(a, b, ID_SIZE);
+}
+
+// ---------------------- Syntax Tree ----------------------
+
+enum class Field { Any, Title, Abstract };
+
+inline const char* fieldName(Field f) {
+    switch (f) {
+        case Field::Any:      return "any field";
+        case Field::Title:    return "title";
+        case Field::Abstract: return "abstract";
+    }
+    return "?";
+}
+
+struct Node {
+    enum Kind { Empty, Term, Phrase, And, Or, Not } kind = Empty;
+    Field field = Field::Any;
+    std::vector<std::string> words;  // Term: one word, Phrase: two or more
+    std::vector<Node> children;      // And/Or: operands, Not: the excluded node
+};
+
+class ParseError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// ---------------------- Parser ----------------------
+
+class Parser {
+public:
+    using Tokenize = std::function<std::vector<std::string>(const std::string&)>;
+
+    explicit Parser(Tokenize tokenize) : tokenize(std::move(tokenize)) {}
+
+    // True if the query uses any operator, so plain word lists keep the
+    // --and/--or behaviour
+    static bool hasOperators(const std::string& query) {
+        try {
+            for (const auto& tok : lex(query)) {
+                if (tok.kind != Tok::Word) return true;
+            }
+        } catch (const ParseError&) {
+            return true;  // let parse() report it
+        }
+        return false;
+    }
+
+    Node parse(const std::string& query) {
+        toks = lex(query);
+        pos = 0;
+        Node root = parseOr();
+        if (pos < toks.size()) {
+            throw ParseError("unexpected " + describe(toks[pos]));
+        }
+        root = simplify(std::move(root));
+        if (root.kind == Node::Empty) {
+            throw ParseError("no searchable words");
+        }
+        validate(root, false);
+        return root;
+    }
+
+private:
+    struct Tok {
+        enum Kind { Word, Phrase, LParen, RParen, And, Or, Not, Minus, Field } kind;
+        std::string text;
+    };
+
+    Tokenize tokenize;
+    std::vector<Tok> toks;
+    std::size_t pos = 0;
+
+    static std::vector<Tok> lex(const std::string& s) {
+        std::vector<Tok> out;
+        std::size_t i = 0;
+        while (i < s.size()) {
+            char c = s[i];
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                i++;
+            } else if (c == '(' || c == ')') {
+                out.push_back({c == '(' ? Tok::LParen : Tok::RParen, ""});
+                i++;
+            } else if (c == '"') {
+                std::size_t end = s.find('"', i + 1);
+                if (end == std::string::npos) {
+                    throw ParseError("unterminated phrase");
+                }
+                out.push_back({Tok::Phrase, s.substr(i + 1, end - i - 1)});
+                i = end + 1;
+            } else {
+                std::size_t end = i;
+                while (end < s.size() && !std::isspace(static_cast<unsigned char>(s[end])) &&
+                       s[end] != '(' && s[end] != ')' && s[end] != '"') {
+                    end++;
+                }
+                std::string run = s.substr(i, end - i);
+                i = end;
+
+                if (run == "AND" || run == "&&") { out.push_back({Tok::And, ""}); continue; }
+                if (run == "OR" || run == "||")  { out.push_back({Tok::Or, ""}); continue; }
+                if (run == "NOT")                { out.push_back({Tok::Not, ""}); continue; }
+                if (run[0] == '-') {
+                    out.push_back({Tok::Minus, ""});
+                    run.erase(0, 1);
+                }
+                std::size_t colon = run.find(':');
+                if (colon != std::string::npos) {
+                    std::string name = run.substr(0, colon);
+                    std::transform(name.begin(), name.end(), name.begin(),
+                                   [](unsigned char ch) { return std::tolower(ch); });
+                    if (name == "title" || name == "abstract") {
+                        out.push_back({Tok::Field, name});
+                        run.erase(0, colon + 1);
+                    }
+                }
+                if (!run.empty()) out.push_back({Tok::Word, run});
+            }
+        }
+        return out;
+    }
+
+    static std::string describe(const Tok& t) {
+        switch (t.kind) {
+            case Tok::Word:   return "'" + t.text + "'";
+            case Tok::Phrase: return "\"" + t.text + "\"";
+            case Tok::LParen: return "'('";
+            case Tok::RParen: return "')'";
+            case Tok::And:    return "AND";
+            case Tok::Or:     return "OR";
+            case Tok::Not:    return "NOT";
+            case Tok::Minus:  return "'-'";
+            case Tok::Field:  return t.text + ":";
+        }
+        return "?";
+    }
+
+    bool at(Tok::Kind k) const { return pos < toks.size() && toks[pos].kind == k; }
+
+    // Starts an operand (used to spot implicit AND)
+    bool atOperand() const {
+        return at(Tok::Word) || at(Tok::Phrase) || at(Tok::LParen) || at(Tok::Not) ||
+               at(Tok::Minus) || at(Tok::Field);
+    }
+
+    Node parseOr() {
+        Node left = parseAnd();
+        if (!at(Tok::Or)) return left;
+        Node node;
+        node.kind = Node::Or;
+        node.children.push_back(std::move(left));
+        while (at(Tok::Or)) {
+            pos++;
+            node.children.push_back(parseAnd());
+        }
+        return node;
+    }
+
+    Node parseAnd() {
+        Node left = parseUnary();
+        if (!at(Tok::And) && !atOperand()) return left;
+        Node node;
+        node.kind = Node::And;
+        node.children.push_back(std::move(left));
+        while (at(Tok::And) || atOperand()) {
+            if (at(Tok::And)) pos++;
+            node.children.push_back(parseUnary());
+        }
+        return node;
+    }
+
+    Node parseUnary() {
+        if (at(Tok::Not) || at(Tok::Minus)) {
+            pos++;
+            Node node;
+            node.kind = Node::Not;
+            node.children.push_back(parseUnary());
+            return node;
+        }
+        return parsePrimary();
+    }
+
+    Node parsePrimary() {
+        if (pos >= toks.size()) {
+            throw ParseError("query ends where a term was expected");
+        }
+        const Tok& t = toks[pos++];
+        switch (t.kind) {
+            case Tok::LParen: {
+                Node inner = parseOr();
+                if (!at(Tok::RParen)) {
+                    throw ParseError("missing ')'");
+                }
+                pos++;
+                return inner;
+            }
+            case Tok::Field: {
+                Field f = t.text == "title" ? Field::Title : Field::Abstract;
+                Node inner = parsePrimary();
+                scope(inner, f);
+                return inner;
+            }
+            case Tok::Word:
+            case Tok::Phrase:
+                return leaf(t.text);
+            default:
+                throw ParseError("unexpected " + describe(t));
+        }
+    }
+
+    Node leaf(const std::string& text) {
+        Node node;
+        node.words = tokenize(text);
+        if (node.words.size() == 1) node.kind = Node::Term;
+        if (node.words.size() > 1) node.kind = Node::Phrase;
+        return node;
+    }
+
+    // A field prefix applies to every leaf below it that has no field yet
+    static void scope(Node& node, Field f) {
+        if (node.kind == Node::Term || node.kind == Node::Phrase) {
+            if (node.field == Field::Any) node.field = f;
+        }
+        for (auto& child : node.children) scope(child, f);
+    }
+
+    // Drops empty operands and collapses one-operand AND/OR
+    static Node simplify(Node node) {
+        if (node.kind == Node::Term || node.kind == Node::Phrase || node.kind == Node::Empty) {
+            return node;
+        }
+        std::vector<Node> kept;
+        for (auto& child : node.children) {
+            Node c = simplify(std::move(child));
+            if (c.kind != Node::Empty) kept.push_back(std::move(c));
+        }
+        node.children = std::move(kept);
+        if (node.children.empty()) return Node{};
+        if (node.kind != Node::Not && node.children.size() == 1) return std::move(node.children[0]);
+        return node;
+    }
+
+    // A NOT must sit directly in an AND that also has a positive operand
+    static void validate(const Node& node, bool inAnd) {
+        if (node.kind == Node::Not && !inAnd) {
+            throw ParseError("NOT needs a positive term beside it");
+        }
+        if (node.kind == Node::Or) {
+            for (const auto& c : node.children) {
+                if (c.kind == Node::Not) throw ParseError("NOT cannot be an operand of OR");
+            }
+        }
+        if (node.kind == Node::And) {
+            bool positive = std::any_of(node.children.begin(), node.children.end(),
+                                        [](const Node& c) { return c.kind != Node::Not; });
+            if (!positive) throw ParseError("NOT needs a positive term beside it");
+        }
+        for (const auto& c : node.children) validate(c, node.kind == Node::And);
+    }
+};
+
+// ---------------------- Cursors ----------------------
+
+class Cursor {
+public:
+    virtual ~Cursor() = default;
+    virtual bool atEnd() const = 0;
+    virtual const char* doc() const = 0;            // current doc ID (ID_SIZE bytes)
+    virtual void next() = 0;
+    virtual void advance(const char* target) = 0;   // first document >= target
+    virtual std::size_t cost() const = 0;           // upper bound on matches
+    // tf of every scored leaf on the current document, by slot
+    virtual void collect(std::vector<int>& tfs) const = 0;
+};
+
+using CursorPtr = std::unique_ptr<Cursor>;
+
+// One term's list; slot < 0 for terms that are only excluded
+class ListCursor : public Cursor {
+public:
+    ListCursor(const char* records, std::size_t count, int slot)
+        : records(records), count(count), slot(slot) {}
+
+    bool atEnd() const override { return pos >= count; }
+    const char* doc() const override { return records + pos * RECORD_SIZE; }
+    void next() override { pos++; }
+    std::size_t cost() const override { return count; }
+
+    // Galloping: doubling steps from the current position, then a binary
+    // search inside the last step
+    void advance(const char* target) override {
+        if (pos >= count || compareIds(doc(), target) >= 0) return;
+        std::size_t bound = 1;
+        while (pos + bound < count && compareIds(records + (pos + bound) * RECORD_SIZE, target) < 0) {
+            bound *= 2;
+        }
+        std::size_t lo = pos + bound / 2 + 1, hi = std::min(pos + bound, count);
+        while (lo < hi) {
+            std::size_t mid = lo + (hi - lo) / 2;
+            if (compareIds(records + mid * RECORD_SIZE, target) < 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        pos = lo;
+    }
+
+    void collect(std::vector<int>& tfs) const override {
+        if (slot < 0) return;
+        int32_t tf;
+        std::memcpy(&tf, doc() + ID_SIZE, sizeof(tf));
+        tfs[slot] = tf;
+    }
+
+private:
+    const char* records;
+    std::size_t count;
+    int slot;
+    std::size_t pos = 0;
+};
+
+class AndCursor : public Cursor {
+public:
+    explicit AndCursor(std::vector<CursorPtr> children) : children(std::move(children)) {
+        std::sort(this->children.begin(), this->children.end(),
+                  [](const CursorPtr& a, const CursorPtr& b) { return a->cost() < b->cost(); });
+        align();
+    }
+
+    bool atEnd() const override { return ended || children[0]->atEnd(); }
+    const char* doc() const override { return children[0]->doc(); }
+    void next() override {
+        if (atEnd()) return;
+        children[0]->next();
+        align();
+    }
+    void advance(const char* target) override {
+        if (atEnd()) return;
+        children[0]->advance(target);
+        align();
+    }
+    std::size_t cost() const override { return children[0]->cost(); }
+    void collect(std::vector<int>& tfs) const override {
+        for (const auto& c : children) c->collect(tfs);
+    }
+
+private:
+    std::vector<CursorPtr> children;  // rarest first
+    bool ended = false;             // some child ran out
+
+    // Leapfrog: move everyone to the lead's document; whoever overshoots
+    // becomes the new target for the lead
+    void align() {
+        while (!children[0]->atEnd()) {
+            const char* target = children[0]->doc();
+            bool agreed = true;
+            for (std::size_t i = 1; i < children.size(); i++) {
+                children[i]->advance(target);
+                if (children[i]->atEnd()) {
+                    ended = true;
+                    return;
+                }
+                if (compareIds(children[i]->doc(), target) > 0) {
+                    children[0]->advance(children[i]->doc());
+                    agreed = false;
+                    break;
+                }
+            }
+            if (agreed) return;
+        }
+    }
+};
+
+class OrCursor : public Cursor {
+public:
+    explicit OrCursor(std::vector<CursorPtr> children) : children(std::move(children)) { settle(); }
+
+    bool atEnd() const override { return current == nullptr; }
+    const char* doc() const override { return current; }
+    void next() override {
+        const char* at = current;
+        for (auto& c : children) {
+            if (!c->atEnd() && compareIds(c->doc(), at) == 0) c->next();
+        }
+        settle();
+    }
+    void advance(const char* target) override {
+        for (auto& c : children) c->advance(target);
+        settle();
+    }
+    std::size_t cost() const override {
+        std::size_t n = 0;
+        for (const auto& c : children) n += c->cost();
+        return n;
+    }
+    void collect(std::vector<int>& tfs) const override {
+        for (const auto& c : children) {
+            if (!c->atEnd() && compareIds(c->doc(), current) == 0) c->collect(tfs);
+        }
+    }
+
+private:
+    std::vector<CursorPtr> children;
+    const char* current = nullptr;
+
+    void settle() {
+        current = nullptr;
+        for (const auto& c : children) {
+            if (!c->atEnd() && (current == nullptr || compareIds(c->doc(), current) < 0)) current = c->doc();
+        }
+    }
+};
+
+// Documents of `include` that `exclude` does not stop on
+class AndNotCursor : public Cursor {
+public:
+    AndNotCursor(CursorPtr include, CursorPtr exclude) : include(std::move(include)), exclude(std::move(exclude)) {
+        skip();
+    }
+
+    bool atEnd() const override { return include->atEnd(); }
+    const char* doc() const override { return include->doc(); }
+    void next() override { include->next(); skip(); }
+    void advance(const char* target) override { include->advance(target); skip(); }
+    std::size_t cost() const override { return include->cost(); }
+    void collect(std::vector<int>& tfs) const override { include->collect(tfs); }
+
+private:
+    CursorPtr include, exclude;
+
+    void skip() {
+        while (!include->atEnd()) {
+            exclude->advance(include->doc());
+            if (exclude->atEnd() || compareIds(exclude->doc(), include->doc()) != 0) return;
+            include->next();
+        }
+    }
+};
+
+// Documents of `child` that pass a per-document check (phrase, field)
+class FilterCursor : public Cursor {
+public:
+    FilterCursor(CursorPtr child, std::function<bool(const char*)> accept)
+        : child(std::move(child)), accept(std::move(accept)) {
+        skip();
+    }
+
+    bool atEnd() const override { return child->atEnd(); }
+    const char* doc() const override { return child->doc(); }
+    void next() override { child->next(); skip(); }
+    void advance(const char* target) override { child->advance(target); skip(); }
+    std::size_t cost() const override { return child->cost(); }
+    void collect(std::vector<int>& tfs) const override { child->collect(tfs); }
+
+private:
+    CursorPtr child;
+    std::function<bool(const char*)> accept;
+
+    void skip() {
+        while (!child->atEnd() && !accept(child->doc())) child->next();
+    }
+};
+
+// ---------------------- Compilation ----------------------
+
+// termCursor(word, scored) opens one word's list (scored = false below a
+// NOT); check(leaf) returns the phrase/field test for a leaf, or an empty
+// function when its terms' lists already answer it
+struct Compiler {
+    std::function<CursorPtr(const std::string&, bool)> termCursor;
+    std::function<std::function<bool(const char*)>(const Node&)> check;
+
+    CursorPtr compile(const Node& node, bool scored = true) const {
+        switch (node.kind) {
+            case Node::Term:
+            case Node::Phrase: {
+                std::vector<CursorPtr> lists;
+                for (const auto& w : node.words) lists.push_back(termCursor(w, scored));
+                CursorPtr c = lists.size() == 1 ? std::move(lists[0]) : std::make_unique<AndCursor>(std::move(lists));
+                auto accept = check(node);
+                if (accept) c = std::make_unique<FilterCursor>(std::move(c), std::move(accept));
+                return c;
+            }
+            case Node::And: {
+                std::vector<CursorPtr> include, exclude;
+                for (const auto& child : node.children) {
+                    if (child.kind == Node::Not) {
+                        exclude.push_back(compile(child.children[0], false));
+                    } else {
+                        include.push_back(compile(child, scored));
+                    }
+                }
+                CursorPtr c = include.size() == 1 ? std::move(include[0]) : std::make_unique<AndCursor>(std::move(include));
+                if (exclude.empty()) return c;
+                CursorPtr ex = exclude.size() == 1 ? std::move(exclude[0]) : std::make_unique<OrCursor>(std::move(exclude));
+                return std::make_unique<AndNotCursor>(std::move(c), std::move(ex));
+            }
+            case Node::Or: {
+                std::vector<CursorPtr> children;
+                for (const auto& child : node.children) children.push_back(compile(child, scored));
+                return std::make_unique<OrCursor>(std::move(children));
+            }
+            default:
+                throw ParseError("NOT needs a positive term beside it");
+        }
+    }
+};
+
+} // namespace boolean_query
@@ -0,0 +1,295 @@
+#pragma once
+
+/*
+ * Citation Graph and PageRank
+ *
+ * forwardIndex reads each paper's bib_entries while it extracts the text and
+ * resolves the cited titles against the titles of the indexed papers, so a
+ * citation becomes an edge between two docIDs (forward_index.txt line
+ * numbers). Titles are matched after folding to lowercase letters and digits
+ * with single spaces, by a 64-bit hash; titles shorter than MIN_TITLE_CHARS
+ * ("Introduction", "Editorial") and titles shared by several papers are not
+ * matched. Self-citations and repeated citations of one paper are dropped.
+ *
+ * pageRank computes PageRank over the graph by power iteration: each
+ * iteration pulls rank along in-links, so every thread writes its own range
+ * of documents and no atomics are needed; threads get ranges of equal
+ * in-link counts. The rank of papers citing nothing (in the collection) is
+ * spread over all papers. Iteration stops when the L1 change drops below the
+ * tolerance.
+ *
+ * search_semantic uses normalizedScores() of the result as its PageRank
+ * signal, in place of doc_scores.json.
+ *
+ * Files (indexes/, little-endian):
+ *   citations.bin  [magic:8 "MGCITE01"][numDocs:4][reserved:4][numEdges:8]
+ *                  offsets: (numDocs + 1) x uint64, then numEdges x uint32
+ *                  cited docIDs; the papers doc d cites are
+ *                  targets[offsets[d] .. offsets[d + 1]), sorted
+ *   pagerank.bin   [magic:8 "MGPRANK1"][numDocs:4][iterations:4]
+ *                  then numDocs x float32, index = docID, summing to 1
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config.hpp"
+
+namespace citation_graph {
+
+constexpr char GRAPH_MAGIC[8] = {'M', 'G', 'C', 'I', 'T', 'E', '0', '1'};
+constexpr char SCORES_MAGIC[8] = {'M', 'G', 'P', 'R', 'A', 'N', 'K', '1'};
+constexpr size_t MIN_TITLE_CHARS = 16;
+
+// FNV-1a of the folded title ("SARS-CoV-2: a Review." -> "sars cov 2 a review"),
+// 0 for titles too short to identify a paper
+inline uint64_t titleKey(const std::string& title) {
+    uint64_t h = 14695981039346656037ull;
+    size_t chars = 0;
+    bool pendingSpace = false;
+    for (unsigned char c : title) {
+        if (c >= 'A' && c <= 'Z') c = static_cast<unsigned char>(c - 'A' + 'a');
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80) {
+            if (pendingSpace && chars > 0) {
+                h = (h ^ ' ') * 1099511628211ull;
+                chars++;
+            }
+            pendingSpace = false;
+            h = (h ^ c) * 1099511628211ull;
+            chars++;
+        } else {
+            pendingSpace = true;
+        }
+    }
+    return chars >= MIN_TITLE_CHARS ? h : 0;
+}
+
+// Runs fn(begin, end) over [0, n) split at the given boundaries, one thread per range
+template <typename Fn>
+void parallelRanges(const std::vector<uint32_t>& bounds, Fn fn) {
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t + 1 < bounds.size(); t++) {
+        workers.emplace_back(fn, bounds[t], bounds[t + 1]);
+    }
+    if (bounds.size() > 1) fn(bounds[0], bounds[1]);
+    for (auto& w : workers) w.join();
+}
+
+// ---------------------- Graph ----------------------
+
+// Out-links in compressed sparse row form
+struct Graph {
+    uint32_t numDocs = 0;
+    std::vector<uint64_t> offsets{0};
+    std::vector<uint32_t> targets;
+
+    uint64_t edges() const { return targets.size(); }
+    uint32_t outDegree(uint32_t d) const { return static_cast<uint32_t>(offsets[d + 1] - offsets[d]); }
+
+    // Appends the next document's out-links (docIDs in order, from 0)
+    void addDocument(std::vector<uint32_t> cited) {
+        std::sort(cited.begin(), cited.end());
+        cited.erase(std::unique(cited.begin(), cited.end()), cited.end());
+        for (uint32_t t : cited) {
+            if (t != numDocs) targets.push_back(t);
+        }
+        offsets.push_back(targets.size());
+        numDocs++;
+    }
+
+    // The same edges pointing the other way (in-links)
+    Graph transposed() const {
+        Graph in;
+        in.numDocs = numDocs;
+        in.offsets.assign(static_cast<size_t>(numDocs) + 1, 0);
+        for (uint32_t t : targets) in.offsets[t + 1]++;
+        for (uint32_t d = 0; d < numDocs; d++) in.offsets[d + 1] += in.offsets[d];
+        in.targets.resize(targets.size());
+        std::vector<uint64_t> fill(in.offsets.begin(), in.offsets.end() - 1);
+        for (uint32_t d = 0; d < numDocs; d++) {
+            for (uint64_t e = offsets[d]; e < offsets[d + 1]; e++) {
+                in.targets[fill[targets[e]]++] = d;
+            }
+        }
+        return in;
+    }
+
+    void save(const fs::path& path) const {
+        std::ofstream out(path, std::ios::binary);
+        if (!out.is_open()) {
+            throw std::runtime_error("Cannot create " + path.string());
+        }
+        uint32_t reserved = 0;
+        uint64_t numEdges = edges();
+        out.write(GRAPH_MAGIC, sizeof(GRAPH_MAGIC));
+        out.write(reinterpret_cast<const char*>(&numDocs), sizeof(numDocs));
+        out.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+        out.write(reinterpret_cast<const char*>(&numEdges), sizeof(numEdges));
+        out.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+        out.write(reinterpret_cast<const char*>(targets.data()), targets.size() * sizeof(uint32_t));
+    }
+
+    void load(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) {
+            throw std::runtime_error("Cannot open citation graph " + path.string() + " (run forwardIndex)");
+        }
+        char magic[8];
+        uint32_t reserved = 0;
+        uint64_t numEdges = 0;
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char*>(&numDocs), sizeof(numDocs));
+        in.read(reinterpret_cast<char*>(&reserved), sizeof(reserved));
+        in.read(reinterpret_cast<char*>(&numEdges), sizeof(numEdges));
+        if (!in || std::memcmp(magic, GRAPH_MAGIC, sizeof(magic)) != 0) {
+            throw std::runtime_error("Not a citation graph: " + path.string());
+        }
+        offsets.resize(static_cast<size_t>(numDocs) + 1);
+        targets.resize(numEdges);
+        in.read(reinterpret_cast<char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+        in.read(reinterpret_cast<char*>(targets.data()), targets.size() * sizeof(uint32_t));
+        if (!in || offsets.back() != numEdges) {
+            throw std::runtime_error("Citation graph is truncated: " + path.string());
+        }
+        for (uint32_t t : targets) {
+            if (t >= numDocs) throw std::runtime_error("Citation graph has an edge past the last document");
+        }
+    }
+};
+
+// ---------------------- PageRank ----------------------
+
+struct PageRankParams {
+    double damping = 0.85;
+    double tolerance = 1e-7;  // L1 change between iterations
+    uint32_t maxIterations = 100;
+    uint32_t threads = 1;
+};
+
+struct PageRankResult {
+    std::vector<float> scores;  // index = docID, sums to 1
+    uint32_t iterations = 0;
+    double residual = 0.0;      // L1 change in the last iteration
+};
+
+inline PageRankResult pageRank(const Graph& graph, const PageRankParams& params) {
+    PageRankResult result;
+    const uint32_t n = graph.numDocs;
+    if (n == 0) return result;
+
+    const Graph in = graph.transposed();
+    const uint32_t threads = std::max<uint32_t>(1, std::min<uint32_t>(params.threads, n));
+
+    // Ranges of docIDs with about the same number of in-links plus documents each
+    std::vector<uint32_t> bounds{0};
+    const double work = static_cast<double>(in.edges()) + n;
+    for (uint32_t d = 0, t = 1; d < n && t < threads; d++) {
+        if (static_cast<double>(in.offsets[d + 1]) + d + 1 >= work * t / threads) {
+            bounds.push_back(d + 1);
+            t++;
+        }
+    }
+    if (bounds.back() != n) bounds.push_back(n);
+    const size_t ranges = bounds.size() - 1;
+
+    std::vector<double> rank(n, 1.0 / n), next(n);
+    std::vector<double> share(n);  // rank / out-degree, what each in-link passes on
+    std::vector<double> dangling(ranges), change(ranges);
+
+    for (uint32_t iter = 0; iter < params.maxIterations; iter++) {
+        parallelRanges(bounds, [&](uint32_t begin, uint32_t end) {
+            size_t r = std::upper_bound(bounds.begin(), bounds.end(), begin) - bounds.begin() - 1;
+            double lost = 0.0;
+            for (uint32_t d = begin; d < end; d++) {
+                uint32_t out = graph.outDegree(d);
+                share[d] = out > 0 ? rank[d] / out : 0.0;
+                if (out == 0) lost += rank[d];
+            }
+            dangling[r] = lost;
+        });
+        double lost = 0.0;
+        for (double x : dangling) lost += x;
+        const double base = (1.0 - params.damping) / n + params.damping * lost / n;
+
+        parallelRanges(bounds, [&](uint32_t begin, uint32_t end) {
+            size_t r = std::upper_bound(bounds.begin(), bounds.end(), begin) - bounds.begin() - 1;
+            double delta = 0.0;
+            for (uint32_t d = begin; d < end; d++) {
+                double sum = 0.0;
+                for (uint64_t e = in.offsets[d]; e < in.offsets[d + 1]; e++) sum += share[in.targets[e]];
+                next[d] = base + params.damping * sum;
+                delta += std::fabs(next[d] - rank[d]);
+            }
+            change[r] = delta;
+        });
+        rank.swap(next);
+
+        result.residual = 0.0;
+        for (double x : change) result.residual += x;
+        result.iterations = iter + 1;
+        if (result.residual < params.tolerance) break;
+    }
+
+    result.scores.assign(rank.begin(), rank.end());
+    return result;
+}
+
+// ---------------------- Scores ----------------------
+
+inline void writeScores(const fs::path& path, const std::vector<float>& scores, uint32_t iterations) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot create " + path.string());
+    }
+    uint32_t numDocs = static_cast<uint32_t>(scores.size());
+    out.write(SCORES_MAGIC, sizeof(SCORES_MAGIC));
+    out.write(reinterpret_cast<const char*>(&numDocs), sizeof(numDocs));
+    out.write(reinterpret_cast<const char*>(&iterations), sizeof(iterations));
+    out.write(reinterpret_cast<const char*>(scores.data()), scores.size() * sizeof(float));
+}
+
+inline std::vector<float> readScores(const fs::path& path, uint32_t* iterationsOut = nullptr) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        throw std::runtime_error("Cannot open PageRank scores " + path.string() + " (run pageRank)");
+    }
+    char magic[8];
+    uint32_t numDocs = 0, iterations = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&numDocs), sizeof(numDocs));
+    in.read(reinterpret_cast<char*>(&iterations), sizeof(iterations));
+    if (!in || std::memcmp(magic, SCORES_MAGIC, sizeof(magic)) != 0) {
+        throw std::runtime_error("Not a PageRank score file: " + path.string());
+    }
+    std::vector<float> scores(numDocs);
+    in.read(reinterpret_cast<char*>(scores.data()), scores.size() * sizeof(float));
+    if (!in) {
+        throw std::runtime_error("PageRank score file is truncated: " + path.string());
+    }
+    if (iterationsOut) *iterationsOut = iterations;
+    return scores;
+}
+
+// PageRank on a 0-1 scale for mixing with other scores: log(1 + n * pr)
+// over its maximum, so the top paper gets 1 and uncited papers share the
+// lowest value (about 0.2 on a small, sparsely linked collection)
+inline std::vector<float> normalizedScores(const std::vector<float>& scores) {
+    std::vector<float> out(scores.size(), 0.0f);
+    if (scores.empty()) return out;
+    const double n = static_cast<double>(scores.size());
+    const double top = std::log1p(n * *std::max_element(scores.begin(), scores.end()));
+    if (top <= 0.0) return out;
+    for (size_t d = 0; d < scores.size(); d++) {
+        out[d] = static_cast<float>(std::log1p(n * scores[d]) / top);
+    }
+    return out;
+}
+
+}  // namespace citation_graph
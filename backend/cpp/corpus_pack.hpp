@@ -0,0 +1,249 @@
+#pragma once
+
+/*
+ * Packed Corpus Container
+ *
+ * Re-indexing used to open every file under pmc_json one by one, paying an
+ * open/stat/read per document and scattering reads over the disk. A corpus
+ * pack stores all documents back to back in one file with an offset table at
+ * the end, so a full pass is one sequential read and any document can be
+ * fetched with a single seek.
+ *
+ * File layout (little-endian):
+ *   Header (32 bytes):
+ *     [magic:8 "MGPACK01"][codec:4][reserved:4][numDocs:8][tableOffset:8]
+ *   Data:
+ *     doc0 bytes, doc1 bytes, ...   (each stored raw or as one zstd frame)
+ *   Offset table (at tableOffset):
+ *     numDocs x [offset:8][storedSize:4][rawSize:4][nameOffset:4][nameLen:4]
+ *     [namesSize:4][names blob]
+ *
+ * Names are the original file names (e.g. PMC7326321.xml.json), so readers
+ * derive doc IDs exactly as they do from a directory listing.
+ *
+ * Compression is optional: build with -DMINIGOOGLE_WITH_ZSTD -lzstd (run.sh
+ * does this when libzstd is installed). A zstd pack opened by a binary built
+ * without zstd fails with a clear error instead of returning garbage.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef MINIGOOGLE_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace corpus_pack {
+
+constexpr char MAGIC[8] = {'M', 'G', 'P', 'A', 'C', 'K', '0', '1'};
+
+enum Codec : uint32_t {
+    CODEC_RAW = 0,
+    CODEC_ZSTD = 1,
+};
+
+struct Entry {
+    uint64_t offset;
+    uint32_t storedSize;
+    uint32_t rawSize;
+    uint32_t nameOffset;
+    uint32_t nameLen;
+};
+
+inline bool zstdAvailable() {
+#ifdef MINIGOOGLE_WITH_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+// ---------------------- Writer ----------------------
+
+class Writer {
+public:
+    Writer(const std::string& path, Codec codec = CODEC_RAW, int level = 3)
+        : codec(codec), level(level) {
+        if (codec == CODEC_ZSTD && !zstdAvailable()) {
+            throw std::runtime_error("zstd requested but this binary was built without MINIGOOGLE_WITH_ZSTD");
+        }
+
+        out.open(path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("Cannot create corpus pack at " + path);
+        }
+
+        // Placeholder header, rewritten by finish()
+        char header[32] = {0};
+        out.write(header, sizeof(header));
+        position = sizeof(header);
+    }
+
+    void add(const std::string& name, const char* data, size_t size) {
+        Entry e{};
+        e.offset = position;
+        e.rawSize = static_cast<uint32_t>(size);
+        e.nameOffset = static_cast<uint32_t>(names.size());
+        e.nameLen = static_cast<uint32_t>(name.size());
+        names += name;
+
+        if (codec == CODEC_ZSTD) {
+#ifdef MINIGOOGLE_WITH_ZSTD
+            scratch.resize(ZSTD_compressBound(size));
+            size_t n = ZSTD_compress(&scratch[0], scratch.size(), data, size, level);
+            if (ZSTD_isError(n)) {
+                throw std::runtime_error(std::string("zstd compression failed: ") + ZSTD_getErrorName(n));
+            }
+            out.write(scratch.data(), n);
+            e.storedSize = static_cast<uint32_t>(n);
+#endif
+        } else {
+            out.write(data, size);
+            e.storedSize = static_cast<uint32_t>(size);
+        }
+
+        position += e.storedSize;
+        entries.push_back(e);
+    }
+
+    void finish() {
+        uint64_t tableOffset = position;
+        out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+        uint32_t namesSize = static_cast<uint32_t>(names.size());
+        out.write(reinterpret_cast<const char*>(&namesSize), sizeof(namesSize));
+        out.write(names.data(), names.size());
+
+        uint64_t numDocs = entries.size();
+        uint32_t codecId = codec;
+        uint32_t reserved = 0;
+        out.seekp(0);
+        out.write(MAGIC, sizeof(MAGIC));
+        out.write(reinterpret_cast<const char*>(&codecId), sizeof(codecId));
+        out.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+        out.write(reinterpret_cast<const char*>(&numDocs), sizeof(numDocs));
+        out.write(reinterpret_cast<const char*>(&tableOffset), sizeof(tableOffset));
+        out.close();
+    }
+
+    size_t size() const { return entries.size(); }
+    uint64_t bytesWritten() const { return position; }
+
+private:
+    std::ofstream out;
+    Codec codec;
+    int level;
+    uint64_t position = 0;
+    std::vector<Entry> entries;
+    std::string names;
+    std::string scratch;
+};
+
+// ---------------------- Reader ----------------------
+
+// Holds the offset table. It is read-only after construction, so worker
+// threads share one Reader and each opens its own Cursor (own file position).
+class Reader {
+public:
+    explicit Reader(const std::string& path) : path(path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) {
+            throw std::runtime_error("Cannot open corpus pack at " + path);
+        }
+
+        char magic[8];
+        uint32_t reserved;
+        uint64_t numDocs, tableOffset;
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char*>(&codec), sizeof(codec));
+        in.read(reinterpret_cast<char*>(&reserved), sizeof(reserved));
+        in.read(reinterpret_cast<char*>(&numDocs), sizeof(numDocs));
+        in.read(reinterpret_cast<char*>(&tableOffset), sizeof(tableOffset));
+
+        if (!in || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+            throw std::runtime_error("Not a corpus pack: " + path);
+        }
+        if (codec == CODEC_ZSTD && !zstdAvailable()) {
+            throw std::runtime_error("Corpus pack is zstd-compressed but this binary was built without MINIGOOGLE_WITH_ZSTD");
+        }
+
+        entries.resize(numDocs);
+        in.seekg(tableOffset);
+        in.read(reinterpret_cast<char*>(entries.data()), numDocs * sizeof(Entry));
+
+        uint32_t namesSize = 0;
+        in.read(reinterpret_cast<char*>(&namesSize), sizeof(namesSize));
+        names.resize(namesSize);
+        in.read(&names[0], namesSize);
+
+        if (!in) {
+            throw std::runtime_error("Corpus pack offset table is truncated: " + path);
+        }
+    }
+
+    size_t size() const { return entries.size(); }
+    uint32_t codecId() const { return codec; }
+    const std::string& filePath() const { return path; }
+    const Entry& entry(size_t i) const { return entries[i]; }
+
+    std::string name(size_t i) const {
+        return names.substr(entries[i].nameOffset, entries[i].nameLen);
+    }
+
+private:
+    std::string path;
+    uint32_t codec = CODEC_RAW;
+    std::vector<Entry> entries;
+    std::string names;
+};
+
+// Sequential reader over one pack. Reading documents in index order walks the
+// data section front to back; workers given contiguous ranges each stream
+// their own slice.
+class Cursor {
+public:
+    explicit Cursor(const Reader& reader) : reader(reader) {
+        in.open(reader.filePath(), std::ios::binary);
+        if (!in.is_open()) {
+            throw std::runtime_error("Cannot open corpus pack at " + reader.filePath());
+        }
+    }
+
+    // Reads document i (decompressed) into out, reusing its capacity.
+    void read(size_t i, std::string& out) {
+        const Entry& e = reader.entry(i);
+
+        if (static_cast<uint64_t>(in.tellg()) != e.offset) {
+            in.seekg(e.offset);
+        }
+
+        if (reader.codecId() == CODEC_ZSTD) {
+#ifdef MINIGOOGLE_WITH_ZSTD
+            scratch.resize(e.storedSize);
+            in.read(&scratch[0], e.storedSize);
+            out.resize(e.rawSize);
+            size_t n = ZSTD_decompress(&out[0], out.size(), scratch.data(), scratch.size());
+            if (ZSTD_isError(n) || n != e.rawSize) {
+                throw std::runtime_error("Corrupt zstd record in corpus pack: " + reader.name(i));
+            }
+#endif
+        } else {
+            out.resize(e.rawSize);
+            in.read(&out[0], e.rawSize);
+        }
+
+        if (!in) {
+            throw std::runtime_error("Short read in corpus pack: " + reader.name(i));
+        }
+    }
+
+private:
+    const Reader& reader;
+    std::ifstream in;
+    std::string scratch;
+};
+
+} // namespace corpus_pack
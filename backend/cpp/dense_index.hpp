@@ -0,0 +1,517 @@
+#pragma once
+
+/*
+ * Dense Document Vectors and HNSW Index
+ *
+ * docVectorBuilder gives every document one dense vector: the idf-weighted
+ * average of the word embeddings of its lemmas (the same features k-means
+ * sharding uses, see shard_cluster.hpp), L2-normalized so a dot product is
+ * the cosine. The vectors are indexed with HNSW (Malkov & Yashunin): a
+ * layered proximity graph searched greedily from the top layer down, then
+ * with a beam of ef candidates on layer 0, which finds the nearest
+ * documents while scoring only a few thousand of them.
+ *
+ * search_semantic --hybrid queries the graph with the query's vector (the
+ * same weighted sum over the query lemmas) next to the lexical barrels.
+ *
+ * Documents are addressed by docID (forward_index.txt line number). A
+ * document with no embedded lemma has a zero vector and is not in the graph.
+ *
+ * Files (indexes/<dense_dir>, little-endian):
+ *   doc_vectors.bin    [magic:8 "MGDVEC01"][numDocs:8][dim:4][reserved:4]
+ *                      then numDocs x dim float32, row = docID; memory-mapped
+ *   lemma_vectors.bin  [magic:8 "MGLVEC01"][count:4][dim:4]
+ *                      then count x ([lemmaId:4] dim float32), each the
+ *                      lemma's embedding times its idf
+ *   hnsw.bin           [magic:8 "MGHNSW01"][numDocs:4][m:4][maxLevel:4][entry:4]
+ *                      [level:4] per docID (-1 = not in the graph)
+ *                      layer 0: numDocs x (2m + 1) uint32 ([count] then links)
+ *                      then for each node with level > 0, in docID order:
+ *                      level x (m + 1) uint32, one link list per upper layer
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "config.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MINIGOOGLE_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dense_index {
+
+constexpr char VECTORS_MAGIC[8] = {'M', 'G', 'D', 'V', 'E', 'C', '0', '1'};
+constexpr char LEMMA_VECTORS_MAGIC[8] = {'M', 'G', 'L', 'V', 'E', 'C', '0', '1'};
+constexpr char HNSW_MAGIC[8] = {'M', 'G', 'H', 'N', 'S', 'W', '0', '1'};
+constexpr size_t VECTORS_HEADER_SIZE = 24;
+
+inline float dot(const float* a, const float* b, uint32_t dim) {
+    float s = 0.0f;
+    for (uint32_t d = 0; d < dim; d++) s += a[d] * b[d];
+    return s;
+}
+
+// Scales v to unit length; false (v left as is) for the zero vector
+inline bool normalize(std::vector<float>& v) {
+    double norm = 0.0;
+    for (float x : v) norm += static_cast<double>(x) * x;
+    if (norm <= 0.0) return false;
+    float inv = static_cast<float>(1.0 / std::sqrt(norm));
+    for (float& x : v) x *= inv;
+    return true;
+}
+
+// ---------------------- Writing ----------------------
+
+// data: numDocs x dim, row = docID
+inline void writeVectors(const fs::path& path, const std::vector<float>& data, uint64_t numDocs, uint32_t dim) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot create " + path.string());
+    }
+    uint32_t reserved = 0;
+    out.write(VECTORS_MAGIC, sizeof(VECTORS_MAGIC));
+    out.write(reinterpret_cast<const char*>(&numDocs), sizeof(numDocs));
+    out.write(reinterpret_cast<const char*>(&dim), sizeof(dim));
+    out.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+    out.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(float));
+}
+
+inline void writeLemmaVectors(const fs::path& path, const std::vector<std::pair<int, std::vector<float>>>& lemmas,
+                              uint32_t dim) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot create " + path.string());
+    }
+    uint32_t count = static_cast<uint32_t>(lemmas.size());
+    out.write(LEMMA_VECTORS_MAGIC, sizeof(LEMMA_VECTORS_MAGIC));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char*>(&dim), sizeof(dim));
+    for (const auto& [lemma, vec] : lemmas) {
+        int32_t id = lemma;
+        out.write(reinterpret_cast<const char*>(&id), sizeof(id));
+        out.write(reinterpret_cast<const char*>(vec.data()), dim * sizeof(float));
+    }
+}
+
+// ---------------------- Reading ----------------------
+
+// The document vectors, mapped into memory where the platform allows it
+class Vectors {
+public:
+    explicit Vectors(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) {
+            throw std::runtime_error("Cannot open document vectors " + path.string() + " (run docVectorBuilder)");
+        }
+        char magic[8];
+        uint32_t reserved = 0;
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char*>(&numDocs), sizeof(numDocs));
+        in.read(reinterpret_cast<char*>(&numDims), sizeof(numDims));
+        in.read(reinterpret_cast<char*>(&reserved), sizeof(reserved));
+        if (!in || std::memcmp(magic, VECTORS_MAGIC, sizeof(magic)) != 0 || numDims == 0) {
+            throw std::runtime_error("Not a document vector file: " + path.string());
+        }
+        size_t bytes = VECTORS_HEADER_SIZE + numDocs * numDims * sizeof(float);
+        if (fs::file_size(path) < bytes) {
+            throw std::runtime_error("Document vector file is truncated: " + path.string());
+        }
+
+#ifdef MINIGOOGLE_HAVE_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            void* p = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (p != MAP_FAILED) {
+                mapped = p;
+                mappedSize = bytes;
+                values = reinterpret_cast<const float*>(static_cast<const uint8_t*>(p) + VECTORS_HEADER_SIZE);
+                return;
+            }
+        }
+#endif
+        copy.resize(numDocs * numDims);
+        in.read(reinterpret_cast<char*>(copy.data()), copy.size() * sizeof(float));
+        if (!in) {
+            throw std::runtime_error("Document vector file is truncated: " + path.string());
+        }
+        values = copy.data();
+    }
+
+    ~Vectors() {
+#ifdef MINIGOOGLE_HAVE_MMAP
+        if (mapped) ::munmap(mapped, mappedSize);
+#endif
+    }
+
+    Vectors(const Vectors&) = delete;
+    Vectors& operator=(const Vectors&) = delete;
+
+    uint64_t size() const { return numDocs; }
+    uint32_t dim() const { return numDims; }
+    const float* row(uint32_t docId) const { return values + static_cast<size_t>(docId) * numDims; }
+
+    bool isZero(uint32_t docId) const {
+        const float* r = row(docId);
+        for (uint32_t d = 0; d < numDims; d++) {
+            if (r[d] != 0.0f) return false;
+        }
+        return true;
+    }
+
+private:
+    uint64_t numDocs = 0;
+    uint32_t numDims = 0;
+    const float* values = nullptr;
+    void* mapped = nullptr;
+    size_t mappedSize = 0;
+    std::vector<float> copy;
+};
+
+// idf-weighted lemma embeddings, for turning a query into a vector
+class LemmaVectors {
+public:
+    explicit LemmaVectors(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) {
+            throw std::runtime_error("Cannot open lemma vectors " + path.string() + " (run docVectorBuilder)");
+        }
+        char magic[8];
+        uint32_t count = 0;
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char*>(&count), sizeof(count));
+        in.read(reinterpret_cast<char*>(&numDims), sizeof(numDims));
+        if (!in || std::memcmp(magic, LEMMA_VECTORS_MAGIC, sizeof(magic)) != 0 || numDims == 0) {
+            throw std::runtime_error("Not a lemma vector file: " + path.string());
+        }
+        vectors.reserve(count);
+        for (uint32_t i = 0; i < count; i++) {
+            int32_t lemma = 0;
+            std::vector<float> vec(numDims);
+            in.read(reinterpret_cast<char*>(&lemma), sizeof(lemma));
+            in.read(reinterpret_cast<char*>(vec.data()), numDims * sizeof(float));
+            if (!in) {
+                throw std::runtime_error("Lemma vector file is truncated: " + path.string());
+            }
+            vectors.emplace(lemma, std::move(vec));
+        }
+    }
+
+    uint32_t dim() const { return numDims; }
+
+    // (1 + log tf)-weighted sum of the lemmas' vectors, normalized; empty
+    // when no lemma has an embedding
+    std::vector<float> queryVector(const std::vector<int>& lemmas) const {
+        std::unordered_map<int, int> tf;
+        for (int lemma : lemmas) tf[lemma]++;
+        std::vector<float> q(numDims, 0.0f);
+        for (const auto& [lemma, count] : tf) {
+            auto it = vectors.find(lemma);
+            if (it == vectors.end()) continue;
+            float w = static_cast<float>(1.0 + std::log(count));
+            for (uint32_t d = 0; d < numDims; d++) q[d] += w * it->second[d];
+        }
+        if (!normalize(q)) q.clear();
+        return q;
+    }
+
+private:
+    uint32_t numDims = 0;
+    std::unordered_map<int, std::vector<float>> vectors;
+};
+
+// ---------------------- HNSW graph ----------------------
+
+struct Neighbor {
+    uint32_t docId;
+    float score;  // cosine
+};
+
+class Hnsw {
+public:
+    struct Params {
+        uint32_t m = 16;               // links per node on upper layers (2m on layer 0)
+        uint32_t efConstruction = 200; // beam width while inserting
+        uint32_t seed = 42;
+    };
+
+    uint32_t nodes() const { return inGraph; }
+    int levels() const { return maxLevel + 1; }
+
+    // Inserts every non-zero document vector, in docID order (deterministic
+    // for a given seed)
+    void build(const Vectors& vectors, const Params& params) {
+        m = std::max<uint32_t>(2, params.m);
+        m0 = 2 * m;
+        numDocs = static_cast<uint32_t>(vectors.size());
+        maxLevel = -1;
+        entry = 0;
+        inGraph = 0;
+        level.assign(numDocs, -1);
+        links0.assign(static_cast<size_t>(numDocs) * (m0 + 1), 0);
+        upper.assign(numDocs, {});
+
+        std::mt19937 rng(params.seed);
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        const double levelMult = 1.0 / std::log(static_cast<double>(m));
+
+        for (uint32_t docId = 0; docId < numDocs; docId++) {
+            if (vectors.isZero(docId)) continue;
+            int l = static_cast<int>(-std::log(std::max(uniform(rng), 1e-12)) * levelMult);
+            insert(vectors, docId, l, std::max(params.efConstruction, m));
+        }
+    }
+
+    // The k documents most similar to query (unit length, vectors.dim()
+    // floats), best first. ef >= k trades time for recall.
+    std::vector<Neighbor> search(const Vectors& vectors, const float* query, size_t k, size_t ef) const {
+        if (maxLevel < 0 || k == 0) return {};
+        const uint32_t dim = vectors.dim();
+
+        uint32_t cur = entry;
+        float curScore = dot(query, vectors.row(cur), dim);
+        for (int lc = maxLevel; lc > 0; lc--) {
+            greedy(vectors, query, lc, cur, curScore);
+        }
+
+        std::vector<bool> visited(numDocs, false);
+        auto found = searchLayer(vectors, query, {{curScore, cur}}, std::max(ef, k), 0, visited);
+        std::vector<Neighbor> out;
+        for (size_t i = 0; i < found.size() && i < k; i++) {
+            out.push_back({found[i].second, found[i].first});
+        }
+        return out;
+    }
+
+    void save(const fs::path& path) const {
+        std::ofstream out(path, std::ios::binary);
+        if (!out.is_open()) {
+            throw std::runtime_error("Cannot create " + path.string());
+        }
+        int32_t top = maxLevel;
+        out.write(HNSW_MAGIC, sizeof(HNSW_MAGIC));
+        out.write(reinterpret_cast<const char*>(&numDocs), sizeof(numDocs));
+        out.write(reinterpret_cast<const char*>(&m), sizeof(m));
+        out.write(reinterpret_cast<const char*>(&top), sizeof(top));
+        out.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        out.write(reinterpret_cast<const char*>(level.data()), level.size() * sizeof(int32_t));
+        out.write(reinterpret_cast<const char*>(links0.data()), links0.size() * sizeof(uint32_t));
+        for (uint32_t docId = 0; docId < numDocs; docId++) {
+            const auto& u = upper[docId];
+            out.write(reinterpret_cast<const char*>(u.data()), u.size() * sizeof(uint32_t));
+        }
+    }
+
+    // numDocs must match the vector file the graph was built from
+    void load(const fs::path& path, uint64_t expectedDocs) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) {
+            throw std::runtime_error("Cannot open HNSW index " + path.string() + " (run docVectorBuilder)");
+        }
+        char magic[8];
+        int32_t top = -1;
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char*>(&numDocs), sizeof(numDocs));
+        in.read(reinterpret_cast<char*>(&m), sizeof(m));
+        in.read(reinterpret_cast<char*>(&top), sizeof(top));
+        in.read(reinterpret_cast<char*>(&entry), sizeof(entry));
+        if (!in || std::memcmp(magic, HNSW_MAGIC, sizeof(magic)) != 0 || m < 2) {
+            throw std::runtime_error("Not an HNSW index: " + path.string());
+        }
+        if (numDocs != expectedDocs) {
+            throw std::runtime_error("HNSW index covers " + std::to_string(numDocs) + " documents, vectors " +
+                                     std::to_string(expectedDocs) + " (rebuild with docVectorBuilder)");
+        }
+        m0 = 2 * m;
+        maxLevel = top;
+        level.resize(numDocs);
+        links0.resize(static_cast<size_t>(numDocs) * (m0 + 1));
+        in.read(reinterpret_cast<char*>(level.data()), level.size() * sizeof(int32_t));
+        in.read(reinterpret_cast<char*>(links0.data()), links0.size() * sizeof(uint32_t));
+        upper.assign(numDocs, {});
+        inGraph = 0;
+        for (uint32_t docId = 0; docId < numDocs && in; docId++) {
+            if (level[docId] >= 0) inGraph++;
+            if (level[docId] <= 0) continue;
+            upper[docId].resize(static_cast<size_t>(level[docId]) * (m + 1));
+            in.read(reinterpret_cast<char*>(upper[docId].data()), upper[docId].size() * sizeof(uint32_t));
+        }
+        if (!in) {
+            throw std::runtime_error("HNSW index is truncated: " + path.string());
+        }
+    }
+
+private:
+    using Scored = std::pair<float, uint32_t>;  // (similarity, docId)
+
+    uint32_t m = 16;
+    uint32_t m0 = 32;
+    uint32_t numDocs = 0;
+    uint32_t inGraph = 0;
+    int maxLevel = -1;
+    uint32_t entry = 0;
+    std::vector<int32_t> level;                 // per docID, -1 = not inserted
+    std::vector<uint32_t> links0;               // numDocs x (m0 + 1): [count][links]
+    std::vector<std::vector<uint32_t>> upper;   // per docID: level x (m + 1)
+
+    uint32_t* links(uint32_t docId, int lc) {
+        return lc == 0 ? &links0[static_cast<size_t>(docId) * (m0 + 1)]
+                       : &upper[docId][static_cast<size_t>(lc - 1) * (m + 1)];
+    }
+    const uint32_t* links(uint32_t docId, int lc) const {
+        return lc == 0 ? &links0[static_cast<size_t>(docId) * (m0 + 1)]
+                       : &upper[docId][static_cast<size_t>(lc - 1) * (m + 1)];
+    }
+
+    // Moves cur to its best neighbour on layer lc until none is better
+    void greedy(const Vectors& vectors, const float* query, int lc, uint32_t& cur, float& curScore) const {
+        for (bool improved = true; improved;) {
+            improved = false;
+            const uint32_t* l = links(cur, lc);
+            for (uint32_t i = 1; i <= l[0]; i++) {
+                float s = dot(query, vectors.row(l[i]), vectors.dim());
+                if (s > curScore) {
+                    curScore = s;
+                    cur = l[i];
+                    improved = true;
+                }
+            }
+        }
+    }
+
+    // Beam search on layer lc from the entry points; returns up to ef
+    // documents, best first
+    std::vector<Scored> searchLayer(const Vectors& vectors, const float* query, const std::vector<Scored>& entries,
+                                    size_t ef, int lc, std::vector<bool>& visited) const {
+        std::priority_queue<Scored> candidates;                                       // best on top
+        std::priority_queue<Scored, std::vector<Scored>, std::greater<Scored>> found;  // worst on top
+        for (const auto& e : entries) {
+            if (visited[e.second]) continue;
+            visited[e.second] = true;
+            candidates.push(e);
+            found.push(e);
+        }
+        while (found.size() > ef) found.pop();
+
+        while (!candidates.empty()) {
+            Scored c = candidates.top();
+            if (found.size() >= ef && c.first < found.top().first) break;
+            candidates.pop();
+
+            const uint32_t* l = links(c.second, lc);
+            for (uint32_t i = 1; i <= l[0]; i++) {
+                uint32_t n = l[i];
+                if (visited[n]) continue;
+                visited[n] = true;
+                float s = dot(query, vectors.row(n), vectors.dim());
+                if (found.size() < ef || s > found.top().first) {
+                    candidates.push({s, n});
+                    found.push({s, n});
+                    if (found.size() > ef) found.pop();
+                }
+            }
+        }
+
+        std::vector<Scored> out(found.size());
+        for (size_t i = out.size(); i-- > 0;) {
+            out[i] = found.top();
+            found.pop();
+        }
+        return out;
+    }
+
+    // Neighbour selection heuristic: keep a candidate only if it is closer to
+    // the base than to every neighbour kept so far, which spreads the links
+    // across directions; top up with the closest rejected ones.
+    // candidates: best first
+    std::vector<uint32_t> selectNeighbors(const Vectors& vectors, const std::vector<Scored>& candidates,
+                                          uint32_t limit) const {
+        std::vector<uint32_t> kept, rejected;
+        for (const auto& [score, docId] : candidates) {
+            if (kept.size() >= limit) break;
+            bool diverse = true;
+            for (uint32_t k : kept) {
+                if (dot(vectors.row(docId), vectors.row(k), vectors.dim()) > score) {
+                    diverse = false;
+                    break;
+                }
+            }
+            (diverse ? kept : rejected).push_back(docId);
+        }
+        for (size_t i = 0; i < rejected.size() && kept.size() < limit; i++) kept.push_back(rejected[i]);
+        return kept;
+    }
+
+    void setLinks(uint32_t docId, int lc, const std::vector<uint32_t>& ids) {
+        uint32_t* l = links(docId, lc);
+        l[0] = static_cast<uint32_t>(ids.size());
+        std::copy(ids.begin(), ids.end(), l + 1);
+    }
+
+    void insert(const Vectors& vectors, uint32_t docId, int l, size_t efConstruction) {
+        level[docId] = l;
+        if (l > 0) upper[docId].assign(static_cast<size_t>(l) * (m + 1), 0);
+        inGraph++;
+        if (maxLevel < 0) {
+            entry = docId;
+            maxLevel = l;
+            return;
+        }
+
+        const float* q = vectors.row(docId);
+        const uint32_t dim = vectors.dim();
+        uint32_t cur = entry;
+        float curScore = dot(q, vectors.row(cur), dim);
+        for (int lc = maxLevel; lc > l; lc--) {
+            greedy(vectors, q, lc, cur, curScore);
+        }
+
+        std::vector<Scored> entries{{curScore, cur}};
+        std::vector<bool> visited(numDocs, false);
+        for (int lc = std::min(l, maxLevel); lc >= 0; lc--) {
+            std::fill(visited.begin(), visited.end(), false);
+            auto found = searchLayer(vectors, q, entries, efConstruction, lc, visited);
+            const uint32_t limit = lc == 0 ? m0 : m;
+            auto neighbors = selectNeighbors(vectors, found, m);
+            setLinks(docId, lc, neighbors);
+
+            // Link back, pruning a neighbour's list when it overflows
+            for (uint32_t n : neighbors) {
+                uint32_t* nl = links(n, lc);
+                if (nl[0] < limit) {
+                    nl[1 + nl[0]++] = docId;
+                    continue;
+                }
+                const float* nv = vectors.row(n);
+                std::vector<Scored> pool{{dot(nv, q, dim), docId}};
+                for (uint32_t i = 1; i <= nl[0]; i++) pool.push_back({dot(nv, vectors.row(nl[i]), dim), nl[i]});
+                std::sort(pool.begin(), pool.end(), std::greater<Scored>());
+                setLinks(n, lc, selectNeighbors(vectors, pool, limit));
+            }
+            entries = std::move(found);
+        }
+
+        if (l > maxLevel) {
+            maxLevel = l;
+            entry = docId;
+        }
+    }
+};
+
+}  // namespace dense_index
@@ -0,0 +1,260 @@
+/*
+ * Document Vector Builder
+ *
+ * Gives every document a dense vector and indexes the vectors with HNSW
+ * (dense_index.hpp) or IVF-PQ (ivf_pq.hpp), for search_semantic --hybrid.
+ *
+ * A document's vector is the idf-weighted average of the word embeddings of
+ * its lemmas, (1 + log tf) * idf per lemma, L2-normalized: the embedding
+ * features of k-means sharding (shard_cluster.hpp). Lemmas without an
+ * embedding are skipped; a document with none gets a zero vector and stays
+ * out of the graph.
+ *
+ * Two passes over the forward index: global df, then the vectors. The index
+ * (--index, default config "dense_index") is built from the mapped vector
+ * file, then a sample of documents is searched against brute force to report
+ * its recall.
+ *
+ * Output (indexes/<dense_dir>):
+ *   doc_vectors.bin, lemma_vectors.bin, and hnsw.bin and/or ivfpq.bin
+ *
+ * Usage (from backend/cpp, after forwardIndex and embeddings_setup.py):
+ *   ./build/docVectorBuilder
+ *   ./build/docVectorBuilder --index hnsw --m 24 --ef-construction 400
+ *   ./build/docVectorBuilder --index ivfpq --lists 1024 --subquantizers 25
+ */
+
+#include "config.hpp"
+#include "lexicon.hpp"
+#include "shard_cluster.hpp"
+#include "dense_index.hpp"
+#include "ivf_pq.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+using namespace std;
+using namespace chrono;
+
+const size_t RECALL_QUERIES = 200;
+const size_t RECALL_K = 10;
+
+// Lemma term frequencies of "doc_id|total_terms|title|abstract|body"
+bool parseForwardLine(const string& line, unordered_map<int, int>& termFreqs) {
+    size_t bar1 = line.find('|');
+    size_t bar2 = (bar1 == string::npos) ? string::npos : line.find('|', bar1 + 1);
+    if (bar2 == string::npos) return false;
+
+    termFreqs.clear();
+    const char* p = line.c_str() + bar2 + 1;
+    while (*p) {
+        if (*p == '|' || *p == ',') {
+            p++;
+            continue;
+        }
+        char* end;
+        long lemma = strtol(p, &end, 10);
+        if (end == p) {
+            p++;
+            continue;
+        }
+        termFreqs[static_cast<int>(lemma)]++;
+        p = end;
+    }
+    return true;
+}
+
+void loadLemmaTable(const fs::path& indexesDir, const json& config, LemmaTable& table) {
+    if (loadLemmaTableBinary((indexesDir / "embeddings" / "lexicon.bin").string(), table)) {
+        return;
+    }
+    fs::path lexiconPath = indexesDir / config["lexicon_file"].get<string>();
+    ifstream lexFile(lexiconPath);
+    if (!lexFile.is_open()) {
+        throw runtime_error("Cannot open lexicon at " + lexiconPath.string());
+    }
+    json lexicon;
+    lexFile >> lexicon;
+    loadLemmaTableJSON(lexicon, table);
+}
+
+// Recall@RECALL_K (percent) of search against brute force, with a sample of
+// documents as queries. A returned document counts if it scores at least the
+// k-th best, since documents tied with the k-th are equally good answers.
+double measureRecall(const dense_index::Vectors& vectors,
+                     const function<vector<dense_index::Neighbor>(const float*, size_t)>& search) {
+    const uint32_t dim = vectors.dim();
+    size_t stride = max<size_t>(1, static_cast<size_t>(vectors.size()) / RECALL_QUERIES);
+    size_t hits = 0, total = 0;
+    for (size_t q = 0; q < vectors.size() && total < RECALL_QUERIES * RECALL_K; q += stride) {
+        uint32_t queryDoc = static_cast<uint32_t>(q);
+        if (vectors.isZero(queryDoc)) continue;
+        const float* query = vectors.row(queryDoc);
+
+        vector<pair<float, uint32_t>> exact;
+        for (uint32_t d = 0; d < vectors.size(); d++) {
+            exact.push_back({dense_index::dot(query, vectors.row(d), dim), d});
+        }
+        size_t k = min(RECALL_K, exact.size());
+        partial_sort(exact.begin(), exact.begin() + k, exact.end(), greater<pair<float, uint32_t>>());
+
+        auto approx = search(query, k);
+        float kth = exact[k - 1].first - 1e-6f;
+        hits += count_if(approx.begin(), approx.end(), [&](const dense_index::Neighbor& n) { return n.score >= kth; });
+        total += k;
+    }
+    return total > 0 ? 100.0 * hits / total : 0.0;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        cout << "======================================" << endl;
+        cout << "  DOCUMENT VECTOR BUILDER" << endl;
+        cout << "======================================\n" << endl;
+
+        // this file is in backend/cpp
+        fs::path backendDir = fs::current_path().parent_path();
+        json config = loadConfig(backendDir);
+
+        dense_index::Hnsw::Params params;
+        params.m = config.value("hnsw_m", 16u);
+        params.efConstruction = config.value("hnsw_ef_construction", 200u);
+        size_t efSearch = config.value("hnsw_ef_search", 64);
+        ivf_pq::Index::Params pqParams;
+        pqParams.lists = config.value("ivf_lists", 0u);
+        pqParams.subquantizers = config.value("pq_subquantizers", 25u);
+        size_t nprobe = config.value("ivf_nprobe", 16);
+        size_t rerank = config.value("pq_rerank", 200);
+        string indexType = config.value("dense_index", "hnsw");
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            if (arg == "--index" && i + 1 < argc) {
+                indexType = argv[++i];
+            } else if (arg == "--lists" && i + 1 < argc) {
+                pqParams.lists = static_cast<uint32_t>(stoul(argv[++i]));
+            } else if (arg == "--subquantizers" && i + 1 < argc) {
+                pqParams.subquantizers = static_cast<uint32_t>(stoul(argv[++i]));
+            } else if (arg == "--m" && i + 1 < argc) {
+                params.m = static_cast<uint32_t>(stoul(argv[++i]));
+            } else if (arg == "--ef-construction" && i + 1 < argc) {
+                params.efConstruction = static_cast<uint32_t>(stoul(argv[++i]));
+            }
+        }
+
+        if (indexType != "hnsw" && indexType != "ivfpq" && indexType != "both") {
+            throw runtime_error("Unknown --index '" + indexType + "' (hnsw, ivfpq or both)");
+        }
+
+        fs::path indexesDir = backendDir / config["indexes_dir"].get<string>();
+        fs::path forwardIndexPath = indexesDir / config["forward_index_file"].get<string>();
+        fs::path embeddingsDir = indexesDir / "embeddings";
+        fs::path outDir = indexesDir / config.value("dense_dir", "dense");
+
+        cout << "Configuration:" << endl;
+        cout << "  Input: " << forwardIndexPath.string() << endl;
+        cout << "  Embeddings: " << embeddingsDir.string() << endl;
+        cout << "  Output: " << outDir.string() << endl;
+        cout << "  Index: " << indexType << "\n" << endl;
+
+        auto startTime = high_resolution_clock::now();
+
+        // Pass 1: global df
+        unordered_map<int, int> globalDf;
+        int64_t numDocs = 0;
+        {
+            ifstream in(forwardIndexPath);
+            if (!in.is_open()) {
+                throw runtime_error("Cannot open forward index at " + forwardIndexPath.string());
+            }
+            string line;
+            unordered_map<int, int> termFreqs;
+            while (getline(in, line)) {
+                if (parseForwardLine(line, termFreqs)) {
+                    for (const auto& [lemma, tf] : termFreqs) globalDf[lemma]++;
+                }
+                numDocs++;  // docID = line number, so unparsable lines keep theirs
+            }
+        }
+        if (numDocs == 0) {
+            throw runtime_error("Forward index is empty");
+        }
+
+        LemmaTable words;
+        loadLemmaTable(indexesDir, config, words);
+        shard_cluster::FeatureSpace space(globalDf, numDocs, embeddingsDir.string(), words);
+        const uint32_t dim = space.dim();
+        cout << "Documents: " << numDocs << ", " << space.embeddedLemmas() << " of " << globalDf.size()
+             << " lemmas have embeddings (" << dim << " dims)" << endl;
+
+        // Pass 2: one vector per document
+        vector<float> data(static_cast<size_t>(numDocs) * dim, 0.0f);
+        size_t zeroDocs = 0;
+        {
+            ifstream in(forwardIndexPath);
+            string line;
+            unordered_map<int, int> termFreqs;
+            for (int64_t docId = 0; docId < numDocs && getline(in, line); docId++) {
+                if (!parseForwardLine(line, termFreqs)) termFreqs.clear();
+                auto v = space.docVector(termFreqs);
+                if (v.empty()) zeroDocs++;
+                float* row = &data[static_cast<size_t>(docId) * dim];
+                for (const auto& [d, w] : v) row[d] = w;
+            }
+        }
+
+        fs::create_directories(outDir);
+        dense_index::writeVectors(outDir / "doc_vectors.bin", data, static_cast<uint64_t>(numDocs), dim);
+        dense_index::writeLemmaVectors(outDir / "lemma_vectors.bin", space.weightedLemmaVectors(), dim);
+        data.clear();
+        data.shrink_to_fit();
+        cout << "Vectors written (" << zeroDocs << " documents without embedded lemmas)" << endl;
+
+        dense_index::Vectors vectors(outDir / "doc_vectors.bin");
+
+        if (indexType == "hnsw" || indexType == "both") {
+            auto graphStart = high_resolution_clock::now();
+            dense_index::Hnsw graph;
+            graph.build(vectors, params);
+            graph.save(outDir / "hnsw.bin");
+            auto graphMs = duration_cast<milliseconds>(high_resolution_clock::now() - graphStart).count();
+            cout << "HNSW: " << graph.nodes() << " nodes, " << graph.levels() << " layers in " << graphMs << "ms" << endl;
+
+            double recall = measureRecall(vectors, [&](const float* q, size_t k) {
+                return graph.search(vectors, q, k, efSearch);
+            });
+            cout << "  Recall@" << RECALL_K << " (ef_search=" << efSearch << "): " << recall << "%" << endl;
+        }
+
+        if (indexType == "ivfpq" || indexType == "both") {
+            auto pqStart = high_resolution_clock::now();
+            ivf_pq::Index pq;
+            pq.build(vectors, pqParams);
+            pq.save(outDir / "ivfpq.bin");
+            auto pqMs = duration_cast<milliseconds>(high_resolution_clock::now() - pqStart).count();
+            cout << "IVF-PQ: " << pq.indexed() << " documents in " << pq.lists() << " lists, "
+                 << pq.subquantizers() << " x 8-bit codes (" << pq.bytesPerDocument()
+                 << " bytes per document in memory, " << dim * sizeof(float) << " as floats) in " << pqMs << "ms" << endl;
+
+            double recall = measureRecall(vectors, [&](const float* q, size_t k) {
+                return pq.search(vectors, q, k, nprobe, rerank);
+            });
+            cout << "  Recall@" << RECALL_K << " (nprobe=" << nprobe << ", rerank=" << rerank << "): " << recall << "%" << endl;
+        }
+
+        auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - startTime).count();
+        cout << "\n=== Document Vectors Complete ===" << endl;
+        cout << "Time: " << duration << "ms" << endl;
+
+    } catch (exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+/*
+ * Document Reordering by Recursive Graph Bisection
+ *
+ * docIDs are forward_index.txt line numbers, assigned in PMC ID order,
+ * which scatters documents on one topic over the whole ID range. reorderDocs
+ * renumbers the documents so that documents sharing terms get nearby docIDs:
+ * posting lists then have small gaps and long dense stretches, which roaring
+ * bitmaps (roaring.hpp) store as runs and bitsets and intersect a container
+ * at a time.
+ *
+ * The order comes from recursive graph bisection (BP, Dhulipala et al., KDD
+ * 2016): split the documents in two halves, then repeatedly swap the pairs
+ * of documents whose move most lowers the estimated cost of encoding the
+ * terms' posting lists in the two halves,
+ *   sum over terms  d1 * log2(n1 / (d1 + 1)) + d2 * log2(n2 / (d2 + 1))
+ * (d1, d2 = documents of the term in each half of sizes n1, n2), and recurse
+ * into both halves. The first levels of the recursion run on parallel
+ * threads.
+ *
+ * Documents are given as sets of terms (Collection); terms found in a single
+ * document are left out, since they cannot bring two documents together.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace doc_reorder {
+
+// Documents as sets of dense term numbers, compressed sparse row form
+struct Collection {
+    uint32_t numTerms = 0;
+    std::vector<uint64_t> offsets{0};
+    std::vector<uint32_t> terms;
+
+    uint32_t size() const { return static_cast<uint32_t>(offsets.size() - 1); }
+    uint64_t postings() const { return terms.size(); }
+    const uint32_t* begin(uint32_t doc) const { return terms.data() + offsets[doc]; }
+    const uint32_t* end(uint32_t doc) const { return terms.data() + offsets[doc + 1]; }
+
+    // Appends the next document; docTerms must be distinct and below numTerms
+    void add(const std::vector<uint32_t>& docTerms) {
+        terms.insert(terms.end(), docTerms.begin(), docTerms.end());
+        offsets.push_back(terms.size());
+    }
+};
+
+struct Params {
+    uint32_t iterations = 20;     // swap rounds per bisection
+    uint32_t minPartition = 16;   // partitions this small keep their order
+    uint32_t threads = 1;
+};
+
+// Average size in bits of a posting of the collection's posting lists with
+// order[newDocId] = oldDocId, if each docID gap were Elias-gamma coded
+// (2 floor(log2 gap) + 1 bits): a measure of how well the order clusters
+inline double bitsPerPosting(const Collection& c, const std::vector<uint32_t>& order) {
+    std::vector<uint32_t> last(c.numTerms, UINT32_MAX);
+    double bits = 0.0;
+    for (uint32_t newId = 0; newId < order.size(); newId++) {
+        for (const uint32_t* t = c.begin(order[newId]); t != c.end(order[newId]); t++) {
+            uint32_t gap = last[*t] == UINT32_MAX ? newId + 1 : newId - last[*t];
+            bits += std::floor(std::log2(static_cast<double>(gap))) * 2.0 + 1.0;
+            last[*t] = newId;
+        }
+    }
+    return c.postings() > 0 ? bits / c.postings() : 0.0;
+}
+
+namespace detail {
+
+// Per-thread term arrays, kept zeroed between bisections by resetting only
+// the terms a bisection touched
+struct Scratch {
+    std::vector<int32_t> leftDeg, rightDeg;
+    std::vector<float> toRight, toLeft;  // cost saved by moving a document across, per term
+    std::vector<uint32_t> touched;
+    std::vector<std::pair<float, uint32_t>> leftGains, rightGains;
+
+    explicit Scratch(uint32_t numTerms)
+        : leftDeg(numTerms, 0), rightDeg(numTerms, 0), toRight(numTerms, 0.0f), toLeft(numTerms, 0.0f) {}
+};
+
+inline double termCost(double deg, double n) {
+    return deg > 0 ? deg * std::log2(n / (deg + 1.0)) : 0.0;
+}
+
+// One bisection of docs[0, n): left half [0, n/2), right half [n/2, n)
+inline void bisect(const Collection& c, uint32_t* docs, size_t n, const Params& params, Scratch& s) {
+    const size_t half = n / 2;
+    const double n1 = static_cast<double>(half), n2 = static_cast<double>(n - half);
+
+    for (uint32_t iter = 0; iter < params.iterations; iter++) {
+        s.touched.clear();
+        for (size_t i = 0; i < n; i++) {
+            std::vector<int32_t>& deg = i < half ? s.leftDeg : s.rightDeg;
+            for (const uint32_t* t = c.begin(docs[i]); t != c.end(docs[i]); t++) {
+                if (s.leftDeg[*t] == 0 && s.rightDeg[*t] == 0) s.touched.push_back(*t);
+                deg[*t]++;
+            }
+        }
+        for (uint32_t t : s.touched) {
+            double d1 = s.leftDeg[t], d2 = s.rightDeg[t];
+            double now = termCost(d1, n1) + termCost(d2, n2);
+            s.toRight[t] = static_cast<float>(now - termCost(d1 - 1, n1) - termCost(d2 + 1, n2));
+            s.toLeft[t] = static_cast<float>(now - termCost(d1 + 1, n1) - termCost(d2 - 1, n2));
+        }
+
+        s.leftGains.clear();
+        s.rightGains.clear();
+        for (size_t i = 0; i < n; i++) {
+            float gain = 0.0f;
+            const std::vector<float>& move = i < half ? s.toRight : s.toLeft;
+            for (const uint32_t* t = c.begin(docs[i]); t != c.end(docs[i]); t++) gain += move[*t];
+            (i < half ? s.leftGains : s.rightGains).push_back({gain, docs[i]});
+        }
+        for (uint32_t t : s.touched) {
+            s.leftDeg[t] = 0;
+            s.rightDeg[t] = 0;
+        }
+
+        auto byGain = [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) {
+            return a.first > b.first;
+        };
+        std::sort(s.leftGains.begin(), s.leftGains.end(), byGain);
+        std::sort(s.rightGains.begin(), s.rightGains.end(), byGain);
+
+        // Swap the best pairs while a pair still pays for itself
+        size_t swaps = 0;
+        while (swaps < s.leftGains.size() && swaps < s.rightGains.size() &&
+               s.leftGains[swaps].first + s.rightGains[swaps].first > 0.0f) {
+            std::swap(s.leftGains[swaps].second, s.rightGains[swaps].second);
+            swaps++;
+        }
+        for (size_t i = 0; i < half; i++) docs[i] = s.leftGains[i].second;
+        for (size_t i = half; i < n; i++) docs[i] = s.rightGains[i - half].second;
+        if (swaps == 0) break;
+    }
+}
+
+inline void reorder(const Collection& c, uint32_t* docs, size_t n, const Params& params, Scratch& s,
+                    uint32_t parallelDepth) {
+    if (n <= params.minPartition || n < 2) return;
+    bisect(c, docs, n, params, s);
+
+    const size_t half = n / 2;
+    if (parallelDepth > 0) {
+        std::thread left([&, half] {
+            Scratch own(c.numTerms);
+            reorder(c, docs, half, params, own, parallelDepth - 1);
+        });
+        reorder(c, docs + half, n - half, params, s, parallelDepth - 1);
+        left.join();
+    } else {
+        reorder(c, docs, half, params, s, 0);
+        reorder(c, docs + half, n - half, params, s, 0);
+    }
+}
+
+}  // namespace detail
+
+// The new order: order[newDocId] = oldDocId
+inline std::vector<uint32_t> graphBisection(const Collection& c, const Params& params) {
+    std::vector<uint32_t> order(c.size());
+    for (uint32_t d = 0; d < order.size(); d++) order[d] = d;
+
+    uint32_t parallelDepth = 0;
+    while ((1u << parallelDepth) < params.threads) parallelDepth++;
+    detail::Scratch scratch(c.numTerms);
+    detail::reorder(c, order.data(), order.size(), params, scratch, parallelDepth);
+    return order;
+}
+
+}  // namespace doc_reorder
@@ -0,0 +1,491 @@
+#pragma once
+
+/*
+ * Document Store
+ *
+ * Display metadata (PMC ID, title, authors, abstract) for every indexed
+ * document, written by forwardIndex next to forward_index.txt and read by
+ * the search engines so top-K results come back with their metadata
+ * attached instead of being looked up again in Python.
+ *
+ * Each record also carries the text snippets are cut from (the abstract, or
+ * the start of the body when there is no abstract) and a token-offset index
+ * over it: byte offset, length and lemma ID of every token, so snippet.hpp
+ * can find the densest window of query terms without re-tokenizing.
+ *
+ * Documents are addressed by integer docID: the line number of the document
+ * in forward_index.txt. Records are packed into ~16 KB blocks and each block
+ * is stored raw or as one zstd frame; fetching a document decodes one block,
+ * and a small LRU cache of decoded blocks serves neighbouring hits.
+ * The PMC ID table sits uncompressed in the footer so postings, which still
+ * carry PMC IDs, are mapped to docIDs with a binary search and no block reads.
+ *
+ * File layout (little-endian):
+ *   Header (48 bytes):
+ *     [magic:8 "MGDOCS02"][codec:4][blockSize:4][numDocs:8][numBlocks:8]
+ *     [tableOffset:8][reserved:8]
+ *   Data:
+ *     block0, block1, ...
+ *   Tables (at tableOffset):
+ *     numBlocks x [offset:8][storedSize:4][rawSize:4]
+ *     numDocs   x [block:4][offsetInBlock:4]
+ *     (numDocs + 1) x [idOffset:4], [idsSize:4][ids blob]   PMC IDs by docID
+ *     numDocs   x [docId:4]                                  docIDs sorted by PMC ID
+ *
+ * Record (inside a decoded block):
+ *   [idLen:2][id][titleLen:4][title][numAuthors:2]([len:2][author])...
+ *   [abstractLen:4][abstract][leadLen:4][lead]
+ *   [numTokens:4] numTokens x (varint startDelta, varint length, varint lemmaId+1)
+ *
+ * startDelta is the offset from the previous token's start; lemmaId+1 is 0
+ * for tokens that are not in the lexicon.
+ *
+ * Compression uses zstd when built with -DMINIGOOGLE_WITH_ZSTD -lzstd
+ * (see corpus_pack.hpp); without it blocks are stored raw and the format
+ * is otherwise identical.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef MINIGOOGLE_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace doc_store {
+
+constexpr char MAGIC[8] = {'M', 'G', 'D', 'O', 'C', 'S', '0', '2'};
+constexpr uint32_t DEFAULT_BLOCK_SIZE = 16 * 1024;
+
+enum Codec : uint32_t {
+    CODEC_RAW = 0,
+    CODEC_ZSTD = 1,
+};
+
+struct BlockEntry {
+    uint64_t offset;
+    uint32_t storedSize;
+    uint32_t rawSize;
+};
+
+struct DocLocation {
+    uint32_t block;
+    uint32_t offsetInBlock;
+};
+
+// One token of a record's snippet text.
+struct TokenSpan {
+    uint32_t start;   // byte offset in snippetText()
+    uint32_t length;
+    int32_t lemmaId;  // -1 if not in the lexicon
+};
+
+struct DocRecord {
+    std::string docId;
+    std::string title;
+    std::vector<std::string> authors;
+    std::string abstract;
+    std::string lead;               // start of the body, only stored when abstract is empty
+    std::vector<TokenSpan> tokens;  // token-offset index over snippetText()
+
+    const std::string& snippetText() const { return abstract.empty() ? lead : abstract; }
+};
+
+inline Codec defaultCodec() {
+#ifdef MINIGOOGLE_WITH_ZSTD
+    return CODEC_ZSTD;
+#else
+    return CODEC_RAW;
+#endif
+}
+
+// ---------------------- Writer ----------------------
+
+// Records must be added in docID order (0, 1, 2, ...).
+class Writer {
+public:
+    Writer(const std::string& path, Codec codec = defaultCodec(),
+           uint32_t blockSize = DEFAULT_BLOCK_SIZE, int level = 3)
+        : codec(codec), blockSize(blockSize), level(level) {
+#ifndef MINIGOOGLE_WITH_ZSTD
+        if (codec == CODEC_ZSTD) {
+            throw std::runtime_error("zstd requested but this binary was built without MINIGOOGLE_WITH_ZSTD");
+        }
+#endif
+        out.open(path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("Cannot create document store at " + path);
+        }
+
+        // Placeholder header, rewritten by finish()
+        char header[48] = {0};
+        out.write(header, sizeof(header));
+        position = sizeof(header);
+    }
+
+    void add(const DocRecord& doc) {
+        size_t before = block.size();
+        putString16(doc.docId);
+        putString32(doc.title);
+        putU16(static_cast<uint16_t>(std::min<size_t>(doc.authors.size(), 0xFFFF)));
+        for (size_t i = 0; i < doc.authors.size() && i < 0xFFFF; i++) {
+            putString16(doc.authors[i]);
+        }
+        putString32(doc.abstract);
+        putString32(doc.lead);
+
+        putU32(static_cast<uint32_t>(doc.tokens.size()));
+        uint32_t prevStart = 0;
+        for (const TokenSpan& t : doc.tokens) {
+            putVarint(t.start - prevStart);
+            putVarint(t.length);
+            putVarint(static_cast<uint32_t>(t.lemmaId + 1));
+            prevStart = t.start;
+        }
+
+        // Start a new block if this record pushed a non-empty block past the
+        // limit; an oversized record simply gets a block of its own.
+        if (block.size() > blockSize && before > 0) {
+            std::string record = block.substr(before);
+            block.resize(before);
+            flushBlock();
+            block = std::move(record);
+            before = 0;
+        }
+
+        locations.push_back({static_cast<uint32_t>(blocks.size()), static_cast<uint32_t>(before)});
+        idOffsets.push_back(static_cast<uint32_t>(ids.size()));
+        ids += doc.docId;
+    }
+
+    void finish() {
+        if (!block.empty()) flushBlock();
+
+        uint64_t tableOffset = position;
+        out.write(reinterpret_cast<const char*>(blocks.data()), blocks.size() * sizeof(BlockEntry));
+        out.write(reinterpret_cast<const char*>(locations.data()), locations.size() * sizeof(DocLocation));
+
+        std::vector<uint32_t> bounds = idOffsets;
+        bounds.push_back(static_cast<uint32_t>(ids.size()));
+        uint32_t idsSize = static_cast<uint32_t>(ids.size());
+        out.write(reinterpret_cast<const char*>(bounds.data()), bounds.size() * sizeof(uint32_t));
+        out.write(reinterpret_cast<const char*>(&idsSize), sizeof(idsSize));
+        out.write(ids.data(), ids.size());
+
+        std::vector<uint32_t> sorted(locations.size());
+        for (uint32_t d = 0; d < sorted.size(); d++) sorted[d] = d;
+        std::sort(sorted.begin(), sorted.end(), [&](uint32_t a, uint32_t b) {
+            return idAt(bounds, a) < idAt(bounds, b);
+        });
+        out.write(reinterpret_cast<const char*>(sorted.data()), sorted.size() * sizeof(uint32_t));
+
+        uint32_t codecId = codec;
+        uint64_t numDocs = locations.size();
+        uint64_t numBlocks = blocks.size();
+        uint64_t reserved = 0;
+        out.seekp(0);
+        out.write(MAGIC, sizeof(MAGIC));
+        out.write(reinterpret_cast<const char*>(&codecId), sizeof(codecId));
+        out.write(reinterpret_cast<const char*>(&blockSize), sizeof(blockSize));
+        out.write(reinterpret_cast<const char*>(&numDocs), sizeof(numDocs));
+        out.write(reinterpret_cast<const char*>(&numBlocks), sizeof(numBlocks));
+        out.write(reinterpret_cast<const char*>(&tableOffset), sizeof(tableOffset));
+        out.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+        out.close();
+    }
+
+    size_t size() const { return locations.size(); }
+    size_t numBlocks() const { return blocks.size() + (block.empty() ? 0 : 1); }
+
+private:
+    std::ofstream out;
+    Codec codec;
+    uint32_t blockSize;
+    int level;
+    uint64_t position = 0;
+    std::string block;
+    std::string scratch;
+    std::vector<BlockEntry> blocks;
+    std::vector<DocLocation> locations;
+    std::vector<uint32_t> idOffsets;
+    std::string ids;
+
+    std::string_view idAt(const std::vector<uint32_t>& bounds, uint32_t d) const {
+        return std::string_view(ids.data() + bounds[d], bounds[d + 1] - bounds[d]);
+    }
+
+    void putU16(uint16_t v) { block.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+    void putU32(uint32_t v) { block.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+
+    void putVarint(uint32_t v) {
+        while (v >= 0x80) {
+            block.push_back(static_cast<char>((v & 0x7F) | 0x80));
+            v >>= 7;
+        }
+        block.push_back(static_cast<char>(v));
+    }
+
+    void putString16(const std::string& s) {
+        size_t n = std::min<size_t>(s.size(), 0xFFFF);
+        putU16(static_cast<uint16_t>(n));
+        block.append(s.data(), n);
+    }
+
+    void putString32(const std::string& s) {
+        putU32(static_cast<uint32_t>(s.size()));
+        block.append(s);
+    }
+
+    void flushBlock() {
+        BlockEntry e{};
+        e.offset = position;
+        e.rawSize = static_cast<uint32_t>(block.size());
+
+        if (codec == CODEC_ZSTD) {
+#ifdef MINIGOOGLE_WITH_ZSTD
+            scratch.resize(ZSTD_compressBound(block.size()));
+            size_t n = ZSTD_compress(&scratch[0], scratch.size(), block.data(), block.size(), level);
+            if (ZSTD_isError(n)) {
+                throw std::runtime_error(std::string("zstd compression failed: ") + ZSTD_getErrorName(n));
+            }
+            out.write(scratch.data(), n);
+            e.storedSize = static_cast<uint32_t>(n);
+#endif
+        } else {
+            out.write(block.data(), block.size());
+            e.storedSize = e.rawSize;
+        }
+
+        position += e.storedSize;
+        blocks.push_back(e);
+        block.clear();
+    }
+};
+
+// ---------------------- Reader ----------------------
+
+// Keeps the block and location tables in memory plus up to cacheBlocks
+// decoded blocks. Not thread-safe: the block cache is mutated on every get().
+class Reader {
+public:
+    explicit Reader(const std::string& path, size_t cacheBlocks = 64)
+        : path(path), cacheCapacity(cacheBlocks > 0 ? cacheBlocks : 1) {
+        in.open(path, std::ios::binary);
+        if (!in.is_open()) {
+            throw std::runtime_error("Cannot open document store at " + path);
+        }
+
+        char magic[8];
+        uint64_t numDocs = 0, numBlocks = 0, tableOffset = 0, reserved = 0;
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char*>(&codec), sizeof(codec));
+        in.read(reinterpret_cast<char*>(&blockSize), sizeof(blockSize));
+        in.read(reinterpret_cast<char*>(&numDocs), sizeof(numDocs));
+        in.read(reinterpret_cast<char*>(&numBlocks), sizeof(numBlocks));
+        in.read(reinterpret_cast<char*>(&tableOffset), sizeof(tableOffset));
+        in.read(reinterpret_cast<char*>(&reserved), sizeof(reserved));
+
+        if (!in || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+            throw std::runtime_error("Not a document store: " + path);
+        }
+#ifndef MINIGOOGLE_WITH_ZSTD
+        if (codec == CODEC_ZSTD) {
+            throw std::runtime_error("Document store is zstd-compressed but this binary was built without MINIGOOGLE_WITH_ZSTD");
+        }
+#endif
+
+        blocks.resize(numBlocks);
+        locations.resize(numDocs);
+        in.seekg(tableOffset);
+        in.read(reinterpret_cast<char*>(blocks.data()), numBlocks * sizeof(BlockEntry));
+        in.read(reinterpret_cast<char*>(locations.data()), numDocs * sizeof(DocLocation));
+
+        uint32_t idsSize = 0;
+        idBounds.resize(numDocs + 1);
+        in.read(reinterpret_cast<char*>(idBounds.data()), idBounds.size() * sizeof(uint32_t));
+        in.read(reinterpret_cast<char*>(&idsSize), sizeof(idsSize));
+        ids.resize(idsSize);
+        in.read(&ids[0], idsSize);
+        sortedById.resize(numDocs);
+        in.read(reinterpret_cast<char*>(sortedById.data()), numDocs * sizeof(uint32_t));
+        if (!in) {
+            throw std::runtime_error("Document store tables are truncated: " + path);
+        }
+    }
+
+    size_t size() const { return locations.size(); }
+    size_t numBlocks() const { return blocks.size(); }
+
+    // Fetches the record for docId. Returns false if docId is out of range.
+    bool get(uint32_t docId, DocRecord& out) {
+        if (docId >= locations.size()) return false;
+
+        const DocLocation& loc = locations[docId];
+        const std::string& data = loadBlock(loc.block);
+        const char* p = data.data() + loc.offsetInBlock;
+
+        out.docId = getString16(p);
+        out.title = getString32(p);
+        uint16_t numAuthors = getU16(p);
+        out.authors.resize(numAuthors);
+        for (uint16_t i = 0; i < numAuthors; i++) {
+            out.authors[i] = getString16(p);
+        }
+        out.abstract = getString32(p);
+        out.lead = getString32(p);
+
+        uint32_t numTokens = getU32(p);
+        out.tokens.resize(numTokens);
+        uint32_t start = 0;
+        for (uint32_t i = 0; i < numTokens; i++) {
+            start += getVarint(p);
+            out.tokens[i].start = start;
+            out.tokens[i].length = getVarint(p);
+            out.tokens[i].lemmaId = static_cast<int32_t>(getVarint(p)) - 1;
+        }
+        return true;
+    }
+
+    // PMC ID of a document, straight from the footer table.
+    std::string_view pmcId(uint32_t docId) const {
+        return std::string_view(ids.data() + idBounds[docId], idBounds[docId + 1] - idBounds[docId]);
+    }
+
+    // PMC ID -> docID by binary search over the sorted ID table.
+    bool findDocId(std::string_view id, uint32_t& docIdOut) const {
+        auto it = std::lower_bound(sortedById.begin(), sortedById.end(), id,
+                                   [&](uint32_t d, std::string_view key) { return pmcId(d) < key; });
+        if (it == sortedById.end() || pmcId(*it) != id) return false;
+        docIdOut = *it;
+        return true;
+    }
+
+private:
+    std::string path;
+    std::ifstream in;
+    uint32_t codec = CODEC_RAW;
+    uint32_t blockSize = DEFAULT_BLOCK_SIZE;
+    std::vector<BlockEntry> blocks;
+    std::vector<DocLocation> locations;
+    std::vector<uint32_t> idBounds;
+    std::string ids;
+    std::vector<uint32_t> sortedById;
+
+    // LRU cache: most recently used block at the front of `lru`
+    size_t cacheCapacity;
+    std::list<std::pair<uint32_t, std::string>> lru;
+    std::unordered_map<uint32_t, std::list<std::pair<uint32_t, std::string>>::iterator> cached;
+    std::string scratch;
+
+    const std::string& loadBlock(uint32_t b) {
+        auto it = cached.find(b);
+        if (it != cached.end()) {
+            lru.splice(lru.begin(), lru, it->second);
+            return it->second->second;
+        }
+
+        std::string data;
+        if (!lru.empty() && lru.size() >= cacheCapacity) {
+            // Recycle the evicted block's buffer
+            data = std::move(lru.back().second);
+            cached.erase(lru.back().first);
+            lru.pop_back();
+        }
+
+        const BlockEntry& e = blocks[b];
+        in.clear();
+        in.seekg(e.offset);
+
+        if (codec == CODEC_ZSTD) {
+#ifdef MINIGOOGLE_WITH_ZSTD
+            scratch.resize(e.storedSize);
+            in.read(&scratch[0], e.storedSize);
+            data.resize(e.rawSize);
+            size_t n = ZSTD_decompress(&data[0], data.size(), scratch.data(), scratch.size());
+            if (ZSTD_isError(n) || n != e.rawSize) {
+                throw std::runtime_error("Corrupt zstd block in document store: " + path);
+            }
+#endif
+        } else {
+            data.resize(e.rawSize);
+            in.read(&data[0], e.rawSize);
+        }
+
+        if (!in) {
+            throw std::runtime_error("Short read in document store: " + path);
+        }
+
+        lru.emplace_front(b, std::move(data));
+        cached[b] = lru.begin();
+        return lru.front().second;
+    }
+
+    static uint16_t getU16(const char*& p) {
+        uint16_t v;
+        std::memcpy(&v, p, sizeof(v));
+        p += sizeof(v);
+        return v;
+    }
+
+    static uint32_t getU32(const char*& p) {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        p += sizeof(v);
+        return v;
+    }
+
+    static uint32_t getVarint(const char*& p) {
+        uint32_t v = 0;
+        for (int shift = 0;; shift += 7) {
+            uint8_t b = static_cast<uint8_t>(*p++);
+            v |= static_cast<uint32_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+    }
+
+    static std::string getString16(const char*& p) {
+        uint16_t n = getU16(p);
+        std::string s(p, n);
+        p += n;
+        return s;
+    }
+
+    static std::string getString32(const char*& p) {
+        uint32_t n = getU32(p);
+        std::string s(p, n);
+        p += n;
+        return s;
+    }
+};
+
+// Prints a record under a result line in the format api.py reads:
+//   "   Title: ...", "   Authors: a; b", "   Abstract: ..." (one line each)
+inline void printRecord(std::ostream& os, const DocRecord& rec) {
+    auto oneLine = [](const std::string& s) {
+        std::string r = s;
+        std::replace(r.begin(), r.end(), '\n', ' ');
+        std::replace(r.begin(), r.end(), '\r', ' ');
+        return r;
+    };
+
+    os << "   Title: " << oneLine(rec.title) << "\n";
+    os << "   Authors: ";
+    for (size_t i = 0; i < rec.authors.size(); i++) {
+        if (i > 0) os << "; ";
+        os << oneLine(rec.authors[i]);
+    }
+    os << "\n";
+    os << "   Abstract: " << oneLine(rec.abstract) << "\n";
+}
+
+} // namespace doc_store
@@ -0,0 +1,208 @@
+#pragma once
+
+/*
+ * Facet Counting
+ *
+ * Counts the values of attribute columns (attributes.hpp) over every
+ * document a query matches, e.g. matches per year or per journal. Executors
+ * hand each match's docID to Counter::add as they produce it, so the counts
+ * come out of the same pass that scores the matches.
+ *
+ * Matches are buffered in batches. Each batch is histogrammed one column at
+ * a time: column values are gathered 8 at a time with AVX2 (one 4-byte load
+ * per docID, masked down to the column width; the column's padding keeps the
+ * last load in bounds), or one at a time on CPUs without it, and added to
+ * four interleaved sub-histograms so runs of equal values (a few years
+ * dominate) do not serialize on a single counter. The AVX2 loop is compiled
+ * with a function target attribute and chosen at run time, as in
+ * score_kernels.hpp, so the build needs no -mavx2.
+ *
+ * Sampled mode counts only the matches whose docID hash falls below the
+ * sample rate and scales the counts up; the hash makes the sample the same
+ * for every query over the same documents.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "attributes.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define MINIGOOGLE_X86_FACETS 1
+#include <immintrin.h>
+#endif
+
+namespace facets {
+
+constexpr std::size_t BATCH = 256;
+constexpr std::size_t LANES = 4;  // interleaved sub-histograms
+
+// hist[lane * stride + v] += 1 for the value v of docIds[i..n), where
+// stride = maxValue + 1
+inline void histogramScalar(const attributes::Column& column, const uint32_t* docIds, std::size_t i,
+                            std::size_t n, uint32_t mask, uint32_t* hist, std::size_t stride) {
+    for (; i < n; i++) {
+        uint32_t v = column.get(docIds[i]) & mask;
+        if (v < stride) hist[(i % LANES) * stride + v]++;
+    }
+}
+
+#ifdef MINIGOOGLE_X86_FACETS
+
+__attribute__((target("avx2"))) inline void histogramAvx2(const attributes::Column& column, const uint32_t* docIds,
+                                                          std::size_t n, uint32_t mask, uint32_t* hist,
+                                                          std::size_t stride) {
+    const uint32_t width = column.bytesPerValue();
+    const uint8_t* base = column.data();
+    const __m256i vmask = _mm256_set1_epi32(static_cast<int>(mask));
+    const __m128i shift = _mm_cvtsi32_si128(width == 1 ? 0 : (width == 2 ? 1 : 2));
+    alignas(32) uint32_t values[8];
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i offsets = _mm256_sll_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(docIds + i)), shift);
+        __m256i v = _mm256_and_si256(_mm256_i32gather_epi32(reinterpret_cast<const int*>(base), offsets, 1), vmask);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(values), v);
+        for (std::size_t k = 0; k < 8; k++) {
+            if (values[k] < stride) hist[(k % LANES) * stride + values[k]]++;
+        }
+    }
+    histogramScalar(column, docIds, i, n, mask, hist, stride);
+}
+
+#endif
+
+// Whether histogram gathers with AVX2, checked on first use
+inline bool histogramUsesAvx2() {
+#ifdef MINIGOOGLE_X86_FACETS
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+// hist[lane * stride + v] += 1 for the value v of every docId, where
+// stride = maxValue + 1
+inline void histogram(const attributes::Column& column, const uint32_t* docIds, std::size_t n,
+                      uint32_t* hist, std::size_t stride) {
+    const uint32_t width = column.bytesPerValue();
+    const uint32_t mask = width == 4 ? 0xFFFFFFFFu : (1u << (8 * width)) - 1;
+#ifdef MINIGOOGLE_X86_FACETS
+    if (histogramUsesAvx2()) {
+        histogramAvx2(column, docIds, n, mask, hist, stride);
+        return;
+    }
+#endif
+    histogramScalar(column, docIds, 0, n, mask, hist, stride);
+}
+
+struct Facet {
+    std::string name;
+    std::vector<std::pair<std::string, uint64_t>> values;  // most frequent first
+};
+
+class Counter {
+public:
+    // sampleRate in (0, 1]; 1 counts every match
+    Counter(const attributes::Store& store, const std::vector<std::string>& names, double sampleRate)
+        : rate(std::min(1.0, std::max(sampleRate, 1e-6))), limit(store.size()) {
+        for (const auto& name : names) {
+            const attributes::Attribute* attr = store.find(name);
+            if (attr == nullptr) {
+                throw std::runtime_error("No attribute '" + name + "' to count facets on");
+            }
+            if (attr->maxValue > (1u << 22)) {
+                throw std::runtime_error("Attribute '" + name + "' has too many values to count as a facet");
+            }
+            limit = std::min<uint64_t>(limit, attr->column->size());
+            Column c;
+            c.attr = attr;
+            c.stride = static_cast<std::size_t>(attr->maxValue) + 1;
+            c.hist.assign(LANES * c.stride, 0);
+            columns.push_back(std::move(c));
+        }
+        threshold = rate >= 1.0 ? UINT32_MAX : static_cast<uint32_t>(rate * 4294967296.0);
+        batch.reserve(BATCH);
+    }
+
+    double sampleRate() const { return rate; }
+    uint64_t matches() const { return seen; }
+    uint64_t counted() const { return kept; }
+
+    void add(uint32_t docId) {
+        if (docId >= limit) return;  // not in the attribute store
+        seen++;
+        if (rate < 1.0 && hash(docId) >= threshold) return;
+        kept++;
+        batch.push_back(docId);
+        if (batch.size() == BATCH) flush();
+    }
+
+    // The topValues most frequent values of each facet (unknown left out);
+    // counts are scaled up by the sample rate
+    std::vector<Facet> finish(std::size_t topValues) {
+        flush();
+        std::vector<Facet> out;
+        for (const auto& c : columns) {
+            std::vector<std::pair<uint32_t, uint64_t>> counts;
+            for (std::size_t v = 1; v < c.stride; v++) {
+                uint64_t total = 0;
+                for (std::size_t lane = 0; lane < LANES; lane++) total += c.hist[lane * c.stride + v];
+                if (total > 0) counts.push_back({static_cast<uint32_t>(v), total});
+            }
+            std::size_t keep = std::min(topValues, counts.size());
+            std::partial_sort(counts.begin(), counts.begin() + keep, counts.end(), [](const auto& a, const auto& b) {
+                return a.second != b.second ? a.second > b.second : a.first < b.first;
+            });
+
+            Facet facet;
+            facet.name = c.attr->name;
+            for (std::size_t k = 0; k < keep; k++) {
+                uint32_t v = counts[k].first;
+                std::string label = c.attr->dict.empty() ? std::to_string(v)
+                                    : v < c.attr->dict.size() ? c.attr->dict[v] : "?";
+                facet.values.push_back({label, static_cast<uint64_t>(counts[k].second / rate + 0.5)});
+            }
+            out.push_back(std::move(facet));
+        }
+        return out;
+    }
+
+private:
+    struct Column {
+        const attributes::Attribute* attr = nullptr;
+        std::size_t stride = 0;
+        std::vector<uint32_t> hist;  // LANES x stride
+    };
+
+    static uint32_t hash(uint32_t x) {
+        x ^= x >> 16;
+        x *= 0x7feb352d;
+        x ^= x >> 15;
+        x *= 0x846ca68b;
+        x ^= x >> 16;
+        return x;
+    }
+
+    void flush() {
+        if (batch.empty()) return;
+        for (auto& c : columns) {
+            histogram(*c.attr->column, batch.data(), batch.size(), c.hist.data(), c.stride);
+        }
+        batch.clear();
+    }
+
+    double rate;
+    uint64_t limit;  // docIDs the columns cover
+    uint32_t threshold = UINT32_MAX;
+    uint64_t seen = 0;
+    uint64_t kept = 0;
+    std::vector<uint32_t> batch;
+    std::vector<Column> columns;
+};
+
+}  // namespace facets
@@ -0,0 +1,465 @@
+#pragma once
+
+/*
+ * Asynchronous File Ingestion
+ *
+ * On network-attached volumes the forward index build is bound by per-file
+ * latency, not bandwidth: reading one JSON file at a time leaves the disk idle
+ * while we parse, and the parser idle while we wait on the disk. This header
+ * splits the two: an ingestion stage keeps many reads in flight and hands
+ * filled buffers to parser workers through a bounded queue, so parsing
+ * overlaps with I/O and a slow consumer throttles the readers.
+ *
+ * Backends:
+ * - io_uring (Linux 5.6+): one thread submits up to `inFlight` IORING_OP_READ
+ *   requests on a ring set up with raw syscalls (no liburing dependency) and
+ *   reaps completions as they arrive. Files are opened synchronously; only
+ *   the reads are asynchronous. If the ring fails mid-run, the reads in
+ *   flight are cancelled and waited out before their files are read again
+ *   with blocking reads.
+ * - Thread pool (everywhere else, or when the kernel/sandbox refuses
+ *   io_uring): `inFlight` reader threads each doing blocking reads.
+ * The backend is chosen at runtime; callers see the same queue either way.
+ *
+ * Buffers arrive in completion order, not input order.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define MINIGOOGLE_HAVE_IO_URING 1
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#endif
+
+// ---------------------- Bounded Queue ----------------------
+
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity ? capacity : 1) {}
+
+    // Blocks while the queue is full. Returns false if the queue was closed.
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mtx);
+        notFull.wait(lock, [&] { return items.size() < capacity || closed; });
+        if (closed) return false;
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Blocks until an item is available. Returns false once closed and drained.
+    bool pop(T& out) {
+        std::unique_lock<std::mutex> lock(mtx);
+        notEmpty.wait(lock, [&] { return !items.empty() || closed; });
+        if (items.empty()) return false;
+        out = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    // No more pushes; consumers drain what is left and then stop.
+    void close() {
+        std::lock_guard<std::mutex> lock(mtx);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+private:
+    size_t capacity;
+    std::deque<T> items;
+    bool closed = false;
+    std::mutex mtx;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+};
+
+// ---------------------- Ingestion ----------------------
+
+struct FileBuffer {
+    std::string path;
+    std::string data;
+    bool ok = false;
+    std::string error;
+};
+
+class FileIngestor {
+public:
+    FileIngestor(std::vector<std::string> paths, int inFlight = 32, bool allowIoUring = true)
+        : paths(std::move(paths)), inFlight(inFlight > 0 ? inFlight : 1), allowIoUring(allowIoUring) {}
+
+    // Reads every path and pushes one FileBuffer per file into out, then
+    // closes out. Blocks until done; run it on its own thread.
+    void run(BoundedQueue<FileBuffer>& out) {
+#ifdef MINIGOOGLE_HAVE_IO_URING
+        if (allowIoUring) {
+            IoUring ring;
+            // Twice the reads in flight, so a cancel for each fits if the ring fails
+            if (ring.init(2 * static_cast<unsigned>(inFlight))) {
+                backend = "io_uring";
+                runIoUring(ring, out);
+                out.close();
+                return;
+            }
+        }
+#endif
+        backend = "thread pool";
+        runThreadPool(out);
+        out.close();
+    }
+
+    // "io_uring" or "thread pool" once run() has picked a backend.
+    const char* backendName() const { return backend.load(); }
+
+    // Set when run() gave up before reading every file; read it after run()
+    // has returned. Files not pushed by then were never read.
+    const std::string& failure() const { return failed; }
+
+private:
+    std::vector<std::string> paths;
+    int inFlight;
+    bool allowIoUring;
+    std::atomic<const char*> backend{"(not started)"};
+    std::string failed;
+
+    static bool readWholeFile(const std::string& path, FileBuffer& buf) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) {
+            buf.error = "could not open file";
+            return false;
+        }
+        in.seekg(0, std::ios::end);
+        buf.data.resize(static_cast<size_t>(in.tellg()));
+        in.seekg(0, std::ios::beg);
+        in.read(&buf.data[0], buf.data.size());
+        if (!in) {
+            buf.error = "short read";
+            return false;
+        }
+        return true;
+    }
+
+    void runThreadPool(BoundedQueue<FileBuffer>& out) {
+        std::atomic<size_t> next{0};
+        auto reader = [&]() {
+            for (size_t i = next++; i < paths.size(); i = next++) {
+                FileBuffer buf;
+                buf.path = paths[i];
+                buf.ok = readWholeFile(paths[i], buf);
+                if (!out.push(std::move(buf))) return;
+            }
+        };
+
+        int numReaders = std::min<int>(inFlight, static_cast<int>(std::max<size_t>(paths.size(), 1)));
+        std::vector<std::thread> readers;
+        for (int t = 0; t < numReaders; t++) {
+            readers.emplace_back(reader);
+        }
+        for (auto& r : readers) {
+            r.join();
+        }
+    }
+
+#ifdef MINIGOOGLE_HAVE_IO_URING
+    // Minimal io_uring wrapper over the raw syscalls: just enough to submit
+    // reads and reap their completions.
+    class IoUring {
+    public:
+        ~IoUring() {
+            if (sqes) munmap(sqes, sqesSize);
+            if (cqPtr && cqPtr != sqPtr) munmap(cqPtr, cqSize);
+            if (sqPtr) munmap(sqPtr, sqSize);
+            if (ringFd >= 0) close(ringFd);
+        }
+
+        bool init(unsigned entries) {
+            io_uring_params p;
+            std::memset(&p, 0, sizeof(p));
+            ringFd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+            if (ringFd < 0) return false;
+
+            sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+            cqSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+            bool singleMmap = p.features & IORING_FEAT_SINGLE_MMAP;
+            if (singleMmap) sqSize = cqSize = std::max(sqSize, cqSize);
+
+            sqPtr = mapRing(sqSize, IORING_OFF_SQ_RING);
+            if (!sqPtr) return false;
+            cqPtr = singleMmap ? sqPtr : mapRing(cqSize, IORING_OFF_CQ_RING);
+            if (!cqPtr) return false;
+
+            sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+            sqes = static_cast<io_uring_sqe*>(mapRing(sqesSize, IORING_OFF_SQES));
+            if (!sqes) return false;
+
+            char* sq = static_cast<char*>(sqPtr);
+            sqTail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+            sqMask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+            sqArray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+
+            char* cq = static_cast<char*>(cqPtr);
+            cqHead = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+            cqTail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+            cqMask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+
+            capacity = p.sq_entries;
+            return supportsRead();
+        }
+
+        unsigned size() const { return capacity; }
+
+        void queueRead(int fd, void* buf, unsigned len, uint64_t offset, uint64_t userData) {
+            io_uring_sqe* sqe = nextSqe();
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = fd;
+            sqe->addr = reinterpret_cast<uint64_t>(buf);
+            sqe->len = len;
+            sqe->off = offset;
+            sqe->user_data = userData;
+            commitSqe();
+        }
+
+        // Submits every queued read, then waits for at least minComplete
+        // completions. The kernel may take fewer SQEs than offered (it is
+        // short of memory, or it stopped at one it could not queue): submit
+        // the rest, after waiting for a read in flight to finish if it took
+        // none.
+        bool submitAndWait(unsigned minComplete) {
+            while (pending > 0) {
+                long r = enter(pending, 0, 0);
+                if (r > 0) {
+                    pending -= static_cast<unsigned>(r);
+                    inFlight += static_cast<unsigned>(r);
+                } else if (r < 0 && errno == EINTR) {
+                    continue;
+                } else if ((r == 0 || errno == EAGAIN) && inFlight > 0) {
+                    if (enter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) return false;
+                } else {
+                    return false;
+                }
+            }
+            while (minComplete > 0 && enter(0, minComplete, IORING_ENTER_GETEVENTS) < 0) {
+                if (errno != EINTR) return false;
+            }
+            return true;
+        }
+
+        // Cancels the reads tagged userData (queued or taken by the kernel),
+        // then waits until every SQE the kernel took has completed,
+        // discarding the completions. Afterwards the kernel holds none of
+        // their buffers. False if the ring cannot do even that.
+        bool cancelAndDrain(const std::vector<uint64_t>& userData) {
+            for (uint64_t target : userData) {
+                io_uring_sqe* sqe = nextSqe();
+                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                sqe->fd = -1;
+                sqe->addr = target;
+                sqe->user_data = CANCEL_TAG;
+                commitSqe();
+            }
+            if (!submitAndWait(0)) return false;
+            while (inFlight > 0) {
+                if (enter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) return false;
+                reap([](uint64_t, int) {});
+            }
+            return true;
+        }
+
+        // Calls fn(userData, result) for each completion ready now.
+        template <typename Fn>
+        void reap(Fn&& fn) {
+            unsigned head = *cqHead;
+            unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            while (head != tail) {
+                const io_uring_cqe& cqe = cqes[head & cqMask];
+                fn(cqe.user_data, cqe.res);
+                head++;
+                inFlight--;
+            }
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        }
+
+    private:
+        int ringFd = -1;
+        void* sqPtr = nullptr;
+        void* cqPtr = nullptr;
+        io_uring_sqe* sqes = nullptr;
+        size_t sqSize = 0, cqSize = 0, sqesSize = 0;
+        unsigned* sqTail = nullptr;
+        unsigned* sqArray = nullptr;
+        unsigned sqMask = 0;
+        unsigned* cqHead = nullptr;
+        unsigned* cqTail = nullptr;
+        unsigned cqMask = 0;
+        io_uring_cqe* cqes = nullptr;
+        unsigned capacity = 0;
+        unsigned pending = 0;    // queued, not yet taken by the kernel
+        unsigned inFlight = 0;   // taken, not yet reaped
+
+        static constexpr uint64_t CANCEL_TAG = ~uint64_t(0);
+
+        // The zeroed SQE at the tail; commitSqe() hands it to the kernel
+        io_uring_sqe* nextSqe() {
+            io_uring_sqe* sqe = &sqes[*sqTail & sqMask];
+            std::memset(sqe, 0, sizeof(*sqe));
+            return sqe;
+        }
+
+        void commitSqe() {
+            unsigned tail = *sqTail;
+            sqArray[tail & sqMask] = tail & sqMask;
+            __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+            pending++;
+        }
+
+        long enter(unsigned toSubmit, unsigned minComplete, unsigned flags) {
+            return syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0);
+        }
+
+        void* mapRing(size_t size, off_t offset) {
+            void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, offset);
+            return p == MAP_FAILED ? nullptr : p;
+        }
+
+        // IORING_OP_READ needs Linux 5.6; ask the kernel instead of guessing.
+        bool supportsRead() {
+            const unsigned numOps = 256;
+            std::vector<char> mem(sizeof(io_uring_probe) + numOps * sizeof(io_uring_probe_op), 0);
+            auto* probe = reinterpret_cast<io_uring_probe*>(mem.data());
+            long r = syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe, numOps);
+            if (r < 0 || probe->last_op < IORING_OP_READ) return false;
+            return probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED;
+        }
+    };
+
+    struct ReadSlot {
+        int fd = -1;
+        size_t filled = 0;
+        FileBuffer buf;
+    };
+
+    void runIoUring(IoUring& ring, BoundedQueue<FileBuffer>& out) {
+        // Half the ring at most: the other half takes the cancels if it fails
+        const size_t numSlots = std::min<size_t>(static_cast<size_t>(inFlight), ring.size() / 2);
+        std::vector<ReadSlot> slots(numSlots);
+        std::vector<size_t> freeSlots;
+        for (size_t s = numSlots; s-- > 0;) freeSlots.push_back(s);
+
+        size_t next = 0;
+        size_t active = 0;
+
+        auto finish = [&](ReadSlot& slot, size_t s, bool ok, const char* error) {
+            if (slot.fd >= 0) close(slot.fd);
+            slot.fd = -1;
+            slot.buf.ok = ok;
+            if (!ok) slot.buf.error = error;
+            out.push(std::move(slot.buf));
+            slot.buf = FileBuffer();
+            freeSlots.push_back(s);
+        };
+
+        auto queueRemaining = [&](ReadSlot& slot, size_t s) {
+            size_t remaining = slot.buf.data.size() - slot.filled;
+            unsigned len = static_cast<unsigned>(std::min<size_t>(remaining, 1u << 30));
+            ring.queueRead(slot.fd, &slot.buf.data[slot.filled], len, slot.filled, s);
+        };
+
+        while (next < paths.size() || active > 0) {
+            // Top up: open files and queue their reads until every slot is busy
+            while (next < paths.size() && !freeSlots.empty()) {
+                size_t s = freeSlots.back();
+                freeSlots.pop_back();
+                ReadSlot& slot = slots[s];
+                slot.buf.path = paths[next++];
+                slot.filled = 0;
+
+                slot.fd = open(slot.buf.path.c_str(), O_RDONLY | O_CLOEXEC);
+                struct stat st;
+                if (slot.fd < 0 || fstat(slot.fd, &st) != 0) {
+                    finish(slot, s, false, "could not open file");
+                    continue;
+                }
+                slot.buf.data.resize(static_cast<size_t>(st.st_size));
+                if (st.st_size == 0) {
+                    finish(slot, s, true, "");
+                    continue;
+                }
+
+                queueRemaining(slot, s);
+                active++;
+            }
+
+            if (active == 0) continue;
+
+            if (!ring.submitAndWait(1)) {
+                // Ring failed mid-run. The kernel may still be reading into
+                // the open slots' buffers: cancel those reads and wait them
+                // out, then finish every file with blocking reads
+                std::vector<uint64_t> reads;
+                for (size_t s = 0; s < numSlots; s++) {
+                    if (slots[s].fd >= 0) reads.push_back(s);
+                }
+                if (!ring.cancelAndDrain(reads)) {
+                    // The buffers may be written at any time from now on:
+                    // never free or reuse them, and stop
+                    static_cast<void>(new std::vector<ReadSlot>(std::move(slots)));
+                    failed = "io_uring failed with reads in flight";
+                    return;
+                }
+                for (size_t s = 0; s < numSlots; s++) {
+                    if (slots[s].fd < 0) continue;
+                    bool ok = readWholeFile(slots[s].buf.path, slots[s].buf);
+                    finish(slots[s], s, ok, "short read");
+                }
+                for (; next < paths.size(); next++) {
+                    FileBuffer buf;
+                    buf.path = paths[next];
+                    buf.ok = readWholeFile(paths[next], buf);
+                    out.push(std::move(buf));
+                }
+                return;
+            }
+
+            ring.reap([&](uint64_t s, int res) {
+                ReadSlot& slot = slots[s];
+                if (res < 0) {
+                    active--;
+                    finish(slot, s, false, "read failed");
+                    return;
+                }
+                slot.filled += static_cast<size_t>(res);
+                if (res == 0 || slot.filled >= slot.buf.data.size()) {
+                    // Done (res == 0 means the file shrank under us)
+                    slot.buf.data.resize(slot.filled);
+                    active--;
+                    finish(slot, s, true, "");
+                } else {
+                    // Short read: queue the rest, picked up by the next submit
+                    queueRemaining(slot, s);
+                }
+            });
+        }
+    }
+#endif
+};
@@ -1,13 +1,19 @@
 #include "config.hpp"
+#include "lexicon.hpp"
+#include "corpus_pack.hpp"
+#include "file_ingest.hpp"
+#include "doc_store.hpp"
+#include "citation_graph.hpp"
 
 #include <iostream>
 #include <string>
 #include <vector>
 #include <unordered_map>
-#include <sstream>
 #include <algorithm>
-#include <cctype>
 #include <climits>
+#include <thread>
+#include <mutex>
+#include <atomic>
 
 using namespace std;
 
@@ -16,9 +22,13 @@ struct Document {
     string doc_id;
     string title;
     string abstract;
+    vector<string> authors;
+    string lead;                              // body start, kept for snippets when there is no abstract
+    vector<doc_store::TokenSpan> snippet_tokens;  // token offsets over abstract (or lead)
     vector<int> title_lemmas;
     vector<int> abstract_lemmas;
     vector<int> body_lemmas;
+    vector<uint64_t> cited_titles;            // citation_graph::titleKey of each bib entry's title
     int total_terms;
 
     Document() : total_terms(0) {}
@@ -26,8 +36,7 @@ struct Document {
 
 class Lexicon {
 private:
-    unordered_map<string, int> wordToID;
-    unordered_map<int, int> wordIDToLemmaID;
+    LemmaTable wordToLemma;  // word -> lemma ID (wordID and wordToLemmaID folded together)
 
 public:
     bool loadFromFile(const string& filename) {
@@ -57,23 +66,10 @@ public:
 
             cout << "JSON parsed successfully!" << endl;
 
-            // Load wordID
-            if (j.contains("wordID")) {
-                cout << "Loading word IDs..." << endl;
-                for (auto& [word, id] : j["wordID"].items()) {
-                    wordToID[word] = id.get<int>();
-                }
-                cout << "Loaded " << wordToID.size() << " word IDs" << endl;
-            }
-
-            // Load wordToLemmaID
-            if (j.contains("wordToLemmaID")) {
-                cout << "Loading lemma mappings..." << endl;
-                for (auto& [wordIdStr, lemmaId] : j["wordToLemmaID"].items()) {
-                    wordIDToLemmaID[stoi(wordIdStr)] = lemmaId.get<int>();
-                }
-                cout << "Loaded " << wordIDToLemmaID.size() << " lemma mappings" << endl;
-            }
+            // Precompute word -> lemma ID in one table
+            cout << "Building word -> lemma table..." << endl;
+            loadLemmaTableJSON(j, wordToLemma);
+            cout << "Loaded " << wordToLemma.size() << " words" << endl;
 
             cout << "Lexicon loaded successfully!" << endl;
             return true;
@@ -87,145 +83,439 @@ public:
         }
     }
 
-    int getLemmaID(const string& word) const {
-        auto it = wordToID.find(word);
-        if (it == wordToID.end()) return -1;
-
-        int wordID = it->second;
-        auto lemmaIt = wordIDToLemmaID.find(wordID);
-        return (lemmaIt != wordIDToLemmaID.end()) ? lemmaIt->second : wordID;
+    int getLemmaID(string_view word) const {
+        return wordToLemma.find(word);
     }
 
-    vector<int> textToLemmaIDs(const string& text) const {
+    // Tokens are views into the tokenizer's buffer; nothing is allocated per word
+    vector<int> textToLemmaIDs(string_view text, Tokenizer& tokenizer) const {
         vector<int> lemmaIDs;
-        stringstream ss(text);
-        string word;
+        wordToLemma.appendLemmaIds(text, tokenizer, lemmaIDs);
+        return lemmaIDs;
+    }
 
-        while (ss >> word) {
-            // Lowercase
-            transform(word.begin(), word.end(), word.begin(), ::tolower);
+    // Offset, length and lemma ID (-1 if unknown) of every token in text,
+    // for the document store's snippet index.
+    vector<doc_store::TokenSpan> textToTokenSpans(string_view text, Tokenizer& tokenizer) const {
+        vector<doc_store::TokenSpan> spans;
+        tokenizer.forEachTokenAt(text, [&](size_t offset, string_view tok) {
+            spans.push_back({static_cast<uint32_t>(offset), static_cast<uint32_t>(tok.size()),
+                             wordToLemma.find(tok)});
+        });
+        return spans;
+    }
+};
 
-            // Remove punctuation
-            word.erase(remove_if(word.begin(), word.end(), ::ispunct), word.end());
+// Streaming extractor for PMC JSON files.
+//
+// Runs as a SAX handler on the bundled json.hpp parser, so no DOM is built:
+// ref_entries, cite_spans and section metadata are scanned past and dropped.
+// Only the fields the forward index needs are copied out:
+//   metadata.title       -> title
+//   abstract[].text      -> abstract (sections joined with a space)
+//   body_text[].text     -> body     (sections joined with a space)
+//   bib_entries.*.title  -> citedTitles (title keys, for the citation graph)
+// A repeated key replaces what the earlier one gave, as json::parse does
+// (the DOM keeps the last value), so a second metadata.title wins.
+// The output strings are members, so one extractor reused across documents
+// stops allocating once it has seen the largest document.
+class PMCExtractor {
+public:
+    std::string title;
+    std::string abstract;
+    std::string body;
+    std::vector<std::string> authors;  // "First Middle Last" from metadata.authors
+    std::vector<uint64_t> citedTitles;
+    std::string error;
+
+    bool extract(const char* data, size_t size) {
+        title.clear();
+        abstract.clear();
+        body.clear();
+        authors.clear();
+        citedTitles.clear();
+        error.clear();
+        depth = 0;
+        section = OTHER;
+        capture = nullptr;
+        inAuthors = false;
+        inMiddle = false;
+
+        return json::sax_parse(data, data + size, this);
+    }
 
-            if (!word.empty()) {
-                int lemmaID = getLemmaID(word);
-                if (lemmaID != -1) {
-                    lemmaIDs.push_back(lemmaID);
-                }
+    // ----- SAX interface (called by json::sax_parse) -----
+
+    bool null() { capture = nullptr; return true; }
+    bool boolean(bool) { capture = nullptr; return true; }
+    bool number_integer(json::number_integer_t) { capture = nullptr; return true; }
+    bool number_unsigned(json::number_unsigned_t) { capture = nullptr; return true; }
+    bool number_float(json::number_float_t, const std::string&) { capture = nullptr; return true; }
+    bool binary(json::binary_t&) { capture = nullptr; return true; }
+
+    bool string(std::string& val) {
+        if (capture) {
+            capture->append(val);
+            if (capture == &abstract || capture == &body) capture->push_back(' ');
+            capture = nullptr;
+        } else if (inMiddle && depth == 5 && !val.empty()) {
+            // metadata.authors[i].middle[j]
+            if (!authorMiddle.empty()) authorMiddle.push_back(' ');
+            authorMiddle.append(val);
+        }
+        return true;
+    }
+
+    bool start_object(size_t) {
+        capture = nullptr;
+        depth++;
+        if (inAuthors && depth == 4) {
+            authorFirst.clear();
+            authorMiddle.clear();
+            authorLast.clear();
+        }
+        return true;
+    }
+
+    bool end_object() {
+        if (inAuthors && depth == 4) finishAuthor();
+        if (section == BIB && depth == 3) {
+            // bib_entries.BIBREFn done
+            uint64_t key = citation_graph::titleKey(citedTitle);
+            if (key != 0) citedTitles.push_back(key);
+            citedTitle.clear();
+        }
+        depth--;
+        if (depth == 1) section = OTHER;
+        return true;
+    }
+
+    bool start_array(size_t) {
+        capture = nullptr;
+        depth++;
+        return true;
+    }
+
+    bool end_array() {
+        depth--;
+        if (depth == 4) inMiddle = false;
+        if (depth == 2) inAuthors = false;
+        if (depth == 1) section = OTHER;
+        return true;
+    }
+
+    bool key(std::string& val) {
+        capture = nullptr;
+
+        if (depth == 1) {
+            // Top-level field: decide which subtree (if any) we care about
+            if (val == "metadata") {
+                section = METADATA;
+                title.clear();
+                authors.clear();
+            } else if (val == "abstract") {
+                section = ABSTRACT;
+                abstract.clear();
+            } else if (val == "body_text") {
+                section = BODY;
+                body.clear();
+            } else if (val == "bib_entries") {
+                section = BIB;
+                citedTitles.clear();
+            } else {
+                section = OTHER;
             }
+        } else if (section == METADATA && depth == 2) {
+            // metadata.title, metadata.authors
+            if (val == "title") {
+                title.clear();
+                capture = &title;
+            }
+            inAuthors = (val == "authors");
+            if (inAuthors) authors.clear();
+        } else if (inAuthors && depth == 4) {
+            // metadata.authors[i].{first,middle,last}
+            inMiddle = (val == "middle");
+            if (val == "first") capture = &authorFirst;
+            else if (val == "last") capture = &authorLast;
+        } else if (section == BIB && depth == 3) {
+            // bib_entries.BIBREFn.title
+            if (val == "title") capture = &citedTitle;
+        } else if (depth == 3 && val == "text") {
+            // abstract[i].text / body_text[i].text
+            if (section == ABSTRACT) capture = &abstract;
+            else if (section == BODY) capture = &body;
         }
+        return true;
+    }
 
-        return lemmaIDs;
+    bool parse_error(size_t position, const std::string&, const nlohmann::detail::exception& ex) {
+        error = "JSON parse error at byte " + to_string(position) + ": " + ex.what();
+        return false;
+    }
+
+private:
+    enum Section { OTHER, METADATA, ABSTRACT, BODY, BIB };
+
+    int depth = 0;
+    Section section = OTHER;
+    std::string* capture = nullptr;
+
+    bool inAuthors = false;
+    bool inMiddle = false;
+    std::string authorFirst, authorMiddle, authorLast;
+    std::string citedTitle;
+
+    void finishAuthor() {
+        std::string name = authorFirst;
+        for (const std::string* part : {&authorMiddle, &authorLast}) {
+            if (part->empty()) continue;
+            if (!name.empty()) name.push_back(' ');
+            name.append(*part);
+        }
+        if (!name.empty()) authors.push_back(std::move(name));
     }
 };
 
+// Bytes of body text kept in the document store for documents without an
+// abstract, cut back to the last space so no word is split.
+const size_t SNIPPET_LEAD_BYTES = 1024;
+
+inline string snippetLead(const string& body) {
+    if (body.size() <= SNIPPET_LEAD_BYTES) return body;
+    size_t cut = body.rfind(' ', SNIPPET_LEAD_BYTES);
+    return body.substr(0, (cut == string::npos || cut == 0) ? SNIPPET_LEAD_BYTES : cut);
+}
+
+// PMC7326321.xml.json -> PMC7326321
+inline string pmcIdFromFilename(const string& filename) {
+    return filename.substr(0, filename.find('.'));
+}
+
 class ForwardIndexBuilder {
 private:
     unordered_map<string, Document> forwardIndex;
     Lexicon lexicon;
 
+    // Documents sorted by PMC ID. Position in this order is the integer docID
+    // used by everything downstream that addresses documents by number.
+    vector<const Document*> docsInIdOrder() const {
+        vector<const Document*> docs;
+        docs.reserve(forwardIndex.size());
+        for (const auto& [id, doc] : forwardIndex) {
+            docs.push_back(&doc);
+        }
+        sort(docs.begin(), docs.end(), [](const Document* a, const Document* b) {
+            return a->doc_id < b->doc_id;
+        });
+        return docs;
+    }
+
 public:
     bool initialize(const string& lexiconPath) {
         return lexicon.loadFromFile(lexiconPath);
     }
 
-    bool processDocument(const string& filepath) {
-        try {
-            ifstream file(filepath);
-            if (!file.is_open()) return false;
+    // Turns the text held by an extractor into a Document.
+    // Returns false when nothing in the document maps to the lexicon.
+    bool buildDocument(const string& pmcId, const PMCExtractor& ex, Tokenizer& tok, Document& doc) const {
+        doc.doc_id = pmcId;
 
-            json j = json::parse(file);
-            file.close();
+        // Title, abstract and body text come straight from the extractor's buffers
+        doc.title = ex.title;
+        doc.title_lemmas = lexicon.textToLemmaIDs(doc.title, tok);
 
-            // Extract PMC ID from filename
-            string filename = fs::path(filepath).filename().string();
-            string pmcId = filename.substr(0, filename.find('.'));
+        doc.abstract = ex.abstract;
+        doc.abstract_lemmas = lexicon.textToLemmaIDs(doc.abstract, tok);
 
-            Document doc;
-            doc.doc_id = pmcId;
+        doc.body_lemmas = lexicon.textToLemmaIDs(ex.body, tok);
+        doc.authors = ex.authors;
+        doc.cited_titles = ex.citedTitles;
 
-            // Extract title
-            if (j.contains("metadata") && j["metadata"].contains("title")) {
-                doc.title = j["metadata"]["title"].get<string>();
-                doc.title_lemmas = lexicon.textToLemmaIDs(doc.title);
-            }
+        // Snippet text: the abstract, or the start of the body if there is none
+        if (doc.abstract.empty()) {
+            doc.lead = snippetLead(ex.body);
+            doc.snippet_tokens = lexicon.textToTokenSpans(doc.lead, tok);
+        } else {
+            doc.snippet_tokens = lexicon.textToTokenSpans(doc.abstract, tok);
+        }
+
+        // Calculate total terms
+        doc.total_terms = doc.title_lemmas.size() +
+                          doc.abstract_lemmas.size() +
+                          doc.body_lemmas.size();
+
+        // Only add if we got some content
+        return doc.total_terms > 0;
+    }
 
-            // Extract abstract (from abstract array)
-            if (j.contains("abstract") && j["abstract"].is_array()) {
-                stringstream abstractText;
-                for (auto& section : j["abstract"]) {
-                    if (section.contains("text")) {
-                        abstractText << section["text"].get<string>() << " ";
+    // Index a corpus pack (see corpus_pack.hpp). The pack is split into
+    // numThreads contiguous slices; each worker streams its slice front to
+    // back with its own cursor, extractor and tokenizer, and results are
+    // merged once all workers finish. numThreads = 1 is a plain sequential scan.
+    void processPack(const string& packPath, int numThreads) {
+        corpus_pack::Reader reader(packPath);
+        const size_t total = reader.size();
+        numThreads = max(1, min<int>(numThreads, static_cast<int>(max<size_t>(total, 1))));
+
+        cout << "Processing corpus pack: " << packPath << endl;
+        cout << "Documents in pack: " << total << ", worker threads: " << numThreads << endl;
+
+        vector<vector<Document>> results(numThreads);
+        atomic<int> processedCount{0};
+        atomic<int> successCount{0};
+        mutex logMutex;
+
+        auto worker = [&](int t) {
+            size_t begin = total * t / numThreads;
+            size_t end = total * (t + 1) / numThreads;
+
+            corpus_pack::Cursor cursor(reader);
+            PMCExtractor ex;
+            Tokenizer tok;
+            string data;
+
+            for (size_t i = begin; i < end; i++) {
+                string name = reader.name(i);
+                try {
+                    cursor.read(i, data);
+                    if (!ex.extract(data.data(), data.size())) {
+                        lock_guard<mutex> lock(logMutex);
+                        cerr << "Error processing " << name << ": " << ex.error << endl;
+                    } else {
+                        Document doc;
+                        if (buildDocument(pmcIdFromFilename(name), ex, tok, doc)) {
+                            results[t].push_back(std::move(doc));
+                            successCount++;
+                        }
                     }
+                } catch (exception& e) {
+                    lock_guard<mutex> lock(logMutex);
+                    cerr << "Error processing " << name << ": " << e.what() << endl;
                 }
-                doc.abstract = abstractText.str();
-                doc.abstract_lemmas = lexicon.textToLemmaIDs(doc.abstract);
-            }
 
-            // Extract body text (from body_text array)
-            if (j.contains("body_text") && j["body_text"].is_array()) {
-                stringstream bodyText;
-                for (auto& section : j["body_text"]) {
-                    if (section.contains("text")) {
-                        bodyText << section["text"].get<string>() << " ";
-                    }
+                int done = ++processedCount;
+                if (done % 1000 == 0) {
+                    lock_guard<mutex> lock(logMutex);
+                    cout << "Processed " << done << " files (indexed: "
+                         << successCount.load() << ")..." << endl;
                 }
-                doc.body_lemmas = lexicon.textToLemmaIDs(bodyText.str());
             }
+        };
 
-            // Calculate total terms
-            doc.total_terms = doc.title_lemmas.size() +
-                              doc.abstract_lemmas.size() +
-                              doc.body_lemmas.size();
+        vector<thread> workers;
+        for (int t = 1; t < numThreads; t++) {
+            workers.emplace_back(worker, t);
+        }
+        worker(0);
+        for (auto& w : workers) {
+            w.join();
+        }
 
-            // Only add if we got some content
-            if (doc.total_terms > 0) {
-                forwardIndex[pmcId] = doc;
-                return true;
+        for (auto& docs : results) {
+            for (auto& doc : docs) {
+                string id = doc.doc_id;
+                forwardIndex[id] = std::move(doc);
             }
-
-            return false;
-
-        } catch (exception& e) {
-            cerr << "Error processing " << filepath << ": " << e.what() << endl;
-            return false;
         }
+
+        cout << "\nProcessing complete!" << endl;
+        cout << "Total processed: " << processedCount.load() << endl;
+        cout << "Successfully indexed: " << successCount.load() << endl;
     }
 
-    void processDirectory(const string& dirPath, int maxFiles = -1) {
+    // Index every JSON file in a directory. Reads go through FileIngestor
+    // (io_uring when available, else a reader thread pool) with `inFlight`
+    // requests outstanding; filled buffers flow through a bounded queue to
+    // numThreads parser workers, so parsing overlaps with I/O.
+    void processDirectory(const string& dirPath, int numThreads = 1, int inFlight = 32,
+                          bool allowIoUring = true, int maxFiles = -1) {
         cout << "Processing PMC files from: " << dirPath << endl;
 
-        int processedCount = 0;
-        int successCount = 0;
-
+        vector<string> paths;
         for (const auto& entry : fs::directory_iterator(dirPath)) {
             if (entry.is_regular_file() && entry.path().extension() == ".json") {
-
-                if (processDocument(entry.path().string())) {
-                    successCount++;
+                paths.push_back(entry.path().string());
+                if (maxFiles > 0 && static_cast<int>(paths.size()) >= maxFiles) {
+                    cout << "Reached max files limit (" << maxFiles << ")" << endl;
+                    break;
                 }
+            }
+        }
 
-                processedCount++;
-
-                if (processedCount % 1000 == 0) {
-                    cout << "Processed " << processedCount << " files (indexed: "
-                         << successCount << ")..." << endl;
+        numThreads = max(1, numThreads);
+        FileIngestor ingestor(std::move(paths), inFlight, allowIoUring);
+        BoundedQueue<FileBuffer> queue(static_cast<size_t>(inFlight + 2 * numThreads));
+
+        thread ingestThread([&] { ingestor.run(queue); });
+
+        vector<vector<Document>> results(numThreads);
+        atomic<int> processedCount{0};
+        atomic<int> successCount{0};
+        mutex logMutex;
+
+        auto worker = [&](int t) {
+            PMCExtractor ex;
+            Tokenizer tok;
+            FileBuffer buf;
+
+            while (queue.pop(buf)) {
+                if (!buf.ok) {
+                    lock_guard<mutex> lock(logMutex);
+                    cerr << "Error processing " << buf.path << ": " << buf.error << endl;
+                } else if (!ex.extract(buf.data.data(), buf.data.size())) {
+                    lock_guard<mutex> lock(logMutex);
+                    cerr << "Error processing " << buf.path << ": " << ex.error << endl;
+                } else {
+                    try {
+                        Document doc;
+                        string pmcId = pmcIdFromFilename(fs::path(buf.path).filename().string());
+                        if (buildDocument(pmcId, ex, tok, doc)) {
+                            results[t].push_back(std::move(doc));
+                            successCount++;
+                        }
+                    } catch (exception& e) {
+                        lock_guard<mutex> lock(logMutex);
+                        cerr << "Error processing " << buf.path << ": " << e.what() << endl;
+                    }
                 }
 
-                if (maxFiles > 0 && processedCount >= maxFiles) {
-                    cout << "Reached max files limit (" << maxFiles << ")" << endl;
-                    break;
+                int done = ++processedCount;
+                if (done % 1000 == 0) {
+                    lock_guard<mutex> lock(logMutex);
+                    cout << "Processed " << done << " files (indexed: "
+                         << successCount.load() << ")..." << endl;
                 }
             }
+        };
+
+        vector<thread> workers;
+        for (int t = 1; t < numThreads; t++) {
+            workers.emplace_back(worker, t);
+        }
+        worker(0);
+        for (auto& w : workers) {
+            w.join();
+        }
+        ingestThread.join();
+        if (!ingestor.failure().empty()) {
+            throw runtime_error("Reading " + dirPath + " failed: " + ingestor.failure());
+        }
+
+        for (auto& docs : results) {
+            for (auto& doc : docs) {
+                string id = doc.doc_id;
+                forwardIndex[id] = std::move(doc);
+            }
         }
 
         cout << "\nProcessing complete!" << endl;
-        cout << "Total processed: " << processedCount << endl;
-        cout << "Successfully indexed: " << successCount << endl;
+        cout << "I/O backend: " << ingestor.backendName() << " (" << inFlight << " reads in flight)" << endl;
+        cout << "Total processed: " << processedCount.load() << endl;
+        cout << "Successfully indexed: " << successCount.load() << endl;
     }
 
-    void saveToFile(const string& outputPath) {
+    void saveToFile(const string& outputPath, const string& offsetsPath) {
         ofstream out(outputPath);
         if (!out.is_open()) {
             cerr << "Error: Could not open output file" << endl;
@@ -234,8 +524,12 @@ public:
 
         cout << "Saving forward index to: " << outputPath << endl;
 
-        for (const auto& [docId, doc] : forwardIndex) {
-            out << docId << "|" << doc.total_terms << "|";
+        // Line number = docID, shared with the document store
+        vector<pair<string, int64_t>> lineOffsets;
+        for (const Document* d : docsInIdOrder()) {
+            const Document& doc = *d;
+            lineOffsets.push_back({doc.doc_id, static_cast<int64_t>(out.tellp())});
+            out << doc.doc_id << "|" << doc.total_terms << "|";
 
             // Save title lemmas
             for (size_t i = 0; i < doc.title_lemmas.size(); i++) {
@@ -261,8 +555,94 @@ public:
             out << "\n";
         }
 
+        int64_t coveredBytes = out.tellp();
         out.close();
         cout << "Forward index saved! (" << forwardIndex.size() << " documents)" << endl;
+
+        saveLineOffsets(offsetsPath, lineOffsets, coveredBytes);
+    }
+
+    // Where each document's line starts, sorted by PMC ID, so search can
+    // check phrases and title:/abstract: terms against a few lines without
+    // scanning the file. Lines appended later (uploads) lie past coveredBytes.
+    //   [numDocs:8][coveredBytes:8] then numDocs x [docId:20][offset:8]
+    void saveLineOffsets(const string& path, vector<pair<string, int64_t>>& lineOffsets, int64_t coveredBytes) {
+        sort(lineOffsets.begin(), lineOffsets.end());
+
+        ofstream out(path, ios::binary);
+        if (!out.is_open()) {
+            cerr << "Error: Could not open " << path << endl;
+            return;
+        }
+        int64_t numDocs = static_cast<int64_t>(lineOffsets.size());
+        out.write(reinterpret_cast<const char*>(&numDocs), sizeof(numDocs));
+        out.write(reinterpret_cast<const char*>(&coveredBytes), sizeof(coveredBytes));
+        for (const auto& [docId, offset] : lineOffsets) {
+            char idBuf[20] = {};
+            strncpy(idBuf, docId.c_str(), sizeof(idBuf) - 1);
+            out.write(idBuf, sizeof(idBuf));
+            out.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+        }
+        cout << "Line offsets saved to: " << path << endl;
+    }
+
+    // Resolves every document's cited titles to docIDs and writes the
+    // citation graph (see citation_graph.hpp) for pageRank
+    void saveCitationGraph(const string& outputPath) {
+        cout << "Saving citation graph to: " << outputPath << endl;
+
+        vector<const Document*> docs = docsInIdOrder();
+        const uint32_t ambiguous = UINT32_MAX;
+        unordered_map<uint64_t, uint32_t> byTitle;
+        byTitle.reserve(docs.size());
+        for (uint32_t d = 0; d < docs.size(); d++) {
+            uint64_t key = citation_graph::titleKey(docs[d]->title);
+            if (key == 0) continue;
+            auto [it, added] = byTitle.emplace(key, d);
+            if (!added) it->second = ambiguous;
+        }
+
+        citation_graph::Graph graph;
+        size_t citations = 0;
+        vector<uint32_t> cited;
+        for (const Document* d : docs) {
+            cited.clear();
+            for (uint64_t key : d->cited_titles) {
+                auto it = byTitle.find(key);
+                if (it != byTitle.end() && it->second != ambiguous) cited.push_back(it->second);
+            }
+            citations += d->cited_titles.size();
+            graph.addDocument(cited);
+        }
+        graph.save(outputPath);
+
+        cout << "Citation graph saved! (" << graph.edges() << " edges resolved from "
+             << citations << " cited titles)" << endl;
+    }
+
+    // Writes titles, authors and abstracts in forward-index line order, so
+    // line N of forward_index.txt and record N of the store are one document.
+    void saveDocStore(const string& outputPath) {
+        cout << "Saving document store to: " << outputPath << endl;
+
+        doc_store::Writer writer(outputPath);
+        doc_store::DocRecord rec;
+        for (const Document* d : docsInIdOrder()) {
+            rec.docId = d->doc_id;
+            rec.title = d->title;
+            rec.authors = d->authors;
+            rec.abstract = d->abstract;
+            // The extractor leaves a separator after each abstract section
+            while (!rec.abstract.empty() && rec.abstract.back() == ' ') rec.abstract.pop_back();
+            rec.lead = d->lead;
+            rec.tokens = d->snippet_tokens;
+            writer.add(rec);
+        }
+        size_t blocks = writer.numBlocks();
+        writer.finish();
+
+        cout << "Document store saved! (" << writer.size() << " documents, "
+             << blocks << " blocks)" << endl;
     }
 
     void printStatistics() {
@@ -299,8 +679,36 @@ public:
     }
 };
 
-int main() {
+// Usage (from backend/cpp):
+//   ./build/forwardIndex                          # read pmc_json directory
+//   ./build/forwardIndex --pack [path]            # read a corpus pack (packCorpus)
+//   ./build/forwardIndex --pack --threads 8       # ...in 8 parallel chunks
+//   ./build/forwardIndex --inflight 64            # reads kept in flight (directory mode)
+//   ./build/forwardIndex --no-uring               # force the thread-pool reader
+int main(int argc, char* argv[]) {
     try {
+        bool usePack = false;
+        std::string packArg;
+        int numThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        int inFlight = 32;
+        bool allowIoUring = true;
+
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--pack") {
+                usePack = true;
+                if (i + 1 < argc && argv[i + 1][0] != '-') {
+                    packArg = argv[++i];
+                }
+            } else if ((arg == "--threads" || arg == "-j") && i + 1 < argc) {
+                numThreads = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--inflight" && i + 1 < argc) {
+                inFlight = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--no-uring") {
+                allowIoUring = false;
+            }
+        }
+
         // this file is in backend/cpp
         fs::path backendDir = fs::current_path().parent_path(); // backend/
 
@@ -315,9 +723,9 @@ int main() {
 
         fs::path lexiconPath = indexesDir / config["lexicon_file"].get<std::string>();
         fs::path forwardIndexPath = indexesDir / config["forward_index_file"].get<std::string>();
-
-        // Find pmc-json folder
-        fs::path pmcFolder = findPMCJSONFolder(dataDir, config["json_data"]);
+        fs::path docStorePath = indexesDir / config.value("doc_store_file", "doc_store.bin");
+        fs::path offsetsPath = indexesDir / config.value("forward_offsets_file", "forward_index.offsets");
+        fs::path citationsPath = indexesDir / config.value("citation_graph_file", "citations.bin");
 
         // Initialize builder
         ForwardIndexBuilder builder;
@@ -326,11 +734,22 @@ int main() {
             return 1;
         }
 
-        // Process all JSON files
-        builder.processDirectory(pmcFolder.string());
+        if (usePack) {
+            // Process a packed corpus (sequential reads, optionally in parallel chunks)
+            fs::path packPath = packArg.empty()
+                ? indexesDir / config.value("corpus_pack", "corpus.pack")
+                : fs::path(packArg);
+            builder.processPack(packPath.string(), numThreads);
+        } else {
+            // Find pmc-json folder and process all JSON files
+            fs::path pmcFolder = findPMCJSONFolder(dataDir, config["json_data"]);
+            builder.processDirectory(pmcFolder.string(), numThreads, inFlight, allowIoUring);
+        }
 
         builder.printStatistics();
-        builder.saveToFile(forwardIndexPath.string());
+        builder.saveToFile(forwardIndexPath.string(), offsetsPath.string());
+        builder.saveDocStore(docStorePath.string());
+        builder.saveCitationGraph(citationsPath.string());
 
         std::cout << "Done!" << std::endl;
     } catch (std::exception& e) {
@@ -0,0 +1,143 @@
+#pragma once
+
+/*
+ * Forward Index Lines
+ *
+ * Reads single documents out of forward_index.txt, which forwardIndex writes
+ * as one line per document:
+ *
+ *   docId|totalTerms|title lemmas|abstract lemmas|body lemmas
+ *
+ * with each lemma list comma-separated in text order. search checks phrases
+ * and title:/abstract: terms against these lines, and search_semantic
+ * computes its re-rank features from them.
+ *
+ * A line is located through forward_index.offsets, also written by
+ * forwardIndex:
+ *
+ *   [numDocs:8][coveredBytes:8] then numDocs x [docId:20][offset:8]
+ *
+ * sorted by docId. Lines appended after the offsets file was written (uploaded
+ * documents) lie past coveredBytes; they are found by scanning the file's
+ * tail once, and win over the table, since a re-upload appends a newer line.
+ * Without the offsets file the whole forward index is scanned once.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace forward_index {
+
+constexpr std::size_t ID_SIZE = 20;
+
+// Lemma IDs of one forward-index line, in text order
+struct Fields {
+    std::vector<int> title;
+    std::vector<int> abstract;
+    std::vector<int> body;
+};
+
+// "12,7,431" -> {12, 7, 431}; stops at the first character that is not a number
+inline std::vector<int> parseLemmaList(const std::string& text) {
+    std::vector<int> lemmas;
+    const char* p = text.c_str();
+    while (*p) {
+        char* end;
+        long v = std::strtol(p, &end, 10);
+        if (end == p) break;
+        lemmas.push_back(static_cast<int>(v));
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return lemmas;
+}
+
+class Reader {
+public:
+    // A missing forward index leaves the reader empty (every lookup fails);
+    // a missing or short offsets file means the whole file is scanned
+    Reader(const std::string& forwardPath, const std::string& offsetsPath) {
+        int64_t covered = 0;
+        std::ifstream offFile(offsetsPath, std::ios::binary);
+        if (offFile.is_open()) {
+            int64_t numDocs = 0;
+            offFile.read(reinterpret_cast<char*>(&numDocs), sizeof(numDocs));
+            offFile.read(reinterpret_cast<char*>(&covered), sizeof(covered));
+            offsets.resize(static_cast<std::size_t>(numDocs) * ENTRY_SIZE);
+            offFile.read(offsets.data(), offsets.size());
+            if (!offFile) {
+                offsets.clear();
+                covered = 0;
+            }
+        }
+
+        file.open(forwardPath, std::ios::binary);
+        if (!file.is_open()) return;
+        file.seekg(covered);
+        std::string line;
+        int64_t offset = covered;
+        while (std::getline(file, line)) {
+            tail[line.substr(0, line.find('|'))] = offset;
+            offset += static_cast<int64_t>(line.size()) + 1;
+        }
+        file.clear();
+    }
+
+    // The document's line parsed into out; false if it has no line
+    bool fields(const std::string& docId, Fields& out) {
+        int64_t offset = find(docId);
+        if (offset < 0 || !file.is_open()) return false;
+
+        std::string line;
+        file.seekg(offset);
+        std::getline(file, line);
+        file.clear();
+
+        // docId|totalTerms|title|abstract|body
+        std::vector<std::string> parts;
+        std::stringstream ss(line);
+        std::string part;
+        while (std::getline(ss, part, '|')) parts.push_back(part);
+        parts.resize(5);
+        out.title = parseLemmaList(parts[2]);
+        out.abstract = parseLemmaList(parts[3]);
+        out.body = parseLemmaList(parts[4]);
+        return true;
+    }
+
+private:
+    static constexpr std::size_t ENTRY_SIZE = ID_SIZE + 8;
+
+    std::vector<char> offsets;  // [docId:20][offset:8] sorted by docId
+    std::unordered_map<std::string, int64_t> tail;  // lines past the offsets table
+    std::ifstream file;
+
+    // Byte offset of the document's line, -1 if it has none
+    int64_t find(const std::string& docId) const {
+        auto tailIt = tail.find(docId);
+        if (tailIt != tail.end()) return tailIt->second;
+
+        char key[ID_SIZE] = {};
+        std::strncpy(key, docId.c_str(), ID_SIZE - 1);
+        std::size_t lo = 0, hi = offsets.size() / ENTRY_SIZE;
+        while (lo < hi) {
+            std::size_t mid = lo + (hi - lo) / 2;
+            const char* entry = offsets.data() + mid * ENTRY_SIZE;
+            int c = std::memcmp(entry, key, ID_SIZE);
+            if (c == 0) {
+                int64_t offset;
+                std::memcpy(&offset, entry + ID_SIZE, sizeof(offset));
+                return offset;
+            }
+            if (c < 0) lo = mid + 1; else hi = mid;
+        }
+        return -1;
+    }
+};
+
+}  // namespace forward_index
@@ -0,0 +1,407 @@
+#pragma once
+
+/*
+ * IVF-PQ Document Vector Index
+ *
+ * A compressed alternative to the HNSW graph (dense_index.hpp) for document
+ * vectors, for collections whose float vectors do not fit in RAM next to the
+ * barrels. Only the codes stay in memory; the full vectors are read from the
+ * memory-mapped doc_vectors.bin for the final re-rank, so the OS pages in
+ * just the candidates.
+ *
+ * - Coarse quantizer (IVF): k-means centroids; every document goes to the
+ *   list of its nearest centroid. A query scans the nprobe lists whose
+ *   centroids have the highest dot product with it.
+ * - Product quantizer (PQ): the residual (vector - centroid) is cut into m
+ *   sub-vectors, each replaced by the 8-bit index of its nearest codeword in
+ *   that subspace's 256-entry codebook. A document costs m code bytes plus
+ *   its 4-byte docID.
+ * - Asymmetric distance (ADC): score(q, x) = <q, c> + sum_j <q_j, codeword_j>.
+ *   The second term uses one lookup table of m x 256 floats per query (the
+ *   same for every list, since the dot product is linear), so a document is
+ *   scored with m table lookups. Codes are stored in blocks of 8 documents,
+ *   subquantizer-major, so AVX2 scores a block with one gather per
+ *   subquantizer; elsewhere the same loop runs scalar.
+ * - Re-rank: the best `rerank` documents by ADC score are re-scored exactly
+ *   against their full vectors and the top k returned.
+ *
+ * File (indexes/<dense_dir>/ivfpq.bin, little-endian):
+ *   [magic:8 "MGIVFPQ1"][numDocs:4][dim:4][lists:4][m:4]
+ *   centroids        lists x dim float32
+ *   subspaces        (m + 1) uint32: first dimension of each subspace, then dim
+ *   codebooks        per subspace j: 256 x (width of j) float32
+ *   per list         [count:4][blocks:4] then blocks x 8 uint32 docIDs
+ *                    (padding = 0xFFFFFFFF), then blocks x m x 8 code bytes
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "dense_index.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace ivf_pq {
+
+constexpr char MAGIC[8] = {'M', 'G', 'I', 'V', 'F', 'P', 'Q', '1'};
+constexpr uint32_t CODEBOOK_SIZE = 256;  // 8-bit codes
+constexpr uint32_t BLOCK = 8;            // documents per code block
+constexpr uint32_t NO_DOC = 0xFFFFFFFFu;
+
+inline float squaredDistance(const float* a, const float* b, uint32_t dim) {
+    float s = 0.0f;
+    for (uint32_t d = 0; d < dim; d++) {
+        float diff = a[d] - b[d];
+        s += diff * diff;
+    }
+    return s;
+}
+
+// Index of the row of table (rows x dim) nearest to x
+inline uint32_t nearestRow(const float* x, const float* table, uint32_t rows, uint32_t dim) {
+    uint32_t best = 0;
+    float bestDist = squaredDistance(x, table, dim);
+    for (uint32_t r = 1; r < rows; r++) {
+        float dist = squaredDistance(x, table + static_cast<size_t>(r) * dim, dim);
+        if (dist < bestDist) {
+            bestDist = dist;
+            best = r;
+        }
+    }
+    return best;
+}
+
+// Lloyd's k-means (squared Euclidean) over n points of dim floats, seeded
+// with k distinct random points; an emptied cluster is reseeded with a
+// random point. Returns k x dim centroids (k <= n).
+inline std::vector<float> kmeans(const std::vector<float>& points, size_t n, uint32_t dim, uint32_t k,
+                                 int iterations, std::mt19937& rng) {
+    if (n == 0 || k == 0) {
+        throw std::runtime_error("k-means needs at least one point and one cluster");
+    }
+    k = static_cast<uint32_t>(std::min<size_t>(k, n));
+
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; i++) order[i] = i;
+    std::shuffle(order.begin(), order.end(), rng);
+    std::vector<float> cent(static_cast<size_t>(k) * dim);
+    for (uint32_t c = 0; c < k; c++) {
+        std::copy_n(&points[order[c] * dim], dim, &cent[static_cast<size_t>(c) * dim]);
+    }
+
+    std::vector<uint32_t> assign(n, 0);
+    std::vector<double> sums(static_cast<size_t>(k) * dim);
+    std::vector<size_t> counts(k);
+    std::uniform_int_distribution<size_t> pick(0, n - 1);
+    for (int iter = 0; iter < iterations; iter++) {
+        bool changed = false;
+        for (size_t i = 0; i < n; i++) {
+            uint32_t c = nearestRow(&points[i * dim], cent.data(), k, dim);
+            changed = changed || c != assign[i];
+            assign[i] = c;
+        }
+        if (iter > 0 && !changed) break;
+
+        std::fill(sums.begin(), sums.end(), 0.0);
+        std::fill(counts.begin(), counts.end(), 0);
+        for (size_t i = 0; i < n; i++) {
+            double* s = &sums[static_cast<size_t>(assign[i]) * dim];
+            for (uint32_t d = 0; d < dim; d++) s[d] += points[i * dim + d];
+            counts[assign[i]]++;
+        }
+        for (uint32_t c = 0; c < k; c++) {
+            float* r = &cent[static_cast<size_t>(c) * dim];
+            if (counts[c] == 0) {
+                std::copy_n(&points[pick(rng) * dim], dim, r);
+                continue;
+            }
+            for (uint32_t d = 0; d < dim; d++) r[d] = static_cast<float>(sums[static_cast<size_t>(c) * dim + d] / counts[c]);
+        }
+    }
+    return cent;
+}
+
+class Index {
+public:
+    struct Params {
+        uint32_t lists = 0;           // 0 = 4 * sqrt(documents)
+        uint32_t subquantizers = 25;  // code bytes per document
+        int iterations = 15;
+        size_t trainSample = 50000;
+        uint32_t seed = 42;
+    };
+
+    uint32_t lists() const { return numLists; }
+    uint32_t subquantizers() const { return m; }
+    uint64_t indexed() const { return numIndexed; }
+    // In-memory bytes per indexed document (codes and docID, without padding)
+    uint32_t bytesPerDocument() const { return m + sizeof(uint32_t); }
+
+    void build(const dense_index::Vectors& vectors, const Params& params) {
+        numDocs = static_cast<uint32_t>(vectors.size());
+        dim = vectors.dim();
+        m = std::max<uint32_t>(1, std::min(params.subquantizers, dim));
+        std::mt19937 rng(params.seed);
+
+        std::vector<uint32_t> docs;
+        for (uint32_t docId = 0; docId < numDocs; docId++) {
+            if (!vectors.isZero(docId)) docs.push_back(docId);
+        }
+        numIndexed = docs.size();
+        if (docs.empty()) {
+            throw std::runtime_error("No document vectors to index");
+        }
+
+        // Subspaces of near-equal width
+        subspaces.assign(m + 1, 0);
+        for (uint32_t j = 0; j <= m; j++) subspaces[j] = static_cast<uint32_t>(static_cast<uint64_t>(j) * dim / m);
+
+        // Training sample: every stride-th document
+        size_t stride = std::max<size_t>(1, (docs.size() + params.trainSample - 1) / params.trainSample);
+        std::vector<uint32_t> sample;
+        for (size_t i = 0; i < docs.size(); i += stride) sample.push_back(docs[i]);
+        std::vector<float> points(sample.size() * dim);
+        for (size_t i = 0; i < sample.size(); i++) std::copy_n(vectors.row(sample[i]), dim, &points[i * dim]);
+
+        uint32_t wanted = params.lists ? params.lists
+                                       : static_cast<uint32_t>(4.0 * std::sqrt(static_cast<double>(docs.size())));
+        centroids = kmeans(points, sample.size(), dim, std::max<uint32_t>(1, wanted), params.iterations, rng);
+        numLists = static_cast<uint32_t>(centroids.size() / dim);
+
+        // Codebooks, trained on the sample's residuals
+        std::vector<float> residuals(points.size());
+        for (size_t i = 0; i < sample.size(); i++) {
+            const float* x = &points[i * dim];
+            const float* c = &centroids[static_cast<size_t>(nearestRow(x, centroids.data(), numLists, dim)) * dim];
+            for (uint32_t d = 0; d < dim; d++) residuals[i * dim + d] = x[d] - c[d];
+        }
+        codebooks.assign(static_cast<size_t>(CODEBOOK_SIZE) * dim, 0.0f);
+        for (uint32_t j = 0; j < m; j++) {
+            uint32_t width = subspaces[j + 1] - subspaces[j];
+            std::vector<float> sub(sample.size() * width);
+            for (size_t i = 0; i < sample.size(); i++) {
+                std::copy_n(&residuals[i * dim + subspaces[j]], width, &sub[i * width]);
+            }
+            auto book = kmeans(sub, sample.size(), width, CODEBOOK_SIZE, params.iterations, rng);
+            std::copy(book.begin(), book.end(), codebook(j));  // fewer than 256 rows stay zero
+        }
+
+        // Encode every document into its list
+        std::vector<std::vector<uint32_t>> members(numLists);
+        for (uint32_t docId : docs) {
+            members[nearestRow(vectors.row(docId), centroids.data(), numLists, dim)].push_back(docId);
+        }
+        invLists.assign(numLists, {});
+        std::vector<float> residual(dim);
+        std::vector<uint8_t> code(m);
+        for (uint32_t l = 0; l < numLists; l++) {
+            List& list = invLists[l];
+            list.count = static_cast<uint32_t>(members[l].size());
+            uint32_t blocks = (list.count + BLOCK - 1) / BLOCK;
+            list.docIds.assign(static_cast<size_t>(blocks) * BLOCK, NO_DOC);
+            list.codes.assign(static_cast<size_t>(blocks) * m * BLOCK, 0);
+            const float* c = &centroids[static_cast<size_t>(l) * dim];
+            for (uint32_t i = 0; i < list.count; i++) {
+                uint32_t docId = members[l][i];
+                const float* x = vectors.row(docId);
+                for (uint32_t d = 0; d < dim; d++) residual[d] = x[d] - c[d];
+                encode(residual.data(), code.data());
+                list.docIds[i] = docId;
+                size_t block = i / BLOCK, lane = i % BLOCK;
+                for (uint32_t j = 0; j < m; j++) list.codes[(block * m + j) * BLOCK + lane] = code[j];
+            }
+        }
+    }
+
+    // The k documents most similar to query (unit length, dim floats), best
+    // first: ADC over the nprobe nearest lists, exact re-rank of the best
+    // `rerank` candidates against vectors
+    std::vector<dense_index::Neighbor> search(const dense_index::Vectors& vectors, const float* query, size_t k,
+                                              size_t nprobe, size_t rerank) const {
+        if (numLists == 0 || k == 0) return {};
+        nprobe = std::min<size_t>(std::max<size_t>(nprobe, 1), numLists);
+        rerank = std::max(rerank, k);
+
+        std::vector<std::pair<float, uint32_t>> probe(numLists);
+        for (uint32_t l = 0; l < numLists; l++) {
+            probe[l] = {dense_index::dot(query, &centroids[static_cast<size_t>(l) * dim], dim), l};
+        }
+        std::partial_sort(probe.begin(), probe.begin() + nprobe, probe.end(), std::greater<std::pair<float, uint32_t>>());
+
+        // lut[j * 256 + code] = <query subvector j, codeword>
+        std::vector<float> lut(static_cast<size_t>(m) * CODEBOOK_SIZE);
+        for (uint32_t j = 0; j < m; j++) {
+            uint32_t width = subspaces[j + 1] - subspaces[j];
+            const float* q = query + subspaces[j];
+            const float* book = codebook(j);
+            for (uint32_t c = 0; c < CODEBOOK_SIZE; c++) {
+                lut[j * CODEBOOK_SIZE + c] = dense_index::dot(q, book + static_cast<size_t>(c) * width, width);
+            }
+        }
+
+        using Scored = std::pair<float, uint32_t>;
+        std::priority_queue<Scored, std::vector<Scored>, std::greater<Scored>> best;  // worst on top
+        alignas(32) float scores[BLOCK];
+        for (size_t p = 0; p < nprobe; p++) {
+            const List& list = invLists[probe[p].second];
+            size_t blocks = list.docIds.size() / BLOCK;
+            for (size_t b = 0; b < blocks; b++) {
+                scoreBlock(&list.codes[b * m * BLOCK], lut.data(), probe[p].first, scores);
+                for (uint32_t lane = 0; lane < BLOCK; lane++) {
+                    uint32_t docId = list.docIds[b * BLOCK + lane];
+                    if (docId == NO_DOC) break;
+                    if (best.size() < rerank) {
+                        best.push({scores[lane], docId});
+                    } else if (scores[lane] > best.top().first) {
+                        best.pop();
+                        best.push({scores[lane], docId});
+                    }
+                }
+            }
+        }
+
+        // Exact re-rank from the full vectors
+        std::vector<dense_index::Neighbor> out;
+        out.reserve(best.size());
+        for (; !best.empty(); best.pop()) {
+            uint32_t docId = best.top().second;
+            out.push_back({docId, dense_index::dot(query, vectors.row(docId), dim)});
+        }
+        std::sort(out.begin(), out.end(), [](const dense_index::Neighbor& a, const dense_index::Neighbor& b) {
+            return a.score != b.score ? a.score > b.score : a.docId < b.docId;
+        });
+        if (out.size() > k) out.resize(k);
+        return out;
+    }
+
+    void save(const fs::path& path) const {
+        std::ofstream out(path, std::ios::binary);
+        if (!out.is_open()) {
+            throw std::runtime_error("Cannot create " + path.string());
+        }
+        out.write(MAGIC, sizeof(MAGIC));
+        out.write(reinterpret_cast<const char*>(&numDocs), sizeof(numDocs));
+        out.write(reinterpret_cast<const char*>(&dim), sizeof(dim));
+        out.write(reinterpret_cast<const char*>(&numLists), sizeof(numLists));
+        out.write(reinterpret_cast<const char*>(&m), sizeof(m));
+        out.write(reinterpret_cast<const char*>(centroids.data()), centroids.size() * sizeof(float));
+        out.write(reinterpret_cast<const char*>(subspaces.data()), subspaces.size() * sizeof(uint32_t));
+        out.write(reinterpret_cast<const char*>(codebooks.data()), codebooks.size() * sizeof(float));
+        for (const auto& list : invLists) {
+            uint32_t blocks = static_cast<uint32_t>(list.docIds.size() / BLOCK);
+            out.write(reinterpret_cast<const char*>(&list.count), sizeof(list.count));
+            out.write(reinterpret_cast<const char*>(&blocks), sizeof(blocks));
+            out.write(reinterpret_cast<const char*>(list.docIds.data()), list.docIds.size() * sizeof(uint32_t));
+            out.write(reinterpret_cast<const char*>(list.codes.data()), list.codes.size());
+        }
+    }
+
+    // numDocs and dim must match the vector file the index was built from
+    void load(const fs::path& path, uint64_t expectedDocs, uint32_t expectedDim) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) {
+            throw std::runtime_error("Cannot open IVF-PQ index " + path.string() + " (run docVectorBuilder --index ivfpq)");
+        }
+        char magic[8];
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char*>(&numDocs), sizeof(numDocs));
+        in.read(reinterpret_cast<char*>(&dim), sizeof(dim));
+        in.read(reinterpret_cast<char*>(&numLists), sizeof(numLists));
+        in.read(reinterpret_cast<char*>(&m), sizeof(m));
+        if (!in || std::memcmp(magic, MAGIC, sizeof(magic)) != 0 || m == 0 || m > dim) {
+            throw std::runtime_error("Not an IVF-PQ index: " + path.string());
+        }
+        if (numDocs != expectedDocs || dim != expectedDim) {
+            throw std::runtime_error("IVF-PQ index does not match the document vectors (rebuild with docVectorBuilder)");
+        }
+        centroids.resize(static_cast<size_t>(numLists) * dim);
+        subspaces.resize(m + 1);
+        codebooks.resize(static_cast<size_t>(CODEBOOK_SIZE) * dim);
+        in.read(reinterpret_cast<char*>(centroids.data()), centroids.size() * sizeof(float));
+        in.read(reinterpret_cast<char*>(subspaces.data()), subspaces.size() * sizeof(uint32_t));
+        in.read(reinterpret_cast<char*>(codebooks.data()), codebooks.size() * sizeof(float));
+        if (!in || subspaces[0] != 0 || subspaces[m] != dim) {
+            throw std::runtime_error("IVF-PQ index is corrupt: " + path.string());
+        }
+
+        invLists.assign(numLists, {});
+        numIndexed = 0;
+        for (auto& list : invLists) {
+            uint32_t blocks = 0;
+            in.read(reinterpret_cast<char*>(&list.count), sizeof(list.count));
+            in.read(reinterpret_cast<char*>(&blocks), sizeof(blocks));
+            if (!in || list.count > static_cast<uint64_t>(blocks) * BLOCK) {
+                throw std::runtime_error("IVF-PQ index is truncated: " + path.string());
+            }
+            list.docIds.resize(static_cast<size_t>(blocks) * BLOCK);
+            list.codes.resize(static_cast<size_t>(blocks) * m * BLOCK);
+            in.read(reinterpret_cast<char*>(list.docIds.data()), list.docIds.size() * sizeof(uint32_t));
+            in.read(reinterpret_cast<char*>(list.codes.data()), list.codes.size());
+            numIndexed += list.count;
+        }
+        if (!in) {
+            throw std::runtime_error("IVF-PQ index is truncated: " + path.string());
+        }
+    }
+
+private:
+    struct List {
+        uint32_t count = 0;
+        std::vector<uint32_t> docIds;  // blocks x BLOCK, padded with NO_DOC
+        std::vector<uint8_t> codes;    // blocks x m x BLOCK
+    };
+
+    uint32_t numDocs = 0;
+    uint32_t dim = 0;
+    uint32_t numLists = 0;
+    uint32_t m = 0;
+    uint64_t numIndexed = 0;
+    std::vector<float> centroids;     // numLists x dim
+    std::vector<uint32_t> subspaces;  // m + 1 dimension boundaries
+    std::vector<float> codebooks;     // subspace j at 256 * subspaces[j]
+    std::vector<List> invLists;
+
+    float* codebook(uint32_t j) { return &codebooks[static_cast<size_t>(CODEBOOK_SIZE) * subspaces[j]]; }
+    const float* codebook(uint32_t j) const { return &codebooks[static_cast<size_t>(CODEBOOK_SIZE) * subspaces[j]]; }
+
+    void encode(const float* residual, uint8_t* code) const {
+        for (uint32_t j = 0; j < m; j++) {
+            uint32_t width = subspaces[j + 1] - subspaces[j];
+            code[j] = static_cast<uint8_t>(nearestRow(residual + subspaces[j], codebook(j), CODEBOOK_SIZE, width));
+        }
+    }
+
+    // ADC scores of one block of 8 documents: bias + sum_j lut[j][code]
+    void scoreBlock(const uint8_t* codes, const float* lut, float bias, float* scores) const {
+#if defined(__AVX2__)
+        __m256 acc = _mm256_set1_ps(bias);
+        for (uint32_t j = 0; j < m; j++) {
+            __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(codes + j * BLOCK));
+            __m256i idx = _mm256_cvtepu8_epi32(bytes);
+            acc = _mm256_add_ps(acc, _mm256_i32gather_ps(lut + j * CODEBOOK_SIZE, idx, 4));
+        }
+        _mm256_store_ps(scores, acc);
+#else
+        for (uint32_t lane = 0; lane < BLOCK; lane++) scores[lane] = bias;
+        for (uint32_t j = 0; j < m; j++) {
+            const float* t = lut + j * CODEBOOK_SIZE;
+            const uint8_t* c = codes + j * BLOCK;
+            for (uint32_t lane = 0; lane < BLOCK; lane++) scores[lane] += t[c[lane]];
+        }
+#endif
+    }
+};
+
+}  // namespace ivf_pq
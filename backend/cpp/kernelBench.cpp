@@ -0,0 +1,152 @@
+/*
+ * Scoring Kernel Benchmark
+ *
+ * Times the block scoring kernels of score_kernels.hpp (BM25, TF-IDF and the
+ * accumulator scatter-add) at every instruction set level this CPU supports,
+ * on synthetic posting lists: tfs skewed towards 1 as in real lists (a few
+ * above the TF-IDF table), document lengths around AVG_DOC_LENGTH, and
+ * ascending docIDs with random gaps. Prints postings scored per nanosecond
+ * and checks that every level returns exactly the scalar results.
+ *
+ * Usage (from backend/cpp):
+ *   ./build/kernelBench
+ *   ./build/kernelBench --postings 1000000 --rounds 50
+ */
+
+#include "score_kernels.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+
+using namespace std;
+using namespace chrono;
+
+const int TOTAL_DOCS = 59000;
+const double BM25_K1 = 1.5;
+const double BM25_B = 0.75;
+const int AVG_DOC_LENGTH = 200;
+
+struct Postings {
+    vector<uint32_t> docs;
+    vector<int32_t> tfs;
+    vector<int32_t> docLengths;
+    uint32_t numDocs = 0;
+};
+
+Postings syntheticPostings(size_t n) {
+    mt19937 rng(42);
+    geometric_distribution<int32_t> tf(0.45);
+    normal_distribution<double> length(AVG_DOC_LENGTH, AVG_DOC_LENGTH / 3.0);
+    uniform_int_distribution<uint32_t> gap(1, 8);
+
+    Postings p;
+    p.docs.reserve(n);
+    p.tfs.reserve(n);
+    p.docLengths.reserve(n);
+    uint32_t doc = 0;
+    for (size_t i = 0; i < n; i++) {
+        doc += gap(rng);
+        p.docs.push_back(doc);
+        p.tfs.push_back(1 + tf(rng));
+        p.docLengths.push_back(max(1, static_cast<int32_t>(length(rng))));
+    }
+    p.numDocs = doc + 1;
+    return p;
+}
+
+// Best time of `rounds` runs of f, in nanoseconds
+template <typename F>
+double bestNs(int rounds, F f) {
+    double best = 1e300;
+    for (int r = 0; r < rounds; r++) {
+        auto start = high_resolution_clock::now();
+        f();
+        best = min(best, static_cast<double>(duration_cast<nanoseconds>(high_resolution_clock::now() - start).count()));
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        cout << "======================================" << endl;
+        cout << "  SCORING KERNEL BENCHMARK" << endl;
+        cout << "======================================\n" << endl;
+
+        size_t numPostings = 1 << 20;
+        int rounds = 20;
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            if (arg == "--postings" && i + 1 < argc) {
+                numPostings = stoul(argv[++i]);
+            } else if (arg == "--rounds" && i + 1 < argc) {
+                rounds = max(1, stoi(argv[++i]));
+            }
+        }
+        if (numPostings == 0) throw runtime_error("--postings must be positive");
+
+        Postings p = syntheticPostings(numPostings);
+        int df = static_cast<int>(min<size_t>(numPostings, TOTAL_DOCS / 2));
+        score_kernels::Bm25Term bm25 = score_kernels::bm25Term(
+            log((static_cast<double>(TOTAL_DOCS - df) + 0.5) / (static_cast<double>(df) + 0.5)),
+            BM25_K1, BM25_B, AVG_DOC_LENGTH);
+        score_kernels::TfIdfTerm tfidf = score_kernels::tfidfTerm(
+            log10(static_cast<double>(TOTAL_DOCS) / static_cast<double>(df)), 0.7);
+
+        cout << "Postings: " << numPostings << " (" << rounds << " rounds, best kept)" << endl;
+        const score_kernels::Kernels& dispatched = score_kernels::kernels();
+        cout << "Dispatched: BM25 " << score_kernels::levelName(dispatched.bm25Level)
+             << ", TF-IDF " << score_kernels::levelName(dispatched.tfidfLevel)
+             << ", scatterAdd " << score_kernels::levelName(dispatched.scatterAddLevel) << "\n" << endl;
+
+        vector<float> values(numPostings), reference(numPostings);
+        vector<float> sums(p.numDocs, 0.0f), referenceSums;
+        vector<float> bm25Ref, tfidfRef;
+
+        cout << left << setw(10) << "Level" << right << setw(14) << "BM25" << setw(14) << "TF-IDF"
+             << setw(14) << "scatterAdd" << "   (postings/ns)" << endl;
+
+        const score_kernels::Level levels[] = {score_kernels::Level::Scalar, score_kernels::Level::Avx2,
+                                               score_kernels::Level::Avx512};
+        bool agree = true;
+        for (score_kernels::Level level : levels) {
+            if (!score_kernels::supported(level)) {
+                cout << left << setw(10) << score_kernels::levelName(level) << right << "   not supported" << endl;
+                continue;
+            }
+            score_kernels::Kernels k = score_kernels::kernelsFor(level);
+
+            double bm25Ns = bestNs(rounds, [&] {
+                k.bm25(bm25, p.tfs.data(), p.docLengths.data(), numPostings, values.data());
+            });
+            if (bm25Ref.empty()) bm25Ref = values;
+            agree = agree && values == bm25Ref;
+
+            double tfidfNs = bestNs(rounds, [&] { k.tfidf(tfidf, p.tfs.data(), numPostings, values.data()); });
+            if (tfidfRef.empty()) tfidfRef = values;
+            agree = agree && values == tfidfRef;
+
+            fill(sums.begin(), sums.end(), 0.0f);
+            double scatterNs = bestNs(rounds, [&] {
+                k.scatterAdd(sums.data(), p.docs.data(), values.data(), numPostings);
+            });
+            if (referenceSums.empty()) referenceSums = sums;
+            agree = agree && sums == referenceSums;
+
+            cout << left << setw(10) << score_kernels::levelName(level) << right << fixed << setprecision(2)
+                 << setw(14) << numPostings / bm25Ns << setw(14) << numPostings / tfidfNs
+                 << setw(14) << numPostings / scatterNs << endl;
+        }
+
+        cout << "\nResults " << (agree ? "identical at every level" : "DIFFER between levels") << endl;
+        return agree ? 0 : 1;
+
+    } catch (exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+}
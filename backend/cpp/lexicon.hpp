@@ -0,0 +1,214 @@
+#pragma once
+
+/*
+ * Word -> Lemma Table
+ *
+ * The lexicon used to be probed twice per token (word -> wordID, then
+ * wordID -> lemmaID), each probe hashing a freshly allocated std::string.
+ * LemmaTable folds both steps into one precomputed word -> lemmaID table
+ * and is keyed by std::string_view, so tokens coming out of the Tokenizer
+ * are looked up in place without building a string.
+ *
+ * Layout: open addressing with linear probing over a power-of-two slot
+ * array. Words live back to back in one arena string; a slot stores the
+ * word's offset/length, the full 32-bit hash (cheap mismatch filter) and
+ * the lemma ID. Load factor is kept at or below 1/2.
+ *
+ * Loaders:
+ * - loadLemmaTableJSON:   lexicon.json ({"wordID": ..., "wordToLemmaID": ...})
+ * - loadLemmaTableBinary: embeddings/lexicon.bin written by embeddings_setup.py
+ *   [numWords:4][(len:2, bytes)...][lemmaId:4 x numWords]
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "json.hpp"
+#include "tokenizer.hpp"
+
+class LemmaTable {
+public:
+    LemmaTable() { slots.resize(16); }
+
+    void reserve(size_t words) {
+        size_t want = 16;
+        while (want < words * 2) want <<= 1;
+        if (want > slots.size()) rehash(want);
+    }
+
+    // Insert or overwrite the lemma for a word.
+    void insert(std::string_view word, int32_t lemmaId) {
+        if ((count + 1) * 2 > slots.size()) rehash(slots.size() * 2);
+
+        uint32_t h = hash(word);
+        size_t mask = slots.size() - 1;
+        for (size_t i = h & mask;; i = (i + 1) & mask) {
+            Slot& s = slots[i];
+            if (s.length == EMPTY) {
+                s.offset = static_cast<uint32_t>(arena.size());
+                s.length = static_cast<uint32_t>(word.size());
+                s.hash = h;
+                s.lemmaId = lemmaId;
+                arena.append(word.data(), word.size());
+                count++;
+                return;
+            }
+            if (s.hash == h && keyOf(s) == word) {
+                s.lemmaId = lemmaId;
+                return;
+            }
+        }
+    }
+
+    // Returns the lemma ID for word, or -1 if the word is not in the lexicon.
+    int32_t find(std::string_view word) const {
+        uint32_t h = hash(word);
+        size_t mask = slots.size() - 1;
+        for (size_t i = h & mask;; i = (i + 1) & mask) {
+            const Slot& s = slots[i];
+            if (s.length == EMPTY) return -1;
+            if (s.hash == h && keyOf(s) == word) return s.lemmaId;
+        }
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // Calls fn(std::string_view word, int32_t lemmaId) for every entry.
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (const Slot& s : slots) {
+            if (s.length != EMPTY) fn(keyOf(s), s.lemmaId);
+        }
+    }
+
+    // Tokenizes text with the shared Tokenizer and appends the lemma IDs of
+    // every token found in the lexicon (unknown tokens are dropped).
+    void appendLemmaIds(std::string_view text, Tokenizer& tokenizer, std::vector<int>& out) const {
+        tokenizer.forEachToken(text, [&](std::string_view tok) {
+            int32_t lemmaId = find(tok);
+            if (lemmaId != -1) out.push_back(lemmaId);
+        });
+    }
+
+private:
+    static constexpr uint32_t EMPTY = 0xFFFFFFFFu;
+
+    struct Slot {
+        uint32_t offset = 0;
+        uint32_t length = EMPTY;
+        uint32_t hash = 0;
+        int32_t lemmaId = -1;
+    };
+
+    std::vector<Slot> slots;
+    std::string arena;
+    size_t count = 0;
+
+    std::string_view keyOf(const Slot& s) const {
+        return std::string_view(arena.data() + s.offset, s.length);
+    }
+
+    // 8 bytes at a time multiply-xorshift hash; words are short so this is
+    // mostly one or two rounds.
+    static uint32_t hash(std::string_view key) {
+        const uint64_t mul = 0x9E3779B97F4A7C15ull;
+        uint64_t h = 0xCBF29CE484222325ull ^ (key.size() * mul);
+        const char* p = key.data();
+        size_t n = key.size();
+
+        while (n >= 8) {
+            uint64_t v;
+            std::memcpy(&v, p, 8);
+            h = (h ^ v) * mul;
+            h ^= h >> 29;
+            p += 8;
+            n -= 8;
+        }
+        if (n > 0) {
+            uint64_t v = 0;
+            std::memcpy(&v, p, n);
+            h = (h ^ v) * mul;
+            h ^= h >> 29;
+        }
+        h *= mul;
+        return static_cast<uint32_t>(h >> 32);
+    }
+
+    void rehash(size_t newSize) {
+        std::vector<Slot> old;
+        old.swap(slots);
+        slots.assign(newSize, Slot());
+
+        size_t mask = newSize - 1;
+        for (const Slot& s : old) {
+            if (s.length == EMPTY) continue;
+            for (size_t i = s.hash & mask;; i = (i + 1) & mask) {
+                if (slots[i].length == EMPTY) {
+                    slots[i] = s;
+                    break;
+                }
+            }
+        }
+    }
+};
+
+// Builds the table from a parsed lexicon.json. Words without an entry in
+// wordToLemmaID map to their own word ID (same fallback as lexicon lookups
+// have always used).
+inline void loadLemmaTableJSON(const nlohmann::json& lexicon, LemmaTable& table) {
+    if (!lexicon.contains("wordID")) return;
+
+    std::unordered_map<int, int> wordIdToLemmaId;
+    if (lexicon.contains("wordToLemmaID")) {
+        for (auto& [wordIdStr, lemmaId] : lexicon["wordToLemmaID"].items()) {
+            wordIdToLemmaId[std::stoi(wordIdStr)] = lemmaId.get<int>();
+        }
+    }
+
+    const auto& wordIds = lexicon["wordID"];
+    table.reserve(wordIds.size());
+    for (auto& [word, id] : wordIds.items()) {
+        int wordId = id.get<int>();
+        auto it = wordIdToLemmaId.find(wordId);
+        table.insert(word, it != wordIdToLemmaId.end() ? it->second : wordId);
+    }
+}
+
+// Loads embeddings/lexicon.bin. Returns false if the file is missing or short.
+inline bool loadLemmaTableBinary(const std::string& binPath, LemmaTable& table) {
+    std::ifstream binFile(binPath, std::ios::binary);
+    if (!binFile.is_open()) {
+        return false;
+    }
+
+    uint32_t numWords = 0;
+    if (!binFile.read(reinterpret_cast<char*>(&numWords), sizeof(numWords))) {
+        return false;
+    }
+
+    std::vector<std::string> words(numWords);
+    for (uint32_t i = 0; i < numWords; i++) {
+        uint16_t wordLen;
+        binFile.read(reinterpret_cast<char*>(&wordLen), sizeof(wordLen));
+        words[i].resize(wordLen);
+        binFile.read(&words[i][0], wordLen);
+    }
+
+    std::vector<int32_t> lemmaIds(numWords);
+    binFile.read(reinterpret_cast<char*>(lemmaIds.data()), numWords * sizeof(int32_t));
+    if (!binFile) {
+        return false;
+    }
+
+    table.reserve(numWords);
+    for (uint32_t i = 0; i < numWords; i++) {
+        table.insert(words[i], lemmaIds[i]);
+    }
+    return true;
+}
@@ -0,0 +1,408 @@
+#pragma once
+
+/*
+ * Learning-to-Rank Re-ranker
+ *
+ * Second ranking stage for search_semantic: the top candidates of the
+ * first-stage score get a feature vector (below) and are re-ordered by a
+ * gradient-boosted tree ensemble read from a file.
+ *
+ * Features, in this order (the model refers to them as f0..f10 or by name):
+ *   bm25_title, bm25_abstract, bm25_body  BM25 of the query terms in one field
+ *   bm25_doc                              BM25 over the whole document
+ *   proximity        matched query terms / shortest window holding them all,
+ *                    best field (1 = adjacent); 0 with fewer than two
+ *   pagerank, semantic, tfidf             first-stage scores
+ *   doc_length       lemmas in the document
+ *   matched_terms, query_terms            original query terms found / asked
+ * Expansion terms count towards BM25 with their expansion weight.
+ *
+ * Model file: an XGBoost JSON tree dump (Booster.dump_model(path,
+ * dump_format="json")), i.e. an array of trees, or {"base_score": s,
+ * "trees": [...]} with the same trees. Nodes are
+ *   {"nodeid", "split": "f3" | feature name, "split_condition": t,
+ *    "yes": id, "no": id, "children": [...]}  or  {"nodeid", "leaf": v}
+ * and x < t goes to "yes".
+ *
+ * Evaluation is QuickScorer (Lucchese et al., SIGIR 2015): leaves of a
+ * tree are numbered left to right and a 64-bit vector per tree holds the
+ * leaves still reachable. Each node's test is false (x >= t, go right)
+ * exactly when the leaves of its left subtree become unreachable, so the
+ * model is flattened into, per feature, all node thresholds in ascending
+ * order with their tree and mask. Scoring a document walks each feature's
+ * thresholds until one exceeds the value, AND-ing the masks in, with no
+ * branching on tree structure; each tree's exit leaf is then the lowest set
+ * bit. Trees with more than 64 leaves are walked node by node.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "config.hpp"
+#include "forward_index.hpp"
+
+namespace ltr {
+
+enum Feature : uint32_t {
+    BM25_TITLE,
+    BM25_ABSTRACT,
+    BM25_BODY,
+    BM25_DOC,
+    PROXIMITY,
+    PAGERANK,
+    SEMANTIC,
+    TFIDF,
+    DOC_LENGTH,
+    MATCHED_TERMS,
+    QUERY_TERMS,
+    NUM_FEATURES
+};
+
+inline const char* featureName(uint32_t f) {
+    static const char* names[NUM_FEATURES] = {"bm25_title", "bm25_abstract", "bm25_body", "bm25_doc",
+                                              "proximity", "pagerank", "semantic", "tfidf",
+                                              "doc_length", "matched_terms", "query_terms"};
+    return f < NUM_FEATURES ? names[f] : "?";
+}
+
+// ---------------------- Features ----------------------
+
+struct QueryTerm {
+    int lemmaId;
+    float weight;   // 1 for query terms, below 1 for expansion terms
+    int df;
+    bool original;
+};
+
+// A document's lemmas per field, as read from its forward index line
+using FieldLemmas = forward_index::Fields;
+
+struct Bm25Params {
+    double k1 = 1.5;
+    double b = 0.75;
+    int64_t totalDocs = 59000;
+    double avgTitle = 12.0;     // average field lengths in lemmas
+    double avgAbstract = 200.0;
+    double avgBody = 3000.0;
+};
+
+// Per-candidate inputs that come from the first stage
+struct FirstStage {
+    double pagerank = 0.0;
+    double semantic = 0.0;
+    double tfidf = 0.0;
+    int matchedTerms = 0;
+    int queryTerms = 0;
+};
+
+inline double bm25(double tf, double df, double length, double avgLength, const Bm25Params& p) {
+    if (tf <= 0.0 || df <= 0.0) return 0.0;
+    double idf = std::log(1.0 + (p.totalDocs - df + 0.5) / (df + 0.5));
+    double norm = p.k1 * (1.0 - p.b + p.b * length / std::max(avgLength, 1.0));
+    return idf * tf * (p.k1 + 1.0) / (tf + norm);
+}
+
+// Shortest window of field holding every lemma of wanted that occurs in it;
+// returns the number of distinct wanted lemmas present, window in spanOut
+inline size_t shortestCover(const std::vector<int>& field, const std::vector<int>& wanted, size_t& spanOut) {
+    std::unordered_map<int, int> inWindow;
+    for (int lemma : wanted) inWindow.emplace(lemma, 0);
+    std::unordered_set<int> seen;
+    for (int lemma : field) {
+        if (inWindow.count(lemma)) seen.insert(lemma);
+    }
+    const size_t present = seen.size();
+    spanOut = 0;
+    if (present < 2) return present;
+
+    size_t covered = 0, best = field.size() + 1, left = 0;
+    for (size_t right = 0; right < field.size(); right++) {
+        auto it = inWindow.find(field[right]);
+        if (it == inWindow.end()) continue;
+        if (it->second++ == 0) covered++;
+        while (covered == present) {
+            best = std::min(best, right - left + 1);
+            auto lt = inWindow.find(field[left]);
+            if (lt != inWindow.end() && --lt->second == 0) covered--;
+            left++;
+        }
+    }
+    spanOut = best;
+    return present;
+}
+
+// Fills out[NUM_FEATURES]
+inline void extractFeatures(const std::vector<QueryTerm>& terms, const FieldLemmas& doc, const FirstStage& first,
+                            const Bm25Params& params, float* out) {
+    std::unordered_map<int, std::array<int, 3>> tf;  // lemma -> tf per field
+    for (const auto& t : terms) tf[t.lemmaId] = {0, 0, 0};
+    const std::vector<int>* fields[3] = {&doc.title, &doc.abstract, &doc.body};
+    for (int f = 0; f < 3; f++) {
+        for (int lemma : *fields[f]) {
+            auto it = tf.find(lemma);
+            if (it != tf.end()) it->second[f]++;
+        }
+    }
+
+    const double lengths[3] = {static_cast<double>(doc.title.size()), static_cast<double>(doc.abstract.size()),
+                               static_cast<double>(doc.body.size())};
+    const double avgs[3] = {params.avgTitle, params.avgAbstract, params.avgBody};
+    const double docLength = lengths[0] + lengths[1] + lengths[2];
+    double fieldScores[3] = {0.0, 0.0, 0.0}, docScore = 0.0;
+    for (const auto& t : terms) {
+        const auto& counts = tf[t.lemmaId];
+        for (int f = 0; f < 3; f++) {
+            fieldScores[f] += t.weight * bm25(counts[f], t.df, lengths[f], avgs[f], params);
+        }
+        docScore += t.weight * bm25(counts[0] + counts[1] + counts[2], t.df, docLength,
+                                    avgs[0] + avgs[1] + avgs[2], params);
+    }
+
+    std::vector<int> wanted;
+    for (const auto& t : terms) {
+        if (t.original) wanted.push_back(t.lemmaId);
+    }
+    double proximity = 0.0;
+    for (int f = 0; f < 3; f++) {
+        size_t span = 0;
+        size_t present = shortestCover(*fields[f], wanted, span);
+        if (present >= 2 && span > 0) proximity = std::max(proximity, static_cast<double>(present) / span);
+    }
+
+    out[BM25_TITLE] = static_cast<float>(fieldScores[0]);
+    out[BM25_ABSTRACT] = static_cast<float>(fieldScores[1]);
+    out[BM25_BODY] = static_cast<float>(fieldScores[2]);
+    out[BM25_DOC] = static_cast<float>(docScore);
+    out[PROXIMITY] = static_cast<float>(proximity);
+    out[PAGERANK] = static_cast<float>(first.pagerank);
+    out[SEMANTIC] = static_cast<float>(first.semantic);
+    out[TFIDF] = static_cast<float>(first.tfidf);
+    out[DOC_LENGTH] = static_cast<float>(docLength);
+    out[MATCHED_TERMS] = static_cast<float>(first.matchedTerms);
+    out[QUERY_TERMS] = static_cast<float>(first.queryTerms);
+}
+
+// ---------------------- Tree ensemble ----------------------
+
+class Model {
+public:
+    explicit Model(const fs::path& path) {
+        std::ifstream in(path);
+        if (!in.is_open()) {
+            throw std::runtime_error("Cannot open ranking model " + path.string());
+        }
+        json doc;
+        try {
+            in >> doc;
+        } catch (const json::parse_error& e) {
+            throw std::runtime_error("Ranking model " + path.string() + " is not JSON: " + e.what());
+        }
+        const json* treeList = &doc;
+        if (doc.is_object()) {
+            baseScore = doc.value("base_score", 0.0f);
+            if (!doc.contains("trees")) {
+                throw std::runtime_error("Ranking model " + path.string() + " has no trees");
+            }
+            treeList = &doc["trees"];
+        }
+        for (const auto& t : *treeList) {
+            ensemble.push_back(parseTree(t));
+        }
+        compile();
+    }
+
+    size_t trees() const { return ensemble.size(); }
+    size_t quickTrees() const { return quick.size(); }
+
+    // QuickScorer over n documents; x holds n rows of NUM_FEATURES values
+    void scoreBatch(const float* x, size_t n, float* out) const {
+        std::vector<uint64_t> reachable(quick.size());
+        for (size_t d = 0; d < n; d++, x += NUM_FEATURES) {
+            std::fill(reachable.begin(), reachable.end(), ~uint64_t(0));
+            for (uint32_t f = 0; f < NUM_FEATURES; f++) {
+                const float v = x[f];
+                const Conditions& c = conditions[f];
+                for (size_t i = 0; i < c.thresholds.size() && v >= c.thresholds[i]; i++) {
+                    reachable[c.trees[i]] &= c.masks[i];
+                }
+            }
+            float s = baseScore;
+            for (size_t t = 0; t < quick.size(); t++) {
+                s += leafValues[t][ctz(reachable[t])];
+            }
+            for (uint32_t t : slow) s += walk(ensemble[t], x);
+            out[d] = s;
+        }
+    }
+
+    float score(const float* x) const {
+        float s = 0.0f;
+        scoreBatch(x, 1, &s);
+        return s;
+    }
+
+    // Plain root-to-leaf traversal of every tree; search_semantic checks
+    // scoreBatch against it while writing --ltr-features
+    float scoreByTraversal(const float* x) const {
+        float s = baseScore;
+        for (const auto& tree : ensemble) s += walk(tree, x);
+        return s;
+    }
+
+private:
+    struct Node {
+        int feature = -1;  // -1 = leaf
+        float threshold = 0.0f;
+        int left = -1;     // x < threshold
+        int right = -1;
+        float value = 0.0f;
+    };
+    struct Tree {
+        std::vector<Node> nodes;  // nodes[0] = root
+    };
+    // One feature's node tests, ascending by threshold (arrays kept apart so
+    // the threshold scan reads contiguous floats)
+    struct Conditions {
+        std::vector<float> thresholds;
+        std::vector<uint32_t> trees;   // index into quick
+        std::vector<uint64_t> masks;   // clear the node's left-subtree leaves
+    };
+
+    float baseScore = 0.0f;
+    std::vector<Tree> ensemble;
+    std::vector<uint32_t> quick;                    // trees with <= 64 leaves
+    std::vector<uint32_t> slow;
+    std::vector<std::vector<float>> leafValues;     // per quick tree, left to right
+    Conditions conditions[NUM_FEATURES];
+
+    static int ctz(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+        return v ? __builtin_ctzll(v) : 0;
+#else
+        int n = 0;
+        while (v && !(v & 1)) {
+            v >>= 1;
+            n++;
+        }
+        return n;
+#endif
+    }
+
+    static uint32_t featureIndex(const std::string& split) {
+        for (uint32_t f = 0; f < NUM_FEATURES; f++) {
+            if (split == featureName(f)) return f;
+        }
+        if (split.size() > 1 && split[0] == 'f' &&
+            std::all_of(split.begin() + 1, split.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            uint32_t f = static_cast<uint32_t>(std::stoul(split.substr(1)));
+            if (f < NUM_FEATURES) return f;
+        }
+        throw std::runtime_error("Ranking model uses unknown feature '" + split + "'");
+    }
+
+    // XGBoost node ids are per tree; children are nested
+    static Tree parseTree(const json& root) {
+        std::unordered_map<int, const json*> byId;
+        std::function<void(const json&)> collect = [&](const json& n) {
+            byId[n.value("nodeid", 0)] = &n;
+            if (n.contains("children")) {
+                for (const auto& c : n["children"]) collect(c);
+            }
+        };
+        collect(root);
+
+        Tree tree;
+        std::function<int(const json&)> build = [&](const json& n) -> int {
+            int index = static_cast<int>(tree.nodes.size());
+            tree.nodes.emplace_back();
+            if (n.contains("leaf")) {
+                tree.nodes[index].value = n["leaf"].get<float>();
+                return index;
+            }
+            auto yes = byId.find(n.value("yes", -1));
+            auto no = byId.find(n.value("no", -1));
+            if (!n.contains("split") || yes == byId.end() || no == byId.end()) {
+                throw std::runtime_error("Ranking model has a malformed tree node");
+            }
+            tree.nodes[index].feature = static_cast<int>(featureIndex(n["split"].get<std::string>()));
+            tree.nodes[index].threshold = n.value("split_condition", 0.0f);
+            int left = build(*yes->second);
+            int right = build(*no->second);
+            tree.nodes[index].left = left;
+            tree.nodes[index].right = right;
+            return index;
+        };
+        build(root);
+        return tree;
+    }
+
+    static float walk(const Tree& tree, const float* x) {
+        int i = 0;
+        while (tree.nodes[i].feature >= 0) {
+            const Node& n = tree.nodes[i];
+            i = x[n.feature] < n.threshold ? n.left : n.right;
+        }
+        return tree.nodes[i].value;
+    }
+
+    // Numbers leaves left to right and records each node's condition
+    void compile() {
+        struct Condition {
+            float threshold;
+            uint32_t tree;
+            uint64_t mask;
+        };
+        std::vector<Condition> byFeature[NUM_FEATURES];
+        for (uint32_t t = 0; t < ensemble.size(); t++) {
+            const Tree& tree = ensemble[t];
+            size_t leaves = std::count_if(tree.nodes.begin(), tree.nodes.end(), [](const Node& n) { return n.feature < 0; });
+            if (leaves > 64) {
+                slow.push_back(t);
+                continue;
+            }
+            uint32_t q = static_cast<uint32_t>(quick.size());
+            quick.push_back(t);
+            leafValues.emplace_back();
+            auto& values = leafValues.back();
+
+            // returns the range [first, end) of leaf numbers under node i
+            std::function<std::pair<int, int>(int)> number = [&](int i) -> std::pair<int, int> {
+                const Node& n = tree.nodes[i];
+                if (n.feature < 0) {
+                    values.push_back(n.value);
+                    int id = static_cast<int>(values.size()) - 1;
+                    return {id, id + 1};
+                }
+                auto l = number(n.left);
+                auto r = number(n.right);
+                uint64_t leftBits = 0;
+                for (int b = l.first; b < l.second; b++) leftBits |= uint64_t(1) << b;
+                byFeature[n.feature].push_back({n.threshold, q, ~leftBits});
+                return {l.first, r.second};
+            };
+            number(0);
+        }
+        for (uint32_t f = 0; f < NUM_FEATURES; f++) {
+            auto& list = byFeature[f];
+            std::stable_sort(list.begin(), list.end(),
+                             [](const Condition& a, const Condition& b) { return a.threshold < b.threshold; });
+            for (const auto& c : list) {
+                conditions[f].thresholds.push_back(c.threshold);
+                conditions[f].trees.push_back(c.tree);
+                conditions[f].masks.push_back(c.mask);
+            }
+        }
+    }
+};
+
+}  // namespace ltr
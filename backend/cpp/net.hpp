@@ -0,0 +1,200 @@
+#pragma once
+
+/*
+ * Minimal TCP Helpers (POSIX)
+ *
+ * Just enough socket plumbing for shardServer and searchCoordinator:
+ * listen/accept, connect with a timeout, and a buffered line reader whose
+ * reads give up at a deadline. The shard protocol is line-based text, one
+ * request per connection, so there is no framing beyond '\n'.
+ *
+ * POSIX only (Linux/macOS). The single-process search binaries do not
+ * include this header, so Windows builds are unaffected.
+ */
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace net {
+
+using Clock = std::chrono::steady_clock;
+
+// "host:port" -> (host, port). Throws on a malformed endpoint.
+inline void parseEndpoint(const std::string& endpoint, std::string& host, int& port) {
+    size_t colon = endpoint.rfind(':');
+    if (colon == std::string::npos || colon == 0) {
+        throw std::runtime_error("Bad endpoint (expected host:port): " + endpoint);
+    }
+    host = endpoint.substr(0, colon);
+    port = std::stoi(endpoint.substr(colon + 1));
+}
+
+// Owns a socket descriptor; closes it on destruction.
+class Socket {
+public:
+    Socket() = default;
+    explicit Socket(int fd) : fd(fd) {}
+    ~Socket() { close(); }
+
+    Socket(Socket&& other) noexcept : fd(other.fd) { other.fd = -1; }
+    Socket& operator=(Socket&& other) noexcept {
+        if (this != &other) {
+            close();
+            fd = other.fd;
+            other.fd = -1;
+        }
+        return *this;
+    }
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    int get() const { return fd; }
+    bool valid() const { return fd >= 0; }
+
+    void close() {
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+private:
+    int fd = -1;
+};
+
+inline Socket listenTcp(int port, int backlog = 64) {
+    Socket s(::socket(AF_INET, SOCK_STREAM, 0));
+    if (!s.valid()) {
+        throw std::runtime_error(std::string("socket() failed: ") + std::strerror(errno));
+    }
+
+    int yes = 1;
+    setsockopt(s.get(), SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+
+    if (::bind(s.get(), reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        throw std::runtime_error("bind to port " + std::to_string(port) + " failed: " + std::strerror(errno));
+    }
+    if (::listen(s.get(), backlog) < 0) {
+        throw std::runtime_error(std::string("listen() failed: ") + std::strerror(errno));
+    }
+    return s;
+}
+
+// Connects to host:port, giving up at the deadline. Returns an invalid
+// Socket on failure (the caller treats the shard as unavailable).
+inline Socket connectTcp(const std::string& host, int port, Clock::time_point deadline) {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0 || !res) {
+        return Socket();
+    }
+
+    Socket s(::socket(res->ai_family, res->ai_socktype, res->ai_protocol));
+    if (!s.valid()) {
+        freeaddrinfo(res);
+        return Socket();
+    }
+
+    int flags = fcntl(s.get(), F_GETFL, 0);
+    fcntl(s.get(), F_SETFL, flags | O_NONBLOCK);
+
+    int rc = ::connect(s.get(), res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+
+    if (rc < 0 && errno != EINPROGRESS) {
+        return Socket();
+    }
+    if (rc < 0) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+        pollfd pfd{s.get(), POLLOUT, 0};
+        if (remaining <= 0 || ::poll(&pfd, 1, static_cast<int>(remaining)) <= 0) {
+            return Socket();
+        }
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(s.get(), SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err != 0) {
+            return Socket();
+        }
+    }
+
+    fcntl(s.get(), F_SETFL, flags);  // back to blocking for writes
+    int yes = 1;
+    setsockopt(s.get(), IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    return s;
+}
+
+inline bool writeAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Buffered '\n'-delimited reader over a socket.
+class LineReader {
+public:
+    explicit LineReader(int fd) : fd(fd) {}
+
+    // Reads one line (without the '\n'). Returns false on EOF, error, or
+    // when the deadline passes before a full line arrives.
+    bool readLine(std::string& line, Clock::time_point deadline = Clock::time_point::max()) {
+        while (true) {
+            size_t nl = buffer.find('\n', scanned);
+            if (nl != std::string::npos) {
+                line.assign(buffer, 0, nl);
+                buffer.erase(0, nl + 1);
+                scanned = 0;
+                return true;
+            }
+            scanned = buffer.size();
+
+            if (deadline != Clock::time_point::max()) {
+                auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+                if (remaining <= 0) return false;
+                pollfd pfd{fd, POLLIN, 0};
+                int rc = ::poll(&pfd, 1, static_cast<int>(remaining));
+                if (rc < 0 && errno == EINTR) continue;
+                if (rc <= 0) return false;
+            }
+
+            char chunk[16384];
+            ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            buffer.append(chunk, static_cast<size_t>(n));
+        }
+    }
+
+private:
+    int fd;
+    std::string buffer;
+    size_t scanned = 0;
+};
+
+} // namespace net
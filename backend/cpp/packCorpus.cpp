@@ -0,0 +1,118 @@
+/*
+ * Corpus Packer
+ *
+ * Concatenates every JSON file under pmc_json into one corpus pack
+ * (see corpus_pack.hpp) so forwardIndex can re-index with sequential reads
+ * instead of one open/stat/read per document.
+ *
+ * Usage (from backend/cpp, like the other index builders):
+ *   ./build/packCorpus                # raw pack -> indexes/corpus.pack
+ *   ./build/packCorpus --zstd [level] # zstd-compressed records (needs MINIGOOGLE_WITH_ZSTD)
+ *
+ * Then:
+ *   ./build/forwardIndex --pack [--threads N]
+ */
+
+#include "config.hpp"
+#include "corpus_pack.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+
+using namespace std;
+using namespace chrono;
+
+int main(int argc, char* argv[]) {
+    try {
+        cout << "======================================" << endl;
+        cout << "  CORPUS PACKER" << endl;
+        cout << "======================================\n" << endl;
+
+        corpus_pack::Codec codec = corpus_pack::CODEC_RAW;
+        int level = 3;
+
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            if (arg == "--zstd") {
+                codec = corpus_pack::CODEC_ZSTD;
+                if (i + 1 < argc && isdigit(static_cast<unsigned char>(argv[i + 1][0]))) {
+                    level = stoi(argv[++i]);
+                }
+            }
+        }
+
+        // this file is in backend/cpp
+        fs::path backendDir = fs::current_path().parent_path();
+        json config = loadConfig(backendDir);
+
+        fs::path dataDir = backendDir / config["data_dir"].get<string>();
+        fs::path indexesDir = backendDir / config["indexes_dir"].get<string>();
+        fs::create_directories(indexesDir);
+
+        fs::path packPath = indexesDir / config.value("corpus_pack", "corpus.pack");
+        fs::path pmcFolder = findPMCJSONFolder(dataDir, config["json_data"]);
+
+        cout << "Configuration:" << endl;
+        cout << "  Input: " << pmcFolder.string() << endl;
+        cout << "  Output: " << packPath.string() << endl;
+        cout << "  Codec: " << (codec == corpus_pack::CODEC_ZSTD ? "zstd (level " + to_string(level) + ")" : "raw") << "\n" << endl;
+
+        auto startTime = high_resolution_clock::now();
+
+        // Sorted so the pack (and every docID derived from it) is reproducible
+        vector<fs::path> files;
+        for (const auto& entry : fs::directory_iterator(pmcFolder)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".json") {
+                files.push_back(entry.path());
+            }
+        }
+        sort(files.begin(), files.end());
+
+        cout << "Found " << files.size() << " JSON files" << endl;
+
+        corpus_pack::Writer writer(packPath.string(), codec, level);
+        string buffer;
+        uint64_t rawBytes = 0;
+
+        for (size_t i = 0; i < files.size(); i++) {
+            ifstream in(files[i], ios::binary);
+            if (!in.is_open()) {
+                cerr << "Warning: could not open " << files[i] << ", skipping." << endl;
+                continue;
+            }
+
+            in.seekg(0, ios::end);
+            buffer.resize(static_cast<size_t>(in.tellg()));
+            in.seekg(0, ios::beg);
+            in.read(&buffer[0], buffer.size());
+
+            writer.add(files[i].filename().string(), buffer.data(), buffer.size());
+            rawBytes += buffer.size();
+
+            if ((i + 1) % 5000 == 0) {
+                cout << "Packed " << (i + 1) << " files..." << endl;
+            }
+        }
+
+        writer.finish();
+
+        auto endTime = high_resolution_clock::now();
+        auto duration = duration_cast<milliseconds>(endTime - startTime).count();
+
+        cout << "\n=== Pack Complete ===" << endl;
+        cout << "Documents: " << writer.size() << endl;
+        cout << "Raw size: " << (rawBytes / 1024.0 / 1024.0) << " MB" << endl;
+        cout << "Pack size: " << (fs::file_size(packPath) / 1024.0 / 1024.0) << " MB" << endl;
+        cout << "Time: " << duration << "ms" << endl;
+
+    } catch (exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
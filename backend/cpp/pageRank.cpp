@@ -0,0 +1,115 @@
+/*
+ * PageRank Builder
+ *
+ * Computes PageRank over the citation graph forwardIndex extracts from the
+ * papers' bib_entries (citation_graph.hpp) and writes one score per docID.
+ * search_semantic uses the scores as its authority signal, in place of the
+ * doc_scores.json heuristic of embeddings_setup.py.
+ *
+ * Output: indexes/pagerank.bin (config "pagerank_file")
+ *
+ * Usage (from backend/cpp, after forwardIndex):
+ *   ./build/pageRank
+ *   ./build/pageRank --threads 8 --damping 0.85 --tolerance 1e-9
+ */
+
+#include "config.hpp"
+#include "citation_graph.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+using namespace std;
+using namespace chrono;
+
+const size_t TOP_PAPERS = 5;
+
+int main(int argc, char* argv[]) {
+    try {
+        cout << "======================================" << endl;
+        cout << "  PAGERANK BUILDER" << endl;
+        cout << "======================================\n" << endl;
+
+        // this file is in backend/cpp
+        fs::path backendDir = fs::current_path().parent_path();
+        json config = loadConfig(backendDir);
+
+        citation_graph::PageRankParams params;
+        params.damping = config.value("pagerank_damping", 0.85);
+        params.tolerance = config.value("pagerank_tolerance", 1e-7);
+        params.maxIterations = config.value("pagerank_max_iterations", 100u);
+        params.threads = max(1u, thread::hardware_concurrency());
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            if ((arg == "--threads" || arg == "-j") && i + 1 < argc) {
+                params.threads = max(1u, static_cast<uint32_t>(stoul(argv[++i])));
+            } else if (arg == "--damping" && i + 1 < argc) {
+                params.damping = stod(argv[++i]);
+            } else if (arg == "--tolerance" && i + 1 < argc) {
+                params.tolerance = stod(argv[++i]);
+            } else if (arg == "--iterations" && i + 1 < argc) {
+                params.maxIterations = static_cast<uint32_t>(stoul(argv[++i]));
+            }
+        }
+        if (params.damping <= 0.0 || params.damping >= 1.0) {
+            throw runtime_error("Damping must be between 0 and 1");
+        }
+
+        fs::path indexesDir = backendDir / config["indexes_dir"].get<string>();
+        fs::path graphPath = indexesDir / config.value("citation_graph_file", "citations.bin");
+        fs::path scoresPath = indexesDir / config.value("pagerank_file", "pagerank.bin");
+
+        cout << "Configuration:" << endl;
+        cout << "  Input: " << graphPath.string() << endl;
+        cout << "  Output: " << scoresPath.string() << endl;
+        cout << "  Damping: " << params.damping << ", tolerance: " << params.tolerance
+             << ", max iterations: " << params.maxIterations << endl;
+        cout << "  Threads: " << params.threads << "\n" << endl;
+
+        auto startTime = high_resolution_clock::now();
+
+        citation_graph::Graph graph;
+        graph.load(graphPath);
+        size_t citing = 0;
+        for (uint32_t d = 0; d < graph.numDocs; d++) {
+            if (graph.outDegree(d) > 0) citing++;
+        }
+        auto loadMs = duration_cast<milliseconds>(high_resolution_clock::now() - startTime).count();
+        cout << "Graph: " << graph.numDocs << " documents, " << graph.edges() << " citations, "
+             << citing << " documents citing others (loaded in " << loadMs << "ms)" << endl;
+
+        auto rankStart = high_resolution_clock::now();
+        citation_graph::PageRankResult result = citation_graph::pageRank(graph, params);
+        auto rankMs = duration_cast<milliseconds>(high_resolution_clock::now() - rankStart).count();
+        cout << "PageRank: " << result.iterations << " iterations in " << rankMs << "ms, L1 change "
+             << result.residual << (result.residual < params.tolerance ? " (converged)" : " (not converged)") << endl;
+
+        citation_graph::writeScores(scoresPath, result.scores, result.iterations);
+
+        // Most cited papers, with their in-link counts
+        citation_graph::Graph in = graph.transposed();
+        vector<uint32_t> order(result.scores.size());
+        for (uint32_t d = 0; d < order.size(); d++) order[d] = d;
+        size_t top = min(TOP_PAPERS, order.size());
+        partial_sort(order.begin(), order.begin() + top, order.end(),
+                     [&](uint32_t a, uint32_t b) { return result.scores[a] > result.scores[b]; });
+        cout << "Top documents (docID: score, cited by):" << endl;
+        for (size_t i = 0; i < top; i++) {
+            cout << "  " << order[i] << ": " << result.scores[order[i]] << ", " << in.outDegree(order[i]) << endl;
+        }
+
+        auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - startTime).count();
+        cout << "\n=== PageRank Complete ===" << endl;
+        cout << "Time: " << duration << "ms" << endl;
+
+    } catch (exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
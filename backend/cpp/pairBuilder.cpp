@@ -0,0 +1,361 @@
+/*
+ * Pair Index Builder
+ *
+ * Materializes the intersection of frequently co-queried term pairs as extra
+ * posting lists in a pair barrel (barrels_binary/pairs.bin / pairs.idx).
+ * An AND query containing such a pair then reads one short list instead of
+ * intersecting two long ones (see processMultiWordQuery in search.cpp).
+ *
+ * Pair sources (--source, default config "pair_source"):
+ * - querylog  every two distinct terms of a logged multi-word query, weighted
+ *             by how often it was asked (indexes/<query_log_file>, one query
+ *             per line; api.py appends to it)
+ * - bigrams   adjacent word pairs counted by ngram_builder.py (bigrams.json)
+ * - auto      the query log if it exists, otherwise bigrams.json
+ *
+ * Only pairs whose rarer term has df >= pair_min_df are worth it (short lists
+ * are cheap to intersect at query time). Pairs are taken most frequent first
+ * until pair_index_max_pairs pairs, or until the worst-case size of their
+ * lists would pass pair_index_max_mb.
+ *
+ * The forward index keeps each section's lemmas in text order, so every pair
+ * posting also records how often the two terms stand next to each other.
+ *
+ * pairs.idx: [numEntries:4] then [lemmaA:4][lemmaB:4][offset:8][length:8]
+ * pairs.bin: [lemmaA:4][lemmaB:4][dfA:4][dfB:4][numDocs:4] then numDocs x
+ *            [docId:20][tfA:4][tfB:4][adjacent:4]
+ * with lemmaA < lemmaB, df the term's full document frequency and postings in
+ * doc ID order, like the barrels.
+ *
+ * Usage (from backend/cpp, after forwardIndex and barrels_binary):
+ *   ./build/pairBuilder
+ *   ./build/pairBuilder --source bigrams --max-pairs 500
+ */
+
+#include "config.hpp"
+#include "lexicon.hpp"
+#include "tokenizer.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+using namespace chrono;
+
+const int DOC_ID_SIZE = 20;
+
+struct PairPosting {
+    char doc_id[DOC_ID_SIZE];
+    int32_t tfA;
+    int32_t tfB;
+    int32_t adjacent;
+};
+
+struct TermPair {
+    int32_t a;  // a < b
+    int32_t b;
+    double weight = 0.0;
+    vector<PairPosting> postings;
+};
+
+uint64_t pairKey(int32_t a, int32_t b) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(a)) << 32) | static_cast<uint32_t>(b);
+}
+
+// Parses "doc_id|total_terms|title|abstract|body" into lemmas in text order,
+// with -1 between sections so no adjacency is counted across them
+bool parseForwardSequence(const string& line, string& docId, vector<int>& lemmas) {
+    size_t bar1 = line.find('|');
+    size_t bar2 = (bar1 == string::npos) ? string::npos : line.find('|', bar1 + 1);
+    if (bar2 == string::npos) return false;
+
+    docId = line.substr(0, bar1);
+    lemmas.clear();
+
+    const char* p = line.c_str() + bar2 + 1;
+    while (*p) {
+        if (*p == '|') {
+            lemmas.push_back(-1);
+            p++;
+            continue;
+        }
+        if (*p == ',') {
+            p++;
+            continue;
+        }
+        char* end;
+        long lemma = strtol(p, &end, 10);
+        if (end == p) {
+            p++;
+            continue;
+        }
+        lemmas.push_back(static_cast<int>(lemma));
+        p = end;
+    }
+    return true;
+}
+
+void loadLemmaTable(const fs::path& indexesDir, const json& config, LemmaTable& table) {
+    if (loadLemmaTableBinary((indexesDir / "embeddings" / "lexicon.bin").string(), table)) {
+        return;
+    }
+    fs::path lexiconPath = indexesDir / config["lexicon_file"].get<string>();
+    ifstream lexFile(lexiconPath);
+    if (!lexFile.is_open()) {
+        throw runtime_error("Cannot open lexicon at " + lexiconPath.string());
+    }
+    json lexicon;
+    lexFile >> lexicon;
+    loadLemmaTableJSON(lexicon, table);
+}
+
+// Adds weight to every pair of distinct known terms in text
+void countPairs(const string& text, double weight, Tokenizer& tokenizer, const LemmaTable& words,
+                unordered_map<uint64_t, double>& counts) {
+    vector<int32_t> ids;
+    for (const auto& word : tokenizer.tokenize(text)) {
+        int32_t id = words.find(word);
+        if (id != -1 && find(ids.begin(), ids.end(), id) == ids.end()) {
+            ids.push_back(id);
+        }
+    }
+    for (size_t i = 0; i < ids.size(); i++) {
+        for (size_t j = i + 1; j < ids.size(); j++) {
+            counts[pairKey(min(ids[i], ids[j]), max(ids[i], ids[j]))] += weight;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        cout << "======================================" << endl;
+        cout << "  PAIR INDEX BUILDER" << endl;
+        cout << "======================================\n" << endl;
+
+        // this file is in backend/cpp
+        fs::path backendDir = fs::current_path().parent_path();
+        json config = loadConfig(backendDir);
+
+        string source = config.value("pair_source", "auto");
+        int maxPairs = config.value("pair_index_max_pairs", 1000);
+        double maxMb = config.value("pair_index_max_mb", 64.0);
+        int minDf = config.value("pair_min_df", 1000);
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            if (arg == "--source" && i + 1 < argc) {
+                source = argv[++i];
+            } else if (arg == "--max-pairs" && i + 1 < argc) {
+                maxPairs = stoi(argv[++i]);
+            } else if (arg == "--max-mb" && i + 1 < argc) {
+                maxMb = stod(argv[++i]);
+            } else if (arg == "--min-df" && i + 1 < argc) {
+                minDf = stoi(argv[++i]);
+            }
+        }
+
+        fs::path indexesDir = backendDir / config["indexes_dir"].get<string>();
+        fs::path forwardIndexPath = indexesDir / config["forward_index_file"].get<string>();
+        fs::path queryLogPath = indexesDir / config.value("query_log_file", "query_log.txt");
+        fs::path bigramsPath = indexesDir / "bigrams.json";
+        fs::path outDir = indexesDir / config.value("barrels_binary_dir", "barrels_binary");
+
+        if (source == "auto") {
+            source = fs::exists(queryLogPath) ? "querylog" : "bigrams";
+        }
+        if (source != "querylog" && source != "bigrams") {
+            throw runtime_error("Unknown --source '" + source + "' (auto, querylog or bigrams)");
+        }
+
+        cout << "Configuration:" << endl;
+        cout << "  Pairs from: " << (source == "querylog" ? queryLogPath : bigramsPath).string() << endl;
+        cout << "  Output: " << (outDir / "pairs.bin").string() << endl;
+        cout << "  Limits: " << maxPairs << " pairs, " << maxMb << "MB, rarer term df >= " << minDf << "\n" << endl;
+
+        auto startTime = high_resolution_clock::now();
+
+        // Candidate pairs with their frequency
+        LemmaTable words;
+        loadLemmaTable(indexesDir, config, words);
+        Tokenizer tokenizer;
+        unordered_map<uint64_t, double> counts;
+
+        if (source == "querylog") {
+            ifstream log(queryLogPath);
+            if (!log.is_open()) {
+                throw runtime_error("Cannot open query log at " + queryLogPath.string());
+            }
+            string line;
+            while (getline(log, line)) {
+                countPairs(line, 1.0, tokenizer, words, counts);
+            }
+        } else {
+            ifstream bigramsFile(bigramsPath);
+            if (!bigramsFile.is_open()) {
+                throw runtime_error("Cannot open " + bigramsPath.string() + " (run ngram_builder.py first)");
+            }
+            json bigrams;
+            bigramsFile >> bigrams;
+            for (auto& [phrase, count] : bigrams.items()) {
+                countPairs(phrase, count.get<double>(), tokenizer, words, counts);
+            }
+        }
+        cout << "Candidate pairs: " << counts.size() << endl;
+
+        // Pass 1: df of every term
+        unordered_map<int, int> df;
+        {
+            ifstream in(forwardIndexPath);
+            if (!in.is_open()) {
+                throw runtime_error("Cannot open forward index at " + forwardIndexPath.string());
+            }
+            string line, docId;
+            vector<int> lemmas;
+            while (getline(in, line)) {
+                if (!parseForwardSequence(line, docId, lemmas)) continue;
+                sort(lemmas.begin(), lemmas.end());
+                lemmas.erase(unique(lemmas.begin(), lemmas.end()), lemmas.end());
+                for (int lemma : lemmas) {
+                    if (lemma >= 0) df[lemma]++;
+                }
+            }
+        }
+
+        // Most frequent first, within the pair and size budgets
+        vector<TermPair> pairs;
+        for (const auto& [key, weight] : counts) {
+            TermPair p;
+            p.a = static_cast<int32_t>(key >> 32);
+            p.b = static_cast<int32_t>(key & 0xFFFFFFFF);
+            p.weight = weight;
+            if (min(df[p.a], df[p.b]) >= minDf) {
+                pairs.push_back(std::move(p));
+            }
+        }
+        sort(pairs.begin(), pairs.end(), [](const TermPair& x, const TermPair& y) {
+            if (x.weight != y.weight) return x.weight > y.weight;
+            return pairKey(x.a, x.b) < pairKey(y.a, y.b);
+        });
+
+        double budgetBytes = maxMb * 1024.0 * 1024.0;
+        double worstCase = 0.0;
+        size_t keep = 0;
+        while (keep < pairs.size() && keep < static_cast<size_t>(maxPairs)) {
+            double bytes = static_cast<double>(min(df[pairs[keep].a], df[pairs[keep].b])) * sizeof(PairPosting);
+            if (worstCase + bytes > budgetBytes) break;
+            worstCase += bytes;
+            keep++;
+        }
+        pairs.resize(keep);
+        cout << "Selected pairs: " << pairs.size() << endl;
+
+        // Pass 2: intersect and count adjacency, one document at a time
+        unordered_map<uint64_t, size_t> pairIndex;
+        unordered_map<int, vector<size_t>> pairsOf;  // lemmaA -> its pairs
+        for (size_t i = 0; i < pairs.size(); i++) {
+            pairIndex[pairKey(pairs[i].a, pairs[i].b)] = i;
+            pairsOf[pairs[i].a].push_back(i);
+        }
+        {
+            ifstream in(forwardIndexPath);
+            string line, docId;
+            vector<int> lemmas;
+            unordered_map<int, int> tf;
+            unordered_map<size_t, int> adjacent;
+            while (getline(in, line)) {
+                if (!parseForwardSequence(line, docId, lemmas)) continue;
+
+                tf.clear();
+                adjacent.clear();
+                for (size_t i = 0; i < lemmas.size(); i++) {
+                    if (lemmas[i] < 0) continue;
+                    tf[lemmas[i]]++;
+                    if (i > 0 && lemmas[i - 1] >= 0 && lemmas[i - 1] != lemmas[i]) {
+                        auto it = pairIndex.find(pairKey(min(lemmas[i - 1], lemmas[i]), max(lemmas[i - 1], lemmas[i])));
+                        if (it != pairIndex.end()) adjacent[it->second]++;
+                    }
+                }
+
+                for (const auto& [lemma, tfA] : tf) {
+                    auto it = pairsOf.find(lemma);
+                    if (it == pairsOf.end()) continue;
+                    for (size_t p : it->second) {
+                        auto tfB = tf.find(pairs[p].b);
+                        if (tfB == tf.end()) continue;
+
+                        PairPosting posting;
+                        memset(posting.doc_id, 0, DOC_ID_SIZE);
+                        strncpy(posting.doc_id, docId.c_str(), DOC_ID_SIZE - 1);
+                        posting.tfA = tfA;
+                        posting.tfB = tfB->second;
+                        auto adj = adjacent.find(p);
+                        posting.adjacent = (adj != adjacent.end()) ? adj->second : 0;
+                        pairs[p].postings.push_back(posting);
+                    }
+                }
+            }
+        }
+
+        // Write the pair barrel
+        fs::create_directories(outDir);
+        ofstream binFile(outDir / "pairs.bin", ios::binary);
+        ofstream idxFile(outDir / "pairs.idx", ios::binary);
+        if (!binFile.is_open() || !idxFile.is_open()) {
+            throw runtime_error("Cannot create pair files in " + outDir.string());
+        }
+
+        int32_t numEntries = static_cast<int32_t>(pairs.size());
+        idxFile.write(reinterpret_cast<char*>(&numEntries), sizeof(numEntries));
+        int64_t totalPostings = 0;
+        int64_t savedPostings = 0;  // postings an AND query no longer reads
+        for (auto& p : pairs) {
+            sort(p.postings.begin(), p.postings.end(), [](const PairPosting& x, const PairPosting& y) {
+                return memcmp(x.doc_id, y.doc_id, DOC_ID_SIZE) < 0;
+            });
+            int32_t dfA = df[p.a];
+            int32_t dfB = df[p.b];
+            int32_t numDocs = static_cast<int32_t>(p.postings.size());
+
+            int64_t offset = binFile.tellp();
+            binFile.write(reinterpret_cast<char*>(&p.a), sizeof(p.a));
+            binFile.write(reinterpret_cast<char*>(&p.b), sizeof(p.b));
+            binFile.write(reinterpret_cast<char*>(&dfA), sizeof(dfA));
+            binFile.write(reinterpret_cast<char*>(&dfB), sizeof(dfB));
+            binFile.write(reinterpret_cast<char*>(&numDocs), sizeof(numDocs));
+            binFile.write(reinterpret_cast<const char*>(p.postings.data()), p.postings.size() * sizeof(PairPosting));
+            int64_t length = static_cast<int64_t>(binFile.tellp()) - offset;
+
+            idxFile.write(reinterpret_cast<char*>(&p.a), sizeof(p.a));
+            idxFile.write(reinterpret_cast<char*>(&p.b), sizeof(p.b));
+            idxFile.write(reinterpret_cast<char*>(&offset), sizeof(offset));
+            idxFile.write(reinterpret_cast<char*>(&length), sizeof(length));
+
+            totalPostings += numDocs;
+            savedPostings += static_cast<int64_t>(dfA) + dfB - numDocs;
+        }
+        binFile.close();
+        idxFile.close();
+
+        auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - startTime).count();
+        double binSize = fs::file_size(outDir / "pairs.bin") / 1024.0 / 1024.0;
+
+        cout << "\n=== Pair Index Complete ===" << endl;
+        cout << "Pairs: " << pairs.size() << ", postings: " << totalPostings << " (" << binSize << "MB)" << endl;
+        if (!pairs.empty()) {
+            cout << "Postings skipped when every pair is queried once: " << savedPostings
+                 << " (" << savedPostings / static_cast<int64_t>(pairs.size()) << " per query)" << endl;
+        }
+        cout << "Time: " << duration << "ms" << endl;
+
+    } catch (exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+/*
+ * Specialized Query Evaluators
+ *
+ * A term-at-a-time query is a loop over its terms' postings: score each
+ * block of postings, add the scores into an accumulator. What varies is the
+ * scoring function, the accumulator and how postings are read, and none of
+ * it varies within a query. QueryEvaluator<Scorer, Accumulator, Cursor> is
+ * one such loop with all three fixed at compile time: the scorer's
+ * parameters are constexpr members of its Params type, so the inner loops
+ * carry no virtual calls and no per-posting branches. Every supported
+ * combination is instantiated, and Dispatch<Scorer> selects one per query
+ * from a table of function pointers.
+ *
+ * Policies:
+ * - Scorer: Bm25<Params> (Params::k1, b, avgDocLen, totalDocs) or
+ *   TfIdf<Params> (Params::totalDocs). term() computes a term's constants
+ *   once, score() scores a block with the kernels of score_kernels.hpp.
+ * - Accumulator: accumulator::Dense or accumulator::Paged.
+ * - Cursor: UniformLengths (every document has the average length, so
+ *   lengths are never read) or DocLengths (per-posting lengths).
+ *
+ * The scorer is fixed per search engine, since every other path of an
+ * engine (tiers, bitmaps, early termination) scores the same way; the
+ * table selects the accumulator and cursor.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "accumulator.hpp"
+#include "score_kernels.hpp"
+
+namespace query_evaluator {
+
+// Postings scored per kernel call: a block's scores stay in L1 until added
+constexpr size_t BLOCK_SIZE = 512;
+
+// One query term: parallel arrays of document numbers (distinct), tfs and,
+// for DocLengths, document lengths
+struct TermPostings {
+    const uint32_t* docs = nullptr;
+    const int32_t* tfs = nullptr;
+    const int32_t* docLengths = nullptr;
+    size_t size = 0;
+    int df = 0;
+    float weight = 1.0f;
+    uint32_t channel = 0;      // channel the scores are added to
+    int32_t alsoChannel = -1;  // second channel for the same scores, or -1
+    int32_t tfChannel = -1;    // channel summing the raw tfs, or -1
+    uint16_t matched = 1;      // added to the matched-term count
+};
+
+struct Query {
+    std::vector<TermPostings> terms;
+    uint32_t numDocs = 0;      // documents are numbered below this
+    uint32_t channels = 1;
+    int requiredTerms = 1;     // minimum matched-term count of a hit
+};
+
+// The documents with at least requiredTerms matches, in the accumulator's
+// visiting order, with their channel sums (hit-major)
+struct Hits {
+    uint32_t channels = 0;
+    std::vector<uint32_t> docs;
+    std::vector<uint16_t> matched;
+    std::vector<float> values;
+
+    size_t size() const { return docs.size(); }
+    float value(size_t hit, uint32_t channel) const { return values[hit * channels + channel]; }
+};
+
+// ---------------------- Scorers ----------------------
+
+template <typename Params>
+struct Bm25 {
+    using Term = score_kernels::Bm25Term;
+
+    // idf = ln((N - df + 0.5) / (df + 0.5)), as calculateBM25
+    static Term term(int df, float weight) {
+        double idf = df > 0 ? std::log((static_cast<double>(Params::totalDocs - df) + 0.5) / (static_cast<double>(df) + 0.5))
+                            : 0.0;
+        return score_kernels::bm25Term(idf * weight, Params::k1, Params::b, Params::avgDocLen);
+    }
+
+    static void score(const score_kernels::Kernels& k, const Term& t, const int32_t* tfs, const int32_t* docLengths,
+                      size_t n, float* out) {
+        k.bm25(t, tfs, docLengths, n, out);
+    }
+};
+
+template <typename Params>
+struct TfIdf {
+    using Term = score_kernels::TfIdfTerm;
+
+    // idf = log10(N / df), as calculateTFIDF; the weight multiplies the score
+    static Term term(int df, float weight) {
+        double idf = df > 0 ? std::log10(static_cast<double>(Params::totalDocs) / static_cast<double>(df)) : 0.0;
+        return score_kernels::tfidfTerm(idf, weight);
+    }
+
+    static void score(const score_kernels::Kernels& k, const Term& t, const int32_t* tfs, const int32_t*, size_t n,
+                      float* out) {
+        k.tfidf(t, tfs, n, out);
+    }
+};
+
+// ---------------------- Cursors ----------------------
+
+struct UniformLengths {
+    static const int32_t* lengths(const TermPostings&, size_t) { return nullptr; }
+};
+
+struct DocLengths {
+    static const int32_t* lengths(const TermPostings& term, size_t offset) {
+        return term.docLengths ? term.docLengths + offset : nullptr;
+    }
+};
+
+// ---------------------- Evaluator ----------------------
+
+template <typename Scorer, typename Accumulator, typename Cursor>
+struct QueryEvaluator {
+    static Hits evaluate(const Query& query) {
+        const score_kernels::Kernels& kernels = score_kernels::kernels();
+        Accumulator& acc = accumulator::threadLocal<Accumulator>(query.numDocs, query.channels);
+        float scores[BLOCK_SIZE];
+        float tfs[BLOCK_SIZE];
+
+        for (const TermPostings& term : query.terms) {
+            const typename Scorer::Term constants = Scorer::term(term.df, term.weight);
+            for (size_t offset = 0; offset < term.size; offset += BLOCK_SIZE) {
+                const size_t n = std::min(BLOCK_SIZE, term.size - offset);
+                const uint32_t* docs = term.docs + offset;
+                Scorer::score(kernels, constants, term.tfs + offset, Cursor::lengths(term, offset), n, scores);
+                acc.addTerm(docs, scores, n, term.channel, term.matched);
+                if (term.alsoChannel >= 0) {
+                    acc.addTerm(docs, scores, n, static_cast<uint32_t>(term.alsoChannel), 0);
+                }
+                if (term.tfChannel >= 0) {
+                    for (size_t i = 0; i < n; i++) tfs[i] = static_cast<float>(term.tfs[offset + i]);
+                    acc.addTerm(docs, tfs, n, static_cast<uint32_t>(term.tfChannel), 0);
+                }
+            }
+        }
+
+        Hits hits;
+        hits.channels = query.channels;
+        acc.forEachTouched([&](uint32_t doc) {
+            if (acc.matched(doc) < query.requiredTerms) return;
+            hits.docs.push_back(doc);
+            hits.matched.push_back(acc.matched(doc));
+            for (uint32_t c = 0; c < query.channels; c++) hits.values.push_back(acc.value(doc, c));
+        });
+        return hits;
+    }
+};
+
+// ---------------------- Dispatch ----------------------
+
+using EvaluateFn = Hits (*)(const Query&);
+
+template <typename Scorer>
+struct Dispatch {
+    // [paged][docLengths]
+    static constexpr EvaluateFn table[2][2] = {
+        {&QueryEvaluator<Scorer, accumulator::Dense, UniformLengths>::evaluate,
+         &QueryEvaluator<Scorer, accumulator::Dense, DocLengths>::evaluate},
+        {&QueryEvaluator<Scorer, accumulator::Paged, UniformLengths>::evaluate,
+         &QueryEvaluator<Scorer, accumulator::Paged, DocLengths>::evaluate},
+    };
+
+    // The evaluator for a query over numDocs documents: Dense arrays up to
+    // denseMaxDocs, Paged beyond; DocLengths only if some term has lengths
+    static EvaluateFn select(const Query& query, uint32_t denseMaxDocs) {
+        bool paged = query.numDocs > denseMaxDocs;
+        bool lengths = std::any_of(query.terms.begin(), query.terms.end(),
+                                   [](const TermPostings& t) { return t.docLengths != nullptr; });
+        return table[paged][lengths];
+    }
+
+    static Hits evaluate(const Query& query, uint32_t denseMaxDocs) { return select(query, denseMaxDocs)(query); }
+};
+
+}  // namespace query_evaluator
@@ -0,0 +1,322 @@
+#pragma once
+
+/*
+ * Cost-Based Query Planner
+ *
+ * Picks how search evaluates a multi-word query before any posting is read,
+ * from what the index files say about each term:
+ *   - df (postings in the term's barrel list)
+ *   - encodings on disk: posting array, roaring bitmap, tier-1 pruned list,
+ *     pair list shared with another query term
+ *   - segment layout: whether barrel lists are in doc ID order
+ *     (barrels_binary/layout.json) and whether new_docs postings must be
+ *     merged in (those lists are no longer ordered)
+ *
+ * The cost unit is "postings touched": posting records decoded or compared,
+ * counting one 64-bit bitmap word or one rank lookup as one posting. Every
+ * available algorithm gets an estimate and the cheapest wins:
+ *
+ *   AND  pair lists    precomputed intersections stand in for their terms
+ *        bitmap AND    roaring containers intersected, tfs by rank
+ *        merge/gallop  rarest term first over doc-ID-ordered lists; each step
+ *                      merges or gallops, whichever its sizes favour
+ *        exhaustive    every posting added into dense accumulators
+ *   OR   bitmap OR, WAND (top-K over doc-ID-ordered lists, skipping documents
+ *        whose score upper bound cannot reach the K-th best), exhaustive
+ *
+ * Tier 1 is tried first when every term has a pruned list and reading them
+ * is estimated to cost well under the best full-index plan; the full plan is
+ * kept as its fallback.
+ *
+ * Estimates assume terms occur independently. --explain prints the plan,
+ * the alternatives and the estimated versus actual postings touched.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace query_planner {
+
+enum class Algorithm { Exhaustive, PairLists, BitmapAnd, BitmapOr, MergeGallop, Wand };
+enum class StepKind { Merge, Gallop };
+
+inline const char* algorithmName(Algorithm a) {
+    switch (a) {
+        case Algorithm::Exhaustive:  return "exhaustive (accumulate every posting)";
+        case Algorithm::PairLists:   return "pair lists";
+        case Algorithm::BitmapAnd:   return "bitmap AND";
+        case Algorithm::BitmapOr:    return "bitmap OR";
+        case Algorithm::MergeGallop: return "merge/galloping intersection";
+        case Algorithm::Wand:        return "WAND top-K";
+    }
+    return "?";
+}
+
+struct TermInfo {
+    std::string word;
+    int lemmaId = 0;
+    int64_t df = 0;             // postings in the barrel list
+    bool bitmap = false;        // has a roaring bitmap
+    int64_t tier1Postings = 0;  // kept postings of its pruned list (0 = not in tier 1)
+    bool newDocs = false;       // also has postings in barrel_new_docs
+    bool positiveIdf = true;    // BM25 contribution never negative
+};
+
+struct PairInfo {
+    std::size_t i = 0, j = 0;   // query term indexes
+    int64_t postings = 0;       // documents in the pair list
+};
+
+struct Layout {
+    bool sortedLists = false;   // barrel lists in doc ID order
+    int64_t numDocs = 1;        // N for selectivity estimates
+    int64_t docsPerContainer = 65536;
+};
+
+// Switches from the command line (--no-tier1 etc.) and a forced algorithm
+struct Constraints {
+    bool tier1 = true;
+    bool bitmaps = true;
+    bool pairs = true;
+    bool sortedAlgorithms = true;  // merge/gallop and WAND
+    bool everyMatch = false;       // caller needs every match (facets): no WAND, no tier 1
+    bool forced = false;
+    Algorithm force = Algorithm::Exhaustive;
+};
+
+struct Step {
+    std::size_t term;           // index into terms
+    StepKind kind;
+    double estimated;           // postings touched by this step
+};
+
+struct Plan {
+    bool andMode = true;
+    Algorithm algorithm = Algorithm::Exhaustive;
+    std::vector<std::size_t> order;      // evaluation order
+    std::vector<PairInfo> pairs;         // used by PairLists
+    std::vector<Step> steps;             // used by MergeGallop
+    double estimated = 0.0;              // chosen full-index algorithm
+    double estimatedMatches = 0.0;
+    bool tryTier1 = false;
+    double tier1Estimated = 0.0;
+    std::string tier1Note;               // why tier 1 is or is not tried
+    std::vector<std::pair<Algorithm, double>> alternatives;  // every applicable estimate
+    std::string forcedNote;              // why a forced algorithm was not used, else empty
+};
+
+// ---------------------- Estimates ----------------------
+
+inline double fraction(const TermInfo& t, const Layout& layout) {
+    return std::min(1.0, static_cast<double>(t.df) / std::max<int64_t>(1, layout.numDocs));
+}
+
+// Words a bitmap AND/OR reads for one term: 1024 per bitmap container,
+// the members themselves for array containers
+inline double bitmapWords(const TermInfo& t, const Layout& layout) {
+    double containers = std::ceil(static_cast<double>(layout.numDocs) / layout.docsPerContainer);
+    double perContainer = t.df / std::max(1.0, containers);
+    return perContainer > 4096 ? containers * 1024.0 : static_cast<double>(t.df);
+}
+
+inline double matchesAnd(const std::vector<TermInfo>& terms, const Layout& layout) {
+    double m = static_cast<double>(layout.numDocs);
+    for (const auto& t : terms) m *= fraction(t, layout);
+    return m;
+}
+
+inline double matchesOr(const std::vector<TermInfo>& terms, const Layout& layout) {
+    double none = 1.0;
+    for (const auto& t : terms) none *= 1.0 - fraction(t, layout);
+    return layout.numDocs * (1.0 - none);
+}
+
+// Rarest first; each step merges (walks the whole next list) or gallops
+// (a few probes per surviving candidate), whichever is cheaper
+inline double planSteps(const std::vector<TermInfo>& terms, const std::vector<std::size_t>& order,
+                        const Layout& layout, std::vector<Step>& steps) {
+    steps.clear();
+    double candidates = static_cast<double>(terms[order[0]].df);
+    double cost = candidates;
+    for (std::size_t k = 1; k < order.size(); k++) {
+        double df = static_cast<double>(terms[order[k]].df);
+        double merge = df;
+        double gallop = candidates * (std::log2(df / std::max(1.0, candidates) + 1.0) + 1.0);
+        StepKind kind = gallop < merge ? StepKind::Gallop : StepKind::Merge;
+        double stepCost = std::min(merge, gallop);
+        steps.push_back({order[k], kind, stepCost});
+        cost += stepCost;
+        candidates *= fraction(terms[order[k]], layout);
+    }
+    return cost;
+}
+
+// ---------------------- Planning ----------------------
+
+inline Plan choose(const std::vector<TermInfo>& terms, const std::vector<PairInfo>& pairCandidates,
+                   bool andMode, const Layout& layout, std::size_t topK, const Constraints& c) {
+    Plan plan;
+    plan.andMode = andMode;
+    const std::size_t n = terms.size();
+    if (n == 0) return plan;
+
+    plan.order.resize(n);
+    for (std::size_t i = 0; i < n; i++) plan.order[i] = i;
+    std::stable_sort(plan.order.begin(), plan.order.end(),
+                     [&](std::size_t a, std::size_t b) { return terms[a].df < terms[b].df; });
+
+    bool anyBitmap = false, anyNewDocs = false, allPositive = true;
+    double totalDf = 0.0;
+    for (const auto& t : terms) {
+        anyBitmap |= t.bitmap;
+        anyNewDocs |= t.newDocs;
+        allPositive &= t.positiveIdf;
+        totalDf += static_cast<double>(t.df);
+    }
+    plan.estimatedMatches = andMode ? matchesAnd(terms, layout) : matchesOr(terms, layout);
+
+    auto consider = [&](Algorithm a, double cost) { plan.alternatives.push_back({a, cost}); };
+    consider(Algorithm::Exhaustive, totalDf);
+
+    bool sortedOk = c.sortedAlgorithms && layout.sortedLists && !anyNewDocs && n >= 2;
+    if (andMode) {
+        if (c.pairs && !pairCandidates.empty()) {
+            std::vector<bool> paired(n, false);
+            double cost = 0.0;
+            for (const auto& p : pairCandidates) {
+                cost += static_cast<double>(p.postings);
+                paired[p.i] = paired[p.j] = true;
+            }
+            for (std::size_t i = 0; i < n; i++) {
+                if (paired[i]) continue;
+                // a bitmap term also costs one rank lookup per match
+                cost += (c.bitmaps && terms[i].bitmap) ? bitmapWords(terms[i], layout) + plan.estimatedMatches
+                                                       : static_cast<double>(terms[i].df);
+            }
+            consider(Algorithm::PairLists, cost);
+        }
+        if (c.bitmaps && anyBitmap) {
+            double cost = plan.estimatedMatches * n;
+            for (const auto& t : terms) cost += t.bitmap ? bitmapWords(t, layout) : static_cast<double>(t.df);
+            consider(Algorithm::BitmapAnd, cost);
+        }
+        if (sortedOk) {
+            std::vector<Step> steps;
+            consider(Algorithm::MergeGallop, planSteps(terms, plan.order, layout, steps));
+        }
+    } else {
+        if (c.bitmaps && anyBitmap) {
+            double cost = plan.estimatedMatches * n;
+            for (const auto& t : terms) cost += t.bitmap ? bitmapWords(t, layout) : static_cast<double>(t.df);
+            consider(Algorithm::BitmapOr, cost);
+        }
+        if (sortedOk && allPositive && topK > 0 && !c.everyMatch) {
+            // Once the top-K fills up, documents holding only common terms are
+            // skipped; assume the most common list is mostly jumped over
+            double mostCommon = static_cast<double>(terms[plan.order.back()].df);
+            double rest = totalDf - mostCommon;
+            consider(Algorithm::Wand, rest + std::min(mostCommon, rest * std::log2(mostCommon + 1.0)));
+        }
+    }
+
+    auto best = plan.alternatives.front();
+    for (const auto& alt : plan.alternatives) {
+        if (alt.second < best.second) best = alt;
+    }
+    if (c.forced) {
+        auto it = std::find_if(plan.alternatives.begin(), plan.alternatives.end(),
+                               [&](const auto& alt) { return alt.first == c.force; });
+        if (it != plan.alternatives.end()) {
+            best = *it;
+        } else {
+            // The same conditions that kept it out of the alternatives
+            const char* why = "not applicable";
+            bool wantsAnd = c.force == Algorithm::PairLists || c.force == Algorithm::BitmapAnd ||
+                            c.force == Algorithm::MergeGallop;
+            bool sorted = c.force == Algorithm::MergeGallop || c.force == Algorithm::Wand;
+            if (wantsAnd && !andMode) why = "OR query";
+            else if (c.force == Algorithm::Wand && andMode) why = "AND query";
+            else if (c.force == Algorithm::BitmapOr && andMode) why = "AND query";
+            else if (c.force == Algorithm::PairLists && !c.pairs) why = "pair lists disabled";
+            else if (c.force == Algorithm::PairLists) why = "no pair list for these terms";
+            else if (!sorted && !c.bitmaps) why = "bitmaps disabled";
+            else if (!sorted) why = "no term has a bitmap";
+            else if (!c.sortedAlgorithms) why = "sorted-list algorithms disabled";
+            else if (!layout.sortedLists) why = "barrel lists not in doc ID order";
+            else if (anyNewDocs) why = "a term has postings in barrel_new_docs";
+            else if (n < 2) why = "single term";
+            else if (!allPositive) why = "a term has a negative idf";
+            else if (c.everyMatch) why = "every match is needed";
+            else if (topK == 0) why = "no top-K limit";
+            plan.forcedNote = std::string(algorithmName(c.force)) + " not applicable (" + why + ")";
+        }
+    }
+    plan.algorithm = best.first;
+    plan.estimated = best.second;
+    if (plan.algorithm == Algorithm::PairLists) plan.pairs = pairCandidates;
+    if (plan.algorithm == Algorithm::MergeGallop) planSteps(terms, plan.order, layout, plan.steps);
+
+    // Tier 1: only worth a try when every term is pruned and reading the
+    // pruned lists is far cheaper than the full plan it might fall back to
+    bool allPruned = true;
+    for (const auto& t : terms) {
+        allPruned &= t.tier1Postings > 0 && !t.newDocs;
+        plan.tier1Estimated += static_cast<double>(t.tier1Postings > 0 ? t.tier1Postings : t.df);
+    }
+    if (!c.tier1) {
+        plan.tier1Note = "disabled";
+    } else if (c.everyMatch) {
+        plan.tier1Note = "skipped: every match is needed";
+    } else if (plan.algorithm == Algorithm::PairLists) {
+        plan.tier1Note = "skipped: pair list is exact";
+    } else if (!allPruned) {
+        plan.tier1Note = "skipped: not every term has a pruned list";
+    } else if (plan.tier1Estimated * 2 > plan.estimated) {
+        plan.tier1Note = "skipped: no cheaper than the full plan";
+    } else {
+        plan.tryTier1 = true;
+        plan.tier1Note = "tried first";
+    }
+    return plan;
+}
+
+// ---------------------- Explain ----------------------
+
+inline void explain(std::ostream& os, const Plan& plan, const std::vector<TermInfo>& terms) {
+    os << "[Plan] " << (plan.andMode ? "AND" : "OR") << " over " << terms.size() << " terms, about "
+       << static_cast<int64_t>(plan.estimatedMatches) << " matching documents expected\n";
+    for (std::size_t k = 0; k < plan.order.size(); k++) {
+        const auto& t = terms[plan.order[k]];
+        os << "  " << (k + 1) << ". '" << t.word << "' df=" << t.df << " encodings: array";
+        if (t.bitmap) os << ", bitmap";
+        if (t.tier1Postings > 0) os << ", tier 1 (" << t.tier1Postings << ")";
+        for (const auto& p : plan.pairs) {
+            if (p.i == plan.order[k] || p.j == plan.order[k]) {
+                os << ", pair with '" << terms[p.i == plan.order[k] ? p.j : p.i].word << "' (" << p.postings << ")";
+            }
+        }
+        if (t.newDocs) os << ", +new_docs";
+        os << "\n";
+    }
+    for (const auto& s : plan.steps) {
+        os << "  step: " << (s.kind == StepKind::Gallop ? "gallop into" : "merge with") << " '"
+           << terms[s.term].word << "' ~" << static_cast<int64_t>(s.estimated) << "\n";
+    }
+    os << "  alternatives:";
+    for (const auto& [a, cost] : plan.alternatives) {
+        os << " " << algorithmName(a) << "=" << static_cast<int64_t>(cost) << ";";
+    }
+    os << "\n  chosen: " << algorithmName(plan.algorithm) << ", estimated postings touched "
+       << static_cast<int64_t>(plan.estimated) << "\n";
+    if (!plan.forcedNote.empty()) os << "  forced: " << plan.forcedNote << ", cheapest plan used instead\n";
+    os << "  tier 1: " << plan.tier1Note;
+    if (plan.tryTier1) os << " (estimated " << static_cast<int64_t>(plan.tier1Estimated) << ")";
+    os << "\n";
+}
+
+} // namespace query_planner
@@ -0,0 +1,436 @@
+/*
+ * Document Reorder
+ *
+ * Renumbers the indexed documents so that documents sharing terms get nearby
+ * docIDs, by recursive graph bisection over the forward index (see
+ * doc_reorder.hpp), or by descending PageRank, so that every posting list is
+ * ordered by static rank and search_semantic can stop scoring a query once
+ * the remaining documents cannot reach its top results. It then rewrites
+ * every file addressed by docID to match:
+ *   forward_index.txt and forward_index.offsets (line number = docID)
+ *   doc_store.bin, citations.bin, pagerank.bin and attributes/
+ *   dense/doc_vectors.bin (row = docID)
+ * Lines appended to the forward index after forwardIndex ran (uploaded
+ * documents) keep their place after the reordered ones.
+ *
+ * Posting lists and shards carry PMC IDs, so they stay valid as they are;
+ * barrels_binary numbers its roaring bitmaps by docID, so run it (after
+ * invertedIndex and barrels in a fresh build) to get the smaller bitmaps,
+ * or the docID-ordered lists search_semantic terminates early on.
+ * The HNSW graph and IVF-PQ lists hold docIDs throughout, so they are
+ * deleted rather than left to map vector hits to the wrong documents:
+ * rerun docVectorBuilder (./run.sh --reorder-docs does).
+ *
+ * Usage (from backend/cpp, after forwardIndex):
+ *   ./build/reorderDocs                    # graph bisection
+ *   ./build/reorderDocs --method pagerank  # by static rank (after pageRank)
+ *   ./build/reorderDocs --method pmc       # back to PMC ID order
+ *   ./build/reorderDocs --threads 8 --iterations 20
+ */
+
+#include "config.hpp"
+#include "doc_store.hpp"
+#include "doc_reorder.hpp"
+#include "citation_graph.hpp"
+#include "attributes.hpp"
+#include "dense_index.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cstring>
+
+using namespace std;
+using namespace chrono;
+
+const int DOC_ID_SIZE = 20;
+
+struct ForwardLine {
+    int64_t offset;
+    string pmcId;
+};
+
+// The documents' lemma sets from the forward index lines before coveredBytes
+// (the ones forwardIndex wrote), as dense term numbers; lemmas found in a
+// single document are dropped
+doc_reorder::Collection readCollection(const fs::path& path, int64_t coveredBytes, vector<ForwardLine>& lines) {
+    ifstream in(path, ios::binary);
+    if (!in.is_open()) {
+        throw runtime_error("Cannot open forward index at " + path.string());
+    }
+
+    vector<uint64_t> offsets{0};
+    vector<int> lemmas;
+    unordered_map<int, uint32_t> df;
+    string line;
+    int64_t offset = 0;
+    vector<int> docLemmas;
+    while (offset < coveredBytes && getline(in, line)) {
+        lines.push_back({offset, line.substr(0, line.find('|'))});
+        offset += static_cast<int64_t>(line.size()) + 1;
+
+        // doc_id|total_terms|title|abstract|body
+        docLemmas.clear();
+        size_t bar2 = line.find('|', line.find('|') + 1);
+        const char* p = bar2 == string::npos ? "" : line.c_str() + bar2 + 1;
+        while (*p) {
+            char* end;
+            long lemma = strtol(p, &end, 10);
+            if (end == p) {
+                p++;
+                continue;
+            }
+            docLemmas.push_back(static_cast<int>(lemma));
+            p = end;
+        }
+        sort(docLemmas.begin(), docLemmas.end());
+        docLemmas.erase(unique(docLemmas.begin(), docLemmas.end()), docLemmas.end());
+        for (int l : docLemmas) df[l]++;
+        lemmas.insert(lemmas.end(), docLemmas.begin(), docLemmas.end());
+        offsets.push_back(lemmas.size());
+    }
+
+    doc_reorder::Collection c;
+    unordered_map<int, uint32_t> termOf;
+    for (const auto& [lemma, count] : df) {
+        if (count >= 2) termOf[lemma] = c.numTerms++;
+    }
+    vector<uint32_t> terms;
+    for (size_t d = 0; d + 1 < offsets.size(); d++) {
+        terms.clear();
+        for (uint64_t i = offsets[d]; i < offsets[d + 1]; i++) {
+            auto it = termOf.find(lemmas[i]);
+            if (it != termOf.end()) terms.push_back(it->second);
+        }
+        c.add(terms);
+    }
+    return c;
+}
+
+// Forward index lines in the new order, the uploaded tail after them, and
+// the line offsets table ([numDocs:8][coveredBytes:8] then numDocs x
+// [docId:20][offset:8] sorted by PMC ID, as forwardIndex writes it)
+void rewriteForwardIndex(const fs::path& path, const fs::path& offsetsPath, const vector<ForwardLine>& lines,
+                         const vector<uint32_t>& order, int64_t coveredBytes) {
+    fs::path tmpPath = path.string() + ".tmp";
+    vector<pair<string, int64_t>> lineOffsets;
+    int64_t newCovered = 0;
+    {
+        ifstream in(path, ios::binary);
+        ofstream out(tmpPath, ios::binary);
+        if (!out.is_open()) {
+            throw runtime_error("Cannot create " + tmpPath.string());
+        }
+        string line;
+        for (uint32_t oldId : order) {
+            in.clear();
+            in.seekg(lines[oldId].offset);
+            getline(in, line);
+            lineOffsets.push_back({lines[oldId].pmcId, static_cast<int64_t>(out.tellp())});
+            out << line << '\n';
+        }
+        newCovered = out.tellp();
+
+        in.clear();
+        in.seekg(coveredBytes);
+        while (getline(in, line)) out << line << '\n';
+        if (!out) {
+            throw runtime_error("Cannot write " + tmpPath.string());
+        }
+    }
+    fs::rename(tmpPath, path);
+
+    sort(lineOffsets.begin(), lineOffsets.end());
+    ofstream out(offsetsPath, ios::binary);
+    if (!out.is_open()) {
+        throw runtime_error("Cannot create " + offsetsPath.string());
+    }
+    int64_t numDocs = static_cast<int64_t>(lineOffsets.size());
+    out.write(reinterpret_cast<const char*>(&numDocs), sizeof(numDocs));
+    out.write(reinterpret_cast<const char*>(&newCovered), sizeof(newCovered));
+    for (const auto& [docId, offset] : lineOffsets) {
+        char idBuf[DOC_ID_SIZE] = {};
+        strncpy(idBuf, docId.c_str(), DOC_ID_SIZE - 1);
+        out.write(idBuf, DOC_ID_SIZE);
+        out.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+    }
+}
+
+// Documents covered by a citation graph or PageRank file: the count after
+// the 8-byte magic in both formats
+uint32_t headerDocCount(const fs::path& path) {
+    ifstream in(path, ios::binary);
+    char magic[8];
+    uint32_t numDocs = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&numDocs), sizeof(numDocs));
+    return numDocs;
+}
+
+// Every docID-addressed file must cover the same documents before any of
+// them is rewritten, so a stale file cannot leave the index half renumbered
+void checkCoverage(size_t numDocs, const fs::path& docStorePath, const fs::path& citationsPath,
+                   const fs::path& pagerankPath, const fs::path& attributesDir) {
+    auto check = [&](size_t count, const fs::path& path, const string& builder) {
+        if (count != numDocs) {
+            throw runtime_error(path.filename().string() + " covers " + to_string(count) + " documents, the forward index " +
+                                to_string(numDocs) + " (rerun " + builder + ")");
+        }
+    };
+    check(doc_store::Reader(docStorePath.string()).size(), docStorePath, "forwardIndex");
+    if (fs::exists(citationsPath)) check(headerDocCount(citationsPath), citationsPath, "forwardIndex");
+    if (fs::exists(pagerankPath)) check(headerDocCount(pagerankPath), pagerankPath, "pageRank");
+    if (fs::exists(attributesDir / "attributes.json")) {
+        ifstream manifestFile(attributesDir / "attributes.json");
+        json manifest;
+        manifestFile >> manifest;
+        check(manifest.value("num_docs", size_t(0)), attributesDir, "attributeBuilder");
+    }
+}
+
+void rewriteDocStore(const fs::path& path, const vector<uint32_t>& order) {
+    fs::path tmpPath = path.string() + ".tmp";
+    {
+        doc_store::Reader reader(path.string());
+        doc_store::Writer writer(tmpPath.string());
+        doc_store::DocRecord rec;
+        for (uint32_t oldId : order) {
+            if (!reader.get(oldId, rec)) {
+                throw runtime_error("Document store has no document " + to_string(oldId));
+            }
+            writer.add(rec);
+        }
+        writer.finish();
+    }
+    fs::rename(tmpPath, path);
+}
+
+void rewriteCitations(const fs::path& path, const vector<uint32_t>& order, const vector<uint32_t>& newId) {
+    citation_graph::Graph graph;
+    graph.load(path);
+    citation_graph::Graph renumbered;
+    vector<uint32_t> cited;
+    for (uint32_t oldId : order) {
+        cited.clear();
+        for (uint64_t e = graph.offsets[oldId]; e < graph.offsets[oldId + 1]; e++) {
+            cited.push_back(newId[graph.targets[e]]);
+        }
+        renumbered.addDocument(cited);
+    }
+    renumbered.save(path);
+}
+
+void rewritePageRank(const fs::path& path, const vector<uint32_t>& order) {
+    uint32_t iterations = 0;
+    vector<float> scores = citation_graph::readScores(path, &iterations);
+    vector<float> renumbered(scores.size());
+    for (size_t d = 0; d < order.size(); d++) renumbered[d] = scores[order[d]];
+    citation_graph::writeScores(path, renumbered, iterations);
+}
+
+// Document vector rows in the new order (rows past it, for uploaded
+// documents, stay); the vector indexes are deleted. Returns what was removed.
+vector<string> rewriteDenseIndex(const fs::path& dir, const vector<uint32_t>& order) {
+    vector<string> removed;
+    fs::path vectorsPath = dir / "doc_vectors.bin";
+    if (fs::exists(vectorsPath)) {
+        vector<float> data;
+        uint64_t numDocs = 0;
+        uint32_t dim = 0;
+        {
+            dense_index::Vectors vectors(vectorsPath);
+            numDocs = vectors.size();
+            dim = vectors.dim();
+            if (numDocs >= order.size()) {
+                data.resize(numDocs * dim);
+                for (uint64_t d = 0; d < numDocs; d++) {
+                    const float* row = vectors.row(d < order.size() ? order[d] : static_cast<uint32_t>(d));
+                    copy(row, row + dim, data.begin() + d * dim);
+                }
+            }
+        }
+        if (numDocs >= order.size()) {
+            fs::path tmpPath = vectorsPath.string() + ".tmp";
+            dense_index::writeVectors(tmpPath, data, numDocs, dim);
+            fs::rename(tmpPath, vectorsPath);
+        } else {
+            // Fewer rows than documents: not built from this forward index
+            fs::remove(vectorsPath);
+            removed.push_back(vectorsPath.filename().string());
+        }
+    }
+    for (const char* name : {"hnsw.bin", "ivfpq.bin"}) {
+        if (fs::remove(dir / name)) removed.push_back(name);
+    }
+    return removed;
+}
+
+// Columns and value bitmaps of every attribute; dictionaries and the
+// manifest do not depend on docIDs
+void rewriteAttributes(const fs::path& dir, const vector<uint32_t>& order) {
+    ifstream manifestFile(dir / "attributes.json");
+    json manifest;
+    manifestFile >> manifest;
+    for (const auto& entry : manifest["attributes"]) {
+        string name = entry["name"].get<string>();
+        vector<uint32_t> values(order.size(), 0);
+        uint32_t width = 0;
+        {
+            attributes::Column column(dir / (name + ".col"));
+            width = column.bytesPerValue();
+            for (size_t d = 0; d < order.size(); d++) values[d] = column.get(order[d]);
+        }
+        attributes::writeColumn(dir / (name + ".col"), values, width);
+        attributes::writeValueIndex(dir / (name + ".bitmaps"), values);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        cout << "======================================" << endl;
+        cout << "  DOCUMENT REORDER" << endl;
+        cout << "======================================\n" << endl;
+
+        // this file is in backend/cpp
+        fs::path backendDir = fs::current_path().parent_path();
+        json config = loadConfig(backendDir);
+
+        string method = "bp";
+        doc_reorder::Params params;
+        params.iterations = config.value("bp_iterations", 20u);
+        params.threads = max(1u, thread::hardware_concurrency());
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            if (arg == "--method" && i + 1 < argc) {
+                method = argv[++i];
+            } else if ((arg == "--threads" || arg == "-j") && i + 1 < argc) {
+                params.threads = max(1u, static_cast<uint32_t>(stoul(argv[++i])));
+            } else if (arg == "--iterations" && i + 1 < argc) {
+                params.iterations = static_cast<uint32_t>(stoul(argv[++i]));
+            }
+        }
+        if (method != "bp" && method != "pagerank" && method != "pmc") {
+            throw runtime_error("Unknown --method '" + method + "' (bp, pagerank or pmc)");
+        }
+
+        fs::path indexesDir = backendDir / config["indexes_dir"].get<string>();
+        fs::path forwardPath = indexesDir / config["forward_index_file"].get<string>();
+        fs::path offsetsPath = indexesDir / config.value("forward_offsets_file", "forward_index.offsets");
+        fs::path docStorePath = indexesDir / config.value("doc_store_file", "doc_store.bin");
+        fs::path citationsPath = indexesDir / config.value("citation_graph_file", "citations.bin");
+        fs::path pagerankPath = indexesDir / config.value("pagerank_file", "pagerank.bin");
+        fs::path attributesDir = indexesDir / config.value("attributes_dir", "attributes");
+
+        cout << "Configuration:" << endl;
+        cout << "  Forward index: " << forwardPath.string() << endl;
+        cout << "  Method: "
+             << (method == "bp" ? "graph bisection" : method == "pagerank" ? "descending PageRank" : "PMC ID order")
+             << endl;
+        if (method == "bp") {
+            cout << "  Iterations: " << params.iterations << ", threads: " << params.threads << endl;
+        }
+        cout << endl;
+
+        auto startTime = high_resolution_clock::now();
+
+        // The documents forwardIndex wrote end at coveredBytes
+        int64_t numDocs = 0, coveredBytes = 0;
+        {
+            ifstream offFile(offsetsPath, ios::binary);
+            if (!offFile.is_open()) {
+                throw runtime_error("Cannot open " + offsetsPath.string() + " (run forwardIndex)");
+            }
+            offFile.read(reinterpret_cast<char*>(&numDocs), sizeof(numDocs));
+            offFile.read(reinterpret_cast<char*>(&coveredBytes), sizeof(coveredBytes));
+        }
+
+        vector<ForwardLine> lines;
+        doc_reorder::Collection collection = readCollection(forwardPath, coveredBytes, lines);
+        if (static_cast<int64_t>(lines.size()) != numDocs) {
+            throw runtime_error("Forward index has " + to_string(lines.size()) + " documents, its offsets table " +
+                                to_string(numDocs) + " (rerun forwardIndex)");
+        }
+        checkCoverage(lines.size(), docStorePath, citationsPath, pagerankPath, attributesDir);
+        if (method == "pagerank" && !fs::exists(pagerankPath)) {
+            throw runtime_error("Cannot open " + pagerankPath.string() + " (run pageRank)");
+        }
+        cout << "Documents: " << collection.size() << ", " << collection.numTerms << " terms in 2+ documents, "
+             << collection.postings() << " postings" << endl;
+
+        vector<uint32_t> identity(collection.size());
+        for (uint32_t d = 0; d < identity.size(); d++) identity[d] = d;
+        double bitsBefore = doc_reorder::bitsPerPosting(collection, identity);
+
+        auto orderStart = high_resolution_clock::now();
+        vector<uint32_t> order;
+        if (method == "bp") {
+            order = doc_reorder::graphBisection(collection, params);
+        } else if (method == "pagerank") {
+            // Ties keep their current order
+            vector<float> scores = citation_graph::readScores(pagerankPath);
+            order = identity;
+            stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return scores[a] > scores[b]; });
+        } else {
+            order = identity;
+            stable_sort(order.begin(), order.end(),
+                        [&](uint32_t a, uint32_t b) { return lines[a].pmcId < lines[b].pmcId; });
+        }
+        auto orderMs = duration_cast<milliseconds>(high_resolution_clock::now() - orderStart).count();
+        double bitsAfter = doc_reorder::bitsPerPosting(collection, order);
+        cout << "Order computed in " << orderMs << "ms: " << bitsBefore << " -> " << bitsAfter
+             << " bits per posting as gamma-coded gaps" << endl;
+
+        vector<uint32_t> newId(order.size());
+        for (uint32_t d = 0; d < order.size(); d++) newId[order[d]] = d;
+
+        rewriteForwardIndex(forwardPath, offsetsPath, lines, order, coveredBytes);
+        cout << "Rewrote " << forwardPath.filename().string() << " and " << offsetsPath.filename().string() << endl;
+        rewriteDocStore(docStorePath, order);
+        cout << "Rewrote " << docStorePath.filename().string() << endl;
+        if (fs::exists(citationsPath)) {
+            rewriteCitations(citationsPath, order, newId);
+            cout << "Rewrote " << citationsPath.filename().string() << endl;
+        }
+        if (fs::exists(pagerankPath)) {
+            rewritePageRank(pagerankPath, order);
+            cout << "Rewrote " << pagerankPath.filename().string() << endl;
+        }
+        if (fs::exists(attributesDir / "attributes.json")) {
+            rewriteAttributes(attributesDir, order);
+            cout << "Rewrote " << attributesDir.filename().string() << "/" << endl;
+        }
+
+        fs::path denseDir = indexesDir / config.value("dense_dir", "dense");
+        vector<string> removed;
+        if (fs::exists(denseDir)) {
+            bool hadVectors = fs::exists(denseDir / "doc_vectors.bin");
+            removed = rewriteDenseIndex(denseDir, order);
+            if (hadVectors && fs::exists(denseDir / "doc_vectors.bin")) {
+                cout << "Rewrote " << denseDir.filename().string() << "/doc_vectors.bin" << endl;
+            }
+            for (const string& name : removed) {
+                cout << "Removed " << denseDir.filename().string() << "/" << name << " (old docIDs)" << endl;
+            }
+        }
+
+        cout << "\nRun barrels_binary to renumber the roaring bitmaps." << endl;
+        if (!removed.empty()) {
+            cout << "Run docVectorBuilder to rebuild the vector index." << endl;
+        }
+
+        auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - startTime).count();
+        cout << "\n=== Reorder Complete ===" << endl;
+        cout << "Time: " << duration << "ms" << endl;
+
+    } catch (exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,500 @@
+#pragma once
+
+/*
+ * Roaring Bitmaps (compressed sets of 32-bit document ordinals)
+ *
+ * The 32-bit space is split into chunks of 65536 values keyed by the high 16
+ * bits. Each non-empty chunk is one container holding the low 16 bits:
+ *   - array container:  sorted uint16 values, used up to 4096 members
+ *   - bitmap container: 1024 x uint64 words (8 KB), used above that
+ * so a container never takes more than 8 KB and dense chunks are plain bit
+ * vectors. Intersections and unions of two bitmap containers are word-wise
+ * AND/OR, done 128 or 256 bits at a time with SSE2/AVX2 when the compiler
+ * targets them (SSE2 is always present on x86-64) and with a scalar loop
+ * elsewhere.
+ *
+ * Used by barrels_binary (roaring.bin) and search for very high-df terms.
+ *
+ * On-disk layout of one bitmap:
+ *   [numContainers:4] then per container
+ *   [key:2][kind:2][cardinality:4][payload]
+ *     kind 0 = array  (cardinality x uint16)
+ *     kind 1 = bitmap (1024 x uint64)
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace roaring {
+
+const uint32_t ARRAY_MAX = 4096;     // largest array container
+const size_t BITMAP_WORDS = 1024;    // 65536 bits
+
+struct Container {
+    uint16_t key = 0;
+    uint32_t cardinality = 0;
+    std::vector<uint16_t> array;     // sorted, when an array container
+    std::vector<uint64_t> words;     // BITMAP_WORDS words, when a bitmap container
+
+    bool isBitmap() const { return !words.empty(); }
+
+    bool contains(uint16_t low) const {
+        if (isBitmap()) return (words[low >> 6] >> (low & 63)) & 1;
+        return std::binary_search(array.begin(), array.end(), low);
+    }
+
+    // Turns a bitmap container with few members back into an array, or an
+    // over-full array into a bitmap
+    void normalize() {
+        if (isBitmap() && cardinality <= ARRAY_MAX) {
+            array.clear();
+            array.reserve(cardinality);
+            for (size_t w = 0; w < BITMAP_WORDS; w++) {
+                uint64_t bits = words[w];
+                while (bits) {
+                    array.push_back(static_cast<uint16_t>(w * 64 + __builtin_ctzll(bits)));
+                    bits &= bits - 1;
+                }
+            }
+            words.clear();
+        } else if (!isBitmap() && cardinality > ARRAY_MAX) {
+            words.assign(BITMAP_WORDS, 0);
+            for (uint16_t v : array) words[v >> 6] |= uint64_t(1) << (v & 63);
+            array.clear();
+        }
+    }
+};
+
+// ---------------------- Word-wise kernels ----------------------
+
+inline uint32_t popcountWords(const uint64_t* w) {
+    uint32_t count = 0;
+    for (size_t i = 0; i < BITMAP_WORDS; i++) count += __builtin_popcountll(w[i]);
+    return count;
+}
+
+// out = a & b, returns the cardinality of out
+inline uint32_t andWords(const uint64_t* a, const uint64_t* b, uint64_t* out) {
+#if defined(__AVX2__)
+    for (size_t i = 0; i < BITMAP_WORDS; i += 4) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_and_si256(va, vb));
+    }
+#elif defined(__SSE2__)
+    for (size_t i = 0; i < BITMAP_WORDS; i += 2) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_and_si128(va, vb));
+    }
+#else
+    for (size_t i = 0; i < BITMAP_WORDS; i++) out[i] = a[i] & b[i];
+#endif
+    return popcountWords(out);
+}
+
+// out = a | b, returns the cardinality of out
+inline uint32_t orWords(const uint64_t* a, const uint64_t* b, uint64_t* out) {
+#if defined(__AVX2__)
+    for (size_t i = 0; i < BITMAP_WORDS; i += 4) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_or_si256(va, vb));
+    }
+#elif defined(__SSE2__)
+    for (size_t i = 0; i < BITMAP_WORDS; i += 2) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_or_si128(va, vb));
+    }
+#else
+    for (size_t i = 0; i < BITMAP_WORDS; i++) out[i] = a[i] | b[i];
+#endif
+    return popcountWords(out);
+}
+
+// ---------------------- Container operations ----------------------
+
+inline Container intersect(const Container& a, const Container& b) {
+    Container out;
+    out.key = a.key;
+
+    if (a.isBitmap() && b.isBitmap()) {
+        out.words.resize(BITMAP_WORDS);
+        out.cardinality = andWords(a.words.data(), b.words.data(), out.words.data());
+        out.normalize();
+    } else if (a.isBitmap() || b.isBitmap()) {
+        const Container& arr = a.isBitmap() ? b : a;
+        const Container& bits = a.isBitmap() ? a : b;
+        for (uint16_t v : arr.array) {
+            if (bits.contains(v)) out.array.push_back(v);
+        }
+        out.cardinality = static_cast<uint32_t>(out.array.size());
+    } else {
+        // Galloping when one side is much smaller, plain merge otherwise
+        const auto& small = a.array.size() <= b.array.size() ? a.array : b.array;
+        const auto& large = a.array.size() <= b.array.size() ? b.array : a.array;
+        if (small.size() * 32 < large.size()) {
+            auto it = large.begin();
+            for (uint16_t v : small) {
+                it = std::lower_bound(it, large.end(), v);
+                if (it == large.end()) break;
+                if (*it == v) out.array.push_back(v);
+            }
+        } else {
+            std::set_intersection(small.begin(), small.end(), large.begin(), large.end(),
+                                  std::back_inserter(out.array));
+        }
+        out.cardinality = static_cast<uint32_t>(out.array.size());
+    }
+    return out;
+}
+
+inline Container unite(const Container& a, const Container& b) {
+    Container out;
+    out.key = a.key;
+
+    if (a.isBitmap() && b.isBitmap()) {
+        out.words.resize(BITMAP_WORDS);
+        out.cardinality = orWords(a.words.data(), b.words.data(), out.words.data());
+    } else if (a.isBitmap() || b.isBitmap()) {
+        const Container& arr = a.isBitmap() ? b : a;
+        out.words = (a.isBitmap() ? a : b).words;
+        for (uint16_t v : arr.array) out.words[v >> 6] |= uint64_t(1) << (v & 63);
+        out.cardinality = popcountWords(out.words.data());
+    } else {
+        std::set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                       std::back_inserter(out.array));
+        out.cardinality = static_cast<uint32_t>(out.array.size());
+        out.normalize();
+    }
+    return out;
+}
+
+// ---------------------- Bitmap ----------------------
+
+class Bitmap {
+public:
+    std::vector<Container> containers;  // sorted by key
+
+    // values must be sorted ascending and unique
+    static Bitmap fromSorted(const std::vector<uint32_t>& values) {
+        Bitmap b;
+        size_t i = 0;
+        while (i < values.size()) {
+            Container c;
+            c.key = static_cast<uint16_t>(values[i] >> 16);
+            while (i < values.size() && (values[i] >> 16) == c.key) {
+                c.array.push_back(static_cast<uint16_t>(values[i] & 0xFFFF));
+                i++;
+            }
+            c.cardinality = static_cast<uint32_t>(c.array.size());
+            c.normalize();
+            b.containers.push_back(std::move(c));
+        }
+        return b;
+    }
+
+    uint64_t cardinality() const {
+        uint64_t n = 0;
+        for (const auto& c : containers) n += c.cardinality;
+        return n;
+    }
+
+    bool contains(uint32_t value) const {
+        uint16_t key = static_cast<uint16_t>(value >> 16);
+        auto it = std::lower_bound(containers.begin(), containers.end(), key,
+                                   [](const Container& c, uint16_t k) { return c.key < k; });
+        return it != containers.end() && it->key == key && it->contains(static_cast<uint16_t>(value & 0xFFFF));
+    }
+
+    // Calls f(value) for every member in ascending order
+    template <typename F>
+    void forEach(F f) const {
+        for (const auto& c : containers) {
+            uint32_t high = uint32_t(c.key) << 16;
+            if (c.isBitmap()) {
+                for (size_t w = 0; w < BITMAP_WORDS; w++) {
+                    uint64_t bits = c.words[w];
+                    while (bits) {
+                        f(high | static_cast<uint32_t>(w * 64 + __builtin_ctzll(bits)));
+                        bits &= bits - 1;
+                    }
+                }
+            } else {
+                for (uint16_t v : c.array) f(high | v);
+            }
+        }
+    }
+
+    void write(std::ostream& out) const {
+        uint32_t n = static_cast<uint32_t>(containers.size());
+        out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+        for (const auto& c : containers) {
+            uint16_t kind = c.isBitmap() ? 1 : 0;
+            out.write(reinterpret_cast<const char*>(&c.key), sizeof(c.key));
+            out.write(reinterpret_cast<const char*>(&kind), sizeof(kind));
+            out.write(reinterpret_cast<const char*>(&c.cardinality), sizeof(c.cardinality));
+            if (kind == 1) {
+                out.write(reinterpret_cast<const char*>(c.words.data()), BITMAP_WORDS * sizeof(uint64_t));
+            } else {
+                out.write(reinterpret_cast<const char*>(c.array.data()), c.array.size() * sizeof(uint16_t));
+            }
+        }
+    }
+
+    bool read(std::istream& in) {
+        containers.clear();
+        uint32_t n = 0;
+        if (!in.read(reinterpret_cast<char*>(&n), sizeof(n))) return false;
+        containers.resize(n);
+        for (auto& c : containers) {
+            uint16_t kind = 0;
+            in.read(reinterpret_cast<char*>(&c.key), sizeof(c.key));
+            in.read(reinterpret_cast<char*>(&kind), sizeof(kind));
+            in.read(reinterpret_cast<char*>(&c.cardinality), sizeof(c.cardinality));
+            if (kind == 1) {
+                c.words.resize(BITMAP_WORDS);
+                in.read(reinterpret_cast<char*>(c.words.data()), BITMAP_WORDS * sizeof(uint64_t));
+            } else {
+                c.array.resize(c.cardinality);
+                in.read(reinterpret_cast<char*>(c.array.data()), c.cardinality * sizeof(uint16_t));
+            }
+        }
+        return static_cast<bool>(in);
+    }
+};
+
+inline Bitmap intersect(const Bitmap& a, const Bitmap& b) {
+    Bitmap out;
+    size_t i = 0, j = 0;
+    while (i < a.containers.size() && j < b.containers.size()) {
+        uint16_t ka = a.containers[i].key, kb = b.containers[j].key;
+        if (ka < kb) {
+            i++;
+        } else if (kb < ka) {
+            j++;
+        } else {
+            Container c = intersect(a.containers[i], b.containers[j]);
+            if (c.cardinality > 0) out.containers.push_back(std::move(c));
+            i++;
+            j++;
+        }
+    }
+    return out;
+}
+
+inline Bitmap unite(const Bitmap& a, const Bitmap& b) {
+    Bitmap out;
+    size_t i = 0, j = 0;
+    while (i < a.containers.size() || j < b.containers.size()) {
+        if (j == b.containers.size() || (i < a.containers.size() && a.containers[i].key < b.containers[j].key)) {
+            out.containers.push_back(a.containers[i++]);
+        } else if (i == a.containers.size() || b.containers[j].key < a.containers[i].key) {
+            out.containers.push_back(b.containers[j++]);
+        } else {
+            out.containers.push_back(unite(a.containers[i++], b.containers[j++]));
+        }
+    }
+    return out;
+}
+
+// Members of a union of bitmaps, counted without building the union: the
+// containers sharing a key are OR-ed into one scratch bit vector; a key
+// held by a single bitmap just adds its container's cardinality
+inline uint64_t unionCardinality(const std::vector<const Bitmap*>& bitmaps) {
+    std::vector<size_t> at(bitmaps.size(), 0);
+    std::vector<uint64_t> scratch;
+    uint64_t total = 0;
+    while (true) {
+        uint32_t key = UINT32_MAX;
+        size_t holders = 0;
+        for (size_t b = 0; b < bitmaps.size(); b++) {
+            if (at[b] == bitmaps[b]->containers.size()) continue;
+            uint32_t k = bitmaps[b]->containers[at[b]].key;
+            if (k < key) {
+                key = k;
+                holders = 0;
+            }
+            if (k == key) holders++;
+        }
+        if (key == UINT32_MAX) return total;
+
+        if (holders > 1) scratch.assign(BITMAP_WORDS, 0);
+        for (size_t b = 0; b < bitmaps.size(); b++) {
+            if (at[b] == bitmaps[b]->containers.size()) continue;
+            const Container& c = bitmaps[b]->containers[at[b]];
+            if (c.key != key) continue;
+            at[b]++;
+            if (holders == 1) {
+                total += c.cardinality;
+            } else if (c.isBitmap()) {
+                for (size_t w = 0; w < BITMAP_WORDS; w++) scratch[w] |= c.words[w];
+            } else {
+                for (uint16_t v : c.array) scratch[v >> 6] |= uint64_t(1) << (v & 63);
+            }
+        }
+        if (holders > 1) total += popcountWords(scratch.data());
+    }
+}
+
+// Walks a bitmap's members in ascending order without expanding it, with
+// each member's rank (its index in member order, for per-member data such
+// as term frequencies). advanceTo() skips whole containers by key and whole
+// words of a bitmap container. The bitmap must outlive the iterator and
+// stay unchanged.
+class Iterator {
+public:
+    Iterator() = default;
+    explicit Iterator(const Bitmap& bitmap) : bitmap(&bitmap) { settle(); }
+
+    bool done() const { return !bitmap || ci == bitmap->containers.size(); }
+    uint32_t value() const { return current; }
+    uint64_t rank() const { return base + pos; }
+
+    void next() {
+        const Container& c = bitmap->containers[ci];
+        pos++;
+        if (c.isBitmap()) {
+            bits &= bits - 1;
+            nextWord(c);
+        } else if (pos == c.array.size()) {
+            nextContainer();
+        } else {
+            current = (current & 0xFFFF0000u) | c.array[pos];
+        }
+    }
+
+    // Moves to the first member >= target (never backwards)
+    void advanceTo(uint32_t target) {
+        if (done() || current >= target) return;
+        uint16_t key = static_cast<uint16_t>(target >> 16);
+        const auto& cs = bitmap->containers;
+        if (cs[ci].key < key) {
+            base += cs[ci].cardinality;
+            ci++;
+            while (ci < cs.size() && cs[ci].key < key) base += cs[ci++].cardinality;
+            settle();
+            if (done() || current >= target) return;
+        }
+
+        const Container& c = cs[ci];
+        uint16_t low = static_cast<uint16_t>(target & 0xFFFF);
+        if (c.isBitmap()) {
+            size_t target64 = low >> 6;
+            uint64_t below = ~(~uint64_t(0) << (low & 63));
+            if (target64 == word) {
+                pos += __builtin_popcountll(bits & below);
+                bits &= ~below;
+            } else {
+                pos += __builtin_popcountll(bits);
+                for (word++; word < target64; word++) pos += __builtin_popcountll(c.words[word]);
+                pos += __builtin_popcountll(c.words[word] & below);
+                bits = c.words[word] & ~below;
+            }
+            nextWord(c);
+        } else {
+            pos = static_cast<uint32_t>(std::lower_bound(c.array.begin() + pos, c.array.end(), low) - c.array.begin());
+            if (pos == c.array.size()) {
+                nextContainer();
+            } else {
+                current = (uint32_t(c.key) << 16) | c.array[pos];
+            }
+        }
+    }
+
+private:
+    const Bitmap* bitmap = nullptr;
+    size_t ci = 0;          // current container
+    uint32_t pos = 0;       // rank of the current member within its container
+    uint64_t base = 0;      // members in earlier containers
+    size_t word = 0;        // bitmap container: word holding the current member
+    uint64_t bits = 0;      // that word's members from the current one on
+    uint32_t current = 0;
+
+    // First member of container ci, if any
+    void settle() {
+        pos = 0;
+        if (done()) return;
+        const Container& c = bitmap->containers[ci];
+        if (c.isBitmap()) {
+            word = 0;
+            bits = c.words[0];
+            nextWord(c);
+        } else {
+            current = (uint32_t(c.key) << 16) | c.array[0];
+        }
+    }
+
+    // Current member = lowest set bit from `bits` on, or the next container
+    void nextWord(const Container& c) {
+        while (bits == 0) {
+            if (++word == BITMAP_WORDS) {
+                nextContainer();
+                return;
+            }
+            bits = c.words[word];
+        }
+        current = (uint32_t(c.key) << 16) | static_cast<uint32_t>(word * 64 + __builtin_ctzll(bits));
+    }
+
+    void nextContainer() {
+        base += bitmap->containers[ci].cardinality;
+        ci++;
+        settle();
+    }
+};
+
+// Walks one bitmap alongside an ascending stream of values, for looking up
+// per-member data stored in member order (e.g. term frequencies). Values
+// passed to seek() must not decrease between calls.
+class RankCursor {
+public:
+    explicit RankCursor(const Bitmap& bitmap) : bitmap(&bitmap) {}
+
+    // True if value is a member; rankOut receives the number of members
+    // smaller than value (its index in member order when it is one)
+    bool seek(uint32_t value, uint64_t& rankOut) {
+        uint16_t key = static_cast<uint16_t>(value >> 16);
+        uint16_t low = static_cast<uint16_t>(value & 0xFFFF);
+        const auto& cs = bitmap->containers;
+
+        while (ci < cs.size() && cs[ci].key < key) {
+            base += cs[ci].cardinality;
+            ci++;
+            pos = 0;
+            wordCount = 0;
+        }
+        rankOut = base;
+        if (ci == cs.size() || cs[ci].key > key) return false;
+
+        const Container& c = cs[ci];
+        if (c.isBitmap()) {
+            size_t w = low >> 6;
+            for (; pos < w; pos++) wordCount += __builtin_popcountll(c.words[pos]);
+            uint64_t bit = uint64_t(1) << (low & 63);
+            rankOut += wordCount + __builtin_popcountll(c.words[w] & (bit - 1));
+            return (c.words[w] & bit) != 0;
+        }
+        while (pos < c.array.size() && c.array[pos] < low) pos++;
+        rankOut += pos;
+        return pos < c.array.size() && c.array[pos] == low;
+    }
+
+private:
+    const Bitmap* bitmap;
+    size_t ci = 0;          // current container
+    size_t pos = 0;         // word (bitmap) or element (array) index within it
+    uint64_t base = 0;      // members in earlier containers
+    uint64_t wordCount = 0; // members in words [0, pos) of a bitmap container
+};
+
+} // namespace roaring
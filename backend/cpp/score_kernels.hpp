@@ -0,0 +1,302 @@
+#pragma once
+
+/*
+ * Block Scoring Kernels
+ *
+ * Term-at-a-time scoring computes one score per posting of a term from the
+ * posting's tf (and document length), then adds it into the document's
+ * accumulator (accumulator.hpp). Everything that depends only on the term
+ * (idf, the BM25 normalization constants, the query weight) is computed once
+ * per term here, and the per-posting work runs over blocks of decoded tfs:
+ *
+ *   BM25    weight * tf / (tf + norm0 + norm1 * docLength)
+ *           weight = idf * (k1 + 1), norm0 = k1 * (1 - b), norm1 = k1 * b / avgdl
+ *   TF-IDF  (1 + log10 tf) * idf * queryWeight, read from a per-term table
+ *           for tf < TFIDF_TABLE_SIZE (nearly every posting) and computed
+ *           otherwise
+ *   scatterAdd  sums[docs[i]] += values[i]
+ *
+ * Each kernel has a scalar version and AVX2 (8 lanes) and AVX-512 (16
+ * lanes) versions, compiled with function target attributes so the build
+ * needs no -mavx flags. kernels() picks, per kernel, the widest version the
+ * CPU supports up to the kernel's MAX_LEVEL: wider is not always faster
+ * (kernelBench measures each). All versions round identically: norm0 + norm1 * docLength is
+ * always one fused multiply-add, the rest single float operations, and the
+ * TF-IDF table is built in double as calculateTFIDF computes it.
+ *
+ * AVX2 has no scatter instruction, so its scatterAdd is the scalar loop;
+ * AVX-512 gathers, adds and scatters 16 sums at a time (the documents of
+ * one call must be distinct, as they are within one posting list).
+ */
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define MINIGOOGLE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace score_kernels {
+
+constexpr int TFIDF_TABLE_SIZE = 64;
+
+struct Bm25Term {
+    float weight = 0.0f;   // idf * (k1 + 1)
+    float norm0 = 0.0f;    // k1 * (1 - b)
+    float norm1 = 0.0f;    // k1 * b / avgDocLen
+    float avgNorm = 0.0f;  // norm0 + norm1 * avgDocLen, when lengths are not given
+};
+
+inline Bm25Term bm25Term(double idf, double k1, double b, double avgDocLen) {
+    Bm25Term t;
+    t.weight = static_cast<float>(idf * (k1 + 1.0));
+    t.norm0 = static_cast<float>(k1 * (1.0 - b));
+    t.norm1 = static_cast<float>(k1 * b / avgDocLen);
+    t.avgNorm = std::fma(t.norm1, static_cast<float>(avgDocLen), t.norm0);
+    return t;
+}
+
+struct TfIdfTerm {
+    double idf = 0.0;
+    double weight = 1.0;
+    std::array<float, TFIDF_TABLE_SIZE> byTf{};  // byTf[0] = 0
+
+    float compute(int32_t tf) const {
+        return tf <= 0 ? 0.0f : static_cast<float>((1.0 + std::log10(static_cast<double>(tf))) * idf * weight);
+    }
+
+    // One posting, exactly as every kernel level scores it
+    float score(int32_t tf) const { return tf < TFIDF_TABLE_SIZE ? byTf[tf] : compute(tf); }
+};
+
+inline TfIdfTerm tfidfTerm(double idf, double weight) {
+    TfIdfTerm t;
+    t.idf = idf;
+    t.weight = weight;
+    for (int tf = 0; tf < TFIDF_TABLE_SIZE; tf++) t.byTf[tf] = t.compute(tf);
+    return t;
+}
+
+enum class Level { Scalar, Avx2, Avx512 };
+
+inline const char* levelName(Level level) {
+    switch (level) {
+        case Level::Avx512: return "avx512";
+        case Level::Avx2:   return "avx2";
+        default:            return "scalar";
+    }
+}
+
+// ---------------------- Scalar ----------------------
+
+namespace scalar {
+
+inline void bm25(const Bm25Term& t, const int32_t* tfs, const int32_t* docLengths, size_t n, float* out) {
+    if (docLengths) {
+        for (size_t i = 0; i < n; i++) {
+            float tf = static_cast<float>(tfs[i]);
+            out[i] = t.weight * tf / (tf + std::fma(t.norm1, static_cast<float>(docLengths[i]), t.norm0));
+        }
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            float tf = static_cast<float>(tfs[i]);
+            out[i] = t.weight * tf / (tf + t.avgNorm);
+        }
+    }
+}
+
+inline void tfidf(const TfIdfTerm& t, const int32_t* tfs, size_t n, float* out) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = t.score(tfs[i]);
+    }
+}
+
+inline void scatterAdd(float* sums, const uint32_t* docs, const float* values, size_t n) {
+    for (size_t i = 0; i < n; i++) sums[docs[i]] += values[i];
+}
+
+}  // namespace scalar
+
+#ifdef MINIGOOGLE_X86_KERNELS
+
+// ---------------------- AVX2 ----------------------
+
+namespace avx2 {
+
+__attribute__((target("avx2,fma"))) inline void bm25(const Bm25Term& t, const int32_t* tfs, const int32_t* docLengths,
+                                                      size_t n, float* out) {
+    const __m256 weight = _mm256_set1_ps(t.weight);
+    const __m256 norm0 = _mm256_set1_ps(t.norm0);
+    const __m256 norm1 = _mm256_set1_ps(t.norm1);
+    const __m256 avgNorm = _mm256_set1_ps(t.avgNorm);
+    size_t i = 0;
+    if (docLengths) {
+        for (; i + 8 <= n; i += 8) {
+            __m256 tf = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(tfs + i)));
+            __m256 len = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(docLengths + i)));
+            __m256 norm = _mm256_fmadd_ps(norm1, len, norm0);
+            _mm256_storeu_ps(out + i, _mm256_div_ps(_mm256_mul_ps(weight, tf), _mm256_add_ps(tf, norm)));
+        }
+    } else {
+        for (; i + 8 <= n; i += 8) {
+            __m256 tf = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(tfs + i)));
+            _mm256_storeu_ps(out + i, _mm256_div_ps(_mm256_mul_ps(weight, tf), _mm256_add_ps(tf, avgNorm)));
+        }
+    }
+    scalar::bm25(t, tfs + i, docLengths ? docLengths + i : nullptr, n - i, out + i);
+}
+
+__attribute__((target("avx2,fma"))) inline void tfidf(const TfIdfTerm& t, const int32_t* tfs, size_t n, float* out) {
+    const __m256i last = _mm256_set1_epi32(TFIDF_TABLE_SIZE - 1);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i tf = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tfs + i));
+        __m256i index = _mm256_min_epi32(tf, last);
+        _mm256_storeu_ps(out + i, _mm256_i32gather_ps(t.byTf.data(), index, 4));
+        int large = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(tf, last)));
+        while (large) {
+            int lane = __builtin_ctz(large);
+            out[i + lane] = t.compute(tfs[i + lane]);
+            large &= large - 1;
+        }
+    }
+    scalar::tfidf(t, tfs + i, n - i, out + i);
+}
+
+}  // namespace avx2
+
+// ---------------------- AVX-512 ----------------------
+
+namespace avx512 {
+
+__attribute__((target("avx512f"))) inline void bm25(const Bm25Term& t, const int32_t* tfs, const int32_t* docLengths,
+                                                     size_t n, float* out) {
+    const __m512 weight = _mm512_set1_ps(t.weight);
+    const __m512 norm0 = _mm512_set1_ps(t.norm0);
+    const __m512 norm1 = _mm512_set1_ps(t.norm1);
+    const __m512 avgNorm = _mm512_set1_ps(t.avgNorm);
+    // Masked-off lanes divide 0 by norm (> 0), never by zero
+    if (docLengths) {
+        for (size_t i = 0; i < n; i += 16) {
+            __mmask16 m = n - i >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << (n - i)) - 1);
+            __m512 tf = _mm512_maskz_cvtepi32_ps(m, _mm512_maskz_loadu_epi32(m, tfs + i));
+            __m512 len = _mm512_maskz_cvtepi32_ps(m, _mm512_maskz_loadu_epi32(m, docLengths + i));
+            __m512 norm = _mm512_fmadd_ps(norm1, len, norm0);
+            _mm512_mask_storeu_ps(out + i, m, _mm512_div_ps(_mm512_mul_ps(weight, tf), _mm512_add_ps(tf, norm)));
+        }
+    } else {
+        for (size_t i = 0; i < n; i += 16) {
+            __mmask16 m = n - i >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << (n - i)) - 1);
+            __m512 tf = _mm512_maskz_cvtepi32_ps(m, _mm512_maskz_loadu_epi32(m, tfs + i));
+            _mm512_mask_storeu_ps(out + i, m, _mm512_div_ps(_mm512_mul_ps(weight, tf), _mm512_add_ps(tf, avgNorm)));
+        }
+    }
+}
+
+__attribute__((target("avx512f"))) inline void tfidf(const TfIdfTerm& t, const int32_t* tfs, size_t n, float* out) {
+    const __m512i last = _mm512_set1_epi32(TFIDF_TABLE_SIZE - 1);
+    for (size_t i = 0; i < n; i += 16) {
+        __mmask16 m = n - i >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512i tf = _mm512_maskz_loadu_epi32(m, tfs + i);
+        __m512i index = _mm512_maskz_min_epi32(m, tf, last);
+        _mm512_mask_storeu_ps(out + i, m, _mm512_mask_i32gather_ps(_mm512_setzero_ps(), m, index, t.byTf.data(), 4));
+        unsigned large = _mm512_mask_cmpgt_epi32_mask(m, tf, last);
+        while (large) {
+            int lane = __builtin_ctz(large);
+            out[i + lane] = t.compute(tfs[i + lane]);
+            large &= large - 1;
+        }
+    }
+}
+
+__attribute__((target("avx512f"))) inline void scatterAdd(float* sums, const uint32_t* docs, const float* values,
+                                                           size_t n) {
+    for (size_t i = 0; i < n; i += 16) {
+        __mmask16 m = n - i >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512i index = _mm512_maskz_loadu_epi32(m, docs + i);
+        __m512 sum = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), m, index, sums, 4);
+        sum = _mm512_add_ps(sum, _mm512_maskz_loadu_ps(m, values + i));
+        _mm512_mask_i32scatter_ps(sums, m, index, sum, 4);
+    }
+}
+
+}  // namespace avx512
+
+#endif  // MINIGOOGLE_X86_KERNELS
+
+// ---------------------- Dispatch ----------------------
+
+struct Kernels {
+    Level bm25Level, tfidfLevel, scatterAddLevel;
+    void (*bm25)(const Bm25Term&, const int32_t*, const int32_t*, size_t, float*);
+    void (*tfidf)(const TfIdfTerm&, const int32_t*, size_t, float*);
+    void (*scatterAdd)(float*, const uint32_t*, const float*, size_t);
+};
+
+inline bool supported(Level level) {
+#ifdef MINIGOOGLE_X86_KERNELS
+    if (level == Level::Avx512) return __builtin_cpu_supports("avx512f");
+    if (level == Level::Avx2) return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+    return level == Level::Scalar;
+}
+
+// The kernels of one level (which must be supported); for benchmarks
+inline Kernels kernelsFor(Level level) {
+#ifdef MINIGOOGLE_X86_KERNELS
+    if (level == Level::Avx512) {
+        return {level, level, level, avx512::bm25, avx512::tfidf, avx512::scatterAdd};
+    }
+    if (level == Level::Avx2) {
+        return {level, level, Level::Scalar, avx2::bm25, avx2::tfidf, scalar::scatterAdd};
+    }
+#endif
+    return {Level::Scalar, Level::Scalar, Level::Scalar, scalar::bm25, scalar::tfidf, scalar::scatterAdd};
+}
+
+// The widest level each kernel is dispatched to. BM25's divide gains from
+// every lane. The TF-IDF table gather is no faster at 16 lanes than at 8,
+// and the scatter-add's gather/scatter loses its gain once the sums outgrow
+// the cache, as they do for a real collection.
+constexpr Level BM25_MAX_LEVEL = Level::Avx512;
+constexpr Level TFIDF_MAX_LEVEL = Level::Avx2;
+constexpr Level SCATTER_ADD_MAX_LEVEL = Level::Scalar;
+
+// The widest supported level no wider than maxLevel
+inline Level bestLevel(Level maxLevel) {
+    if (maxLevel == Level::Avx512 && supported(Level::Avx512)) return Level::Avx512;
+    if (maxLevel != Level::Scalar && supported(Level::Avx2)) return Level::Avx2;
+    return Level::Scalar;
+}
+
+// Each kernel at its dispatched level, chosen on first use
+inline const Kernels& kernels() {
+    static const Kernels best = [] {
+        Kernels k = kernelsFor(bestLevel(BM25_MAX_LEVEL));
+        Kernels tfidf = kernelsFor(bestLevel(TFIDF_MAX_LEVEL));
+        Kernels scatterAdd = kernelsFor(bestLevel(SCATTER_ADD_MAX_LEVEL));
+        k.tfidfLevel = tfidf.tfidfLevel;
+        k.tfidf = tfidf.tfidf;
+        k.scatterAddLevel = scatterAdd.scatterAddLevel;
+        k.scatterAdd = scatterAdd.scatterAdd;
+        return k;
+    }();
+    return best;
+}
+
+inline void bm25(const Bm25Term& t, const int32_t* tfs, const int32_t* docLengths, size_t n, float* out) {
+    kernels().bm25(t, tfs, docLengths, n, out);
+}
+
+inline void tfidf(const TfIdfTerm& t, const int32_t* tfs, size_t n, float* out) {
+    kernels().tfidf(t, tfs, n, out);
+}
+
+inline void scatterAdd(float* sums, const uint32_t* docs, const float* values, size_t n) {
+    kernels().scatterAdd(sums, docs, values, n);
+}
+
+}  // namespace score_kernels
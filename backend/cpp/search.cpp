@@ -7,12 +7,43 @@
  * - AND/OR query modes for multi-word queries
  * - TF-IDF ranking
  * - Cached lexicon and barrel lookup for repeated queries
+ * - Tier-1 pruned index (barrels_binary/tier1.*): answers from the highest-tf
+ *   postings of long lists when score upper bounds prove the top-K is exact,
+ *   otherwise falls back to the full barrels
+ * - Roaring bitmaps (barrels_binary/roaring.*) for very high-df terms: AND/OR
+ *   over them combines bitmap containers instead of hashing doc ID strings
+ * - Pair barrel (barrels_binary/pairs.*, built by pairBuilder): AND queries
+ *   containing a frequent term pair read its precomputed intersection
+ * - Cost-based planner (query_planner.hpp): picks the evaluation order and
+ *   algorithm (pair lists, bitmap AND/OR, merge/galloping intersection, WAND
+ *   top-K or exhaustive term-at-a-time scoring into dense accumulators,
+ *   accumulator.hpp) and whether to try tier 1 first
+ * - Boolean query language (boolean_query.hpp): AND/OR/NOT, -term,
+ *   parentheses, "phrases" and title:/abstract: scoping, evaluated by lazy
+ *   posting cursors; phrases and fields are checked on the forward index
+ * - Attribute filters (attributes.hpp, built by attributeBuilder): year
+ *   ranges, journals and licenses, checked while postings are read so
+ *   rejected documents are never scored
+ * - Facets (facets.hpp): counts of years, journals, licenses or authors over
+ *   every match, taken in the pass that scores them (optionally sampled)
  *
  * Usage:
  *   ./search "single word"
  *   ./search "word1 word2 word3"          # Default: AND mode
  *   ./search "word1 word2 word3" --or     # OR mode
  *   ./search "word1 word2 word3" --and    # AND mode (explicit)
+ *   ./search "word1 word2" --no-tier1     # always read the full barrels
+ *   ./search "word1 word2" --no-roaring   # posting lists even for bitmap terms
+ *   ./search "word1 word2" --no-pairs     # ignore the pair barrel
+ *   ./search "word1 word2" --explain      # print the plan and postings touched
+ *   ./search "word1 word2" --algorithm wand   # force one plan: exhaustive,
+ *                                             # pairs, bitmap, merge or wand
+ *   ./search 'covid AND (vaccine OR "booster dose") -influenza title:lung'
+ *   ./search "word1 word2" --year 2019-2021 --journal Nature --license cc-by
+ *                          # --year Y, Y-Y, Y- or -Y; repeat --journal or
+ *                          # --license to allow several values
+ *   ./search "word1 word2" --facets year,journal   # counts over all matches
+ *   ./search "word1 word2" --facets year --facet-sample 0.1
  */
 
 #include <iostream>
@@ -28,8 +59,22 @@
 #include <cmath>
 #include <chrono>
 #include <cctype>
+#include <memory>
+#include <limits>
+#include <functional>
 
 #include "config.hpp"
+#include "lexicon.hpp"
+#include "doc_store.hpp"
+#include "snippet.hpp"
+#include "roaring.hpp"
+#include "accumulator.hpp"
+#include "query_evaluator.hpp"
+#include "query_planner.hpp"
+#include "boolean_query.hpp"
+#include "attributes.hpp"
+#include "facets.hpp"
+#include "forward_index.hpp"
 
 namespace fs = std::filesystem;
 using json = nlohmann::json;
@@ -37,12 +82,22 @@ using namespace std::chrono;
 
 // Constants
 const int DOC_ID_SIZE = 20;
-const int TOTAL_DOCS = 59000;  // Approximate total documents for IDF calculation
+const int POSTING_SIZE = DOC_ID_SIZE + 4;  // [docId:20][tf:4] in the barrel files
+constexpr int TOTAL_DOCS = 59000;  // Approximate total documents for IDF calculation
 
 // BM25 Parameters
-const double BM25_K1 = 1.5;    // Term saturation parameter (typical: 1.2-2.0)
-const double BM25_B = 0.75;    // Length normalization (typical: 0.75)
-const int AVG_DOC_LENGTH = 200; // Average document length in terms
+constexpr double BM25_K1 = 1.5;    // Term saturation parameter (typical: 1.2-2.0)
+constexpr double BM25_B = 0.75;    // Length normalization (typical: 0.75)
+constexpr int AVG_DOC_LENGTH = 200; // Average document length in terms
+
+// The BM25 parameters as the scorer policy of query_evaluator.hpp
+struct Bm25Params {
+    static constexpr int totalDocs = TOTAL_DOCS;
+    static constexpr double k1 = BM25_K1;
+    static constexpr double b = BM25_B;
+    static constexpr int avgDocLen = AVG_DOC_LENGTH;
+};
+using Bm25Scorer = query_evaluator::Bm25<Bm25Params>;
 
 // ---------------------- Data Structures ----------------------
 
@@ -61,17 +116,35 @@ struct IndexEntry {
 // ---------------------- Global Cache (loaded once) ----------------------
 
 struct SearchCache {
-    std::unordered_map<std::string, int> wordToLemmaId;  // word -> lemmaId (from binary lexicon)
-    json lexicon;  // fallback for JSON lexicon
-    bool useBinaryLexicon = false;
+    LemmaTable wordToLemma;  // word -> lemmaId (binary lexicon, or built from JSON lexicon)
     std::unordered_map<int, int> barrelLookup;  // lemmaId -> barrelId
     std::unordered_map<int, std::unordered_map<int, IndexEntry>> barrelIndices;  // barrelId -> (lemmaId -> IndexEntry)
+    std::unordered_map<int, IndexEntry> tier1Index;  // lemmaId -> IndexEntry in tier1.bin (empty if not built)
+    std::unordered_map<int, IndexEntry> roaringIndex;  // lemmaId -> IndexEntry in roaring.bin (empty if not built)
+    std::vector<std::string> roaringDocs;  // document ordinal -> docId, loaded on first use
+    std::unordered_map<std::string, uint32_t> roaringOrdinals;  // docId -> ordinal, built on first use
+    std::unordered_map<uint64_t, IndexEntry> pairIndex;  // (lemmaA, lemmaB) -> IndexEntry in pairs.bin (empty if not built)
+    std::unique_ptr<doc_store::Reader> docStore;  // titles/authors/abstracts by docID (optional)
+    std::unique_ptr<attributes::Store> attributes;  // year/journal/license by docID, loaded for filters
+    query_planner::Layout layout;  // from barrels_binary/layout.json
+    // Forward index by PMC ID, loaded on the first phrase or field query
+    std::unique_ptr<forward_index::Reader> forward;
+    std::unordered_map<std::string, forward_index::Fields> forwardFields;
     bool initialized = false;
     fs::path backendDir;
 };
 
 static SearchCache g_cache;
 
+// Postings read or compared by the current query (see --explain)
+static int64_t g_postingsTouched = 0;
+
+// Attribute filter of the current query (--year, --journal, --license)
+static attributes::Filter g_filter;
+
+// Facet counts of the current query (--facets), null when none were asked for
+static std::unique_ptr<facets::Counter> g_facets;
+
 // ---------------------- Utility Functions ----------------------
 
 std::string toLower(const std::string& str) {
@@ -81,66 +154,37 @@ std::string toLower(const std::string& str) {
     return result;
 }
 
-std::vector<std::string> tokenize(const std::string& query) {
-    std::vector<std::string> tokens;
-    std::istringstream iss(query);
-    std::string token;
-    while (iss >> token) {
-        // Remove punctuation and convert to lowercase
-        std::string clean;
-        for (char c : token) {
-            if (std::isalnum(c)) {
-                clean += std::tolower(c);
-            }
-        }
-        if (!clean.empty()) {
-            tokens.push_back(clean);
-        }
-    }
-    return tokens;
+// Key of a term pair in the pair barrel (lemmaA < lemmaB)
+uint64_t pairKey(int lemmaA, int lemmaB) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(lemmaA)) << 32) | static_cast<uint32_t>(lemmaB);
 }
 
-// ---------------------- Binary Lexicon Loading ----------------------
-
-bool loadBinaryLexicon(const fs::path& binPath) {
-    if (!fs::exists(binPath)) {
-        return false;
-    }
-
-    std::ifstream binFile(binPath, std::ios::binary);
-    if (!binFile.is_open()) {
-        return false;
-    }
-
-    uint32_t numWords;
-    binFile.read(reinterpret_cast<char*>(&numWords), sizeof(numWords));
-
-    std::vector<std::pair<std::string, int>> words;
-    words.reserve(numWords);
-
-    for (uint32_t i = 0; i < numWords; i++) {
-        uint16_t wordLen;
-        binFile.read(reinterpret_cast<char*>(&wordLen), sizeof(wordLen));
+// Same normalization as forwardIndex (see tokenizer.hpp)
+std::vector<std::string> tokenize(const std::string& query) {
+    Tokenizer tokenizer;
+    return tokenizer.tokenize(query);
+}
 
-        std::string word(wordLen, '\0');
-        binFile.read(&word[0], wordLen);
+// ---------------------- Cache Initialization ----------------------
 
-        words.push_back({word, 0});
-    }
+// Reads a [numEntries][lemmaId, offset, length]... index; a missing file leaves it empty
+void loadIndexFile(const fs::path& idxPath, std::unordered_map<int, IndexEntry>& indexOut) {
+    std::ifstream idxFile(idxPath, std::ios::binary);
+    if (!idxFile.is_open()) return;
 
-    for (uint32_t i = 0; i < numWords; i++) {
+    int32_t numEntries = 0;
+    idxFile.read(reinterpret_cast<char*>(&numEntries), sizeof(numEntries));
+    indexOut.reserve(numEntries);
+    for (int i = 0; i < numEntries; i++) {
         int32_t lemmaId;
-        binFile.read(reinterpret_cast<char*>(&lemmaId), sizeof(lemmaId));
-        words[i].second = lemmaId;
-        g_cache.wordToLemmaId[words[i].first] = lemmaId;
+        IndexEntry entry;
+        idxFile.read(reinterpret_cast<char*>(&lemmaId), sizeof(lemmaId));
+        idxFile.read(reinterpret_cast<char*>(&entry.offset), sizeof(entry.offset));
+        idxFile.read(reinterpret_cast<char*>(&entry.length), sizeof(entry.length));
+        indexOut[lemmaId] = entry;
     }
-
-    binFile.close();
-    return true;
 }
 
-// ---------------------- Cache Initialization ----------------------
-
 void initializeCache(const fs::path& backendDir, const json& config) {
     if (g_cache.initialized) return;
 
@@ -155,16 +199,17 @@ void initializeCache(const fs::path& backendDir, const json& config) {
 
     // Try binary lexicon first (much faster)
     fs::path binLexPath = embeddingsDir / "lexicon.bin";
-    if (loadBinaryLexicon(binLexPath)) {
-        g_cache.useBinaryLexicon = true;
-    } else {
+    if (!loadLemmaTableBinary(binLexPath.string(), g_cache.wordToLemma)) {
         // Fallback to JSON lexicon
         std::ifstream lexFile(lexiconPath);
         if (!lexFile.is_open()) {
             throw std::runtime_error("Cannot open lexicon at " + lexiconPath.string());
         }
-        lexFile >> g_cache.lexicon;
+        json lexicon;
+        lexFile >> lexicon;
         lexFile.close();
+
+        loadLemmaTableJSON(lexicon, g_cache.wordToLemma);
     }
 
     // Load barrel lookup
@@ -215,6 +260,47 @@ void initializeCache(const fs::path& backendDir, const json& config) {
         idxFile.close();
     }
 
+    // Tier-1 pruned index and roaring bitmaps (both optional)
+    loadIndexFile(binaryBarrelsDir / "tier1.idx", g_cache.tier1Index);
+    loadIndexFile(binaryBarrelsDir / "roaring.idx", g_cache.roaringIndex);
+
+    // Pair barrel (optional): [numEntries] then [lemmaA, lemmaB, offset, length]...
+    std::ifstream pairIdx(binaryBarrelsDir / "pairs.idx", std::ios::binary);
+    if (pairIdx.is_open()) {
+        int32_t numEntries = 0;
+        pairIdx.read(reinterpret_cast<char*>(&numEntries), sizeof(numEntries));
+        g_cache.pairIndex.reserve(numEntries);
+        for (int i = 0; i < numEntries; i++) {
+            int32_t lemmas[2];
+            IndexEntry entry;
+            pairIdx.read(reinterpret_cast<char*>(lemmas), sizeof(lemmas));
+            pairIdx.read(reinterpret_cast<char*>(&entry.offset), sizeof(entry.offset));
+            pairIdx.read(reinterpret_cast<char*>(&entry.length), sizeof(entry.length));
+            g_cache.pairIndex[pairKey(lemmas[0], lemmas[1])] = entry;
+        }
+    }
+
+    // Segment layout for the planner; barrels converted before layout.json
+    // existed are not known to be in doc ID order
+    g_cache.layout.numDocs = TOTAL_DOCS;
+    std::ifstream layoutFile(binaryBarrelsDir / "layout.json");
+    if (layoutFile.is_open()) {
+        json layout;
+        layoutFile >> layout;
+        g_cache.layout.sortedLists = layout.value("postings_sorted_by_doc_id", false);
+        g_cache.layout.numDocs = std::max<int64_t>(1, layout.value("num_docs", int64_t(TOTAL_DOCS)));
+    }
+
+    // Document store for result metadata (optional: results print without it)
+    fs::path docStorePath = indexesDir / config.value("doc_store_file", "doc_store.bin");
+    if (fs::exists(docStorePath)) {
+        try {
+            g_cache.docStore = std::make_unique<doc_store::Reader>(docStorePath.string());
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: " << e.what() << std::endl;
+        }
+    }
+
     g_cache.initialized = true;
 
     auto endTime = high_resolution_clock::now();
@@ -225,29 +311,120 @@ void initializeCache(const fs::path& backendDir, const json& config) {
 // ---------------------- Lexicon Lookup ----------------------
 
 bool getLemmaIdForWord(const std::string& word, int& lemmaIdOut) {
-    // Use binary lexicon if available
-    if (g_cache.useBinaryLexicon) {
-        auto it = g_cache.wordToLemmaId.find(word);
-        if (it != g_cache.wordToLemmaId.end()) {
-            lemmaIdOut = it->second;
-            return true;
-        }
+    int32_t lemmaId = g_cache.wordToLemma.find(word);
+    if (lemmaId == -1) {
         return false;
     }
 
-    // Fallback to JSON lexicon
-    if (!g_cache.lexicon.contains("wordID")) {
-        return false;
+    lemmaIdOut = lemmaId;
+    return true;
+}
+
+// ---------------------- Attribute Filters ----------------------
+
+// Filter flags as given on the command line
+struct FilterSpec {
+    std::vector<std::string> years;     // "2020", "2019-2021", "2019-" or "-2021"
+    std::vector<std::string> journals;  // any of these, ignoring case
+    std::vector<std::string> licenses;
+
+    bool empty() const { return years.empty() && journals.empty() && licenses.empty(); }
+};
+
+// Facet flags as given on the command line
+struct FacetSpec {
+    std::vector<std::string> names;  // attributes to count, e.g. year,journal
+    double sampleRate = 0.0;         // --facet-sample; 0 = decide from the expected matches
+};
+
+// The attribute store, for filters and facets. Postings carry PMC IDs, so the
+// document store is needed to map them to the docIDs the store is keyed by.
+const attributes::Store& loadAttributes(const fs::path& backendDir, const json& config, const char* purpose) {
+    if (!g_cache.docStore) {
+        throw std::runtime_error(std::string(purpose) + " need the document store (run forwardIndex)");
+    }
+    if (!g_cache.attributes) {
+        fs::path dir = backendDir / config["indexes_dir"].get<std::string>() / config.value("attributes_dir", "attributes");
+        g_cache.attributes = std::make_unique<attributes::Store>(dir);
     }
+    return *g_cache.attributes;
+}
 
-    const json& wordID = g_cache.lexicon["wordID"];
-    auto it = wordID.find(word);
-    if (it == wordID.end()) {
-        return false;
+// Builds g_filter from the attribute store
+void buildFilter(const fs::path& backendDir, const json& config, const FilterSpec& spec) {
+    if (spec.empty()) return;
+    loadAttributes(backendDir, config, "Filters");
+
+    for (const auto& range : spec.years) {
+        std::size_t dash = range.find('-');
+        std::string lo = range.substr(0, dash);
+        std::string hi = dash == std::string::npos ? lo : range.substr(dash + 1);
+        try {
+            g_filter.addRange(*g_cache.attributes, "year", lo.empty() ? 1 : std::stoul(lo),
+                              hi.empty() ? 9999 : std::stoul(hi));
+        } catch (const std::logic_error&) {
+            throw std::runtime_error("Bad --year '" + range + "' (use 2020, 2019-2021, 2019- or -2021)");
+        }
     }
+    if (!spec.journals.empty()) g_filter.addValues(*g_cache.attributes, "journal", spec.journals);
+    if (!spec.licenses.empty()) g_filter.addValues(*g_cache.attributes, "license", spec.licenses);
 
-    lemmaIdOut = it.value().get<int>();
-    return true;
+    std::cout << "[Filter: " << g_filter.description() << ", at most " << g_filter.estimate()
+              << " of " << g_cache.attributes->size() << " documents]\n" << std::endl;
+}
+
+// Sets up g_facets. Without --facet-sample, a query expected to match more
+// than facet_sample_above documents counts a sample of about that many.
+void startFacets(const fs::path& backendDir, const json& config, const FacetSpec& spec, double expectedMatches) {
+    if (spec.names.empty()) return;
+    const attributes::Store& store = loadAttributes(backendDir, config, "Facets");
+
+    double rate = spec.sampleRate;
+    if (rate <= 0.0) {
+        double above = config.value("facet_sample_above", 200000.0);
+        if (g_filter.active()) {
+            expectedMatches *= static_cast<double>(g_filter.estimate()) / std::max<uint64_t>(1, store.size());
+        }
+        rate = expectedMatches > above ? above / expectedMatches : 1.0;
+    }
+    g_facets = std::make_unique<facets::Counter>(store, spec.names, rate);
+}
+
+// Counts a matching document towards the query's facets
+void countFacets(const char* docId) {
+    if (!g_facets) return;
+    uint32_t id;
+    if (g_cache.docStore->findDocId(std::string_view(docId, strnlen(docId, DOC_ID_SIZE)), id)) {
+        g_facets->add(id);
+    }
+}
+
+// Prints "[Facet name: value=count, ...]" lines; "~" marks sampled counts
+void printFacets(std::size_t topValues) {
+    if (!g_facets) return;
+    bool sampled = g_facets->sampleRate() < 1.0;
+    std::cout << "\n[Facets: " << g_facets->counted() << " of " << g_facets->matches() << " matches counted";
+    if (sampled) std::cout << " (" << g_facets->sampleRate() * 100.0 << "% sample)";
+    std::cout << "]" << std::endl;
+    for (const auto& facet : g_facets->finish(topValues)) {
+        std::cout << "[Facet " << facet.name << ":";
+        for (std::size_t i = 0; i < facet.values.size(); i++) {
+            std::cout << (i ? ", " : " ") << facet.values[i].first << "=" << (sampled ? "~" : "")
+                      << facet.values[i].second;
+        }
+        std::cout << "]" << std::endl;
+    }
+}
+
+// Whether a posting's document passes the query's filter. Called by every
+// posting reader, so rejected documents are dropped before they are hashed
+// or scored. Documents missing from the document store (new uploads) have
+// no attributes and never pass.
+bool passesFilter(const char* docId) {
+    if (!g_filter.active()) return true;
+    uint32_t id;
+    return g_cache.docStore->findDocId(std::string_view(docId, strnlen(docId, DOC_ID_SIZE)), id) &&
+           g_filter.accepts(id);
 }
 
 // ---------------------- Binary Barrel Search (FAST) ----------------------
@@ -298,6 +475,7 @@ bool findPostingsBinary(
     binFile.read(reinterpret_cast<char*>(&numDocs), sizeof(numDocs));
 
     dfOut = df;
+    g_postingsTouched += numDocs;
 
     // Read postings
     postingsOut.clear();
@@ -309,6 +487,7 @@ bool findPostingsBinary(
 
         binFile.read(docIdBuf, DOC_ID_SIZE);
         binFile.read(reinterpret_cast<char*>(&tf), sizeof(tf));
+        if (!passesFilter(docIdBuf)) continue;
 
         DocPosting dp;
         dp.docId = std::string(docIdBuf);
@@ -364,11 +543,13 @@ bool findPostingsJSON(
 
     const json& postingJson = barrel["postings"][lemmaKey];
     dfOut = postingJson.value("df", 0);
+    g_postingsTouched += postingJson["docs"].size();
 
     postingsOut.clear();
     for (const auto& d : postingJson["docs"]) {
         DocPosting dp;
         dp.docId = d.at("doc_id").get<std::string>();
+        if (!passesFilter(dp.docId.c_str())) continue;
         dp.tf = d.at("tf").get<int>();
         dp.score = 0.0;
         postingsOut.push_back(dp);
@@ -417,6 +598,7 @@ bool findPostings(
                 binFile.read(reinterpret_cast<char*>(&readLemmaId), sizeof(readLemmaId));
                 binFile.read(reinterpret_cast<char*>(&newDf), sizeof(newDf));
                 binFile.read(reinterpret_cast<char*>(&numDocs), sizeof(numDocs));
+                g_postingsTouched += numDocs;
 
                 // Collect doc IDs we already have
                 std::unordered_set<std::string> existingDocs;
@@ -439,7 +621,7 @@ bool findPostings(
                         docId = docId.substr(0, nullPos);
                     }
 
-                    if (existingDocs.find(docId) == existingDocs.end()) {
+                    if (existingDocs.find(docId) == existingDocs.end() && passesFilter(docId.c_str())) {
                         DocPosting dp;
                         dp.docId = docId;
                         dp.tf = tf;
@@ -459,6 +641,163 @@ bool findPostings(
     return foundMain;
 }
 
+bool inNewDocsBarrel(int lemmaId) {
+    auto it = g_cache.barrelIndices.find(10);
+    return it != g_cache.barrelIndices.end() && it->second.count(lemmaId) > 0;
+}
+
+// ---------------------- Roaring Bitmap Terms ----------------------
+
+struct BitmapTerm {
+    int df = 0;
+    roaring::Bitmap docs;       // document ordinals
+    std::vector<uint16_t> tfs;  // tf of each member, in ordinal order
+};
+
+bool readBitmapTerm(const fs::path& backendDir, const json& config, int lemmaId, BitmapTerm& out) {
+    auto it = g_cache.roaringIndex.find(lemmaId);
+    if (it == g_cache.roaringIndex.end()) {
+        return false;
+    }
+
+    fs::path binPath = backendDir / config["indexes_dir"].get<std::string>() / "barrels_binary" / "roaring.bin";
+    std::ifstream binFile(binPath, std::ios::binary);
+    if (!binFile.is_open()) {
+        return false;
+    }
+    binFile.seekg(it->second.offset);
+
+    int32_t header[3];  // lemmaId, df, numDocs
+    binFile.read(reinterpret_cast<char*>(header), sizeof(header));
+    out.df = header[1];
+    if (!out.docs.read(binFile)) {
+        return false;
+    }
+    for (const auto& c : out.docs.containers) {
+        g_postingsTouched += c.isBitmap() ? roaring::BITMAP_WORDS : c.cardinality;
+    }
+    out.tfs.resize(header[2]);
+    binFile.read(reinterpret_cast<char*>(out.tfs.data()), out.tfs.size() * sizeof(uint16_t));
+    return static_cast<bool>(binFile);
+}
+
+// Ordinal -> docId table written next to roaring.bin
+const std::vector<std::string>& roaringDocIds(const fs::path& backendDir, const json& config) {
+    if (!g_cache.roaringDocs.empty()) return g_cache.roaringDocs;
+
+    fs::path docsPath = backendDir / config["indexes_dir"].get<std::string>() / "barrels_binary" / "roaring_docs.bin";
+    std::ifstream docsFile(docsPath, std::ios::binary);
+    if (!docsFile.is_open()) {
+        throw std::runtime_error("Cannot open " + docsPath.string() + " (rerun barrels_binary)");
+    }
+    int32_t numDocs = 0;
+    docsFile.read(reinterpret_cast<char*>(&numDocs), sizeof(numDocs));
+    std::vector<char> buf(static_cast<size_t>(numDocs) * DOC_ID_SIZE);
+    docsFile.read(buf.data(), buf.size());
+
+    g_cache.roaringDocs.reserve(numDocs);
+    for (int32_t i = 0; i < numDocs; i++) {
+        const char* id = buf.data() + static_cast<size_t>(i) * DOC_ID_SIZE;
+        g_cache.roaringDocs.emplace_back(id, std::find(id, id + DOC_ID_SIZE, '\0'));
+    }
+    return g_cache.roaringDocs;
+}
+
+const std::unordered_map<std::string, uint32_t>& roaringOrdinals(const fs::path& backendDir, const json& config) {
+    if (g_cache.roaringOrdinals.empty()) {
+        const auto& docIds = roaringDocIds(backendDir, config);
+        g_cache.roaringOrdinals.reserve(docIds.size());
+        for (uint32_t i = 0; i < docIds.size(); i++) {
+            g_cache.roaringOrdinals.emplace(docIds[i], i);
+        }
+    }
+    return g_cache.roaringOrdinals;
+}
+
+// ---------------------- Pair Barrel ----------------------
+
+// Reads the pair list of two terms (written by pairBuilder), split back into
+// one posting list per term over the documents that contain both
+bool readPairList(const fs::path& backendDir, const json& config, int lemmaA, int lemmaB,
+                  std::vector<DocPosting>& forA, std::vector<DocPosting>& forB, int& dfA, int& dfB) {
+    bool swapped = lemmaA > lemmaB;
+    auto it = g_cache.pairIndex.find(swapped ? pairKey(lemmaB, lemmaA) : pairKey(lemmaA, lemmaB));
+    if (it == g_cache.pairIndex.end()) {
+        return false;
+    }
+
+    fs::path binPath = backendDir / config["indexes_dir"].get<std::string>() / "barrels_binary" / "pairs.bin";
+    std::ifstream binFile(binPath, std::ios::binary);
+    if (!binFile.is_open()) {
+        return false;
+    }
+    binFile.seekg(it->second.offset);
+
+    int32_t header[5];  // lemmaA, lemmaB, dfA, dfB, numDocs (lemmaA < lemmaB)
+    binFile.read(reinterpret_cast<char*>(header), sizeof(header));
+    dfA = swapped ? header[3] : header[2];
+    dfB = swapped ? header[2] : header[3];
+    g_postingsTouched += header[4];
+
+    forA.clear();
+    forB.clear();
+    forA.reserve(header[4]);
+    forB.reserve(header[4]);
+    for (int i = 0; i < header[4]; i++) {
+        char docIdBuf[DOC_ID_SIZE];
+        int32_t counts[3];  // tfA, tfB, adjacent
+
+        binFile.read(docIdBuf, DOC_ID_SIZE);
+        binFile.read(reinterpret_cast<char*>(counts), sizeof(counts));
+        if (!passesFilter(docIdBuf)) continue;
+
+        DocPosting dp;
+        dp.docId = std::string(docIdBuf, std::find(docIdBuf, docIdBuf + DOC_ID_SIZE, '\0'));
+        dp.docLength = AVG_DOC_LENGTH;
+        dp.score = 0.0;
+        dp.tf = swapped ? counts[1] : counts[0];
+        forA.push_back(dp);
+        dp.tf = swapped ? counts[0] : counts[1];
+        forB.push_back(dp);
+    }
+    return static_cast<bool>(binFile);
+}
+
+// Disjoint pairs of query terms (indexes into lemmaIds) that have a pair
+// list, shortest lists first. Terms with new-document postings are left
+// out: the pair barrel only covers the main index.
+std::vector<std::pair<std::size_t, std::size_t>> planPairs(const std::vector<int>& lemmaIds) {
+    struct Candidate {
+        std::size_t i, j;
+        int64_t length;
+    };
+    std::vector<Candidate> candidates;
+    if (g_cache.pairIndex.empty()) return {};
+
+    for (std::size_t i = 0; i < lemmaIds.size(); i++) {
+        for (std::size_t j = i + 1; j < lemmaIds.size(); j++) {
+            int a = std::min(lemmaIds[i], lemmaIds[j]);
+            int b = std::max(lemmaIds[i], lemmaIds[j]);
+            if (a == b) continue;
+            auto it = g_cache.pairIndex.find(pairKey(a, b));
+            if (it != g_cache.pairIndex.end() && !inNewDocsBarrel(a) && !inNewDocsBarrel(b)) {
+                candidates.push_back({i, j, it->second.length});
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate& x, const Candidate& y) { return x.length < y.length; });
+
+    std::vector<bool> used(lemmaIds.size(), false);
+    std::vector<std::pair<std::size_t, std::size_t>> plan;
+    for (const auto& c : candidates) {
+        if (used[c.i] || used[c.j]) continue;
+        used[c.i] = used[c.j] = true;
+        plan.push_back({c.i, c.j});
+    }
+    return plan;
+}
+
 // ---------------------- BM25 Scoring ----------------------
 
 double calculateBM25(int tf, int df, int docLength, int totalDocs = TOTAL_DOCS, int avgDocLen = AVG_DOC_LENGTH) {
@@ -494,6 +833,17 @@ double calculateTFIDF(int tf, int df, int totalDocs = TOTAL_DOCS) {
 
 enum QueryMode { AND_MODE, OR_MODE };
 
+// Optional index structures a query may use; each has a --no-* switch for
+// comparing against the plain barrels
+struct QueryOptions {
+    bool useTier1 = true;
+    bool useRoaring = true;
+    bool usePairs = true;
+    bool explain = false;
+    bool everyMatch = false;  // facets count every match: no WAND or tier-1 top-K
+    std::string algorithm;  // --algorithm: force a plan instead of the cheapest
+};
+
 struct QueryResult {
     std::string docId;
     double totalScore;
@@ -501,25 +851,201 @@ struct QueryResult {
     std::vector<int> termFreqs;  // TF for each query term
 };
 
+// Score descending, then more matched terms first
+void sortResults(std::vector<QueryResult>& results) {
+    std::sort(results.begin(), results.end(),
+              [](const QueryResult& a, const QueryResult& b) {
+                  if (std::abs(a.totalScore - b.totalScore) > 0.001) {
+                      return a.totalScore > b.totalScore;
+                  }
+                  return a.matchedTerms > b.matchedTerms;
+              });
+}
+
+// Scores a query in which some terms are roaring bitmaps. Documents are
+// handled as ordinals: bitmap terms are intersected (AND) or united (OR)
+// container by container and their tfs are looked up by rank; list terms are
+// first mapped onto ordinals, with documents outside the ordinal table
+// numbered past its end. Returns every matching document, unsorted.
+std::vector<QueryResult> processBitmapQuery(
+    const fs::path& backendDir,
+    const json& config,
+    QueryMode mode,
+    const std::vector<std::vector<DocPosting>>& allPostings,
+    const std::vector<int>& bitmapSlot,
+    const std::vector<BitmapTerm>& bitmapTerms,
+    const std::vector<int>& dfs
+) {
+    const std::size_t n = allPostings.size();
+    const auto& docIds = roaringDocIds(backendDir, config);
+
+    // List terms as (ordinal, tf), ascending
+    std::vector<std::string> extraIds;
+    std::unordered_map<std::string, uint32_t> extraOrdinals;
+    std::vector<std::vector<std::pair<uint32_t, int>>> lists(n);
+    for (std::size_t i = 0; i < n; i++) {
+        if (bitmapSlot[i] >= 0) continue;
+        const auto& ordinals = roaringOrdinals(backendDir, config);
+        for (const auto& posting : allPostings[i]) {
+            auto it = ordinals.find(posting.docId);
+            if (it != ordinals.end()) {
+                lists[i].push_back({it->second, posting.tf});
+            } else if (mode == OR_MODE) {
+                // In no bitmap term, so it cannot match an AND query
+                auto [extra, inserted] = extraOrdinals.emplace(
+                    posting.docId, static_cast<uint32_t>(docIds.size() + extraIds.size()));
+                if (inserted) extraIds.push_back(posting.docId);
+                lists[i].push_back({extra->second, posting.tf});
+            }
+        }
+        std::sort(lists[i].begin(), lists[i].end());
+    }
+
+    auto listBitmap = [&](std::size_t i) {
+        std::vector<uint32_t> members;
+        members.reserve(lists[i].size());
+        for (const auto& entry : lists[i]) {
+            if (members.empty() || members.back() != entry.first) members.push_back(entry.first);
+        }
+        return roaring::Bitmap::fromSorted(members);
+    };
+
+    // Candidate documents
+    roaring::Bitmap candidates;
+    if (mode == AND_MODE) {
+        std::vector<const roaring::Bitmap*> order;
+        for (const auto& bt : bitmapTerms) order.push_back(&bt.docs);
+        std::sort(order.begin(), order.end(), [](const roaring::Bitmap* a, const roaring::Bitmap* b) {
+            return a->cardinality() < b->cardinality();
+        });
+        candidates = *order[0];
+        for (std::size_t j = 1; j < order.size(); j++) {
+            candidates = roaring::intersect(candidates, *order[j]);
+        }
+        for (std::size_t i = 0; i < n; i++) {
+            if (bitmapSlot[i] < 0) candidates = roaring::intersect(candidates, listBitmap(i));
+        }
+    } else {
+        for (const auto& bt : bitmapTerms) candidates = roaring::unite(candidates, bt.docs);
+        for (std::size_t i = 0; i < n; i++) {
+            if (bitmapSlot[i] < 0) candidates = roaring::unite(candidates, listBitmap(i));
+        }
+    }
+
+    // Score the candidates in ordinal order
+    std::vector<roaring::RankCursor> cursors;
+    for (const auto& bt : bitmapTerms) cursors.emplace_back(bt.docs);
+    std::vector<std::size_t> listPos(n, 0);
+
+    std::vector<QueryResult> results;
+    results.reserve(candidates.cardinality());
+    candidates.forEach([&](uint32_t ordinal) {
+        QueryResult result;
+        result.docId = ordinal < docIds.size() ? docIds[ordinal] : extraIds[ordinal - docIds.size()];
+        if (ordinal < docIds.size() && !passesFilter(result.docId.c_str())) return;
+        countFacets(result.docId.c_str());
+        result.totalScore = 0.0;
+        result.matchedTerms = 0;
+        result.termFreqs.assign(n, 0);
+
+        for (std::size_t i = 0; i < n; i++) {
+            int tf = 0;
+            if (bitmapSlot[i] >= 0) {
+                uint64_t rank;
+                g_postingsTouched++;
+                if (cursors[bitmapSlot[i]].seek(ordinal, rank)) {
+                    tf = bitmapTerms[bitmapSlot[i]].tfs[rank];
+                }
+            } else {
+                const auto& list = lists[i];
+                std::size_t& pos = listPos[i];
+                while (pos < list.size() && list[pos].first < ordinal) pos++;
+                if (pos < list.size() && list[pos].first == ordinal) tf = list[pos].second;
+            }
+            if (tf > 0) {
+                result.totalScore += calculateBM25(tf, dfs[i], AVG_DOC_LENGTH);
+                result.matchedTerms++;
+                result.termFreqs[i] = tf;
+            }
+        }
+        results.push_back(std::move(result));
+    });
+    return results;
+}
+
 std::vector<QueryResult> processMultiWordQuery(
     const fs::path& backendDir,
     const json& config,
     const std::vector<std::string>& queryWords,
     QueryMode mode,
+    const QueryOptions& opts,
     std::vector<int>& lemmaIds,
     std::vector<int>& dfs
 ) {
     // Get postings for each word
     std::vector<std::vector<DocPosting>> allPostings;
+    std::vector<int> bitmapSlot;  // per term: index into bitmapTerms, or -1
+    std::vector<BitmapTerm> bitmapTerms;
     lemmaIds.clear();
     dfs.clear();
 
+    std::vector<std::string> words;
+    std::vector<int> wordLemmas;
     for (const auto& word : queryWords) {
         int lemmaId;
         if (!getLemmaIdForWord(word, lemmaId)) {
             std::cout << "  Word '" << word << "': not found in lexicon" << std::endl;
             continue;
         }
+        words.push_back(word);
+        wordLemmas.push_back(lemmaId);
+    }
+
+    // An AND query only needs the documents of a pair that have both terms,
+    // so a pair list stands in for both of its terms' full lists
+    std::vector<std::vector<DocPosting>> pairPostings(words.size());
+    std::vector<int> pairDf(words.size(), 0);
+    std::vector<bool> fromPair(words.size(), false);
+    if (mode == AND_MODE && opts.usePairs) {
+        for (const auto& [i, j] : planPairs(wordLemmas)) {
+            if (readPairList(backendDir, config, wordLemmas[i], wordLemmas[j],
+                             pairPostings[i], pairPostings[j], pairDf[i], pairDf[j])) {
+                std::cout << "  Pair '" << words[i] << " " << words[j] << "': "
+                          << pairPostings[i].size() << " documents in the pair barrel" << std::endl;
+                fromPair[i] = fromPair[j] = true;
+            }
+        }
+    }
+
+    for (std::size_t w = 0; w < words.size(); w++) {
+        const std::string& word = words[w];
+        int lemmaId = wordLemmas[w];
+
+        if (fromPair[w]) {
+            std::cout << "  Word '" << word << "': lemmaId=" << lemmaId
+                      << ", df=" << pairDf[w] << " (pair list)" << std::endl;
+            lemmaIds.push_back(lemmaId);
+            dfs.push_back(pairDf[w]);
+            allPostings.push_back(std::move(pairPostings[w]));
+            bitmapSlot.push_back(-1);
+            continue;
+        }
+
+        // Dense terms come as bitmaps, unless new documents added postings
+        BitmapTerm bitmapTerm;
+        if (opts.useRoaring && !inNewDocsBarrel(lemmaId) && readBitmapTerm(backendDir, config, lemmaId, bitmapTerm)) {
+            auto it = g_cache.barrelLookup.find(lemmaId);
+            std::cout << "  Word '" << word << "': lemmaId=" << lemmaId
+                      << ", df=" << bitmapTerm.df << ", barrel="
+                      << (it != g_cache.barrelLookup.end() ? it->second : -1) << " (roaring bitmap)" << std::endl;
+
+            lemmaIds.push_back(lemmaId);
+            dfs.push_back(bitmapTerm.df);
+            allPostings.emplace_back();
+            bitmapSlot.push_back(static_cast<int>(bitmapTerms.size()));
+            bitmapTerms.push_back(std::move(bitmapTerm));
+            continue;
+        }
 
         std::vector<DocPosting> postings;
         int df, barrelId;
@@ -535,55 +1061,826 @@ std::vector<QueryResult> processMultiWordQuery(
         lemmaIds.push_back(lemmaId);
         dfs.push_back(df);
         allPostings.push_back(postings);
+        bitmapSlot.push_back(-1);
     }
 
     if (allPostings.empty()) {
         return {};
     }
 
-    // Build document -> scores map
-    std::unordered_map<std::string, QueryResult> docScores;
-
-    for (size_t i = 0; i < allPostings.size(); i++) {
-        int df = dfs[i];
+    std::vector<QueryResult> results;
+    if (!bitmapTerms.empty()) {
+        results = processBitmapQuery(backendDir, config, mode, allPostings, bitmapSlot, bitmapTerms, dfs);
+        sortResults(results);
+        return results;
+    }
 
+    // Documents as roaring ordinals when the roaring index exists, numbered
+    // after it in order of appearance otherwise
+    const std::vector<std::string>* knownIds = nullptr;
+    const std::unordered_map<std::string, uint32_t>* ordinals = nullptr;
+    if (!g_cache.roaringIndex.empty()) {
+        knownIds = &roaringDocIds(backendDir, config);
+        ordinals = &roaringOrdinals(backendDir, config);
+    }
+    const uint32_t numKnown = knownIds ? static_cast<uint32_t>(knownIds->size()) : 0;
+    std::vector<std::string> extraIds;
+    std::unordered_map<std::string, uint32_t> extraOrdinals;
+
+    const std::size_t n = allPostings.size();
+    std::vector<std::vector<uint32_t>> docs(n);
+    std::vector<std::vector<int32_t>> tfs(n), docLengths(n);
+    for (std::size_t i = 0; i < n; i++) {
+        bool uniform = true;
         for (const auto& posting : allPostings[i]) {
-            // Use BM25 instead of TF-IDF for better ranking
-            double bm25 = calculateBM25(posting.tf, df, posting.docLength);
+            uint32_t doc;
+            auto it = ordinals ? ordinals->find(posting.docId) : extraOrdinals.end();
+            if (ordinals && it != ordinals->end()) {
+                doc = it->second;
+            } else {
+                auto [extra, inserted] = extraOrdinals.emplace(
+                    posting.docId, static_cast<uint32_t>(numKnown + extraIds.size()));
+                if (inserted) extraIds.push_back(posting.docId);
+                doc = extra->second;
+            }
+            docs[i].push_back(doc);
+            tfs[i].push_back(posting.tf);
+            docLengths[i].push_back(posting.docLength);
+            uniform = uniform && posting.docLength == AVG_DOC_LENGTH;
+        }
+        if (uniform) docLengths[i].clear();
+    }
+
+    // Use BM25 instead of TF-IDF for better ranking: channel 0 sums the
+    // scores, channel 1 + i holds term i's tf
+    query_evaluator::Query query;
+    for (std::size_t i = 0; i < n; i++) {
+        query_evaluator::TermPostings term;
+        term.docs = docs[i].data();
+        term.tfs = tfs[i].data();
+        term.docLengths = docLengths[i].empty() ? nullptr : docLengths[i].data();
+        term.size = docs[i].size();
+        term.df = dfs[i];
+        term.tfChannel = static_cast<int32_t>(i + 1);
+        query.terms.push_back(term);
+    }
+    query.numDocs = numKnown + static_cast<uint32_t>(extraIds.size());
+    query.channels = static_cast<uint32_t>(n) + 1;
+    // Filter by query mode
+    query.requiredTerms = (mode == AND_MODE) ? static_cast<int>(n) : 1;
+
+    query_evaluator::Hits hits = query_evaluator::Dispatch<Bm25Scorer>::evaluate(
+        query, config.value("accumulator_dense_max_docs", accumulator::DEFAULT_DENSE_MAX_DOCS));
+    results.reserve(hits.size());
+    for (std::size_t h = 0; h < hits.size(); h++) {
+        QueryResult result;
+        result.docId = hits.docs[h] < numKnown ? (*knownIds)[hits.docs[h]] : extraIds[hits.docs[h] - numKnown];
+        result.totalScore = hits.value(h, 0);
+        result.matchedTerms = hits.matched[h];
+        result.termFreqs.resize(n);
+        for (std::size_t i = 0; i < n; i++) {
+            result.termFreqs[i] = static_cast<int>(hits.value(h, static_cast<uint32_t>(i + 1)));
+        }
+        countFacets(result.docId.c_str());
+        results.push_back(std::move(result));
+    }
+
+    sortResults(results);
+    return results;
+}
+
+// ---------------------- Tier-1 Query Processing ----------------------
+
+struct Tier1List {
+    int df = 0;                        // full-list document frequency
+    int cutTf = 0;                     // largest tf left out of tier 1 (0 = complete list)
+    std::vector<DocPosting> postings;  // highest tf first
+};
+
+bool readTier1List(const fs::path& backendDir, const json& config, int lemmaId, Tier1List& out) {
+    auto it = g_cache.tier1Index.find(lemmaId);
+    if (it == g_cache.tier1Index.end()) {
+        return false;
+    }
+
+    fs::path binPath = backendDir / config["indexes_dir"].get<std::string>() / "barrels_binary" / "tier1.bin";
+    std::ifstream binFile(binPath, std::ios::binary);
+    if (!binFile.is_open()) {
+        return false;
+    }
+    binFile.seekg(it->second.offset);
+
+    int32_t header[4];  // lemmaId, df, numKept, cutTf
+    binFile.read(reinterpret_cast<char*>(header), sizeof(header));
+    out.df = header[1];
+    out.cutTf = header[3];
+    g_postingsTouched += header[2];
+
+    out.postings.clear();
+    out.postings.reserve(header[2]);
+    for (int i = 0; i < header[2]; i++) {
+        char docIdBuf[DOC_ID_SIZE];
+        int32_t tf;
+
+        binFile.read(docIdBuf, DOC_ID_SIZE);
+        binFile.read(reinterpret_cast<char*>(&tf), sizeof(tf));
+        if (!passesFilter(docIdBuf)) continue;
+
+        DocPosting dp;
+        dp.docId = std::string(docIdBuf);
+        dp.tf = tf;
+        dp.docLength = AVG_DOC_LENGTH;
+        dp.score = 0.0;
+        out.postings.push_back(dp);
+    }
+    return static_cast<bool>(binFile);
+}
+
+// Largest BM25 contribution of any posting left out of a pruned list. All
+// postings score with the same docLength, so BM25 is monotone in tf and the
+// extremes sit at tf = 1 and tf = cutTf.
+double tier1Bound(const Tier1List& list) {
+    return std::max(calculateBM25(1, list.df, AVG_DOC_LENGTH),
+                    calculateBM25(list.cutTf, list.df, AVG_DOC_LENGTH));
+}
+
+// Answers a multi-word query from tier 1 alone when that provably gives the
+// same top-K as the full barrels. Documents seen in every pruned list they
+// could belong to have exact scores; anything else (partly seen, or not seen
+// at all) is bounded by its known score plus the pruned lists' bounds. The
+// answer is safe when the K-th exact score is at least every such bound.
+// Returns false (reasonOut says why) when the caller must use the full barrels.
+bool processMultiWordQueryTier1(
+    const fs::path& backendDir,
+    const json& config,
+    const std::vector<std::string>& queryWords,
+    QueryMode mode,
+    std::size_t topK,
+    std::vector<int>& lemmaIds,
+    std::vector<int>& dfs,
+    std::vector<QueryResult>& resultsOut,
+    std::string& reasonOut
+) {
+    std::vector<Tier1List> lists;
+    std::ostringstream log;
+    lemmaIds.clear();
+    dfs.clear();
+
+    for (const auto& word : queryWords) {
+        int lemmaId;
+        if (!getLemmaIdForWord(word, lemmaId)) {
+            log << "  Word '" << word << "': not found in lexicon\n";
+            continue;
+        }
+        if (inNewDocsBarrel(lemmaId)) {
+            reasonOut = "'" + word + "' has postings in new documents";
+            return false;
+        }
+
+        // Short lists are not in tier 1: read them whole from their barrel
+        Tier1List list;
+        if (!readTier1List(backendDir, config, lemmaId, list)) {
+            int barrelId;
+            if (!findPostings(backendDir, config, lemmaId, list.postings, list.df, barrelId)) {
+                log << "  Word '" << word << "': no postings found\n";
+                continue;
+            }
+            list.cutTf = 0;
+        }
 
-            auto& result = docScores[posting.docId];
+        log << "  Word '" << word << "': lemmaId=" << lemmaId << ", df=" << list.df
+            << ", tier 1=" << list.postings.size() << " postings\n";
+        lemmaIds.push_back(lemmaId);
+        dfs.push_back(list.df);
+        lists.push_back(std::move(list));
+    }
+
+    const std::size_t n = lists.size();
+    if (n > 64) {
+        reasonOut = "too many terms";
+        return false;
+    }
+
+    // docId -> (known score, bitmask of lists the doc was seen in)
+    std::unordered_map<std::string, std::pair<QueryResult, uint64_t>> seen;
+    for (std::size_t i = 0; i < n; i++) {
+        for (const auto& posting : lists[i].postings) {
+            auto& [result, mask] = seen[posting.docId];
             if (result.docId.empty()) {
                 result.docId = posting.docId;
                 result.totalScore = 0.0;
                 result.matchedTerms = 0;
-                result.termFreqs.resize(allPostings.size(), 0);
+                result.termFreqs.resize(n, 0);
             }
-
-            result.totalScore += bm25;
+            result.totalScore += calculateBM25(posting.tf, lists[i].df, posting.docLength);
             result.matchedTerms++;
             result.termFreqs[i] = posting.tf;
+            mask |= uint64_t(1) << i;
         }
     }
 
-    // Filter by query mode
+    uint64_t allMask = (n == 64) ? ~uint64_t(0) : ((uint64_t(1) << n) - 1);
+    uint64_t prunedMask = 0;
+    std::vector<double> bound(n, 0.0);
+    for (std::size_t i = 0; i < n; i++) {
+        if (lists[i].cutTf > 0) {
+            prunedMask |= uint64_t(1) << i;
+            // In OR mode a document may simply lack the term, contributing 0
+            bound[i] = (mode == AND_MODE) ? tier1Bound(lists[i]) : std::max(0.0, tier1Bound(lists[i]));
+        }
+    }
+
+    auto boundOf = [&](uint64_t missing) {
+        double b = 0.0;
+        for (std::size_t i = 0; i < n; i++) {
+            if (missing & (uint64_t(1) << i)) b += bound[i];
+        }
+        return b;
+    };
+
+    const double NONE = -std::numeric_limits<double>::infinity();
+    std::vector<QueryResult> exact;
+    double bestOpen = NONE;  // best possible score of any document not in `exact`
+
+    for (auto& [docId, entry] : seen) {
+        auto& [result, mask] = entry;
+        uint64_t missing = allMask & ~mask;
+        if ((missing & ~prunedMask) != 0 && mode == AND_MODE) {
+            continue;  // lacks a term whose list is complete: cannot match
+        }
+        if ((missing & prunedMask) == 0) {
+            exact.push_back(std::move(result));
+        } else {
+            bestOpen = std::max(bestOpen, result.totalScore + boundOf(missing & prunedMask));
+        }
+    }
+
+    // Documents in no tier-1 list at all
+    if (n > 0) {
+        if (mode == AND_MODE && prunedMask == allMask) {
+            bestOpen = std::max(bestOpen, boundOf(allMask));
+        } else if (mode == OR_MODE && prunedMask != 0) {
+            bestOpen = std::max(bestOpen, boundOf(prunedMask));
+        }
+    }
+
+    sortResults(exact);
+
+    if (exact.size() < topK && bestOpen != NONE) {
+        reasonOut = "only " + std::to_string(exact.size()) + " exact matches";
+        return false;
+    }
+    if (exact.size() >= topK && topK > 0 && bestOpen > exact[topK - 1].totalScore) {
+        reasonOut = "score bound not met";
+        return false;
+    }
+
+    std::cout << log.str();
+    resultsOut = std::move(exact);
+    return true;
+}
+
+// ---------------------- Planned Query Processing ----------------------
+
+// What the index files say about each query word, read from the cached .idx
+// entries without touching a posting. Words missing from the lexicon are
+// left out (every executor skips them too).
+std::vector<query_planner::TermInfo> describeTerms(const std::vector<std::string>& queryWords) {
+    std::vector<query_planner::TermInfo> terms;
+    for (const auto& word : queryWords) {
+        query_planner::TermInfo t;
+        t.word = word;
+        if (!getLemmaIdForWord(word, t.lemmaId)) continue;
+
+        auto barrelIt = g_cache.barrelLookup.find(t.lemmaId);
+        if (barrelIt != g_cache.barrelLookup.end()) {
+            auto& idx = g_cache.barrelIndices[barrelIt->second];
+            auto it = idx.find(t.lemmaId);
+            if (it != idx.end()) t.df = (it->second.length - 12) / POSTING_SIZE;
+        }
+        // A term first seen in an added document is looked up in barrel 10
+        // itself: it has new_docs postings too, and only there
+        bool onlyNewDocs = barrelIt != g_cache.barrelLookup.end() && barrelIt->second == 10;
+        t.newDocs = onlyNewDocs || inNewDocsBarrel(t.lemmaId);
+        if (t.newDocs && !onlyNewDocs) {
+            t.df += (g_cache.barrelIndices[10][t.lemmaId].length - 12) / POSTING_SIZE;
+        }
+        t.bitmap = !t.newDocs && g_cache.roaringIndex.count(t.lemmaId) > 0;
+        auto tier1It = g_cache.tier1Index.find(t.lemmaId);
+        if (tier1It != g_cache.tier1Index.end()) t.tier1Postings = (tier1It->second.length - 16) / POSTING_SIZE;
+        t.positiveIdf = 2 * t.df < TOTAL_DOCS;
+        terms.push_back(t);
+    }
+    return terms;
+}
+
+query_planner::Algorithm parseAlgorithm(const std::string& name, QueryMode mode) {
+    using query_planner::Algorithm;
+    if (name == "exhaustive") return Algorithm::Exhaustive;
+    if (name == "pairs") return Algorithm::PairLists;
+    if (name == "bitmap") return mode == AND_MODE ? Algorithm::BitmapAnd : Algorithm::BitmapOr;
+    if (name == "merge") return Algorithm::MergeGallop;
+    if (name == "wand") return Algorithm::Wand;
+    throw std::runtime_error("Unknown --algorithm '" + name + "' (exhaustive, pairs, bitmap, merge, wand)");
+}
+
+query_planner::Plan planQuery(const std::vector<query_planner::TermInfo>& terms, QueryMode mode,
+                              std::size_t topK, const QueryOptions& opts) {
+    std::vector<int> lemmaIds;
+    for (const auto& t : terms) lemmaIds.push_back(t.lemmaId);
+
+    std::vector<query_planner::PairInfo> pairs;
+    for (const auto& [i, j] : planPairs(lemmaIds)) {
+        const auto& entry = g_cache.pairIndex.at(pairKey(std::min(lemmaIds[i], lemmaIds[j]),
+                                                         std::max(lemmaIds[i], lemmaIds[j])));
+        pairs.push_back({i, j, (entry.length - 20) / (DOC_ID_SIZE + 12)});
+    }
+
+    query_planner::Constraints constraints;
+    constraints.tier1 = opts.useTier1 && !g_cache.tier1Index.empty();
+    constraints.bitmaps = opts.useRoaring;
+    constraints.pairs = opts.usePairs;
+    constraints.everyMatch = opts.everyMatch;
+    if (!opts.algorithm.empty()) {
+        constraints.forced = true;
+        constraints.force = parseAlgorithm(opts.algorithm, mode);
+    }
+    query_planner::Plan plan = query_planner::choose(terms, pairs, mode == AND_MODE, g_cache.layout, topK, constraints);
+    if (!plan.forcedNote.empty()) {
+        std::cerr << "Warning: --algorithm " << opts.algorithm << ": " << plan.forcedNote << ", running "
+                  << query_planner::algorithmName(plan.algorithm) << " instead" << std::endl;
+    }
+    return plan;
+}
+
+// A barrel list kept as its raw records, in doc ID order, so merges and
+// galloping searches compare doc IDs in place
+struct RawList {
+    int df = 0;
+    std::vector<char> records;
+
+    std::size_t size() const { return records.size() / POSTING_SIZE; }
+    const char* docId(std::size_t i) const { return records.data() + i * POSTING_SIZE; }
+    int tf(std::size_t i) const {
+        int32_t tf;
+        std::memcpy(&tf, docId(i) + DOC_ID_SIZE, sizeof(tf));
+        return tf;
+    }
+    std::string docIdString(std::size_t i) const {
+        const char* id = docId(i);
+        return std::string(id, std::find(id, id + DOC_ID_SIZE, '\0'));
+    }
+};
+
+// One barrel's records for lemmaId (barrel 10 = new_docs)
+bool readBarrelRecords(const fs::path& backendDir, const json& config, int barrelId, int lemmaId, RawList& out) {
+    auto& barrelIdx = g_cache.barrelIndices[barrelId];
+    auto entryIt = barrelIdx.find(lemmaId);
+    if (entryIt == barrelIdx.end()) {
+        return false;
+    }
+
+    std::string barrelFileName = (barrelId == 10) ? "barrel_new_docs.bin" : ("barrel_" + std::to_string(barrelId) + ".bin");
+    fs::path binPath = backendDir / config["indexes_dir"].get<std::string>() / "barrels_binary" / barrelFileName;
+    std::ifstream binFile(binPath, std::ios::binary);
+    if (!binFile.is_open()) {
+        return false;
+    }
+    binFile.seekg(entryIt->second.offset);
+
+    int32_t header[3];  // lemmaId, df, numDocs
+    binFile.read(reinterpret_cast<char*>(header), sizeof(header));
+    out.df = header[1];
+    out.records.resize(static_cast<std::size_t>(header[2]) * POSTING_SIZE);
+    binFile.read(out.records.data(), out.records.size());
+
+    // Drop filtered documents in place; the rest keep their doc ID order
+    if (g_filter.active()) {
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < out.size(); i++) {
+            if (!passesFilter(out.docId(i))) continue;
+            if (kept != i) std::memmove(&out.records[kept * POSTING_SIZE], out.docId(i), POSTING_SIZE);
+            kept++;
+        }
+        out.records.resize(kept * POSTING_SIZE);
+    }
+    return static_cast<bool>(binFile);
+}
+
+// Main-barrel list only: new_docs postings are not merged in, which is why
+// the planner never picks a sorted algorithm for a term with any (including
+// one only in barrel 10, which has no list here at all)
+bool readRawList(const fs::path& backendDir, const json& config, int lemmaId, RawList& out) {
+    auto it = g_cache.barrelLookup.find(lemmaId);
+    if (it == g_cache.barrelLookup.end() || it->second == 10) {
+        return false;
+    }
+    return readBarrelRecords(backendDir, config, it->second, lemmaId, out);
+}
+
+int compareDocIds(const char* a, const char* b) {
+    return std::memcmp(a, b, DOC_ID_SIZE);
+}
+
+// First position >= from whose doc ID is not below target: doubling steps
+// from `from`, then a binary search inside the last step
+std::size_t gallopTo(const RawList& list, std::size_t from, const char* target) {
+    const std::size_t n = list.size();
+    g_postingsTouched++;
+    if (from >= n || compareDocIds(list.docId(from), target) >= 0) {
+        return from;
+    }
+    std::size_t bound = 1;
+    while (from + bound < n && compareDocIds(list.docId(from + bound), target) < 0) {
+        g_postingsTouched++;
+        bound *= 2;
+    }
+    std::size_t lo = from + bound / 2 + 1, hi = std::min(from + bound, n);
+    while (lo < hi) {
+        std::size_t mid = lo + (hi - lo) / 2;
+        g_postingsTouched++;
+        if (compareDocIds(list.docId(mid), target) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Reads the raw lists of the planned terms; slotOut maps each term to its
+// list (-1 when it has none)
+std::vector<RawList> readPlannedLists(
+    const fs::path& backendDir,
+    const json& config,
+    const std::vector<query_planner::TermInfo>& terms,
+    std::vector<int>& slotOut,
+    std::vector<int>& lemmaIds,
+    std::vector<int>& dfs
+) {
+    std::vector<RawList> lists;
+    slotOut.assign(terms.size(), -1);
+    lemmaIds.clear();
+    dfs.clear();
+    for (std::size_t t = 0; t < terms.size(); t++) {
+        RawList list;
+        if (!readRawList(backendDir, config, terms[t].lemmaId, list)) {
+            std::cout << "  Word '" << terms[t].word << "': no postings found" << std::endl;
+            continue;
+        }
+        std::cout << "  Word '" << terms[t].word << "': lemmaId=" << terms[t].lemmaId
+                  << ", df=" << list.df << ", barrel=" << g_cache.barrelLookup[terms[t].lemmaId] << std::endl;
+        slotOut[t] = static_cast<int>(lists.size());
+        lemmaIds.push_back(terms[t].lemmaId);
+        dfs.push_back(list.df);
+        lists.push_back(std::move(list));
+    }
+    return lists;
+}
+
+// AND over doc-ID-ordered lists, in the plan's order: the rarest list gives
+// the candidates and each later list either merges with them or is galloped
+// into once per candidate. Returns every match, sorted.
+std::vector<QueryResult> processSortedAnd(
+    const fs::path& backendDir,
+    const json& config,
+    const std::vector<query_planner::TermInfo>& terms,
+    const query_planner::Plan& plan,
+    std::vector<int>& lemmaIds,
+    std::vector<int>& dfs
+) {
+    std::vector<int> slot;
+    std::vector<RawList> lists = readPlannedLists(backendDir, config, terms, slot, lemmaIds, dfs);
+    if (lists.empty()) {
+        return {};
+    }
+
+    // (list, how it joins the candidates), skipping terms without a list
+    std::vector<std::pair<int, query_planner::StepKind>> order;
+    for (std::size_t k = 0; k < plan.order.size(); k++) {
+        if (slot[plan.order[k]] < 0) continue;
+        order.push_back({slot[plan.order[k]], k > 0 ? plan.steps[k - 1].kind : query_planner::StepKind::Merge});
+    }
+
+    // pos[list][c] = where candidate c sits in that list
+    const std::size_t n = lists.size();
+    const RawList& lead = lists[order[0].first];
+    std::vector<std::vector<uint32_t>> pos(n);
+    std::size_t count = lead.size();
+    pos[order[0].first].resize(count);
+    for (std::size_t c = 0; c < count; c++) pos[order[0].first][c] = static_cast<uint32_t>(c);
+    g_postingsTouched += count;
+
+    for (std::size_t k = 1; k < order.size() && count > 0; k++) {
+        const auto [s, kind] = order[k];
+        const RawList& list = lists[s];
+        pos[s].resize(count);
+        std::size_t kept = 0, j = 0;
+        for (std::size_t c = 0; c < count; c++) {
+            const char* target = lead.docId(pos[order[0].first][c]);
+            if (kind == query_planner::StepKind::Gallop) {
+                j = gallopTo(list, j, target);
+            } else {
+                while (j < list.size() && compareDocIds(list.docId(j), target) < 0) {
+                    g_postingsTouched++;
+                    j++;
+                }
+            }
+            if (j < list.size() && compareDocIds(list.docId(j), target) == 0) {
+                for (std::size_t p = 0; p < k; p++) pos[order[p].first][kept] = pos[order[p].first][c];
+                pos[s][kept++] = static_cast<uint32_t>(j);
+            }
+        }
+        count = kept;
+    }
+
     std::vector<QueryResult> results;
-    int requiredTerms = (mode == AND_MODE) ? static_cast<int>(allPostings.size()) : 1;
+    results.reserve(count);
+    for (std::size_t c = 0; c < count; c++) {
+        QueryResult result;
+        result.docId = lead.docIdString(pos[order[0].first][c]);
+        countFacets(result.docId.c_str());
+        result.totalScore = 0.0;
+        result.matchedTerms = static_cast<int>(n);
+        result.termFreqs.assign(n, 0);
+        for (std::size_t s = 0; s < n; s++) {
+            int tf = lists[s].tf(pos[s][c]);
+            result.totalScore += calculateBM25(tf, dfs[s], AVG_DOC_LENGTH);
+            result.termFreqs[s] = tf;
+        }
+        results.push_back(std::move(result));
+    }
+    sortResults(results);
+    return results;
+}
 
-    for (auto& [docId, result] : docScores) {
-        if (result.matchedTerms >= requiredTerms) {
-            results.push_back(result);
+// BM25 saturates at idf * (k1 + 1) as tf grows (every document is scored
+// with the average length), so no posting of the term can score more
+double bm25UpperBound(int df) {
+    return std::log((static_cast<double>(TOTAL_DOCS - df) + 0.5) / (static_cast<double>(df) + 0.5)) * (BM25_K1 + 1.0);
+}
+
+// OR top-K with WAND: cursors are kept in doc ID order and a document is
+// only scored once the bounds of the cursors up to it could beat the K-th
+// best score so far; cursors before that pivot gallop straight to it. Needs
+// every idf positive (checked by the planner). Returns the top-K, sorted.
+std::vector<QueryResult> processWandOr(
+    const fs::path& backendDir,
+    const json& config,
+    const std::vector<query_planner::TermInfo>& terms,
+    std::size_t topK,
+    std::vector<int>& lemmaIds,
+    std::vector<int>& dfs
+) {
+    std::vector<int> slot;
+    std::vector<RawList> lists = readPlannedLists(backendDir, config, terms, slot, lemmaIds, dfs);
+    const std::size_t n = lists.size();
+
+    struct Cursor {
+        std::size_t list;
+        std::size_t pos;
+        double bound;
+    };
+    std::vector<Cursor> cursors;
+    for (std::size_t s = 0; s < n; s++) {
+        if (lists[s].size() > 0) cursors.push_back({s, 0, bm25UpperBound(dfs[s])});
+    }
+    auto docAt = [&](const Cursor& c) { return lists[c.list].docId(c.pos); };
+
+    // Min-heap on score holding the best topK documents
+    auto worse = [](const QueryResult& a, const QueryResult& b) { return a.totalScore > b.totalScore; };
+    std::vector<QueryResult> top;
+
+    while (!cursors.empty() && topK > 0) {
+        std::sort(cursors.begin(), cursors.end(),
+                  [&](const Cursor& a, const Cursor& b) { return compareDocIds(docAt(a), docAt(b)) < 0; });
+        double threshold = top.size() == topK ? top.front().totalScore : -std::numeric_limits<double>::infinity();
+
+        std::size_t pivot = cursors.size();
+        double reach = 0.0;
+        for (std::size_t i = 0; i < cursors.size(); i++) {
+            reach += cursors[i].bound;
+            if (reach > threshold) {
+                pivot = i;
+                break;
+            }
+        }
+        if (pivot == cursors.size()) {
+            break;  // no remaining document can enter the top-K
         }
+        const char* pivotDoc = docAt(cursors[pivot]);
+
+        if (compareDocIds(docAt(cursors[0]), pivotDoc) == 0) {
+            QueryResult result;
+            result.docId = lists[cursors[0].list].docIdString(cursors[0].pos);
+            result.totalScore = 0.0;
+            result.matchedTerms = 0;
+            result.termFreqs.assign(n, 0);
+            for (auto& c : cursors) {
+                if (compareDocIds(docAt(c), pivotDoc) != 0) break;
+                result.termFreqs[c.list] = lists[c.list].tf(c.pos);
+                result.matchedTerms++;
+                c.pos++;
+                g_postingsTouched++;
+            }
+            for (std::size_t s = 0; s < n; s++) {
+                if (result.termFreqs[s] > 0) result.totalScore += calculateBM25(result.termFreqs[s], dfs[s], AVG_DOC_LENGTH);
+            }
+            if (top.size() < topK) {
+                top.push_back(std::move(result));
+                std::push_heap(top.begin(), top.end(), worse);
+            } else if (result.totalScore > threshold) {
+                std::pop_heap(top.begin(), top.end(), worse);
+                top.back() = std::move(result);
+                std::push_heap(top.begin(), top.end(), worse);
+            }
+        } else {
+            for (std::size_t i = 0; i < pivot; i++) {
+                cursors[i].pos = gallopTo(lists[cursors[i].list], cursors[i].pos, pivotDoc);
+            }
+        }
+
+        cursors.erase(std::remove_if(cursors.begin(), cursors.end(),
+                                     [&](const Cursor& c) { return c.pos >= lists[c.list].size(); }),
+                      cursors.end());
     }
 
-    // Sort by score descending
-    std::sort(results.begin(), results.end(),
-              [](const QueryResult& a, const QueryResult& b) {
-                  if (std::abs(a.totalScore - b.totalScore) > 0.001) {
-                      return a.totalScore > b.totalScore;
-                  }
-                  return a.matchedTerms > b.matchedTerms;
-              });
+    sortResults(top);
+    return top;
+}
+
+// ---------------------- Forward Index Lookup ----------------------
+
+// A document's title/abstract/body lemma IDs from its forward-index line,
+// parsed on first request; nullptr if the line cannot be found
+const forward_index::Fields* forwardFields(const fs::path& backendDir, const json& config, const std::string& docId) {
+    auto cached = g_cache.forwardFields.find(docId);
+    if (cached != g_cache.forwardFields.end()) {
+        return &cached->second;
+    }
+    if (!g_cache.forward) {
+        fs::path indexesDir = backendDir / config["indexes_dir"].get<std::string>();
+        g_cache.forward = std::make_unique<forward_index::Reader>(
+            (indexesDir / config["forward_index_file"].get<std::string>()).string(),
+            (indexesDir / config.value("forward_offsets_file", "forward_index.offsets")).string());
+    }
+
+    forward_index::Fields fields;
+    if (!g_cache.forward->fields(docId, fields)) {
+        return nullptr;
+    }
+    return &(g_cache.forwardFields[docId] = std::move(fields));
+}
+
+// ---------------------- Boolean Query Processing ----------------------
+
+// The whole list of a term, new documents included, in doc ID order
+bool readTermList(const fs::path& backendDir, const json& config, int lemmaId, RawList& out) {
+    bool found = readRawList(backendDir, config, lemmaId, out);
+    std::size_t mainSize = found ? out.size() : 0;
+    bool resort = found && !g_cache.layout.sortedLists;
+
+    RawList added;
+    if (inNewDocsBarrel(lemmaId) && readBarrelRecords(backendDir, config, 10, lemmaId, added)) {
+        if (found) {
+            out.records.insert(out.records.end(), added.records.begin(), added.records.end());
+        } else {
+            out = std::move(added);
+            found = true;
+        }
+        resort = true;
+    }
+    if (!resort) {
+        return found;
+    }
+
+    // Stable, so a document in both barrels keeps its main-barrel posting
+    std::vector<std::size_t> order(out.size());
+    for (std::size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return compareDocIds(out.docId(a), out.docId(b)) < 0;
+    });
+    std::vector<char> sorted;
+    sorted.reserve(out.records.size());
+    for (std::size_t i : order) {
+        if (!sorted.empty() && compareDocIds(sorted.data() + sorted.size() - POSTING_SIZE, out.docId(i)) == 0) continue;
+        sorted.insert(sorted.end(), out.docId(i), out.docId(i) + POSTING_SIZE);
+    }
+    out.records.swap(sorted);
+    if (mainSize > 0) {
+        out.df += static_cast<int>(out.size() - mainSize);  // like findPostings
+    }
+    return found;
+}
+
+// Phrase and field conditions, checked on the forward-index line of each
+// document the leaf's term cursors agree on
+std::function<bool(const char*)> leafCheck(const fs::path& backendDir, const json& config,
+                                           const boolean_query::Node& leaf) {
+    using boolean_query::Field;
+    if (leaf.kind == boolean_query::Node::Term && leaf.field == Field::Any) {
+        return {};
+    }
+
+    std::vector<int> sequence;
+    for (const auto& word : leaf.words) {
+        int lemmaId = -1;
+        getLemmaIdForWord(word, lemmaId);
+        sequence.push_back(lemmaId);
+    }
+    Field field = leaf.field;
+
+    std::cout << "  " << (leaf.kind == boolean_query::Node::Phrase ? "Phrase \"" : "Term \"");
+    for (std::size_t i = 0; i < leaf.words.size(); i++) std::cout << (i ? " " : "") << leaf.words[i];
+    std::cout << "\" in " << boolean_query::fieldName(field) << std::endl;
+
+    return [&backendDir, &config, sequence, field](const char* id) {
+        const forward_index::Fields* fields = forwardFields(backendDir, config, std::string(id, std::find(id, id + DOC_ID_SIZE, '\0')));
+        if (fields == nullptr) return false;
+        auto has = [&](const std::vector<int>& text) {
+            return std::search(text.begin(), text.end(), sequence.begin(), sequence.end()) != text.end();
+        };
+        switch (field) {
+            case Field::Title:    return has(fields->title);
+            case Field::Abstract: return has(fields->abstract);
+            default:              return has(fields->title) || has(fields->abstract) || has(fields->body);
+        }
+    };
+}
+
+// Runs a query written in the boolean language (boolean_query.hpp). Terms
+// outside a NOT are scored, in query order (termWordsOut); every document
+// the cursor tree stops on is a match. Returns all matches, sorted.
+std::vector<QueryResult> processBooleanQuery(
+    const fs::path& backendDir,
+    const json& config,
+    const std::string& query,
+    std::vector<std::string>& termWordsOut,
+    std::vector<int>& lemmaIds
+) {
+    boolean_query::Parser parser(tokenize);
+    boolean_query::Node tree = parser.parse(query);
+
+    std::vector<std::unique_ptr<RawList>> lists;
+    std::unordered_map<int, const RawList*> byLemma;  // a repeated word shares one list
+    std::vector<int> dfs;  // per scored term
+    termWordsOut.clear();
+    lemmaIds.clear();
+
+    boolean_query::Compiler compiler;
+    compiler.termCursor = [&](const std::string& word, bool scored) -> boolean_query::CursorPtr {
+        int lemmaId;
+        const RawList* list = nullptr;
+        if (getLemmaIdForWord(word, lemmaId)) {
+            auto it = byLemma.find(lemmaId);
+            if (it == byLemma.end()) {
+                lists.push_back(std::make_unique<RawList>());
+                if (!readTermList(backendDir, config, lemmaId, *lists.back())) lists.back()->records.clear();
+                it = byLemma.emplace(lemmaId, lists.back().get()).first;
+            }
+            list = it->second;
+            std::cout << "  Word '" << word << "': lemmaId=" << lemmaId << ", df=" << list->df
+                      << (scored ? "" : " (excluded)") << std::endl;
+            if (scored) lemmaIds.push_back(lemmaId);
+        } else {
+            std::cout << "  Word '" << word << "': not found in lexicon" << std::endl;
+        }
+
+        int slot = -1;
+        if (scored) {
+            slot = static_cast<int>(termWordsOut.size());
+            termWordsOut.push_back(word);
+            dfs.push_back(list ? list->df : 0);
+        }
+        return std::make_unique<boolean_query::ListCursor>(list ? list->records.data() : nullptr,
+                                                           list ? list->size() : 0, slot);
+    };
+    compiler.check = [&](const boolean_query::Node& leaf) { return leafCheck(backendDir, config, leaf); };
+
+    boolean_query::CursorPtr cursor = compiler.compile(tree);
 
+    std::vector<QueryResult> results;
+    std::vector<int> tfs(termWordsOut.size());
+    for (; !cursor->atEnd(); cursor->next()) {
+        std::fill(tfs.begin(), tfs.end(), 0);
+        cursor->collect(tfs);
+
+        QueryResult result;
+        const char* id = cursor->doc();
+        result.docId = std::string(id, std::find(id, id + DOC_ID_SIZE, '\0'));
+        countFacets(id);
+        result.totalScore = 0.0;
+        result.matchedTerms = 0;
+        for (std::size_t s = 0; s < tfs.size(); s++) {
+            if (tfs[s] > 0) {
+                result.totalScore += calculateBM25(tfs[s], dfs[s], AVG_DOC_LENGTH);
+                result.matchedTerms++;
+            }
+        }
+        result.termFreqs = tfs;
+        results.push_back(std::move(result));
+    }
+    sortResults(results);
     return results;
 }
 
@@ -593,22 +1890,50 @@ std::vector<DocPosting> processSingleWordQuery(
     const fs::path& backendDir,
     const json& config,
     const std::string& word,
+    std::size_t topK,
+    bool useTier1,
     int& lemmaIdOut,
     int& dfOut,
-    int& barrelIdOut
+    int& barrelIdOut,
+    bool& fromTier1Out
 ) {
+    fromTier1Out = false;
     if (!getLemmaIdForWord(word, lemmaIdOut)) {
         return {};
     }
 
     std::vector<DocPosting> postings;
-    if (!findPostings(backendDir, config, lemmaIdOut, postings, dfOut, barrelIdOut)) {
+
+    // Tier 1 holds the highest-tf postings, which are the top BM25 scores
+    // unless the bound of the pruned tail says otherwise
+    Tier1List tier1;
+    if (useTier1 && !inNewDocsBarrel(lemmaIdOut) && readTier1List(backendDir, config, lemmaIdOut, tier1)) {
+        bool safe = tier1.cutTf == 0;
+        if (!safe && tier1.postings.size() >= topK && topK > 0) {
+            std::vector<double> scores;
+            for (const auto& p : tier1.postings) {
+                scores.push_back(calculateBM25(p.tf, tier1.df, p.docLength));
+            }
+            std::nth_element(scores.begin(), scores.begin() + (topK - 1), scores.end(), std::greater<double>());
+            safe = scores[topK - 1] >= tier1Bound(tier1);
+        }
+        if (safe) {
+            postings = std::move(tier1.postings);
+            dfOut = tier1.df;
+            auto it = g_cache.barrelLookup.find(lemmaIdOut);
+            barrelIdOut = (it != g_cache.barrelLookup.end()) ? it->second : -1;
+            fromTier1Out = true;
+        }
+    }
+
+    if (!fromTier1Out && !findPostings(backendDir, config, lemmaIdOut, postings, dfOut, barrelIdOut)) {
         return {};
     }
 
     // Calculate BM25 scores
     for (auto& p : postings) {
         p.score = calculateBM25(p.tf, dfOut, p.docLength);
+        countFacets(p.docId.c_str());
     }
 
     // Sort by BM25 score
@@ -622,6 +1947,48 @@ std::vector<DocPosting> processSingleWordQuery(
     return postings;
 }
 
+// ---------------------- Result Documents and Snippets ----------------------
+
+struct ResultDoc {
+    bool found = false;
+    doc_store::DocRecord rec;
+    std::string snippet;
+};
+
+// Post-ranking stage, run on the final top-K only: fetches each result's
+// record from the document store and cuts its query-biased snippet.
+// Documents missing from the store (new uploads) come back with found = false.
+// elapsedMsOut receives the stage's own wall time.
+std::vector<ResultDoc> loadResultDocs(const std::vector<std::string>& pmcIds,
+                                      const snippet::TermWeights& terms,
+                                      const snippet::Options& opts,
+                                      double& elapsedMsOut) {
+    auto start = high_resolution_clock::now();
+    std::vector<ResultDoc> docs(pmcIds.size());
+    elapsedMsOut = 0.0;
+    if (!g_cache.docStore) return docs;
+
+    for (size_t i = 0; i < pmcIds.size(); i++) {
+        uint32_t docId;
+        if (g_cache.docStore->findDocId(pmcIds[i], docId) && g_cache.docStore->get(docId, docs[i].rec)) {
+            docs[i].found = true;
+            docs[i].snippet = snippet::generate(docs[i].rec, terms, opts);
+        }
+    }
+
+    elapsedMsOut = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000.0;
+    return docs;
+}
+
+// Prints title/authors/abstract/snippet lines under a result line.
+void printResultDoc(const ResultDoc& doc) {
+    if (!doc.found) return;
+    doc_store::printRecord(std::cout, doc.rec);
+    if (!doc.snippet.empty()) {
+        std::cout << "   Snippet: " << doc.snippet << "\n";
+    }
+}
+
 // ---------------------- Main ----------------------
 
 // Helper to find backend directory from executable path
@@ -673,6 +2040,9 @@ int main(int argc, char* argv[]) {
         // Parse arguments
         std::string queryString;
         QueryMode mode = AND_MODE;
+        QueryOptions opts;
+        FilterSpec filterSpec;
+        FacetSpec facetSpec;
 
         if (argc >= 2) {
             queryString = argv[1];
@@ -683,6 +2053,30 @@ int main(int argc, char* argv[]) {
                     mode = OR_MODE;
                 } else if (arg == "--and" || arg == "-a") {
                     mode = AND_MODE;
+                } else if (arg == "--no-tier1") {
+                    opts.useTier1 = false;
+                } else if (arg == "--no-roaring") {
+                    opts.useRoaring = false;
+                } else if (arg == "--no-pairs") {
+                    opts.usePairs = false;
+                } else if (arg == "--explain") {
+                    opts.explain = true;
+                } else if (arg == "--algorithm" && i + 1 < argc) {
+                    opts.algorithm = argv[++i];
+                } else if (arg == "--year" && i + 1 < argc) {
+                    filterSpec.years.push_back(argv[++i]);
+                } else if (arg == "--journal" && i + 1 < argc) {
+                    filterSpec.journals.push_back(argv[++i]);
+                } else if (arg == "--license" && i + 1 < argc) {
+                    filterSpec.licenses.push_back(argv[++i]);
+                } else if (arg == "--facets" && i + 1 < argc) {
+                    std::stringstream names(argv[++i]);
+                    std::string name;
+                    while (std::getline(names, name, ',')) {
+                        if (!name.empty()) facetSpec.names.push_back(name);
+                    }
+                } else if (arg == "--facet-sample" && i + 1 < argc) {
+                    facetSpec.sampleRate = std::stod(argv[++i]);
                 }
             }
         } else {
@@ -703,6 +2097,8 @@ int main(int argc, char* argv[]) {
         json config = loadConfig(backendDir);
 
         initializeCache(backendDir, config);
+        buildFilter(backendDir, config, filterSpec);
+        opts.everyMatch = !facetSpec.names.empty();
 
         // Tokenize query
         std::vector<std::string> queryWords = tokenize(queryString);
@@ -716,15 +2112,26 @@ int main(int argc, char* argv[]) {
 
         // Process query
         const std::size_t TOP_K = 20;
+        const std::size_t FACET_VALUES = config.value("facet_top_values", 10);
+        snippet::Options snippetOpts = snippet::optionsFromConfig(config);
+        double snippetMs = 0.0;
+        std::size_t snippetDocs = 0;
 
-        if (queryWords.size() == 1) {
+        bool booleanQuery = boolean_query::Parser::hasOperators(queryString);
+
+        if (!booleanQuery && queryWords.size() == 1) {
             // Single-word query
             std::string word = queryWords[0];
             int lemmaId, df, barrelId;
 
             std::cout << "Query: '" << word << "' (single-word mode)\n" << std::endl;
 
-            auto results = processSingleWordQuery(backendDir, config, word, lemmaId, df, barrelId);
+            auto terms = describeTerms({word});
+            startFacets(backendDir, config, facetSpec, terms.empty() ? 0.0 : static_cast<double>(terms[0].df));
+
+            bool fromTier1 = false;
+            auto results = processSingleWordQuery(backendDir, config, word, TOP_K, opts.useTier1 && !opts.everyMatch,
+                                                  lemmaId, df, barrelId, fromTier1);
 
             if (results.empty()) {
                 std::cout << "No results found for '" << word << "'.\n";
@@ -732,8 +2139,13 @@ int main(int argc, char* argv[]) {
             }
 
             std::cout << "Lemma ID: " << lemmaId << std::endl;
-            std::cout << "Barrel: " << barrelId << std::endl;
+            std::cout << "Barrel: " << barrelId << (fromTier1 ? " (answered from tier 1)" : "") << std::endl;
             std::cout << "Document frequency (df): " << df << std::endl;
+            if (opts.explain) {
+                int64_t estimated = fromTier1 ? terms[0].tier1Postings : terms[0].df;
+                std::cout << "[Explain: " << (fromTier1 ? "tier-1 list" : "full list") << ", estimated "
+                          << estimated << " postings touched, actual " << g_postingsTouched << "]" << std::endl;
+            }
 
             auto searchEnd = high_resolution_clock::now();
             auto searchTime = duration_cast<milliseconds>(searchEnd - searchStart).count();
@@ -741,40 +2153,122 @@ int main(int argc, char* argv[]) {
             std::cout << "\nTop " << std::min(TOP_K, results.size())
                       << " results for '" << word << "' (in " << searchTime << "ms):\n" << std::endl;
 
+            std::vector<std::string> topIds;
             for (size_t i = 0; i < std::min(TOP_K, results.size()); i++) {
+                topIds.push_back(results[i].docId);
+            }
+            auto docs = loadResultDocs(topIds, {{lemmaId, 1.0f}}, snippetOpts, snippetMs);
+            snippetDocs = docs.size();
+
+            for (size_t i = 0; i < docs.size(); i++) {
                 std::cout << (i + 1) << ". DocID: " << results[i].docId
                           << " | tf: " << results[i].tf
                           << " | BM25: " << results[i].score << std::endl;
+                printResultDoc(docs[i]);
             }
+            printFacets(FACET_VALUES);
 
         } else {
-            // Multi-word query
-            std::cout << "Query: '" << queryString << "' ("
-                      << (mode == AND_MODE ? "AND" : "OR") << " mode)\n" << std::endl;
-
-            std::cout << "Processing " << queryWords.size() << " words:" << std::endl;
-
+            // Multi-word query: a word list under --and/--or, or the boolean language
             std::vector<int> lemmaIds, dfs;
-            auto results = processMultiWordQuery(backendDir, config, queryWords, mode, lemmaIds, dfs);
+            std::vector<QueryResult> results;
+            bool partial = false;  // results are a proven top-K, not every match
+            std::size_t numTerms = queryWords.size();
+
+            if (booleanQuery) {
+                std::cout << "Query: '" << queryString << "' (boolean mode)\n" << std::endl;
+                std::cout << "Processing terms:" << std::endl;
+
+                // No estimate of the matches: counted in full unless --facet-sample
+                startFacets(backendDir, config, facetSpec, 0.0);
+
+                std::vector<std::string> termWords;
+                try {
+                    results = processBooleanQuery(backendDir, config, queryString, termWords, lemmaIds);
+                } catch (const boolean_query::ParseError& e) {
+                    std::cerr << "Query error: " << e.what() << "\n";
+                    return 1;
+                }
+                numTerms = termWords.size();
+            } else {
+                std::cout << "Query: '" << queryString << "' ("
+                          << (mode == AND_MODE ? "AND" : "OR") << " mode)\n" << std::endl;
+
+                auto planTerms = describeTerms(queryWords);
+                query_planner::Plan plan = planQuery(planTerms, mode, TOP_K, opts);
+                if (opts.explain) {
+                    query_planner::explain(std::cout, plan, planTerms);
+                    std::cout << std::endl;
+                }
+                startFacets(backendDir, config, facetSpec, plan.estimatedMatches);
+
+                std::cout << "Processing " << queryWords.size() << " words:" << std::endl;
+
+                std::string tier1Reason;
+                bool fromTier1 = plan.tryTier1 &&
+                                 processMultiWordQueryTier1(backendDir, config, queryWords, mode, TOP_K,
+                                                            lemmaIds, dfs, results, tier1Reason);
+                partial = fromTier1;
+                if (!fromTier1) {
+                    using query_planner::Algorithm;
+                    if (plan.algorithm == Algorithm::MergeGallop) {
+                        results = processSortedAnd(backendDir, config, planTerms, plan, lemmaIds, dfs);
+                    } else if (plan.algorithm == Algorithm::Wand) {
+                        results = processWandOr(backendDir, config, planTerms, TOP_K, lemmaIds, dfs);
+                        partial = true;
+                    } else {
+                        QueryOptions run = opts;
+                        run.usePairs = plan.algorithm == Algorithm::PairLists;
+                        run.useRoaring = opts.useRoaring && plan.algorithm != Algorithm::Exhaustive;
+                        results = processMultiWordQuery(backendDir, config, queryWords, mode, run, lemmaIds, dfs);
+                    }
+                }
+                if (!g_cache.tier1Index.empty()) {
+                    std::cout << "[Tier 1: " << (fromTier1       ? "answered, full barrels skipped"
+                                                 : plan.tryTier1 ? "fell back to full barrels (" + tier1Reason + ")"
+                                                                 : "not tried (" + plan.tier1Note + ")")
+                              << "]" << std::endl;
+                }
+                if (opts.explain) {
+                    std::cout << "[Explain: " << (fromTier1 ? "tier 1" : query_planner::algorithmName(plan.algorithm))
+                              << ", estimated " << static_cast<int64_t>(fromTier1 ? plan.tier1Estimated : plan.estimated)
+                              << " postings touched, actual " << g_postingsTouched << "]" << std::endl;
+                }
+            }
 
             auto searchEnd = high_resolution_clock::now();
             auto searchTime = duration_cast<milliseconds>(searchEnd - searchStart).count();
 
             if (results.empty()) {
-                std::cout << "\nNo documents found matching "
-                          << (mode == AND_MODE ? "ALL" : "ANY") << " query terms.\n";
+                if (booleanQuery) {
+                    std::cout << "\nNo documents found matching the query.\n";
+                } else {
+                    std::cout << "\nNo documents found matching "
+                              << (mode == AND_MODE ? "ALL" : "ANY") << " query terms.\n";
+                }
                 return 0;
             }
 
-            std::cout << "\nFound " << results.size() << " matching documents" << std::endl;
+            std::cout << "\nFound " << results.size() << (partial ? "+" : "") << " matching documents" << std::endl;
             std::cout << "\nTop " << std::min(TOP_K, results.size())
                       << " results (in " << searchTime << "ms):\n" << std::endl;
 
+            std::vector<std::string> topIds;
             for (size_t i = 0; i < std::min(TOP_K, results.size()); i++) {
+                topIds.push_back(results[i].docId);
+            }
+            snippet::TermWeights terms;
+            for (int id : lemmaIds) {
+                terms[id] = 1.0f;
+            }
+            auto docs = loadResultDocs(topIds, terms, snippetOpts, snippetMs);
+            snippetDocs = docs.size();
+
+            for (size_t i = 0; i < docs.size(); i++) {
                 const auto& r = results[i];
                 std::cout << (i + 1) << ". DocID: " << r.docId
                           << " | Score: " << r.totalScore
-                          << " | Matched: " << r.matchedTerms << "/" << queryWords.size();
+                          << " | Matched: " << r.matchedTerms << "/" << numTerms;
 
                 // Show TF for each term
                 std::cout << " | TFs: [";
@@ -783,13 +2277,16 @@ int main(int argc, char* argv[]) {
                     std::cout << r.termFreqs[j];
                 }
                 std::cout << "]" << std::endl;
+                printResultDoc(docs[i]);
             }
+            printFacets(FACET_VALUES);
         }
 
         auto totalEnd = high_resolution_clock::now();
         auto totalTime = duration_cast<milliseconds>(totalEnd - totalStart).count();
 
-        std::cout << "\n[Total time: " << totalTime << "ms]" << std::endl;
+        std::cout << "\n[Snippet stage: " << snippetDocs << " docs, " << snippetMs << "ms]" << std::endl;
+        std::cout << "[Total time: " << totalTime << "ms]" << std::endl;
 
     } catch (const std::exception& e) {
         std::cerr << "Fatal error: " << e.what() << "\n";
@@ -0,0 +1,580 @@
+/*
+ * Search Coordinator (scatter-gather over document-partitioned shards)
+ *
+ * Resolves the query to lemma IDs, attaches each term's corpus-wide df,
+ * sends the same SEARCH request to every shardServer in parallel and merges
+ * the per-shard top-K lists into the global top-K.
+ *
+ * Because every shard scores with the global N/df/avgdl (see shard_index.hpp),
+ * the merged list is the same ranking a single BM25 index over the whole
+ * corpus would return.
+ *
+ * Each shard can have several replicas. Requests go to the replica with the
+ * fewest outstanding requests; if it has not answered after the shard's
+ * recent p95 latency, a hedged copy goes to a second replica and the first
+ * answer wins (see shard_client.hpp). A shard with no answer by
+ * shard_timeout_ms is left out and the result is flagged incomplete.
+ *
+ * Shard routing (see shard_cluster.hpp): with topical (k-means) shards the
+ * query only goes to the route_shards best shards by the selection index
+ * ("df" collection statistics or "centroid" similarity). Any partitioning
+ * skips shards where an AND term has no postings, since they cannot match.
+ *
+ * Usage:
+ *   ./build/searchCoordinator "covid vaccine"                 # AND mode
+ *   ./build/searchCoordinator "covid vaccine" --or
+ *   ./build/searchCoordinator "covid vaccine" --shards 10.0.0.1:7100|10.0.0.2:7100,10.0.0.3:7101
+ *   ./build/searchCoordinator "covid vaccine" --bench 500 --concurrency 8 [--no-hedge]
+ *   ./build/searchCoordinator "covid vaccine" --route 3 --recall   # 0 = all shards
+ *
+ * Shard endpoints come from --shards (',' between shards, '|' between
+ * replicas), else config "shard_servers", else local ports
+ * shard_base_port + replica * shard_replica_port_stride + shard.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <queue>
+#include <atomic>
+#include <mutex>
+
+#include "config.hpp"
+#include "tokenizer.hpp"
+#include "lexicon.hpp"
+#include "doc_store.hpp"
+#include "snippet.hpp"
+#include "net.hpp"
+#include "shard_index.hpp"
+#include "shard_protocol.hpp"
+#include "shard_client.hpp"
+#include "shard_cluster.hpp"
+
+using namespace std::chrono;
+
+// ---------------------- Scatter ----------------------
+
+// Sends the request to every shard in parallel (each through its replica
+// group, hedged) and waits for all of them, at most until the deadline.
+std::vector<shard_client::ShardOutcome> scatter(const std::vector<std::shared_ptr<shard_client::ShardGroup>>& groups,
+                                                const std::string& request,
+                                                net::Clock::time_point deadline,
+                                                const shard_client::HedgePolicy& policy) {
+    std::vector<shard_client::ShardOutcome> outcomes(groups.size());
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < groups.size(); i++) {
+        workers.emplace_back([&, i]() {
+            outcomes[i] = shard_client::query(groups[i], request, deadline, policy);
+        });
+    }
+    for (auto& t : workers) {
+        t.join();
+    }
+    return outcomes;
+}
+
+// ---------------------- Merge ----------------------
+
+bool betterHit(const shard_protocol::Hit& a, const shard_protocol::Hit& b) {
+    if (a.score != b.score) return a.score > b.score;
+    return a.docId < b.docId;
+}
+
+// k-way merge of the shards' sorted top-K lists: a heap holds the head of
+// each list, so only the k winners are ever popped.
+std::vector<shard_protocol::Hit> mergeTopK(std::vector<std::vector<shard_protocol::Hit>>& lists, std::size_t k) {
+    using Head = std::pair<std::size_t, std::size_t>;  // (list, position)
+    auto worse = [&](const Head& a, const Head& b) {
+        return betterHit(lists[b.first][b.second], lists[a.first][a.second]);
+    };
+    std::priority_queue<Head, std::vector<Head>, decltype(worse)> heap(worse);
+    for (std::size_t i = 0; i < lists.size(); i++) {
+        if (!lists[i].empty()) heap.push({i, 0});
+    }
+
+    std::vector<shard_protocol::Hit> merged;
+    while (!heap.empty() && merged.size() < k) {
+        auto [list, pos] = heap.top();
+        heap.pop();
+        merged.push_back(std::move(lists[list][pos]));
+        if (pos + 1 < lists[list].size()) heap.push({list, pos + 1});
+    }
+    return merged;
+}
+
+// ---------------------- Setup ----------------------
+
+// Same lookup as search.cpp: backend/cpp/build/<exe> -> backend/
+fs::path findBackendDir(const char* argv0) {
+    fs::path exePath;
+    try {
+        if (fs::exists("/proc/self/exe")) {
+            exePath = fs::canonical("/proc/self/exe").parent_path();
+        } else {
+            exePath = fs::canonical(argv0).parent_path();
+        }
+    } catch (...) {
+        exePath = fs::current_path();
+    }
+
+    for (const fs::path& candidate : {exePath.parent_path().parent_path(),
+                                      fs::current_path().parent_path().parent_path(),
+                                      fs::current_path().parent_path(),
+                                      fs::current_path()}) {
+        if (fs::exists(candidate / "config.json")) {
+            return candidate;
+        }
+    }
+    throw std::runtime_error("Cannot find config.json. Run from backend/cpp/build/ or set correct path.");
+}
+
+void loadLemmaTable(const fs::path& indexesDir, const json& config, LemmaTable& table) {
+    if (loadLemmaTableBinary((indexesDir / "embeddings" / "lexicon.bin").string(), table)) {
+        return;
+    }
+    fs::path lexiconPath = indexesDir / config["lexicon_file"].get<std::string>();
+    std::ifstream lexFile(lexiconPath);
+    if (!lexFile.is_open()) {
+        throw std::runtime_error("Cannot open lexicon at " + lexiconPath.string());
+    }
+    json lexicon;
+    lexFile >> lexicon;
+    loadLemmaTableJSON(lexicon, table);
+}
+
+std::vector<std::string> split(const std::string& list, char sep) {
+    std::vector<std::string> out;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, sep)) {
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+// Replica endpoints per shard. From --shards ("a|b,c|d": shards split by ',',
+// replicas by '|'), else config "shard_servers" (same strings, or arrays),
+// else local ports shard_base_port + replica * shard_replica_port_stride + shard.
+std::vector<std::vector<std::string>> resolveShardGroups(const std::string& cliList, const json& config, int numShards) {
+    std::vector<std::vector<std::string>> groups;
+    if (!cliList.empty()) {
+        for (const auto& shard : split(cliList, ',')) {
+            groups.push_back(split(shard, '|'));
+        }
+        return groups;
+    }
+    if (config.contains("shard_servers") && !config["shard_servers"].empty()) {
+        for (const auto& shard : config["shard_servers"]) {
+            groups.push_back(shard.is_array() ? shard.get<std::vector<std::string>>()
+                                              : split(shard.get<std::string>(), '|'));
+        }
+        return groups;
+    }
+
+    int basePort = config.value("shard_base_port", 7100);
+    int replicas = std::max(1, config.value("shard_replicas", 1));
+    int stride = config.value("shard_replica_port_stride", 100);
+    for (int k = 0; k < numShards; k++) {
+        std::vector<std::string> group;
+        for (int r = 0; r < replicas; r++) {
+            group.push_back("127.0.0.1:" + std::to_string(basePort + r * stride + k));
+        }
+        groups.push_back(group);
+    }
+    return groups;
+}
+
+// ---------------------- Benchmark ----------------------
+
+// Replays one query `total` times from `concurrency` client threads against
+// the same replica groups, so the latency windows fill up and hedging and
+// replica selection behave as they would under steady traffic.
+void runBenchmark(const std::vector<std::shared_ptr<shard_client::ShardGroup>>& groups,
+                  const std::vector<int>& shardIds,
+                  const std::string& request, int timeoutMs, const shard_client::HedgePolicy& policy,
+                  int total, int concurrency) {
+    std::mutex statsMutex;
+    std::vector<double> latencies;
+    int partial = 0, hedges = 0, hedgeWins = 0, shardTimeouts = 0;
+    int64_t postingsScanned = 0;
+    std::atomic<int> nextQuery{0};
+
+    auto worker = [&]() {
+        while (nextQuery.fetch_add(1) < total) {
+            auto start = net::Clock::now();
+            auto outcomes = scatter(groups, request, start + milliseconds(timeoutMs), policy);
+            double ms = duration_cast<microseconds>(net::Clock::now() - start).count() / 1000.0;
+
+            std::lock_guard<std::mutex> lock(statsMutex);
+            latencies.push_back(ms);
+            bool complete = true;
+            for (const auto& o : outcomes) {
+                complete = complete && o.response.ok;
+                hedges += o.hedged;
+                hedgeWins += o.hedgeWon;
+                shardTimeouts += o.timedOut;
+                postingsScanned += o.response.postingsScanned;
+            }
+            partial += !complete;
+        }
+    };
+
+    std::vector<std::thread> clients;
+    for (int c = 0; c < std::max(1, concurrency); c++) {
+        clients.emplace_back(worker);
+    }
+    for (auto& t : clients) {
+        t.join();
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto pct = [&](double p) {
+        return latencies[std::min(latencies.size() - 1, static_cast<std::size_t>(p * latencies.size()))];
+    };
+
+    std::cout << "\nBenchmark: " << total << " queries, " << concurrency << " clients, hedging "
+              << (policy.enabled ? "on" : "off") << std::endl;
+    std::cout << "  Latency p50: " << pct(0.50) << "ms  p95: " << pct(0.95)
+              << "ms  p99: " << pct(0.99) << "ms  max: " << latencies.back() << "ms" << std::endl;
+    std::cout << "  Hedged shard requests: " << hedges << " (won " << hedgeWins << ")" << std::endl;
+    std::cout << "  Partial answers: " << partial << " (" << shardTimeouts << " shard deadlines hit)" << std::endl;
+    std::cout << "  Shards per query: " << groups.size() << ", postings scanned per query: "
+              << postingsScanned / std::max(1, total) << std::endl;
+
+    std::cout << "\nReplicas:" << std::endl;
+    for (std::size_t k = 0; k < groups.size(); k++) {
+        for (std::size_t r = 0; r < groups[k]->size(); r++) {
+            auto& rep = groups[k]->replica(r);
+            std::cout << "  shard " << shardIds[k] << " " << rep.endpoint << ": " << rep.requests.load()
+                      << " requests, " << rep.failures.load() << " failed" << std::endl;
+        }
+        std::cout << "  shard " << shardIds[k] << " p95: "
+                  << groups[k]->latency.percentile(policy.percentile, 1, 0.0) << "ms" << std::endl;
+    }
+}
+
+// ---------------------- Main ----------------------
+
+int main(int argc, char* argv[]) {
+    try {
+        auto totalStart = high_resolution_clock::now();
+
+        std::string queryString;
+        std::string shardList;
+        bool andMode = true;
+        bool hedging = true;
+        std::size_t topK = 20;
+        int benchQueries = 0;
+        int benchConcurrency = 4;
+        int routeArg = -1;
+        bool checkRecall = false;
+
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--or" || arg == "-o") {
+                andMode = false;
+            } else if (arg == "--and" || arg == "-a") {
+                andMode = true;
+            } else if (arg == "--shards" && i + 1 < argc) {
+                shardList = argv[++i];
+            } else if (arg == "--top" && i + 1 < argc) {
+                topK = static_cast<std::size_t>(std::stoi(argv[++i]));
+            } else if (arg == "--no-hedge") {
+                hedging = false;
+            } else if (arg == "--bench" && i + 1 < argc) {
+                benchQueries = std::stoi(argv[++i]);
+            } else if (arg == "--route" && i + 1 < argc) {
+                routeArg = std::stoi(argv[++i]);
+            } else if (arg == "--recall") {
+                checkRecall = true;
+            } else if (arg == "--concurrency" && i + 1 < argc) {
+                benchConcurrency = std::stoi(argv[++i]);
+            } else if (queryString.empty()) {
+                queryString = arg;
+            }
+        }
+
+        if (queryString.empty()) {
+            std::cout << "Enter query: ";
+            if (!std::getline(std::cin, queryString) || queryString.empty()) {
+                std::cerr << "No query provided.\n";
+                return 1;
+            }
+        }
+
+        fs::path backendDir = findBackendDir(argv[0]);
+        json config = loadConfig(backendDir);
+        fs::path indexesDir = backendDir / config["indexes_dir"].get<std::string>();
+        fs::path shardsDir = indexesDir / config.value("shards_dir", "shards");
+
+        auto loadStart = high_resolution_clock::now();
+
+        LemmaTable wordToLemma;
+        loadLemmaTable(indexesDir, config, wordToLemma);
+
+        std::ifstream statsFile(shardsDir / "global_stats.json");
+        if (!statsFile.is_open()) {
+            throw std::runtime_error("Cannot open " + (shardsDir / "global_stats.json").string()
+                                     + " (run shardBuilder first)");
+        }
+        json globalStats;
+        statsFile >> globalStats;
+        auto globalDf = shard_index::readGlobalDf((shardsDir / "global_df.bin").string());
+
+        // Resource selection index (written by shardBuilder)
+        shard_cluster::ShardSummary summary;
+        bool haveSummary = shard_cluster::readSummary((shardsDir / "selection.bin").string(), summary);
+        shard_cluster::Centroids centroids;
+        bool haveCentroids = shard_cluster::readCentroids((shardsDir / "centroids.bin").string(), centroids);
+
+        std::unique_ptr<doc_store::Reader> docStore;
+        fs::path docStorePath = indexesDir / config.value("doc_store_file", "doc_store.bin");
+        if (fs::exists(docStorePath)) {
+            try {
+                docStore = std::make_unique<doc_store::Reader>(docStorePath.string());
+            } catch (const std::exception& e) {
+                std::cerr << "Warning: " << e.what() << std::endl;
+            }
+        }
+
+        auto loadMs = duration_cast<milliseconds>(high_resolution_clock::now() - loadStart).count();
+        std::cout << "[Coordinator initialized in " << loadMs << "ms]\n" << std::endl;
+
+        // Resolve query words to (lemmaId, global df)
+        Tokenizer tokenizer;
+        std::vector<std::string> queryWords = tokenizer.tokenize(queryString);
+        if (queryWords.empty()) {
+            std::cerr << "No valid query words.\n";
+            return 1;
+        }
+
+        std::cout << "Query: '" << queryString << "' (" << (andMode ? "AND" : "OR") << " mode)\n" << std::endl;
+        std::cout << "Processing " << queryWords.size() << " words:" << std::endl;
+
+        shard_protocol::Query query;
+        query.topK = static_cast<int>(topK);
+        query.andMode = andMode;
+        query.totalDocs = globalStats["num_docs"].get<int64_t>();
+        query.avgDocLength = globalStats["avg_doc_length"].get<double>();
+
+        for (const auto& word : queryWords) {
+            int32_t lemmaId = wordToLemma.find(word);
+            if (lemmaId == -1) {
+                std::cout << "  Word '" << word << "': not found in lexicon" << std::endl;
+                continue;
+            }
+            auto it = globalDf.find(lemmaId);
+            if (it == globalDf.end()) {
+                std::cout << "  Word '" << word << "': no postings" << std::endl;
+                continue;
+            }
+            std::cout << "  Word '" << word << "' -> lemma " << lemmaId << ", df=" << it->second << std::endl;
+            query.terms.emplace_back(lemmaId, it->second);
+        }
+
+        if (query.terms.empty()) {
+            std::cout << "\nNo documents found matching " << (andMode ? "ALL" : "ANY") << " query terms.\n";
+            return 0;
+        }
+
+        // Scatter
+        int numShards = globalStats.value("num_shards", 1);
+        std::vector<std::shared_ptr<shard_client::ShardGroup>> groups;
+        for (const auto& endpoints : resolveShardGroups(shardList, config, numShards)) {
+            groups.push_back(std::make_shared<shard_client::ShardGroup>(endpoints));
+        }
+
+        shard_client::HedgePolicy policy;
+        policy.enabled = hedging && config.value("hedge_enabled", true);
+        policy.percentile = config.value("hedge_percentile", 95) / 100.0;
+        policy.defaultDelayMs = config.value("hedge_delay_ms", 20.0);
+        int timeoutMs = config.value("shard_timeout_ms", 2000);
+
+        std::string request = shard_protocol::formatQuery(query);
+
+        // Route to the best shards only (topical shards), skipping any shard
+        // the selection index proves cannot match
+        int routeTop = routeArg >= 0 ? routeArg
+                     : (globalStats.value("partition", "") == "kmeans" ? config.value("route_shards", 2) : 0);
+        std::string selection = config.value("shard_selection", "df");
+
+        std::vector<shard_cluster::ShardScore> ranked;
+        bool exactPrune = false;
+        if (static_cast<int>(groups.size()) != numShards) {
+            selection = "none (endpoint list does not match shard count)";
+        } else if (selection == "centroid" && haveCentroids && static_cast<int>(centroids.k) == numShards) {
+            std::unique_ptr<shard_cluster::FeatureSpace> space;
+            if (centroids.features == shard_cluster::Features::Embeddings) {
+                space = std::make_unique<shard_cluster::FeatureSpace>(globalDf, query.totalDocs,
+                                                                      (indexesDir / "embeddings").string(), wordToLemma);
+            } else {
+                space = std::make_unique<shard_cluster::FeatureSpace>(globalDf, query.totalDocs);
+            }
+            std::vector<int> lemmas;
+            for (const auto& [lemmaId, df] : query.terms) lemmas.push_back(lemmaId);
+            ranked = shard_cluster::rankShardsByCentroid(centroids, space->queryVector(lemmas));
+        } else if (haveSummary && static_cast<int>(summary.numDocs.size()) == numShards) {
+            selection = "df";
+            ranked = shard_cluster::rankShardsByDf(summary, query.terms, andMode, query.totalDocs);
+            exactPrune = andMode;
+        } else {
+            selection = "none";
+        }
+
+        std::vector<int> selected;
+        if (ranked.empty()) {
+            for (int i = 0; i < static_cast<int>(groups.size()); i++) selected.push_back(i);
+        } else {
+            for (const auto& r : ranked) {
+                if (exactPrune && r.score <= 0.0) break;
+                if (routeTop > 0 && static_cast<int>(selected.size()) >= routeTop) break;
+                selected.push_back(r.shard);
+            }
+        }
+
+        std::vector<std::shared_ptr<shard_client::ShardGroup>> routed;
+        for (int shard : selected) routed.push_back(groups[shard]);
+
+        std::cout << "\nRouting: " << selected.size() << "/" << groups.size() << " shards by " << selection;
+        if (!ranked.empty()) {
+            std::cout << " [";
+            for (std::size_t i = 0; i < selected.size(); i++) {
+                std::cout << (i ? ", " : "") << ranked[i].shard << " (" << ranked[i].score << ")";
+            }
+            std::cout << "]";
+        }
+        std::cout << std::endl;
+
+        if (benchQueries > 0) {
+            runBenchmark(routed, selected, request, timeoutMs, policy, benchQueries, benchConcurrency);
+            return 0;
+        }
+
+        auto searchStart = high_resolution_clock::now();
+        auto outcomes = scatter(routed, request, net::Clock::now() + milliseconds(timeoutMs), policy);
+
+        // Gather
+        std::vector<std::vector<shard_protocol::Hit>> shardHits;
+        int64_t totalMatched = 0;
+        int64_t totalScanned = 0;
+        std::size_t shardsOk = 0;
+
+        std::cout << "\nShards:" << std::endl;
+        for (std::size_t i = 0; i < outcomes.size(); i++) {
+            auto& o = outcomes[i];
+            std::cout << "  [" << selected[i] << "] ";
+            if (o.response.ok) {
+                shardsOk++;
+                totalMatched += o.response.numMatched;
+                totalScanned += o.response.postingsScanned;
+                std::cout << o.endpoint << ": " << o.response.numMatched << " matched, "
+                          << o.response.hits.size() << " returned, " << o.response.postingsScanned
+                          << " postings, " << o.elapsedMs << "ms";
+                shardHits.push_back(std::move(o.response.hits));
+            } else {
+                std::cout << "MISSING (" << o.response.error << ") after " << o.elapsedMs << "ms";
+            }
+            if (o.hedged) {
+                std::cout << " [hedged after " << o.hedgeDelayMs << "ms" << (o.hedgeWon ? ", hedge won" : "") << "]";
+            }
+            std::cout << std::endl;
+            for (const auto& err : o.errors) {
+                std::cout << "      " << err << std::endl;
+            }
+        }
+
+        std::vector<shard_protocol::Hit> merged = mergeTopK(shardHits, topK);
+        std::size_t k = merged.size();
+
+        auto searchTime = duration_cast<milliseconds>(high_resolution_clock::now() - searchStart).count();
+
+        // Completeness flag: false when any shard missed its deadline or had no live replica
+        bool complete = shardsOk == outcomes.size();
+        std::cout << "\n[Complete: " << (complete ? "true" : "false") << " (" << shardsOk << "/"
+                  << outcomes.size() << " shards)]" << std::endl;
+
+        if (merged.empty()) {
+            std::cout << "\nNo documents found matching " << (andMode ? "ALL" : "ANY") << " query terms.\n";
+            return 0;
+        }
+
+        std::cout << "\nFound " << totalMatched << " matching documents ("
+                  << totalScanned << " postings scanned)" << std::endl;
+
+        if (checkRecall && selected.size() < groups.size()) {
+            // Same query on every shard: how much of the exhaustive top-K did routing keep?
+            auto all = scatter(groups, request, net::Clock::now() + milliseconds(timeoutMs), policy);
+            std::vector<std::vector<shard_protocol::Hit>> allHits;
+            for (auto& o : all) {
+                if (o.response.ok) allHits.push_back(std::move(o.response.hits));
+            }
+            auto exhaustive = mergeTopK(allHits, topK);
+            std::size_t kept = 0;
+            for (const auto& h : exhaustive) {
+                kept += std::any_of(merged.begin(), merged.end(),
+                                    [&](const shard_protocol::Hit& m) { return m.docId == h.docId; });
+            }
+            std::cout << "[Recall@" << topK << " vs all shards: " << kept << "/" << exhaustive.size() << "]" << std::endl;
+        }
+        std::cout << "\nTop " << k << " results (in " << searchTime << "ms):\n" << std::endl;
+
+        // Metadata and snippets for the merged top-K
+        auto snippetStart = high_resolution_clock::now();
+        snippet::Options snippetOpts = snippet::optionsFromConfig(config);
+        snippet::TermWeights terms;
+        for (const auto& [lemmaId, df] : query.terms) {
+            terms[lemmaId] = 1.0f;
+        }
+
+        std::vector<doc_store::DocRecord> records(k);
+        std::vector<std::string> snippets(k);
+        std::vector<bool> found(k, false);
+        if (docStore) {
+            for (std::size_t i = 0; i < k; i++) {
+                uint32_t docId;
+                if (docStore->findDocId(merged[i].docId, docId) && docStore->get(docId, records[i])) {
+                    found[i] = true;
+                    snippets[i] = snippet::generate(records[i], terms, snippetOpts);
+                }
+            }
+        }
+        double snippetMs = duration_cast<microseconds>(high_resolution_clock::now() - snippetStart).count() / 1000.0;
+
+        for (std::size_t i = 0; i < k; i++) {
+            const auto& r = merged[i];
+            std::cout << (i + 1) << ". DocID: " << r.docId
+                      << " | Score: " << r.score
+                      << " | Matched: " << r.matchedTerms << "/" << queryWords.size()
+                      << " | TFs: [";
+            for (std::size_t j = 0; j < r.termFreqs.size(); j++) {
+                if (j > 0) std::cout << ",";
+                std::cout << r.termFreqs[j];
+            }
+            std::cout << "]" << std::endl;
+
+            if (found[i]) {
+                doc_store::printRecord(std::cout, records[i]);
+                if (!snippets[i].empty()) {
+                    std::cout << "   Snippet: " << snippets[i] << "\n";
+                }
+            }
+        }
+
+        auto totalTime = duration_cast<milliseconds>(high_resolution_clock::now() - totalStart).count();
+        std::cout << "\n[Snippet stage: " << k << " docs, " << snippetMs << "ms]" << std::endl;
+        std::cout << "[Total time: " << totalTime << "ms]" << std::endl;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -5,13 +5,26 @@
  * - Semantic search using GloVe word embeddings (query expansion)
  * - Fast prefix-based autocomplete with document frequency ranking
  * - PageRank-style document authority scores
- * - TF-IDF + semantic similarity + PageRank combined ranking
+ * - TF-IDF + semantic similarity + PageRank combined ranking, with the top
+ *   candidates optionally re-ranked by a gradient-boosted tree model (ltr.hpp)
+ * - Term-at-a-time scoring into dense per-document accumulators
+ *   (accumulator.hpp) over roaring ordinals
  * - Binary barrel format for O(1) seeks
+ * - Hybrid mode: lexical barrels and a document vector index (HNSW or
+ *   IVF-PQ) searched in parallel, fused with reciprocal-rank fusion
+ * - With docIDs in descending PageRank order (reorderDocs --method pagerank),
+ *   OR and single-term queries stop scoring once no remaining document can
+ *   reach the top results
  * - Performance: single word < 500ms, 5-word < 1.5s
  *
  * Usage:
  *   ./search_semantic "query"                    # Semantic search (AND mode)
  *   ./search_semantic "query" --or               # OR mode
+ *   ./search_semantic "query" --no-rerank        # First-stage ranking only
+ *   ./search_semantic "query" --ltr-features f   # Append re-rank features (training data)
+ *   ./search_semantic "query" --exhaustive       # Score every match (no early termination)
+ *   ./search_semantic "query" --hybrid           # Lexical + document vectors (RRF)
+ *   ./search_semantic "query" --hybrid --vector-index ivfpq
  *   ./search_semantic --autocomplete "prefix"    # Get suggestions (3-5)
  *   ./search_semantic --similar "word"           # Find similar words
  */
@@ -30,10 +43,23 @@
 #include <cmath>
 #include <chrono>
 #include <cctype>
+#include <memory>
 #include <queue>
 #include <functional>
+#include <future>
 
 #include "config.hpp"
+#include "lexicon.hpp"
+#include "doc_store.hpp"
+#include "snippet.hpp"
+#include "dense_index.hpp"
+#include "ivf_pq.hpp"
+#include "ltr.hpp"
+#include "forward_index.hpp"
+#include "citation_graph.hpp"
+#include "roaring.hpp"
+#include "accumulator.hpp"
+#include "query_evaluator.hpp"
 
 namespace fs = std::filesystem;
 using json = nlohmann::json;
@@ -43,12 +69,18 @@ using namespace std::chrono;
 
 const int EMBEDDING_DIM = 50;           // GloVe 50d
 const int DOC_ID_SIZE = 20;
-const int TOTAL_DOCS = 59000;
+constexpr int TOTAL_DOCS = 59000;
 const int TOP_SIMILAR_WORDS = 3;        // Expand query with top-k similar words
 const int AUTOCOMPLETE_SUGGESTIONS = 5;
-const float SEMANTIC_WEIGHT = 0.3f;     // Weight for semantic similarity in ranking
-const float TFIDF_WEIGHT = 0.5f;        // Weight for TF-IDF
-const float PAGERANK_WEIGHT = 0.2f;     // Weight for PageRank
+constexpr float SEMANTIC_WEIGHT = 0.3f; // Weight for semantic similarity in ranking
+constexpr float TFIDF_WEIGHT = 0.5f;    // Weight for TF-IDF
+constexpr float PAGERANK_WEIGHT = 0.2f; // Weight for PageRank
+
+// TF-IDF as the scorer policy of query_evaluator.hpp
+struct TfIdfParams {
+    static constexpr int totalDocs = TOTAL_DOCS;
+};
+using TfIdfScorer = query_evaluator::TfIdf<TfIdfParams>;
 
 // ===================== Data Structures =====================
 
@@ -77,9 +109,8 @@ struct AutocompleteSuggestion {
 // ===================== Global Cache =====================
 
 struct SearchCache {
-    // Lexicon
-    std::unordered_map<std::string, int> wordToWordId;
-    std::unordered_map<int, int> wordIdToLemmaId;
+    // Lexicon (word -> lemmaId)
+    LemmaTable wordToLemma;
 
     // Barrel lookup
     std::unordered_map<int, int> barrelLookup;
@@ -96,6 +127,37 @@ struct SearchCache {
 
     // Document PageRank scores
     std::unordered_map<std::string, float> docScores;
+    std::vector<float> staticRank;  // the same scores by docID (from pagerank.bin)
+
+    // Roaring bitmaps of barrels_binary. Their ordinals number the documents
+    // for the score accumulators, and when docIDs are in descending static
+    // rank (staticRankOrder) they are docIDs, so the bitmaps are posting
+    // lists in static-rank order.
+    bool staticRankOrder = false;
+    std::unordered_map<int, IndexEntry> roaringIndex;
+    std::vector<std::string> roaringDocs;  // ordinal -> docId
+    std::unordered_map<std::string, uint32_t> roaringOrdinals;
+
+    // Titles/authors/abstracts by docID (optional)
+    std::unique_ptr<doc_store::Reader> docStore;
+
+    // Document vectors and their index (hybrid mode only): the HNSW graph,
+    // or IVF-PQ codes with the full vectors only read for the re-rank
+    std::unique_ptr<dense_index::Vectors> docVectors;
+    std::unique_ptr<dense_index::LemmaVectors> lemmaVectors;
+    std::string vectorIndex;
+    dense_index::Hnsw hnsw;
+    ivf_pq::Index ivfpq;
+
+    // Forward index lines, for re-rank features (located on first use)
+    std::unique_ptr<forward_index::Reader> forward;
+
+    // Second-stage ranking model (optional) and where to log its features
+    std::unique_ptr<ltr::Model> ranker;
+    std::string featureLogPath;
+
+    // Whether searches may return only the results they use (false with --exhaustive)
+    bool lexicalLimit = true;
 
     bool initialized = false;
     fs::path backendDir;
@@ -112,22 +174,10 @@ std::string toLower(const std::string& str) {
     return result;
 }
 
+// Same normalization as forwardIndex (see tokenizer.hpp)
 std::vector<std::string> tokenize(const std::string& query) {
-    std::vector<std::string> tokens;
-    std::istringstream iss(query);
-    std::string token;
-    while (iss >> token) {
-        std::string clean;
-        for (char c : token) {
-            if (std::isalnum(c)) {
-                clean += std::tolower(c);
-            }
-        }
-        if (!clean.empty()) {
-            tokens.push_back(clean);
-        }
-    }
-    return tokens;
+    Tokenizer tokenizer;
+    return tokenizer.tokenize(query);
 }
 
 // ===================== Embeddings Functions =====================
@@ -233,14 +283,7 @@ std::vector<SimilarWord> findSimilarWords(const std::string& word, int topK = TO
         sw.word = w;
         sw.similarity = sim;
 
-        auto wordIt = g_cache.wordToWordId.find(w);
-        if (wordIt != g_cache.wordToWordId.end()) {
-            int wordId = wordIt->second;
-            auto lemmaIt = g_cache.wordIdToLemmaId.find(wordId);
-            sw.lemmaId = (lemmaIt != g_cache.wordIdToLemmaId.end()) ? lemmaIt->second : -1;
-        } else {
-            sw.lemmaId = -1;
-        }
+        sw.lemmaId = g_cache.wordToLemma.find(w);
 
         similar.push_back(sw);
     }
@@ -386,8 +429,28 @@ std::vector<AutocompleteSuggestion> getAutocompleteSuggestions(
 
 // ===================== PageRank Functions =====================
 
-void loadDocScores(const fs::path& embeddingsDir) {
-    fs::path scoresPath = embeddingsDir / "doc_scores.json";
+// Citation PageRank (pagerank.bin, by docID, needs the document store for
+// PMC IDs), else the heuristic scores of embeddings_setup.py
+void loadDocScores(const fs::path& indexesDir, const json& config) {
+    fs::path pagerankPath = indexesDir / config.value("pagerank_file", "pagerank.bin");
+    if (fs::exists(pagerankPath) && g_cache.docStore) {
+        try {
+            auto start = high_resolution_clock::now();
+            std::vector<float> scores = citation_graph::normalizedScores(citation_graph::readScores(pagerankPath));
+            uint32_t numDocs = static_cast<uint32_t>(std::min(scores.size(), g_cache.docStore->size()));
+            for (uint32_t d = 0; d < numDocs; d++) {
+                g_cache.docScores[std::string(g_cache.docStore->pmcId(d))] = scores[d];
+            }
+            g_cache.staticRank.assign(scores.begin(), scores.begin() + numDocs);
+            auto ms = duration_cast<milliseconds>(high_resolution_clock::now() - start).count();
+            std::cout << "[Loaded " << numDocs << " PageRank scores in " << ms << "ms]" << std::endl;
+            return;
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: " << e.what() << std::endl;
+        }
+    }
+
+    fs::path scoresPath = indexesDir / "embeddings" / "doc_scores.json";
 
     if (!fs::exists(scoresPath)) {
         std::cout << "[Document scores not found - using default]" << std::endl;
@@ -410,6 +473,60 @@ void loadDocScores(const fs::path& embeddingsDir) {
     std::cout << "[Loaded " << g_cache.docScores.size() << " doc scores in " << ms << "ms]" << std::endl;
 }
 
+// Roaring bitmaps of the long posting lists and the ordinal -> doc ID table
+// (optional: without them every list is read from its barrel and numbered
+// per query)
+void loadRoaringIndex(const fs::path& indexesDir) {
+    fs::path binaryBarrelsDir = indexesDir / "barrels_binary";
+    std::ifstream idxFile(binaryBarrelsDir / "roaring.idx", std::ios::binary);
+    std::ifstream docsFile(binaryBarrelsDir / "roaring_docs.bin", std::ios::binary);
+    if (!idxFile.is_open() || !docsFile.is_open()) return;
+
+    int32_t numDocs = 0;
+    docsFile.read(reinterpret_cast<char*>(&numDocs), sizeof(numDocs));
+    std::vector<char> buf(static_cast<size_t>(std::max(numDocs, 0)) * DOC_ID_SIZE);
+    docsFile.read(buf.data(), buf.size());
+    if (!docsFile) return;
+    g_cache.roaringDocs.reserve(numDocs);
+    g_cache.roaringOrdinals.reserve(numDocs);
+    for (int32_t i = 0; i < numDocs; i++) {
+        const char* id = buf.data() + static_cast<size_t>(i) * DOC_ID_SIZE;
+        g_cache.roaringDocs.emplace_back(id, std::find(id, id + DOC_ID_SIZE, '\0'));
+        g_cache.roaringOrdinals.emplace(g_cache.roaringDocs.back(), static_cast<uint32_t>(i));
+    }
+
+    int32_t numEntries = 0;
+    idxFile.read(reinterpret_cast<char*>(&numEntries), sizeof(numEntries));
+    for (int i = 0; i < numEntries; i++) {
+        int32_t lemmaId;
+        IndexEntry entry;
+        idxFile.read(reinterpret_cast<char*>(&lemmaId), sizeof(lemmaId));
+        idxFile.read(reinterpret_cast<char*>(&entry.offset), sizeof(entry.offset));
+        idxFile.read(reinterpret_cast<char*>(&entry.length), sizeof(entry.length));
+        g_cache.roaringIndex[lemmaId] = entry;
+    }
+}
+
+// Early termination needs docIDs in descending static rank and roaring
+// bitmaps numbered by those docIDs (barrels_binary run after reorderDocs).
+// Both are checked here, so any other index is evaluated exhaustively.
+void loadStaticRankOrder(const json& config) {
+    const auto& rank = g_cache.staticRank;
+    if (!config.value("static_rank_termination", true) || rank.empty() || g_cache.roaringIndex.empty()) return;
+    for (size_t d = 1; d < rank.size(); d++) {
+        if (rank[d] > rank[d - 1]) return;
+    }
+    if (g_cache.roaringDocs.size() < rank.size()) return;
+    for (uint32_t d = 0; d < rank.size(); d++) {
+        if (g_cache.roaringDocs[d] != g_cache.docStore->pmcId(d)) {
+            std::cout << "[Roaring bitmaps predate the docID order - rerun barrels_binary]" << std::endl;
+            return;
+        }
+    }
+    g_cache.staticRankOrder = true;
+    std::cout << "[DocIDs in static-rank order: early termination on]" << std::endl;
+}
+
 float getDocScore(const std::string& docId) {
     auto it = g_cache.docScores.find(docId);
     if (it != g_cache.docScores.end()) {
@@ -451,50 +568,6 @@ fs::path findBackendDir(const char* argv0) {
     throw std::runtime_error("Cannot find config.json");
 }
 
-// ===================== Binary Lexicon Loading =====================
-
-bool loadBinaryLexicon(const fs::path& binPath) {
-    if (!fs::exists(binPath)) {
-        return false;
-    }
-
-    std::ifstream binFile(binPath, std::ios::binary);
-    if (!binFile.is_open()) {
-        return false;
-    }
-
-    // Read header
-    uint32_t numWords;
-    binFile.read(reinterpret_cast<char*>(&numWords), sizeof(numWords));
-
-    // Read words and build lookup
-    std::vector<std::pair<std::string, int>> words;
-    words.reserve(numWords);
-
-    for (uint32_t i = 0; i < numWords; i++) {
-        uint16_t wordLen;
-        binFile.read(reinterpret_cast<char*>(&wordLen), sizeof(wordLen));
-
-        std::string word(wordLen, '\0');
-        binFile.read(&word[0], wordLen);
-
-        words.push_back({word, 0});  // lemma_id to be filled
-    }
-
-    // Read lemma IDs
-    for (uint32_t i = 0; i < numWords; i++) {
-        int32_t lemmaId;
-        binFile.read(reinterpret_cast<char*>(&lemmaId), sizeof(lemmaId));
-
-        words[i].second = lemmaId;
-        g_cache.wordToWordId[words[i].first] = static_cast<int>(i);
-        g_cache.wordIdToLemmaId[static_cast<int>(i)] = lemmaId;
-    }
-
-    binFile.close();
-    return true;
-}
-
 // ===================== Cache Initialization =====================
 
 void initializeCache(const fs::path& backendDir, const json& config) {
@@ -511,7 +584,7 @@ void initializeCache(const fs::path& backendDir, const json& config) {
 
     // Try binary lexicon first (much faster)
     fs::path binLexPath = embeddingsDir / "lexicon.bin";
-    if (!loadBinaryLexicon(binLexPath)) {
+    if (!loadLemmaTableBinary(binLexPath.string(), g_cache.wordToLemma)) {
         // Fallback to JSON lexicon
         std::cout << "[Binary lexicon not found, loading JSON...]" << std::endl;
         std::ifstream lexFile(lexiconPath);
@@ -522,17 +595,7 @@ void initializeCache(const fs::path& backendDir, const json& config) {
         lexFile >> lexicon;
         lexFile.close();
 
-        if (lexicon.contains("wordID")) {
-            for (auto& [word, id] : lexicon["wordID"].items()) {
-                g_cache.wordToWordId[word] = id.get<int>();
-            }
-        }
-
-        if (lexicon.contains("wordToLemmaID")) {
-            for (auto& [wordIdStr, lemmaId] : lexicon["wordToLemmaID"].items()) {
-                g_cache.wordIdToLemmaId[std::stoi(wordIdStr)] = lemmaId.get<int>();
-            }
-        }
+        loadLemmaTableJSON(lexicon, g_cache.wordToLemma);
     }
 
     // Load barrel lookup
@@ -586,8 +649,31 @@ void initializeCache(const fs::path& backendDir, const json& config) {
     // Load autocomplete index
     loadAutocomplete(embeddingsDir);
 
+    // Re-ranking model (optional: first-stage order without it)
+    fs::path modelPath = indexesDir / config.value("ltr_model", "ltr_model.json");
+    if (fs::exists(modelPath)) {
+        try {
+            g_cache.ranker = std::make_unique<ltr::Model>(modelPath);
+            std::cout << "[Loaded ranking model: " << g_cache.ranker->trees() << " trees]" << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: " << e.what() << std::endl;
+        }
+    }
+
+    // Document store for result metadata (optional: results print without it)
+    fs::path docStorePath = indexesDir / config.value("doc_store_file", "doc_store.bin");
+    if (fs::exists(docStorePath)) {
+        try {
+            g_cache.docStore = std::make_unique<doc_store::Reader>(docStorePath.string());
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: " << e.what() << std::endl;
+        }
+    }
+
     // Load document scores for PageRank (optional)
-    loadDocScores(embeddingsDir);
+    loadDocScores(indexesDir, config);
+    loadRoaringIndex(indexesDir);
+    loadStaticRankOrder(config);
 
     g_cache.initialized = true;
 
@@ -599,19 +685,12 @@ void initializeCache(const fs::path& backendDir, const json& config) {
 // ===================== Lexicon Lookup =====================
 
 bool getLemmaIdForWord(const std::string& word, int& lemmaIdOut) {
-    auto it = g_cache.wordToWordId.find(word);
-    if (it == g_cache.wordToWordId.end()) {
+    int32_t lemmaId = g_cache.wordToLemma.find(word);
+    if (lemmaId == -1) {
         return false;
     }
 
-    int wordId = it->second;
-    auto lemmaIt = g_cache.wordIdToLemmaId.find(wordId);
-    if (lemmaIt != g_cache.wordIdToLemmaId.end()) {
-        lemmaIdOut = lemmaIt->second;
-    } else {
-        lemmaIdOut = wordId;  // Use word ID as lemma ID if no mapping
-    }
-
+    lemmaIdOut = lemmaId;
     return true;
 }
 
@@ -763,7 +842,8 @@ struct ExpandedTerm {
     float weight;
 };
 
-std::vector<ExpandedTerm> expandQuery(const std::vector<std::string>& queryWords) {
+// expand = false keeps only the query's own terms
+std::vector<ExpandedTerm> expandQuery(const std::vector<std::string>& queryWords, bool expand = true) {
     std::vector<ExpandedTerm> expandedTerms;
     std::unordered_set<int> seenLemmas;
 
@@ -777,7 +857,7 @@ std::vector<ExpandedTerm> expandQuery(const std::vector<std::string>& queryWords
         }
 
         // Find similar words for semantic expansion (only if embeddings loaded)
-        if (g_cache.embeddingsLoaded) {
+        if (expand && g_cache.embeddingsLoaded) {
             auto similar = findSimilarWords(word, TOP_SIMILAR_WORDS);
 
             for (const auto& sim : similar) {
@@ -806,13 +886,450 @@ struct SearchResult {
     int totalTerms;
 };
 
+// ===================== Re-ranking =====================
+
+// A document's title/abstract/body lemmas from its forward index line
+bool forwardFields(const json& config, const std::string& docId, ltr::FieldLemmas& out) {
+    if (!g_cache.forward) {
+        fs::path indexesDir = g_cache.backendDir / config["indexes_dir"].get<std::string>();
+        g_cache.forward = std::make_unique<forward_index::Reader>(
+            (indexesDir / config["forward_index_file"].get<std::string>()).string(),
+            (indexesDir / config.value("forward_offsets_file", "forward_index.offsets")).string());
+    }
+    return g_cache.forward->fields(docId, out);
+}
+
+// Second stage: features for the top ltr_rerank_depth results, logged to
+// featureLogPath if set (SVMlight lines, label 0 for the caller to fill in,
+// feature indices 0-based as in the model's f0..f10), then re-ordered by the
+// ranking model's score. Results below the depth keep their order.
+void rerankTopResults(const json& config, const std::vector<ltr::QueryTerm>& terms, const std::string& queryText,
+                      std::vector<SearchResult>& results, bool verbose) {
+    const size_t depth = std::min<size_t>(config.value("ltr_rerank_depth", 200), results.size());
+    if (depth == 0 || (!g_cache.ranker && g_cache.featureLogPath.empty())) return;
+
+    ltr::Bm25Params params;
+    params.totalDocs = TOTAL_DOCS;
+    params.avgTitle = config.value("ltr_avg_title_length", params.avgTitle);
+    params.avgAbstract = config.value("ltr_avg_abstract_length", params.avgAbstract);
+    params.avgBody = config.value("ltr_avg_body_length", params.avgBody);
+
+    auto featureStart = high_resolution_clock::now();
+    std::vector<float> features(depth * ltr::NUM_FEATURES);
+    for (size_t i = 0; i < depth; i++) {
+        const SearchResult& r = results[i];
+        ltr::FieldLemmas fields;
+        forwardFields(config, r.docId, fields);  // stays empty for an unknown document
+        ltr::FirstStage first;
+        first.pagerank = r.pagerankScore;
+        first.semantic = r.semanticScore;
+        first.tfidf = r.tfidfScore;
+        first.matchedTerms = r.matchedTerms;
+        first.queryTerms = r.totalTerms;
+        ltr::extractFeatures(terms, fields, first, params, &features[i * ltr::NUM_FEATURES]);
+    }
+    double featureMs = duration_cast<microseconds>(high_resolution_clock::now() - featureStart).count() / 1000.0;
+
+    if (!g_cache.featureLogPath.empty()) {
+        std::ofstream log(g_cache.featureLogPath, std::ios::app);
+        if (!log.is_open()) {
+            throw std::runtime_error("Cannot open " + g_cache.featureLogPath);
+        }
+        uint32_t qid = 2166136261u;  // FNV-1a of the query, stable across runs
+        for (unsigned char c : queryText) qid = (qid ^ c) * 16777619u;
+        for (size_t i = 0; i < depth; i++) {
+            log << "0 qid:" << qid;
+            for (uint32_t f = 0; f < ltr::NUM_FEATURES; f++) {
+                log << ' ' << f << ':' << features[i * ltr::NUM_FEATURES + f];
+            }
+            log << " # " << results[i].docId << ' ' << queryText << '\n';
+        }
+    }
+    if (!g_cache.ranker) return;
+
+    auto modelStart = high_resolution_clock::now();
+    std::vector<float> scores(depth);
+    g_cache.ranker->scoreBatch(features.data(), depth, scores.data());
+    for (size_t i = 0; i < depth; i++) results[i].totalScore = scores[i];
+    std::stable_sort(results.begin(), results.begin() + depth,
+                     [](const SearchResult& a, const SearchResult& b) { return a.totalScore > b.totalScore; });
+    double modelMs = duration_cast<microseconds>(high_resolution_clock::now() - modelStart).count() / 1000.0;
+    if (!g_cache.featureLogPath.empty()) {
+        // While collecting training data, check QuickScorer against a plain
+        // walk of every tree (the sums differ only in summation order)
+        size_t differ = 0;
+        float largest = 0.0f;
+        for (size_t i = 0; i < depth; i++) {
+            float expected = g_cache.ranker->scoreByTraversal(&features[i * ltr::NUM_FEATURES]);
+            float diff = std::fabs(scores[i] - expected);
+            if (diff > 1e-4f * (1.0f + std::fabs(expected))) differ++;
+            largest = std::max(largest, diff);
+        }
+        if (differ > 0) {
+            std::cerr << "Warning: QuickScorer and tree traversal disagree on " << differ << " of " << depth
+                      << " candidates (largest difference " << largest << ")" << std::endl;
+        }
+    }
+
+    if (verbose) {
+        std::cout << "[Re-rank: " << depth << " candidates, " << g_cache.ranker->trees() << " trees, features "
+                  << featureMs << "ms, model " << modelMs << "ms]" << std::endl;
+    }
+}
+
+// ===================== Document-Numbered Lists =====================
+
+// One term's postings by document number (roaring ordinal), ascending
+struct RankedList {
+    std::vector<uint32_t> docs;
+    std::vector<int32_t> tfs;
+    int df = 0;
+    float weight = 0.0f;
+};
+
+// One term's postings by document number as stored: its roaring bitmap when
+// it has one (tfs in member order), and the postings the bitmap does not
+// hold, sorted: its new_docs barrel uploads, or the whole barrel list of a
+// term without a bitmap
+struct RankedPostings {
+    roaring::Bitmap bitmap;
+    std::vector<uint16_t> bitmapTfs;
+    std::vector<std::pair<uint32_t, int32_t>> rest;
+    int df = 0;
+    int32_t maxTf = 0;
+
+    uint64_t size() const { return bitmapTfs.size() + rest.size(); }
+};
+
+const std::string& rankedDocId(uint32_t doc, const std::vector<std::string>& extraIds) {
+    return doc < g_cache.roaringDocs.size() ? g_cache.roaringDocs[doc] : extraIds[doc - g_cache.roaringDocs.size()];
+}
+
+// Ordinal of a document, numbering documents the roaring index does not
+// know (uploads) after it, per query
+uint32_t rankedOrdinal(const std::string& docId, std::unordered_map<std::string, uint32_t>& extraOrdinals,
+                       std::vector<std::string>& extraIds) {
+    auto it = g_cache.roaringOrdinals.find(docId);
+    if (it != g_cache.roaringOrdinals.end()) return it->second;
+    auto [extra, inserted] = extraOrdinals.emplace(
+        docId, static_cast<uint32_t>(g_cache.roaringDocs.size() + extraIds.size()));
+    if (inserted) extraIds.push_back(docId);
+    return extra->second;
+}
+
+// Reads a term's bitmap and tfs without expanding the bitmap; maxTf comes
+// from the tf array on the way
+bool readRankedPostings(const json& config, int lemmaId, RankedPostings& out,
+                        std::unordered_map<std::string, uint32_t>& extraOrdinals, std::vector<std::string>& extraIds) {
+    fs::path binaryBarrelsDir = g_cache.backendDir / config["indexes_dir"].get<std::string>() / "barrels_binary";
+
+    auto it = g_cache.roaringIndex.find(lemmaId);
+    if (it != g_cache.roaringIndex.end()) {
+        std::ifstream binFile(binaryBarrelsDir / "roaring.bin", std::ios::binary);
+        if (!binFile.is_open()) return false;
+        binFile.seekg(it->second.offset);
+
+        int32_t header[3];  // lemmaId, df, numDocs
+        binFile.read(reinterpret_cast<char*>(header), sizeof(header));
+        if (!out.bitmap.read(binFile)) return false;
+        out.bitmapTfs.resize(header[2]);
+        binFile.read(reinterpret_cast<char*>(out.bitmapTfs.data()), out.bitmapTfs.size() * sizeof(uint16_t));
+        if (!binFile) return false;
+        out.df = header[1];
+        for (uint16_t tf : out.bitmapTfs) out.maxTf = std::max<int32_t>(out.maxTf, tf);
+
+        auto newIt = g_cache.barrelIndices[10].find(lemmaId);
+        if (newIt != g_cache.barrelIndices[10].end()) {
+            std::ifstream newDocsFile(binaryBarrelsDir / "barrel_new_docs.bin", std::ios::binary);
+            newDocsFile.seekg(newIt->second.offset);
+            int32_t newHeader[3];  // lemmaId, df, numDocs
+            newDocsFile.read(reinterpret_cast<char*>(newHeader), sizeof(newHeader));
+            for (int i = 0; newDocsFile && i < newHeader[2]; i++) {
+                char docIdBuf[DOC_ID_SIZE];
+                int32_t tf;
+                newDocsFile.read(docIdBuf, DOC_ID_SIZE);
+                newDocsFile.read(reinterpret_cast<char*>(&tf), sizeof(tf));
+                std::string docId(docIdBuf, std::find(docIdBuf, docIdBuf + DOC_ID_SIZE, '\0'));
+                uint32_t d = rankedOrdinal(docId, extraOrdinals, extraIds);
+                if (!out.bitmap.contains(d)) {
+                    out.rest.push_back({d, tf});
+                    out.df++;
+                }
+            }
+        }
+    } else {
+        std::vector<DocPosting> postings;
+        int barrelId;
+        if (!findPostingsBinary(config, lemmaId, postings, out.df, barrelId)) return false;
+        for (const auto& posting : postings) {
+            out.rest.push_back({rankedOrdinal(posting.docId, extraOrdinals, extraIds), posting.tf});
+        }
+    }
+
+    std::sort(out.rest.begin(), out.rest.end());
+    for (const auto& [d, tf] : out.rest) out.maxTf = std::max(out.maxTf, tf);
+    return true;
+}
+
+// A term's list from its roaring bitmap when it has one (plus its new_docs
+// barrel postings, which the bitmaps do not cover), else from its barrel
+bool readRankedList(const json& config, int lemmaId, RankedList& out,
+                    std::unordered_map<std::string, uint32_t>& extraOrdinals, std::vector<std::string>& extraIds) {
+    RankedPostings postings;
+    if (!readRankedPostings(config, lemmaId, postings, extraOrdinals, extraIds)) return false;
+
+    out.df = postings.df;
+    out.docs.reserve(postings.size());
+    out.tfs.reserve(postings.size());
+    auto rest = postings.rest.begin();
+    size_t member = 0;
+    postings.bitmap.forEach([&](uint32_t d) {
+        for (; rest != postings.rest.end() && rest->first < d; ++rest) {
+            out.docs.push_back(rest->first);
+            out.tfs.push_back(rest->second);
+        }
+        out.docs.push_back(d);
+        out.tfs.push_back(postings.bitmapTfs[member++]);
+    });
+    for (; rest != postings.rest.end(); ++rest) {
+        out.docs.push_back(rest->first);
+        out.tfs.push_back(rest->second);
+    }
+    return true;
+}
+
+// ===================== Term-at-a-Time Accumulation =====================
+
+// Adds every list to the tf-idf channel (0) and expansion terms also to the
+// semantic channel (1), counting original terms as matches, then keeps the
+// documents with requiredTerms matches
+std::vector<SearchResult> accumulateTerms(const json& config, const std::vector<RankedList>& lists,
+                                          const std::vector<std::string>& extraIds, int requiredTerms,
+                                          int originalTermCount) {
+    query_evaluator::Query query;
+    for (const auto& list : lists) {
+        bool original = list.weight >= 1.0f;
+        query_evaluator::TermPostings term;
+        term.docs = list.docs.data();
+        term.tfs = list.tfs.data();
+        term.size = list.docs.size();
+        term.df = list.df;
+        term.weight = list.weight;
+        term.alsoChannel = original ? -1 : 1;
+        term.matched = original ? 1 : 0;
+        query.terms.push_back(term);
+    }
+    query.numDocs = static_cast<uint32_t>(g_cache.roaringDocs.size() + extraIds.size());
+    query.channels = 2;
+    query.requiredTerms = requiredTerms;
+
+    query_evaluator::Hits hits = query_evaluator::Dispatch<TfIdfScorer>::evaluate(
+        query, config.value("accumulator_dense_max_docs", accumulator::DEFAULT_DENSE_MAX_DOCS));
+    std::vector<SearchResult> results;
+    results.reserve(hits.size());
+    for (size_t h = 0; h < hits.size(); h++) {
+        SearchResult result;
+        result.docId = rankedDocId(hits.docs[h], extraIds);
+        result.tfidfScore = hits.value(h, 0);
+        result.semanticScore = hits.value(h, 1);
+        result.pagerankScore = getDocScore(result.docId);
+        result.matchedTerms = hits.matched[h];
+        result.totalTerms = originalTermCount;
+        result.totalScore = TFIDF_WEIGHT * result.tfidfScore +
+                           SEMANTIC_WEIGHT * result.semanticScore +
+                           PAGERANK_WEIGHT * result.pagerankScore;
+        results.push_back(std::move(result));
+    }
+    return results;
+}
+
+// ===================== Static-Rank Early Termination =====================
+
+// A term's postings walked in docID order straight from RankedPostings: the
+// bitmap through a roaring iterator merged with the sorted rest, each
+// posting scored only when it is reached
+struct RankedCursor {
+    RankedPostings postings;
+    score_kernels::TfIdfTerm constants;
+    float weight = 0.0f;
+    double bound = 0.0;          // largest score one posting can add
+    roaring::Iterator members;
+    size_t restPos = 0;
+
+    // Call once the cursor has its final address (the iterator points into it)
+    void start() { members = roaring::Iterator(postings.bitmap); }
+
+    uint32_t doc() const {
+        uint32_t fromBitmap = members.done() ? UINT32_MAX : members.value();
+        uint32_t fromRest = restPos < postings.rest.size() ? postings.rest[restPos].first : UINT32_MAX;
+        return std::min(fromBitmap, fromRest);
+    }
+
+    // Score of the posting at doc(), which moves on to the next one
+    float take() {
+        if (!members.done() && (restPos == postings.rest.size() || members.value() < postings.rest[restPos].first)) {
+            float value = constants.score(postings.bitmapTfs[members.rank()]);
+            members.next();
+            return value;
+        }
+        return constants.score(postings.rest[restPos++].second);
+    }
+
+    void advanceTo(uint32_t target) {
+        members.advanceTo(target);
+        while (restPos < postings.rest.size() && postings.rest[restPos].first < target) restPos++;
+    }
+};
+
+// OR and single-term queries when docIDs are in descending static rank:
+// documents are scored in docID order, and scoring stops at the first one
+// whose bound (every term's largest contribution plus its own static rank)
+// cannot beat the limit-th result, since no later document can. Documents
+// past the ranked range (uploads, default score) are always scored.
+// Scores are computed exactly as in semanticSearch. A term's bound is the
+// score of its largest tf; its postings are read as stored and decoded and
+// scored only up to where scoring stops. matches is set to the number of
+// matching documents (the union of the original terms' lists), counted
+// container by container, including the ones never scored.
+std::vector<SearchResult> staticRankSearch(
+    const json& config,
+    const std::vector<ExpandedTerm>& expandedTerms,
+    int originalTermCount,
+    size_t limit,
+    std::vector<ltr::QueryTerm>& rankTerms,
+    size_t& matches,
+    bool verbose
+) {
+    std::unordered_map<std::string, uint32_t> extraOrdinals;
+    std::vector<std::string> extraIds;
+    std::vector<RankedCursor> cursors;
+    cursors.reserve(expandedTerms.size());
+    double termBound = 0.0;
+    uint64_t totalPostings = 0;
+
+    for (const auto& term : expandedTerms) {
+        RankedCursor cursor;
+        if (!readRankedPostings(config, term.lemmaId, cursor.postings, extraOrdinals, extraIds)) {
+            continue;
+        }
+        rankTerms.push_back({term.lemmaId, term.weight, cursor.postings.df, term.weight >= 1.0f});
+        cursor.weight = term.weight;
+        cursor.constants = TfIdfScorer::term(cursor.postings.df, term.weight);
+
+        // TF-IDF grows with tf; a negative idf makes every posting lower the
+        // score, so it adds nothing to the bound
+        double maxValue = std::max(0.0f, cursor.constants.score(cursor.postings.maxTf));
+        cursor.bound = maxValue * (TFIDF_WEIGHT + (term.weight < 1.0f ? SEMANTIC_WEIGHT : 0.0f));
+        termBound += cursor.bound;
+        totalPostings += cursor.postings.size();
+        cursors.push_back(std::move(cursor));
+    }
+    for (auto& cursor : cursors) cursor.start();
+
+    termBound += 1e-6 * std::abs(termBound);  // float sums may round up
+
+    std::vector<roaring::Bitmap> restBitmaps;
+    restBitmaps.reserve(cursors.size());
+    std::vector<const roaring::Bitmap*> matching;
+    for (const auto& cursor : cursors) {
+        if (cursor.weight < 1.0f) continue;
+        matching.push_back(&cursor.postings.bitmap);
+        if (cursor.postings.rest.empty()) continue;
+        std::vector<uint32_t> docs;
+        docs.reserve(cursor.postings.rest.size());
+        for (const auto& posting : cursor.postings.rest) docs.push_back(posting.first);
+        restBitmaps.push_back(roaring::Bitmap::fromSorted(docs));
+        matching.push_back(&restBitmaps.back());
+    }
+    matches = roaring::unionCardinality(matching);
+
+    auto byScore = [](const SearchResult& a, const SearchResult& b) { return a.totalScore > b.totalScore; };
+    std::priority_queue<SearchResult, std::vector<SearchResult>, decltype(byScore)> top(byScore);  // worst on top
+
+    const uint32_t numRanked = static_cast<uint32_t>(g_cache.staticRank.size());
+    uint32_t stoppedAt = numRanked;
+    uint64_t scoredPostings = 0;
+    while (true) {
+        // Candidates come from the original terms' lists
+        uint32_t doc = UINT32_MAX;
+        for (const auto& cursor : cursors) {
+            if (cursor.weight >= 1.0f) doc = std::min(doc, cursor.doc());
+        }
+        if (doc == UINT32_MAX) break;
+
+        if (doc < numRanked && top.size() == limit &&
+            termBound + PAGERANK_WEIGHT * g_cache.staticRank[doc] < top.top().totalScore) {
+            stoppedAt = doc;
+            for (auto& cursor : cursors) cursor.advanceTo(numRanked);
+            continue;
+        }
+
+        SearchResult result;
+        float tfidf = 0.0f, semantic = 0.0f;
+        result.matchedTerms = 0;
+        result.totalTerms = originalTermCount;
+        for (auto& cursor : cursors) {
+            cursor.advanceTo(doc);
+            if (cursor.doc() != doc) continue;
+
+            float value = cursor.take();
+            scoredPostings++;
+            tfidf += value;
+            if (cursor.weight < 1.0f) {
+                semantic += value;
+            } else {
+                result.matchedTerms++;
+            }
+        }
+        result.tfidfScore = tfidf;
+        result.semanticScore = semantic;
+
+        const std::string& docId = rankedDocId(doc, extraIds);
+        result.pagerankScore = doc < numRanked ? g_cache.staticRank[doc] : getDocScore(docId);
+        result.totalScore = TFIDF_WEIGHT * result.tfidfScore +
+                           SEMANTIC_WEIGHT * result.semanticScore +
+                           PAGERANK_WEIGHT * result.pagerankScore;
+
+        if (top.size() < limit || result.totalScore > top.top().totalScore) {
+            result.docId = docId;
+            top.push(std::move(result));
+            if (top.size() > limit) top.pop();
+        }
+    }
+
+    std::vector<SearchResult> results;
+    results.reserve(top.size());
+    while (!top.empty()) {
+        results.push_back(top.top());
+        top.pop();
+    }
+    std::reverse(results.begin(), results.end());
+
+    if (verbose) {
+        std::cout << "[Static-rank order: scored " << scoredPostings << " of " << totalPostings << " postings";
+        if (stoppedAt < numRanked) {
+            std::cout << ", stopped at docID " << stoppedAt << " of " << numRanked;
+        }
+        std::cout << "]" << std::endl;
+    }
+    return results;
+}
+
+// limit > 0 allows returning only the best `limit` results, which lets
+// OR and single-term queries terminate early on a static-rank docID order;
+// matchesOut then still receives the number of matching documents
 std::vector<SearchResult> semanticSearch(
     const json& config,
     const std::vector<std::string>& queryWords,
     QueryMode mode,
-    bool verbose = true
+    bool verbose = true,
+    std::vector<ExpandedTerm>* expandedTermsOut = nullptr,
+    bool expand = true,
+    size_t limit = 0,
+    size_t* matchesOut = nullptr
 ) {
-    auto expandedTerms = expandQuery(queryWords);
+    auto expandedTerms = expandQuery(queryWords, expand);
+    if (expandedTermsOut) *expandedTermsOut = expandedTerms;
 
     if (verbose) {
         std::cout << "Query expansion (" << expandedTerms.size() << " terms):" << std::endl;
@@ -822,61 +1339,224 @@ std::vector<SearchResult> semanticSearch(
         }
     }
 
-    std::unordered_map<std::string, SearchResult> docResults;
     int originalTermCount = static_cast<int>(queryWords.size());
+    std::vector<ltr::QueryTerm> rankTerms;
+    std::vector<SearchResult> results;
 
-    for (const auto& term : expandedTerms) {
-        std::vector<DocPosting> postings;
-        int df, barrelId;
+    if (limit > 0 && g_cache.staticRankOrder && (mode == OR_MODE || originalTermCount == 1)) {
+        size_t matches = 0;
+        results = staticRankSearch(config, expandedTerms, originalTermCount, limit, rankTerms, matches, verbose);
+        if (matchesOut) *matchesOut = matches;
+    } else {
+        std::unordered_map<std::string, uint32_t> extraOrdinals;
+        std::vector<std::string> extraIds;
+        std::vector<RankedList> lists;
+        for (const auto& term : expandedTerms) {
+            RankedList list;
+            if (!readRankedList(config, term.lemmaId, list, extraOrdinals, extraIds)) {
+                continue;
+            }
+            rankTerms.push_back({term.lemmaId, term.weight, list.df, term.weight >= 1.0f});
+            list.weight = term.weight;
+            lists.push_back(std::move(list));
+        }
 
-        if (!findPostingsBinary(config, term.lemmaId, postings, df, barrelId)) {
-            continue;
+        int requiredTerms = (mode == AND_MODE) ? originalTermCount : 1;
+        results = accumulateTerms(config, lists, extraIds, requiredTerms, originalTermCount);
+        if (matchesOut) *matchesOut = results.size();
+
+        std::sort(results.begin(), results.end(),
+                  [](const SearchResult& a, const SearchResult& b) {
+                      return a.totalScore > b.totalScore;
+                  });
+    }
+
+    std::string queryText;
+    for (const auto& word : queryWords) queryText += (queryText.empty() ? "" : " ") + word;
+    rerankTopResults(config, rankTerms, queryText, results, verbose);
+
+    return results;
+}
+
+// ===================== Hybrid Search =====================
+
+// Loads the document vectors and the index written by docVectorBuilder
+// (indexType "hnsw" or "ivfpq"). Vector hits are docIDs, so the document
+// store is needed for PMC IDs.
+void loadDenseIndex(const json& config, const std::string& indexType) {
+    if (g_cache.docVectors) return;
+    if (!g_cache.docStore) {
+        throw std::runtime_error("Hybrid search needs the document store (run packCorpus)");
+    }
+
+    auto start = high_resolution_clock::now();
+    fs::path denseDir = g_cache.backendDir / config["indexes_dir"].get<std::string>() /
+                        config.value("dense_dir", "dense");
+    g_cache.docVectors = std::make_unique<dense_index::Vectors>(denseDir / "doc_vectors.bin");
+    g_cache.lemmaVectors = std::make_unique<dense_index::LemmaVectors>(denseDir / "lemma_vectors.bin");
+    g_cache.vectorIndex = indexType;
+
+    size_t indexed = 0;
+    if (indexType == "ivfpq") {
+        g_cache.ivfpq.load(denseDir / "ivfpq.bin", g_cache.docVectors->size(), g_cache.docVectors->dim());
+        indexed = g_cache.ivfpq.indexed();
+    } else if (indexType == "hnsw") {
+        g_cache.hnsw.load(denseDir / "hnsw.bin", g_cache.docVectors->size());
+        indexed = g_cache.hnsw.nodes();
+    } else {
+        throw std::runtime_error("Unknown vector index '" + indexType + "' (hnsw or ivfpq)");
+    }
+
+    auto ms = duration_cast<milliseconds>(high_resolution_clock::now() - start).count();
+    std::cout << "[Loaded " << (indexType == "ivfpq" ? "IVF-PQ" : "HNSW") << " index of " << indexed
+              << " document vectors in " << ms << "ms]" << std::endl;
+}
+
+struct VectorHit {
+    std::string docId;
+    float cosine;
+};
+
+// Nearest documents to the query's vector (the idf-weighted sum of its
+// lemmas' embeddings), best first
+std::vector<VectorHit> vectorSearch(const json& config, const std::vector<int>& queryLemmas, size_t k) {
+    std::vector<VectorHit> hits;
+    std::vector<float> query = g_cache.lemmaVectors->queryVector(queryLemmas);
+    if (query.empty() || query.size() != g_cache.docVectors->dim()) return hits;
+
+    std::vector<dense_index::Neighbor> nearest;
+    if (g_cache.vectorIndex == "ivfpq") {
+        nearest = g_cache.ivfpq.search(*g_cache.docVectors, query.data(), k, config.value("ivf_nprobe", 16),
+                                       std::max<size_t>(k, config.value("pq_rerank", 200)));
+    } else {
+        nearest = g_cache.hnsw.search(*g_cache.docVectors, query.data(), k,
+                                      std::max<size_t>(k, config.value("hnsw_ef_search", 64)));
+    }
+    for (const auto& n : nearest) {
+        if (n.docId < g_cache.docStore->size()) {
+            hits.push_back({std::string(g_cache.docStore->pmcId(n.docId)), n.score});
         }
+    }
+    return hits;
+}
 
-        for (const auto& posting : postings) {
-            double tfidf = calculateTFIDF(posting.tf, df);
-
-            auto& result = docResults[posting.docId];
-            if (result.docId.empty()) {
-                result.docId = posting.docId;
-                result.tfidfScore = 0.0;
-                result.semanticScore = 0.0;
-                result.pagerankScore = getDocScore(posting.docId);
-                result.matchedTerms = 0;
-                result.totalTerms = originalTermCount;
-            }
+struct HybridResult {
+    SearchResult lexical;  // zero scores when only the vector leg found it
+    int lexicalRank = 0;   // 1-based; 0 = not in that leg's list
+    int vectorRank = 0;
+    float cosine = 0.0f;
+    double fusedScore = 0.0;
+};
 
-            result.tfidfScore += tfidf * term.weight;
+struct HybridStats {
+    size_t lexicalMatches = 0;
+    size_t lexicalUsed = 0;
+    size_t vectorHits = 0;
+    double lexicalMs = 0.0;
+    double vectorMs = 0.0;
+};
 
-            if (term.weight < 1.0f) {
-                result.semanticScore += tfidf * term.weight;
-            }
+// Runs the lexical search (query terms only, no expansion) and the vector
+// search in parallel and fuses their top `depth` lists by reciprocal rank:
+// score(d) = sum over lists of 1 / (rrfK + rank(d)).
+std::vector<HybridResult> hybridSearch(
+    const json& config,
+    const std::vector<std::string>& queryWords,
+    QueryMode mode,
+    HybridStats& stats
+) {
+    const size_t depth = config.value("hybrid_depth", 100);
+    const double rrfK = config.value("rrf_k", 60.0);
 
-            if (term.weight >= 1.0f) {
-                result.matchedTerms++;
-            }
+    std::vector<int> queryLemmas;
+    for (const auto& word : queryWords) {
+        int lemmaId;
+        if (getLemmaIdForWord(word, lemmaId)) queryLemmas.push_back(lemmaId);
+    }
+
+    auto vectorLeg = std::async(std::launch::async, [&]() {
+        auto start = high_resolution_clock::now();
+        auto hits = vectorSearch(config, queryLemmas, depth);
+        stats.vectorMs = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000.0;
+        return hits;
+    });
+
+    auto lexicalStart = high_resolution_clock::now();
+    auto lexical = semanticSearch(config, queryWords, mode, false, nullptr, false, g_cache.lexicalLimit ? depth : 0,
+                                  &stats.lexicalMatches);
+    stats.lexicalMs = duration_cast<microseconds>(high_resolution_clock::now() - lexicalStart).count() / 1000.0;
+    auto vector = vectorLeg.get();
+
+    stats.lexicalUsed = std::min(depth, lexical.size());
+    stats.vectorHits = vector.size();
+
+    std::unordered_map<std::string, HybridResult> fused;
+    for (size_t i = 0; i < stats.lexicalUsed; i++) {
+        auto& r = fused[lexical[i].docId];
+        r.lexical = lexical[i];
+        r.lexicalRank = static_cast<int>(i + 1);
+        r.fusedScore += 1.0 / (rrfK + r.lexicalRank);
+    }
+    for (size_t i = 0; i < vector.size(); i++) {
+        auto& r = fused[vector[i].docId];
+        if (r.lexicalRank == 0) {
+            r.lexical = {vector[i].docId, 0.0, 0.0, 0.0, getDocScore(vector[i].docId), 0,
+                         static_cast<int>(queryWords.size())};
         }
+        r.vectorRank = static_cast<int>(i + 1);
+        r.cosine = vector[i].cosine;
+        r.fusedScore += 1.0 / (rrfK + r.vectorRank);
     }
 
-    std::vector<SearchResult> results;
-    int requiredTerms = (mode == AND_MODE) ? originalTermCount : 1;
+    std::vector<HybridResult> results;
+    results.reserve(fused.size());
+    for (auto& [docId, r] : fused) results.push_back(std::move(r));
+    std::sort(results.begin(), results.end(), [](const HybridResult& a, const HybridResult& b) {
+        return a.fusedScore != b.fusedScore ? a.fusedScore > b.fusedScore : a.lexical.docId < b.lexical.docId;
+    });
+    return results;
+}
 
-    for (auto& [docId, result] : docResults) {
-        if (result.matchedTerms >= requiredTerms) {
-            result.totalScore = TFIDF_WEIGHT * result.tfidfScore +
-                               SEMANTIC_WEIGHT * result.semanticScore +
-                               PAGERANK_WEIGHT * result.pagerankScore;
+// ===================== Result Documents and Snippets =====================
 
-            results.push_back(result);
+struct ResultDoc {
+    bool found = false;
+    doc_store::DocRecord rec;
+    std::string snippet;
+};
+
+// Post-ranking stage, run on the final top-K only: fetches each result's
+// record from the document store and cuts its query-biased snippet.
+// Documents missing from the store (new uploads) come back with found = false.
+// elapsedMsOut receives the stage's own wall time.
+std::vector<ResultDoc> loadResultDocs(const std::vector<std::string>& pmcIds,
+                                      const snippet::TermWeights& terms,
+                                      const snippet::Options& opts,
+                                      double& elapsedMsOut) {
+    auto start = high_resolution_clock::now();
+    std::vector<ResultDoc> docs(pmcIds.size());
+    elapsedMsOut = 0.0;
+    if (!g_cache.docStore) return docs;
+
+    for (size_t i = 0; i < pmcIds.size(); i++) {
+        uint32_t docId;
+        if (g_cache.docStore->findDocId(pmcIds[i], docId) && g_cache.docStore->get(docId, docs[i].rec)) {
+            docs[i].found = true;
+            docs[i].snippet = snippet::generate(docs[i].rec, terms, opts);
         }
     }
 
-    std::sort(results.begin(), results.end(),
-              [](const SearchResult& a, const SearchResult& b) {
-                  return a.totalScore > b.totalScore;
-              });
+    elapsedMsOut = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000.0;
+    return docs;
+}
 
-    return results;
+// Prints title/authors/abstract/snippet lines under a result line.
+void printResultDoc(const ResultDoc& doc) {
+    if (!doc.found) return;
+    doc_store::printRecord(std::cout, doc.rec);
+    if (!doc.snippet.empty()) {
+        std::cout << "   Snippet: " << doc.snippet << "\n";
+    }
 }
 
 // ===================== Main =====================
@@ -885,6 +1565,11 @@ void printUsage(const char* progName) {
     std::cout << "Usage:\n";
     std::cout << "  " << progName << " \"query\"                    # Semantic search\n";
     std::cout << "  " << progName << " \"query\" --or               # OR mode\n";
+    std::cout << "  " << progName << " \"query\" --no-rerank        # First-stage ranking only\n";
+    std::cout << "  " << progName << " \"query\" --ltr-features f   # Append re-rank features to f\n";
+    std::cout << "  " << progName << " \"query\" --exhaustive       # Score every match (no early termination)\n";
+    std::cout << "  " << progName << " \"query\" --hybrid           # Lexical + document vectors (RRF)\n";
+    std::cout << "  " << progName << " \"query\" --hybrid --vector-index ivfpq   # hnsw or ivfpq\n";
     std::cout << "  " << progName << " --autocomplete \"prefix\"    # Get suggestions\n";
     std::cout << "  " << progName << " --similar \"word\"           # Find similar words\n";
 }
@@ -902,6 +1587,11 @@ int main(int argc, char* argv[]) {
         QueryMode mode = AND_MODE;
         bool autocompleteMode = false;
         bool similarMode = false;
+        bool hybridMode = false;
+        bool rerank = true;
+        bool exhaustive = false;
+        std::string featureLogPath;
+        std::string vectorIndex;
 
         for (int i = 1; i < argc; i++) {
             std::string arg = argv[i];
@@ -910,6 +1600,16 @@ int main(int argc, char* argv[]) {
                 mode = OR_MODE;
             } else if (arg == "--and" || arg == "-a") {
                 mode = AND_MODE;
+            } else if (arg == "--hybrid") {
+                hybridMode = true;
+            } else if (arg == "--no-rerank") {
+                rerank = false;
+            } else if (arg == "--exhaustive") {
+                exhaustive = true;
+            } else if (arg == "--ltr-features" && i + 1 < argc) {
+                featureLogPath = argv[++i];
+            } else if (arg == "--vector-index" && i + 1 < argc) {
+                vectorIndex = argv[++i];
             } else if (arg == "--autocomplete" || arg == "-ac") {
                 autocompleteMode = true;
                 if (i + 1 < argc) {
@@ -937,6 +1637,9 @@ int main(int argc, char* argv[]) {
         json config = loadConfig(backendDir);
 
         initializeCache(backendDir, config);
+        if (!rerank) g_cache.ranker.reset();
+        g_cache.featureLogPath = featureLogPath;
+        g_cache.lexicalLimit = !exhaustive;
 
         auto searchStart = high_resolution_clock::now();
 
@@ -997,10 +1700,77 @@ int main(int argc, char* argv[]) {
             return 1;
         }
 
+        if (hybridMode) {
+            if (vectorIndex.empty()) {
+                vectorIndex = config.value("dense_index", "hnsw");
+                if (vectorIndex == "both") vectorIndex = "hnsw";
+            }
+            loadDenseIndex(config, vectorIndex);
+            auto hybridStart = high_resolution_clock::now();
+
+            std::cout << "Hybrid Search: '" << queryString << "' ("
+                      << (mode == AND_MODE ? "AND" : "OR") << " mode)\n" << std::endl;
+
+            HybridStats stats;
+            auto results = hybridSearch(config, queryWords, mode, stats);
+            auto searchTime = duration_cast<milliseconds>(high_resolution_clock::now() - hybridStart).count();
+
+            std::cout << "[Hybrid: lexical top " << stats.lexicalUsed << " of " << stats.lexicalMatches
+                      << " matches (" << stats.lexicalMs << "ms), vector top " << stats.vectorHits
+                      << " (" << stats.vectorMs << "ms), fused " << results.size() << "]" << std::endl;
+
+            if (results.empty()) {
+                std::cout << "\nNo documents found.\n";
+                return 0;
+            }
+
+            std::cout << "\nFound " << stats.lexicalMatches << " lexical matches, " << results.size()
+                      << " fused documents\n";
+            std::cout << "\nTop 20 results (in " << searchTime << "ms):\n" << std::endl;
+
+            const size_t TOP_K = 20;
+            std::vector<std::string> topIds;
+            for (size_t i = 0; i < std::min(TOP_K, results.size()); i++) {
+                topIds.push_back(results[i].lexical.docId);
+            }
+            snippet::TermWeights terms;
+            for (const auto& term : expandQuery(queryWords, false)) {
+                terms[term.lemmaId] = term.weight;
+            }
+            double snippetMs = 0.0;
+            auto docs = loadResultDocs(topIds, terms, snippet::optionsFromConfig(config), snippetMs);
+
+            for (size_t i = 0; i < docs.size(); i++) {
+                const auto& h = results[i];
+                const auto& r = h.lexical;
+                std::cout << (i + 1) << ". DocID: " << r.docId
+                          << " | Score: " << h.fusedScore
+                          << " | TF-IDF: " << r.tfidfScore
+                          << " | PageRank: " << r.pagerankScore
+                          << " | Matched: " << r.matchedTerms << "/" << r.totalTerms
+                          << " | Lexical: " << (h.lexicalRank ? std::to_string(h.lexicalRank) : "-")
+                          << " | Vector: " << (h.vectorRank ? std::to_string(h.vectorRank) : "-");
+                if (h.vectorRank) std::cout << " (cos " << h.cosine << ")";
+                std::cout << std::endl;
+                printResultDoc(docs[i]);
+            }
+
+            auto totalTime = duration_cast<milliseconds>(high_resolution_clock::now() - totalStart).count();
+            std::cout << "\n[Snippet stage: " << docs.size() << " docs, " << snippetMs << "ms]" << std::endl;
+            std::cout << "[Total time: " << totalTime << "ms]" << std::endl;
+            return 0;
+        }
+
         std::cout << "Semantic Search: '" << queryString << "' ("
                   << (mode == AND_MODE ? "AND" : "OR") << " mode)\n" << std::endl;
 
-        auto results = semanticSearch(config, queryWords, mode);
+        // The printed results and the re-rank candidates
+        const size_t TOP_K = 20;
+        size_t limit = exhaustive ? 0 : std::max<size_t>(TOP_K, config.value("ltr_rerank_depth", 200));
+
+        std::vector<ExpandedTerm> expandedTerms;
+        size_t matches = 0;
+        auto results = semanticSearch(config, queryWords, mode, true, &expandedTerms, true, limit, &matches);
 
         auto searchEnd = high_resolution_clock::now();
         auto searchTime = duration_cast<milliseconds>(searchEnd - searchStart).count();
@@ -1010,11 +1780,22 @@ int main(int argc, char* argv[]) {
             return 0;
         }
 
-        std::cout << "\nFound " << results.size() << " documents\n";
+        std::cout << "\nFound " << matches << " documents\n";
         std::cout << "\nTop 20 results (in " << searchTime << "ms):\n" << std::endl;
 
-        const size_t TOP_K = 20;
+        // Snippet stage: final top-K only, highlighting original and expanded terms
+        std::vector<std::string> topIds;
         for (size_t i = 0; i < std::min(TOP_K, results.size()); i++) {
+            topIds.push_back(results[i].docId);
+        }
+        snippet::TermWeights terms;
+        for (const auto& term : expandedTerms) {
+            terms[term.lemmaId] = term.weight;
+        }
+        double snippetMs = 0.0;
+        auto docs = loadResultDocs(topIds, terms, snippet::optionsFromConfig(config), snippetMs);
+
+        for (size_t i = 0; i < docs.size(); i++) {
             const auto& r = results[i];
             std::cout << (i + 1) << ". DocID: " << r.docId
                       << " | Score: " << r.totalScore
@@ -1022,12 +1803,14 @@ int main(int argc, char* argv[]) {
                       << " | PageRank: " << r.pagerankScore
                       << " | Matched: " << r.matchedTerms << "/" << r.totalTerms
                       << std::endl;
+            printResultDoc(docs[i]);
         }
 
         auto totalEnd = high_resolution_clock::now();
         auto totalTime = duration_cast<milliseconds>(totalEnd - totalStart).count();
 
-        std::cout << "\n[Total time: " << totalTime << "ms]" << std::endl;
+        std::cout << "\n[Snippet stage: " << docs.size() << " docs, " << snippetMs << "ms]" << std::endl;
+        std::cout << "[Total time: " << totalTime << "ms]" << std::endl;
 
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << "\n";
@@ -0,0 +1,301 @@
+/*
+ * Shard Builder
+ *
+ * Splits the forward index into N document-partitioned shards (see
+ * shard_index.hpp). Each shard gets its own barrels, document lengths and
+ * stats; corpus-wide df and N go to global files the coordinator reads.
+ *
+ * Partitioning (--partition, default config "shard_partition"):
+ * - round-robin  documents dealt by docID (forward_index.txt line number);
+ *                even shard sizes and term distributions
+ * - kmeans       spherical k-means over document vectors (see shard_cluster.hpp)
+ *                gives topical shards, so the coordinator can route a query
+ *                to only the few shards that hold its topic
+ *
+ * Either way the build also writes selection.bin (per-shard term df) for
+ * query routing; kmeans adds centroids.bin.
+ *
+ * Memory stays bounded by one shard's postings: a first pass over the forward
+ * index collects global df, k-means trains on a sample and assigns documents
+ * in one more streaming pass, then each shard is built by its own pass.
+ *
+ * Usage (from backend/cpp, like the other index builders):
+ *   ./build/shardBuilder              # num_shards from config.json
+ *   ./build/shardBuilder --shards 4
+ *   ./build/shardBuilder --shards 16 --partition kmeans [--features lemmas|embeddings]
+ *
+ * Then start one shardServer per shard and query with searchCoordinator.
+ */
+
+#include "config.hpp"
+#include "lexicon.hpp"
+#include "shard_index.hpp"
+#include "shard_cluster.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <chrono>
+#include <memory>
+
+using namespace std;
+using namespace chrono;
+
+// One parsed forward index line
+struct ForwardDoc {
+    string docId;
+    unordered_map<int, int> termFreqs;
+    int length = 0;
+};
+
+// Parses "doc_id|total_terms|title|abstract|body" (lemma lists comma-separated)
+bool parseForwardLine(const string& line, ForwardDoc& doc) {
+    size_t bar1 = line.find('|');
+    size_t bar2 = (bar1 == string::npos) ? string::npos : line.find('|', bar1 + 1);
+    if (bar2 == string::npos) return false;
+
+    doc.docId = line.substr(0, bar1);
+    doc.termFreqs.clear();
+    doc.length = 0;
+
+    const char* p = line.c_str() + bar2 + 1;
+    while (*p) {
+        if (*p == '|' || *p == ',') {
+            p++;
+            continue;
+        }
+        char* end;
+        long lemma = strtol(p, &end, 10);
+        if (end == p) {
+            p++;
+            continue;
+        }
+        doc.termFreqs[static_cast<int>(lemma)]++;
+        doc.length++;
+        p = end;
+    }
+    return true;
+}
+
+void loadLemmaTable(const fs::path& indexesDir, const json& config, LemmaTable& table) {
+    if (loadLemmaTableBinary((indexesDir / "embeddings" / "lexicon.bin").string(), table)) {
+        return;
+    }
+    fs::path lexiconPath = indexesDir / config["lexicon_file"].get<string>();
+    ifstream lexFile(lexiconPath);
+    if (!lexFile.is_open()) {
+        throw runtime_error("Cannot open lexicon at " + lexiconPath.string());
+    }
+    json lexicon;
+    lexFile >> lexicon;
+    loadLemmaTableJSON(lexicon, table);
+}
+
+// Clusters documents with spherical k-means; returns each docID's shard and
+// writes centroids.bin. Falls back to lemma features if embeddings are missing.
+vector<int> clusterDocuments(const fs::path& forwardIndexPath, const fs::path& indexesDir,
+                             const fs::path& shardsDir, const json& config,
+                             const unordered_map<int, int>& globalDf, int64_t numDocs,
+                             int numShards, string features, int iterations, int64_t sampleSize) {
+    unique_ptr<shard_cluster::FeatureSpace> space;
+    if (features == "embeddings") {
+        try {
+            LemmaTable words;
+            loadLemmaTable(indexesDir, config, words);
+            space = make_unique<shard_cluster::FeatureSpace>(globalDf, numDocs,
+                                                             (indexesDir / "embeddings").string(), words);
+            cout << "Embedding features: " << space->dim() << " dims, "
+                 << space->embeddedLemmas() << " lemmas with vectors" << endl;
+        } catch (exception& e) {
+            cerr << "Warning: " << e.what() << " - clustering on lemma vectors instead" << endl;
+        }
+    }
+    if (!space) {
+        space = make_unique<shard_cluster::FeatureSpace>(globalDf, numDocs);
+        cout << "Lemma features: " << space->dim() << " dims" << endl;
+    }
+
+    // Train on every stride-th document
+    int64_t stride = max<int64_t>(1, (numDocs + sampleSize - 1) / sampleSize);
+    vector<shard_cluster::SparseVec> sample;
+    {
+        ifstream in(forwardIndexPath);
+        string line;
+        ForwardDoc doc;
+        int64_t docId = 0;
+        while (getline(in, line)) {
+            if (!parseForwardLine(line, doc)) continue;
+            if (docId % stride == 0) {
+                sample.push_back(space->docVector(doc.termFreqs));
+            }
+            docId++;
+        }
+    }
+
+    auto trainStart = high_resolution_clock::now();
+    auto centroids = shard_cluster::kmeans(sample, static_cast<uint32_t>(numShards), space->dim(),
+                                           space->features(), iterations);
+    auto trainMs = duration_cast<milliseconds>(high_resolution_clock::now() - trainStart).count();
+    cout << "k-means: " << centroids.k << " clusters from " << sample.size()
+         << " sampled docs in " << trainMs << "ms" << endl;
+    shard_cluster::writeCentroids((shardsDir / "centroids.bin").string(), centroids);
+
+    // Assign every document to its nearest centroid
+    vector<int> assignment;
+    assignment.reserve(numDocs);
+    ifstream in(forwardIndexPath);
+    string line;
+    ForwardDoc doc;
+    while (getline(in, line)) {
+        if (!parseForwardLine(line, doc)) continue;
+        assignment.push_back(static_cast<int>(centroids.nearest(space->docVector(doc.termFreqs))));
+    }
+    return assignment;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        cout << "======================================" << endl;
+        cout << "  SHARD BUILDER" << endl;
+        cout << "======================================\n" << endl;
+
+        // this file is in backend/cpp
+        fs::path backendDir = fs::current_path().parent_path();
+        json config = loadConfig(backendDir);
+
+        int numShards = config.value("num_shards", 4);
+        string partition = config.value("shard_partition", "round-robin");
+        string features = config.value("kmeans_features", "embeddings");
+        int iterations = config.value("kmeans_iterations", 15);
+        int64_t sampleSize = config.value("kmeans_sample", 20000);
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            if ((arg == "--shards" || arg == "-n") && i + 1 < argc) {
+                numShards = stoi(argv[++i]);
+            } else if (arg == "--partition" && i + 1 < argc) {
+                partition = argv[++i];
+            } else if (arg == "--features" && i + 1 < argc) {
+                features = argv[++i];
+            } else if (arg == "--iterations" && i + 1 < argc) {
+                iterations = stoi(argv[++i]);
+            }
+        }
+        if (numShards < 1) {
+            throw runtime_error("--shards must be at least 1");
+        }
+        if (partition != "round-robin" && partition != "kmeans") {
+            throw runtime_error("Unknown --partition '" + partition + "' (round-robin or kmeans)");
+        }
+
+        fs::path indexesDir = backendDir / config["indexes_dir"].get<string>();
+        fs::path forwardIndexPath = indexesDir / config["forward_index_file"].get<string>();
+        fs::path shardsDir = indexesDir / config.value("shards_dir", "shards");
+
+        cout << "Configuration:" << endl;
+        cout << "  Input: " << forwardIndexPath.string() << endl;
+        cout << "  Output: " << shardsDir.string() << endl;
+        cout << "  Shards: " << numShards << " (" << partition << ")\n" << endl;
+
+        auto startTime = high_resolution_clock::now();
+
+        // Pass 1: global df, N and average document length
+        unordered_map<int, int> globalDf;
+        int64_t numDocs = 0;
+        int64_t totalLength = 0;
+        {
+            ifstream in(forwardIndexPath);
+            if (!in.is_open()) {
+                throw runtime_error("Cannot open forward index at " + forwardIndexPath.string());
+            }
+            string line;
+            ForwardDoc doc;
+            while (getline(in, line)) {
+                if (!parseForwardLine(line, doc)) continue;
+                for (const auto& [lemma, tf] : doc.termFreqs) {
+                    globalDf[lemma]++;
+                }
+                totalLength += doc.length;
+                numDocs++;
+            }
+        }
+
+        if (numDocs == 0) {
+            throw runtime_error("Forward index is empty");
+        }
+        double avgDocLength = static_cast<double>(totalLength) / numDocs;
+
+        cout << "Documents: " << numDocs << ", terms: " << globalDf.size()
+             << ", avg doc length: " << avgDocLength << endl;
+
+        fs::create_directories(shardsDir);
+        fs::remove(shardsDir / "centroids.bin");
+        shard_index::writeGlobalDf((shardsDir / "global_df.bin").string(), globalDf);
+
+        vector<int> assignment;
+        if (partition == "kmeans") {
+            assignment = clusterDocuments(forwardIndexPath, indexesDir, shardsDir, config, globalDf,
+                                          numDocs, numShards, features, iterations, sampleSize);
+        } else {
+            assignment.resize(numDocs);
+            for (int64_t d = 0; d < numDocs; d++) {
+                assignment[d] = static_cast<int>(d % numShards);
+            }
+        }
+
+        json globalStats;
+        globalStats["num_shards"] = numShards;
+        globalStats["num_docs"] = numDocs;
+        globalStats["avg_doc_length"] = avgDocLength;
+        globalStats["partition"] = partition;
+        ofstream(shardsDir / "global_stats.json") << globalStats.dump(4) << endl;
+
+        shard_cluster::ShardSummary summary;
+
+        // One pass per shard
+        for (int shard = 0; shard < numShards; shard++) {
+            auto shardStart = high_resolution_clock::now();
+
+            shard_index::ShardWriter writer;
+            ifstream in(forwardIndexPath);
+            string line;
+            ForwardDoc doc;
+            int64_t docId = 0;
+
+            while (getline(in, line)) {
+                if (!parseForwardLine(line, doc)) continue;
+                if (assignment[docId] == shard) {
+                    writer.addDocument(doc.docId, doc.termFreqs, doc.length);
+                }
+                docId++;
+            }
+
+            fs::path dir = shardsDir / shard_index::shardDirName(shard);
+            fs::create_directories(dir);
+            writer.write(dir.string(), shard, globalDf);
+            summary.numDocs.push_back(static_cast<int32_t>(writer.numDocs()));
+            summary.df.push_back(writer.localDf());
+
+            auto ms = duration_cast<milliseconds>(high_resolution_clock::now() - shardStart).count();
+            cout << "Shard " << shard << ": " << writer.numDocs() << " docs, "
+                 << writer.numTerms() << " terms (" << ms << "ms)" << endl;
+        }
+
+        shard_cluster::writeSummary((shardsDir / "selection.bin").string(), summary);
+
+        auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - startTime).count();
+
+        cout << "\n=== Shards Complete ===" << endl;
+        cout << "Location: " << shardsDir.string() << endl;
+        cout << "Time: " << duration << "ms" << endl;
+
+    } catch (exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
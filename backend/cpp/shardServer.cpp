@@ -0,0 +1,224 @@
+/*
+ * Shard Server
+ *
+ * Serves one document-partitioned shard (built by shardBuilder) over TCP
+ * using the line protocol in shard_protocol.hpp. The coordinator sends the
+ * query's lemma IDs with their corpus-wide df; the shard scores its own
+ * postings with BM25 and returns its local top-K.
+ *
+ * Every connection gets its own thread; the shard's offset tables and doc
+ * lengths are shared read-only.
+ *
+ * Usage (from backend/cpp):
+ *   ./build/shardServer --shard 0                  # port = shard_base_port + 0
+ *   ./build/shardServer --shard 1 --port 7201
+ *   ./build/shardServer --shard 0 --dir /data/shards/shard_0
+ *
+ * Replicas: start the same shard again with --replica R; its default port is
+ * shard_base_port + R * shard_replica_port_stride + shard.
+ *   ./build/shardServer --shard 0 --replica 1       # port 7200
+ *
+ * Straggler injection for testing hedged requests: with --delay-ms D and
+ * --delay-prob P, each SEARCH sleeps D ms with probability P before answering.
+ *
+ * Run several on one box (one per shard and replica) to test the cluster locally:
+ *   ./run.sh --shards
+ */
+
+#include "config.hpp"
+#include "net.hpp"
+#include "shard_index.hpp"
+#include "shard_protocol.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <random>
+
+using namespace std;
+using namespace chrono;
+
+// Scores the shard's postings for a query and returns its top-K.
+shard_protocol::Response searchShard(const shard_index::ShardReader& shard, const shard_protocol::Query& q) {
+    shard_protocol::Response resp;
+    const size_t numTerms = q.terms.size();
+    const int fallbackLength = static_cast<int>(q.avgDocLength);
+
+    unordered_map<string, shard_protocol::Hit> acc;
+    vector<shard_index::Posting> postings;
+
+    for (size_t i = 0; i < numTerms; i++) {
+        const auto& [lemmaId, df] = q.terms[i];
+        if (!shard.readPostings(lemmaId, postings)) continue;
+        resp.postingsScanned += static_cast<int64_t>(postings.size());
+
+        for (const auto& p : postings) {
+            string docId(p.docId, find(p.docId, p.docId + shard_index::DOC_ID_SIZE, '\0'));
+            auto& hit = acc[docId];
+            if (hit.termFreqs.empty()) {
+                hit.docId = docId;
+                hit.termFreqs.assign(numTerms, 0);
+            }
+            hit.score += shard_index::bm25(p.tf, df, shard.docLength(docId, fallbackLength),
+                                           q.totalDocs, q.avgDocLength);
+            hit.matchedTerms++;
+            hit.termFreqs[i] = p.tf;
+        }
+    }
+
+    int required = q.andMode ? static_cast<int>(numTerms) : 1;
+    for (auto& [docId, hit] : acc) {
+        if (hit.matchedTerms >= required) {
+            resp.numMatched++;
+            resp.hits.push_back(std::move(hit));
+        }
+    }
+
+    auto better = [](const shard_protocol::Hit& a, const shard_protocol::Hit& b) {
+        if (a.score != b.score) return a.score > b.score;
+        return a.docId < b.docId;
+    };
+    size_t k = min(resp.hits.size(), static_cast<size_t>(q.topK));
+    partial_sort(resp.hits.begin(), resp.hits.begin() + k, resp.hits.end(), better);
+    resp.hits.resize(k);
+    resp.ok = true;
+    return resp;
+}
+
+// Artificial slowness for exercising hedging locally
+struct DelayInjection {
+    int delayMs = 0;
+    double probability = 0.0;
+
+    void maybeSleep() const {
+        if (delayMs <= 0 || probability <= 0.0) return;
+        thread_local mt19937 rng(random_device{}());
+        if (uniform_real_distribution<double>(0.0, 1.0)(rng) < probability) {
+            this_thread::sleep_for(milliseconds(delayMs));
+        }
+    }
+};
+
+void serveConnection(const net::Socket& conn, const shard_index::ShardReader& shard, int shardId,
+                     const DelayInjection& delay) {
+    net::LineReader reader(conn.get());
+    string line;
+    if (!reader.readLine(line, net::Clock::now() + seconds(10))) {
+        return;
+    }
+
+    if (line == "PING") {
+        net::writeAll(conn.get(), "PONG " + to_string(shardId) + " " + to_string(shard.numDocs()) + "\n");
+        return;
+    }
+
+    shard_protocol::Query query;
+    if (!shard_protocol::parseQuery(line, query)) {
+        net::writeAll(conn.get(), "ERR malformed request\n");
+        return;
+    }
+
+    delay.maybeSleep();
+    auto resp = searchShard(shard, query);
+
+    string out = "OK " + to_string(resp.hits.size()) + " " + to_string(resp.numMatched) + " "
+               + to_string(resp.postingsScanned) + "\n";
+    for (const auto& hit : resp.hits) {
+        out += shard_protocol::formatHit(hit);
+    }
+    out += "END\n";
+    net::writeAll(conn.get(), out);
+}
+
+// Runs on a detached thread, where an uncaught exception would terminate
+// the server: any failure is answered with ERR, and the socket closes when
+// conn goes out of scope
+void handleConnection(net::Socket conn, const shard_index::ShardReader& shard, int shardId,
+                      const DelayInjection& delay) {
+    try {
+        serveConnection(conn, shard, shardId, delay);
+    } catch (const exception& e) {
+        cerr << "Shard " << shardId << ": request failed: " << e.what() << endl;
+        net::writeAll(conn.get(), "ERR malformed request\n");
+    }
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        int shardId = -1;
+        int replica = 0;
+        int port = -1;
+        string dirArg;
+        DelayInjection delay;
+
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            if (arg == "--shard" && i + 1 < argc) {
+                shardId = stoi(argv[++i]);
+            } else if (arg == "--replica" && i + 1 < argc) {
+                replica = stoi(argv[++i]);
+            } else if (arg == "--delay-ms" && i + 1 < argc) {
+                delay.delayMs = stoi(argv[++i]);
+            } else if (arg == "--delay-prob" && i + 1 < argc) {
+                delay.probability = stod(argv[++i]);
+            } else if (arg == "--port" && i + 1 < argc) {
+                port = stoi(argv[++i]);
+            } else if (arg == "--dir" && i + 1 < argc) {
+                dirArg = argv[++i];
+            }
+        }
+
+        if (shardId < 0) {
+            cerr << "Usage: shardServer --shard <id> [--replica <r>] [--port <port>] [--dir <shard dir>]"
+                 << " [--delay-ms <ms> --delay-prob <p>]" << endl;
+            return 1;
+        }
+
+        // this file is in backend/cpp
+        fs::path backendDir = fs::current_path().parent_path();
+        json config = loadConfig(backendDir);
+
+        fs::path indexesDir = backendDir / config["indexes_dir"].get<string>();
+        fs::path shardDir = dirArg.empty()
+            ? indexesDir / config.value("shards_dir", "shards") / shard_index::shardDirName(shardId)
+            : fs::path(dirArg);
+        if (port < 0) {
+            port = config.value("shard_base_port", 7100)
+                 + replica * config.value("shard_replica_port_stride", 100) + shardId;
+        }
+
+        auto loadStart = high_resolution_clock::now();
+        shard_index::ShardReader shard(shardDir.string());
+        auto loadMs = duration_cast<milliseconds>(high_resolution_clock::now() - loadStart).count();
+
+        net::Socket listener = net::listenTcp(port);
+
+        cout << "[Shard " << shardId << "] " << shard.numDocs() << " docs, " << shard.numTerms()
+             << " terms loaded from " << shardDir.string() << " in " << loadMs << "ms" << endl;
+        cout << "[Shard " << shardId << "] replica " << replica << " listening on port " << port << endl;
+        if (delay.delayMs > 0) {
+            cout << "[Shard " << shardId << "] injecting " << delay.delayMs << "ms delay on "
+                 << delay.probability * 100 << "% of requests" << endl;
+        }
+
+        while (true) {
+            int fd = ::accept(listener.get(), nullptr, nullptr);
+            if (fd < 0) {
+                if (errno == EINTR) continue;
+                cerr << "accept() failed: " << strerror(errno) << endl;
+                continue;
+            }
+            thread(handleConnection, net::Socket(fd), cref(shard), shardId, cref(delay)).detach();
+        }
+
+    } catch (exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,322 @@
+#pragma once
+
+/*
+ * Replicated Shard Client (hedged requests)
+ *
+ * Each shard may be served by several replicas (identical shardServer
+ * processes). For every query the coordinator asks one replica per shard
+ * and, if that replica has not answered after the shard's recent p95
+ * latency, sends the same request to a second replica and takes whichever
+ * answer arrives first ("hedged request").
+ *
+ * - Replica choice: least outstanding requests, ties broken round-robin.
+ * - A replica that fails outright (refused, reset, ERR) fails over to the
+ *   next untried replica immediately, without waiting for the hedge delay.
+ * - Everything stops at the per-shard deadline; the shard is then reported
+ *   as missing and the coordinator returns a partial result.
+ *
+ * Attempts run on detached threads that own a reference to the ShardGroup,
+ * so a straggler that loses the race finishes (at the latest by the
+ * deadline) without blocking the query.
+ *
+ * POSIX only (uses net.hpp).
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "net.hpp"
+#include "shard_protocol.hpp"
+
+namespace shard_client {
+
+// ---------------------- One request ----------------------
+
+// Reads "OK n matched scanned", n hit lines and "END".
+inline bool readResponse(net::LineReader& reader, net::Clock::time_point deadline, shard_protocol::Response& resp) {
+    std::string line;
+    if (!reader.readLine(line, deadline)) {
+        resp.error = "timed out";
+        return false;
+    }
+    if (line.rfind("ERR", 0) == 0) {
+        resp.error = line.size() > 4 ? line.substr(4) : "shard error";
+        return false;
+    }
+
+    std::istringstream header(line);
+    std::string status;
+    size_t numHits = 0;
+    if (!(header >> status >> numHits >> resp.numMatched >> resp.postingsScanned) || status != "OK") {
+        resp.error = "bad response header";
+        return false;
+    }
+
+    resp.hits.resize(numHits);
+    for (size_t i = 0; i < numHits; i++) {
+        if (!reader.readLine(line, deadline)) {
+            resp.error = "timed out";
+            return false;
+        }
+        if (!shard_protocol::parseHit(line, resp.hits[i])) {
+            resp.error = "bad hit line";
+            return false;
+        }
+    }
+    if (!reader.readLine(line, deadline) || line != "END") {
+        resp.error = "truncated response";
+        return false;
+    }
+    resp.ok = true;
+    return true;
+}
+
+// One request on a fresh connection. Never throws; failures land in resp.error.
+inline void callOnce(const std::string& endpoint, const std::string& request,
+                     net::Clock::time_point deadline, shard_protocol::Response& resp) {
+    try {
+        std::string host;
+        int port;
+        net::parseEndpoint(endpoint, host, port);
+
+        net::Socket sock = net::connectTcp(host, port, deadline);
+        if (!sock.valid()) {
+            resp.error = "connect failed";
+        } else if (!net::writeAll(sock.get(), request)) {
+            resp.error = "send failed";
+        } else {
+            net::LineReader reader(sock.get());
+            readResponse(reader, deadline, resp);
+        }
+    } catch (const std::exception& e) {
+        resp.error = e.what();
+    }
+}
+
+// ---------------------- Replica bookkeeping ----------------------
+
+// Sliding window of recent successful response times (ms).
+class LatencyWindow {
+public:
+    explicit LatencyWindow(size_t capacity = 512) : capacity(capacity) {}
+
+    void add(double ms) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (samples.size() < capacity) {
+            samples.push_back(ms);
+        } else {
+            samples[next] = ms;
+            next = (next + 1) % capacity;
+        }
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return samples.size();
+    }
+
+    // p in [0, 1]. Returns fallback while fewer than minSamples are recorded.
+    double percentile(double p, size_t minSamples, double fallback) const {
+        std::vector<double> copy;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (samples.size() < minSamples || samples.empty()) return fallback;
+            copy = samples;
+        }
+        size_t idx = std::min(copy.size() - 1, static_cast<size_t>(p * copy.size()));
+        std::nth_element(copy.begin(), copy.begin() + idx, copy.end());
+        return copy[idx];
+    }
+
+private:
+    size_t capacity;
+    mutable std::mutex mutex;
+    std::vector<double> samples;
+    size_t next = 0;
+};
+
+struct Replica {
+    std::string endpoint;
+    std::atomic<int> outstanding{0};
+    std::atomic<int64_t> requests{0};
+    std::atomic<int64_t> failures{0};
+
+    explicit Replica(std::string endpoint) : endpoint(std::move(endpoint)) {}
+};
+
+// All replicas of one shard, plus that shard's latency history.
+class ShardGroup {
+public:
+    explicit ShardGroup(const std::vector<std::string>& endpoints) {
+        for (const auto& e : endpoints) {
+            replicas.push_back(std::make_unique<Replica>(e));
+        }
+    }
+
+    size_t size() const { return replicas.size(); }
+    Replica& replica(size_t i) { return *replicas[i]; }
+
+    // Least outstanding requests among replicas not yet tried for this
+    // query; ties go round-robin so idle replicas share the load. -1 if none left.
+    int pick(const std::vector<bool>& tried) {
+        size_t n = replicas.size();
+        size_t start = rotation.fetch_add(1) % n;
+        int best = -1;
+        int bestLoad = 0;
+        for (size_t j = 0; j < n; j++) {
+            size_t i = (start + j) % n;
+            if (tried[i]) continue;
+            int load = replicas[i]->outstanding.load();
+            if (best < 0 || load < bestLoad) {
+                best = static_cast<int>(i);
+                bestLoad = load;
+            }
+        }
+        return best;
+    }
+
+    LatencyWindow latency;
+
+private:
+    std::vector<std::unique_ptr<Replica>> replicas;
+    std::atomic<size_t> rotation{0};
+};
+
+// ---------------------- Hedged query ----------------------
+
+struct HedgePolicy {
+    bool enabled = true;
+    double percentile = 0.95;     // hedge after this quantile of recent latency
+    double defaultDelayMs = 20.0; // used until minSamples responses are recorded
+    size_t minSamples = 20;
+};
+
+struct ShardOutcome {
+    shard_protocol::Response response;
+    std::string endpoint;           // replica whose answer was used
+    std::vector<std::string> errors;
+    double elapsedMs = 0.0;
+    double hedgeDelayMs = 0.0;
+    int attempts = 0;
+    bool hedged = false;            // a second replica was asked after the delay
+    bool hedgeWon = false;          // and its answer was the one used
+    bool timedOut = false;
+};
+
+// Asks the group's replicas for one shard's answer, hedging and failing over
+// as described at the top of this file. Returns by the deadline at the latest.
+inline ShardOutcome query(const std::shared_ptr<ShardGroup>& group, const std::string& request,
+                          net::Clock::time_point deadline, const HedgePolicy& policy) {
+    struct State {
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool done = false;
+        int pending = 0;
+        int winner = -1;
+        shard_protocol::Response response;
+        std::string endpoint;
+        std::vector<std::string> errors;
+    };
+    auto state = std::make_shared<State>();
+    auto start = net::Clock::now();
+
+    ShardOutcome out;
+    out.hedgeDelayMs = std::max(1.0, group->latency.percentile(policy.percentile, policy.minSamples,
+                                                               policy.defaultDelayMs));
+    std::vector<bool> tried(group->size(), false);
+    int hedgeAttempt = -1;
+
+    // Caller holds state->mutex
+    auto launch = [&](int replicaIdx) {
+        tried[replicaIdx] = true;
+        int attempt = out.attempts++;
+        state->pending++;
+
+        Replica& r = group->replica(replicaIdx);
+        r.outstanding++;
+        r.requests++;
+
+        std::thread([state, group, &r, request, deadline, attempt]() {
+            auto t0 = net::Clock::now();
+            shard_protocol::Response resp;
+            callOnce(r.endpoint, request, deadline, resp);
+            double ms = std::chrono::duration_cast<std::chrono::microseconds>(net::Clock::now() - t0).count() / 1000.0;
+            r.outstanding--;
+            if (resp.ok) {
+                group->latency.add(ms);
+            } else {
+                r.failures++;
+            }
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->pending--;
+            if (resp.ok && !state->done) {
+                state->done = true;
+                state->winner = attempt;
+                state->response = std::move(resp);
+                state->endpoint = r.endpoint;
+            } else if (!resp.ok) {
+                state->errors.push_back(r.endpoint + ": " + resp.error);
+            }
+            state->cv.notify_all();
+        }).detach();
+    };
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    int first = group->pick(tried);
+    if (first >= 0) {
+        launch(first);
+    }
+    auto hedgeAt = start + std::chrono::microseconds(static_cast<int64_t>(out.hedgeDelayMs * 1000));
+
+    while (!state->done) {
+        if (state->pending == 0) {
+            // Every attempt so far failed: fail over right away
+            int next = group->pick(tried);
+            if (next < 0 || net::Clock::now() >= deadline) break;
+            launch(next);
+            continue;
+        }
+
+        bool canHedge = policy.enabled && hedgeAttempt < 0 &&
+                        std::find(tried.begin(), tried.end(), false) != tried.end();
+        auto wakeAt = canHedge ? std::min(hedgeAt, deadline) : deadline;
+        state->cv.wait_until(lock, wakeAt);
+        if (state->done) break;
+
+        auto now = net::Clock::now();
+        if (now >= deadline) {
+            out.timedOut = true;
+            break;
+        }
+        if (canHedge && now >= hedgeAt) {
+            int next = group->pick(tried);
+            if (next >= 0) {
+                hedgeAttempt = out.attempts;
+                out.hedged = true;
+                launch(next);
+            }
+        }
+    }
+
+    if (state->done) {
+        out.response = std::move(state->response);
+        out.endpoint = state->endpoint;
+        out.hedgeWon = (state->winner == hedgeAttempt);
+    } else {
+        out.response.ok = false;
+        out.response.error = out.timedOut ? "deadline exceeded" : "all replicas failed";
+    }
+    out.errors = state->errors;
+    out.elapsedMs = std::chrono::duration_cast<std::chrono::microseconds>(net::Clock::now() - start).count() / 1000.0;
+    return out;
+}
+
+} // namespace shard_client
@@ -0,0 +1,435 @@
+#pragma once
+
+/*
+ * Topical Shards and Resource Selection
+ *
+ * shardBuilder --partition kmeans clusters documents into topical shards
+ * instead of dealing them round-robin, and writes two small resource-selection
+ * files the coordinator uses to send a query to only the few shards likely to
+ * hold its matches:
+ *
+ *   shards/selection.bin   per-shard document count and shard-local df of
+ *                          every term (a collection statistics index)
+ *       [numShards:4] numShards x { [numDocs:4][numEntries:4] numEntries x [lemmaId:4][df:4] }
+ *   shards/centroids.bin   the k-means centroids
+ *       [magic "MGCENT01":8][features:4][k:4][dim:4] k x dim x float32
+ *
+ * Document vectors (spherical k-means, cosine similarity):
+ * - Features::Lemmas      sparse (1 + log tf) * idf over lemma IDs
+ * - Features::Embeddings  idf-weighted average of the lemmas' word embeddings
+ *                         (embeddings.bin/vocab.json, averaged over every word
+ *                         of a lemma that has a vector)
+ * Both are L2-normalized, so a centroid dot product is the cosine.
+ *
+ * Shard ranking (rankShards):
+ * - "df":       AND estimates the shard's matching docs as
+ *               numDocs * prod(df_s(t) / numDocs); OR sums df_s(t) * idf(t).
+ *               Shards where an AND term is absent score 0 and are never
+ *               routed to, since they cannot match.
+ * - "centroid": cosine between the query vector and each centroid.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "json.hpp"
+#include "lexicon.hpp"
+
+namespace shard_cluster {
+
+enum class Features : uint32_t { Lemmas = 0, Embeddings = 1 };
+
+inline const char* featuresName(Features f) {
+    return f == Features::Embeddings ? "embeddings" : "lemmas";
+}
+
+using SparseVec = std::vector<std::pair<uint32_t, float>>;  // (dimension, weight)
+
+inline void normalize(SparseVec& v) {
+    double norm = 0.0;
+    for (const auto& [d, w] : v) norm += static_cast<double>(w) * w;
+    if (norm <= 0.0) return;
+    float inv = static_cast<float>(1.0 / std::sqrt(norm));
+    for (auto& [d, w] : v) w *= inv;
+}
+
+inline float dot(const SparseVec& v, const float* centroid) {
+    float s = 0.0f;
+    for (const auto& [d, w] : v) s += w * centroid[d];
+    return s;
+}
+
+// ---------------------- Feature space ----------------------
+
+class FeatureSpace {
+public:
+    // Lemma features: dimension = largest lemma ID + 1
+    FeatureSpace(const std::unordered_map<int, int>& globalDf, int64_t totalDocs)
+        : type(Features::Lemmas) {
+        initIdf(globalDf, totalDocs);
+        int maxLemma = 0;
+        for (const auto& [lemma, df] : globalDf) maxLemma = std::max(maxLemma, lemma);
+        numDims = static_cast<uint32_t>(maxLemma) + 1;
+    }
+
+    // Embedding features. Throws if the embedding files are missing or unusable.
+    FeatureSpace(const std::unordered_map<int, int>& globalDf, int64_t totalDocs,
+                 const std::string& embeddingsDir, const LemmaTable& words)
+        : type(Features::Embeddings) {
+        initIdf(globalDf, totalDocs);
+        loadLemmaEmbeddings(embeddingsDir, words);
+    }
+
+    Features features() const { return type; }
+    uint32_t dim() const { return numDims; }
+    size_t embeddedLemmas() const { return lemmaVectors.size(); }
+
+    // termFreqs: lemmaId -> tf
+    SparseVec docVector(const std::unordered_map<int, int>& termFreqs) const {
+        if (type == Features::Lemmas) {
+            SparseVec v;
+            v.reserve(termFreqs.size());
+            for (const auto& [lemma, tf] : termFreqs) {
+                if (lemma < 0 || static_cast<uint32_t>(lemma) >= numDims) continue;
+                v.emplace_back(static_cast<uint32_t>(lemma), static_cast<float>((1.0 + std::log(tf)) * idfOf(lemma)));
+            }
+            normalize(v);
+            return v;
+        }
+
+        std::vector<float> dense(numDims, 0.0f);
+        for (const auto& [lemma, tf] : termFreqs) {
+            addEmbedding(dense, lemma, static_cast<float>((1.0 + std::log(tf)) * idfOf(lemma)));
+        }
+        return toSparse(dense);
+    }
+
+    SparseVec queryVector(const std::vector<int>& lemmas) const {
+        std::unordered_map<int, int> tf;
+        for (int lemma : lemmas) tf[lemma]++;
+        return docVector(tf);
+    }
+
+    // Embedding features: every embedded lemma's vector times its idf, by
+    // lemma ID, so a document vector is the (1 + log tf)-weighted sum of these
+    std::vector<std::pair<int, std::vector<float>>> weightedLemmaVectors() const {
+        std::vector<std::pair<int, std::vector<float>>> out;
+        out.reserve(lemmaVectors.size());
+        for (const auto& [lemma, vec] : lemmaVectors) {
+            std::vector<float> w(vec);
+            float f = idfOf(lemma);
+            for (float& x : w) x *= f;
+            out.emplace_back(lemma, std::move(w));
+        }
+        std::sort(out.begin(), out.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        return out;
+    }
+
+private:
+    Features type;
+    uint32_t numDims = 0;
+    std::unordered_map<int, float> idf;
+    std::unordered_map<int, std::vector<float>> lemmaVectors;
+
+    void initIdf(const std::unordered_map<int, int>& globalDf, int64_t totalDocs) {
+        idf.reserve(globalDf.size());
+        for (const auto& [lemma, df] : globalDf) {
+            idf[lemma] = static_cast<float>(std::log(1.0 + static_cast<double>(totalDocs) / df));
+        }
+    }
+
+    float idfOf(int lemma) const {
+        auto it = idf.find(lemma);
+        return it != idf.end() ? it->second : 0.0f;
+    }
+
+    void addEmbedding(std::vector<float>& dense, int lemma, float weight) const {
+        auto it = lemmaVectors.find(lemma);
+        if (it == lemmaVectors.end()) return;
+        for (uint32_t d = 0; d < numDims; d++) dense[d] += weight * it->second[d];
+    }
+
+    static SparseVec toSparse(const std::vector<float>& dense) {
+        SparseVec v;
+        v.reserve(dense.size());
+        for (uint32_t d = 0; d < dense.size(); d++) {
+            if (dense[d] != 0.0f) v.emplace_back(d, dense[d]);
+        }
+        normalize(v);
+        return v;
+    }
+
+    // Same files search_semantic.cpp reads: vocab.json (word -> row) and
+    // embeddings.bin ([numWords:4][dim:4] numWords x dim x float32).
+    void loadLemmaEmbeddings(const std::string& embeddingsDir, const LemmaTable& words) {
+        std::ifstream vocabFile(embeddingsDir + "/vocab.json");
+        std::ifstream bin(embeddingsDir + "/embeddings.bin", std::ios::binary);
+        if (!vocabFile.is_open() || !bin.is_open()) {
+            throw std::runtime_error("Embeddings not found in " + embeddingsDir + " (run embeddings_setup.py)");
+        }
+
+        uint32_t numWords = 0;
+        bin.read(reinterpret_cast<char*>(&numWords), sizeof(numWords));
+        bin.read(reinterpret_cast<char*>(&numDims), sizeof(numDims));
+        std::vector<float> matrix(static_cast<size_t>(numWords) * numDims);
+        bin.read(reinterpret_cast<char*>(matrix.data()), matrix.size() * sizeof(float));
+        if (!bin || numDims == 0) {
+            throw std::runtime_error("Truncated embeddings.bin in " + embeddingsDir);
+        }
+
+        nlohmann::json vocab;
+        vocabFile >> vocab;
+
+        std::unordered_map<int, int> wordsPerLemma;
+        for (auto& [word, row] : vocab.items()) {
+            int32_t lemma = words.find(word);
+            int r = row.get<int>();
+            if (lemma == -1 || r < 0 || static_cast<uint32_t>(r) >= numWords) continue;
+
+            auto& vec = lemmaVectors[lemma];
+            vec.resize(numDims, 0.0f);
+            const float* src = &matrix[static_cast<size_t>(r) * numDims];
+            for (uint32_t d = 0; d < numDims; d++) vec[d] += src[d];
+            wordsPerLemma[lemma]++;
+        }
+        for (auto& [lemma, vec] : lemmaVectors) {
+            float inv = 1.0f / wordsPerLemma[lemma];
+            for (float& x : vec) x *= inv;
+        }
+    }
+};
+
+// ---------------------- Spherical k-means ----------------------
+
+struct Centroids {
+    Features features = Features::Lemmas;
+    uint32_t k = 0;
+    uint32_t dim = 0;
+    std::vector<float> data;  // k x dim
+
+    const float* row(uint32_t c) const { return &data[static_cast<size_t>(c) * dim]; }
+
+    // Index of the most similar centroid; similarityOut receives its cosine.
+    uint32_t nearest(const SparseVec& v, float* similarityOut = nullptr) const {
+        uint32_t best = 0;
+        float bestSim = -2.0f;
+        for (uint32_t c = 0; c < k; c++) {
+            float s = dot(v, row(c));
+            if (s > bestSim) {
+                bestSim = s;
+                best = c;
+            }
+        }
+        if (similarityOut) *similarityOut = bestSim;
+        return best;
+    }
+};
+
+// k-means++ seeding then Lloyd iterations with cosine similarity. A cluster
+// that empties is reseeded with the point its old centroid fits worst.
+// Deterministic for a given seed.
+inline Centroids kmeans(const std::vector<SparseVec>& points, uint32_t k, uint32_t dim,
+                        Features features, int iterations, uint32_t seed = 42) {
+    if (points.empty() || k == 0) {
+        throw std::runtime_error("k-means needs at least one point and one cluster");
+    }
+    k = std::min<uint32_t>(k, static_cast<uint32_t>(points.size()));
+
+    Centroids cent;
+    cent.features = features;
+    cent.k = k;
+    cent.dim = dim;
+    cent.data.assign(static_cast<size_t>(k) * dim, 0.0f);
+
+    auto setRow = [&](uint32_t c, const SparseVec& v) {
+        float* r = &cent.data[static_cast<size_t>(c) * dim];
+        std::fill(r, r + dim, 0.0f);
+        for (const auto& [d, w] : v) r[d] = w;
+    };
+
+    std::mt19937 rng(seed);
+    setRow(0, points[std::uniform_int_distribution<size_t>(0, points.size() - 1)(rng)]);
+
+    std::vector<double> distance(points.size(), 2.0);  // 1 - cosine to nearest seed
+    for (uint32_t c = 1; c < k; c++) {
+        double total = 0.0;
+        for (size_t i = 0; i < points.size(); i++) {
+            distance[i] = std::min(distance[i], 1.0 - dot(points[i], cent.row(c - 1)));
+            total += distance[i] * distance[i];
+        }
+        double target = std::uniform_real_distribution<double>(0.0, total)(rng);
+        size_t pick = 0;
+        for (double acc = 0.0; pick + 1 < points.size(); pick++) {
+            acc += distance[pick] * distance[pick];
+            if (acc >= target) break;
+        }
+        setRow(c, points[pick]);
+    }
+
+    std::vector<uint32_t> assign(points.size(), 0);
+    std::vector<float> similarity(points.size(), 0.0f);
+    std::vector<double> sums(static_cast<size_t>(k) * dim);
+    std::vector<size_t> counts(k);
+
+    for (int iter = 0; iter < iterations; iter++) {
+        bool changed = false;
+        for (size_t i = 0; i < points.size(); i++) {
+            uint32_t c = cent.nearest(points[i], &similarity[i]);
+            changed = changed || c != assign[i];
+            assign[i] = c;
+        }
+        if (iter > 0 && !changed) break;
+
+        std::fill(sums.begin(), sums.end(), 0.0);
+        std::fill(counts.begin(), counts.end(), 0);
+        for (size_t i = 0; i < points.size(); i++) {
+            double* s = &sums[static_cast<size_t>(assign[i]) * dim];
+            for (const auto& [d, w] : points[i]) s[d] += w;
+            counts[assign[i]]++;
+        }
+
+        for (uint32_t c = 0; c < k; c++) {
+            float* r = &cent.data[static_cast<size_t>(c) * dim];
+            if (counts[c] == 0) {
+                size_t worst = std::min_element(similarity.begin(), similarity.end()) - similarity.begin();
+                setRow(c, points[worst]);
+                similarity[worst] = 1.0f;
+                continue;
+            }
+            const double* s = &sums[static_cast<size_t>(c) * dim];
+            double norm = 0.0;
+            for (uint32_t d = 0; d < dim; d++) norm += s[d] * s[d];
+            double inv = norm > 0.0 ? 1.0 / std::sqrt(norm) : 0.0;
+            for (uint32_t d = 0; d < dim; d++) r[d] = static_cast<float>(s[d] * inv);
+        }
+    }
+    return cent;
+}
+
+inline void writeCentroids(const std::string& path, const Centroids& c) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot create " + path);
+    }
+    uint32_t features = static_cast<uint32_t>(c.features);
+    out.write("MGCENT01", 8);
+    out.write(reinterpret_cast<const char*>(&features), sizeof(features));
+    out.write(reinterpret_cast<const char*>(&c.k), sizeof(c.k));
+    out.write(reinterpret_cast<const char*>(&c.dim), sizeof(c.dim));
+    out.write(reinterpret_cast<const char*>(c.data.data()), c.data.size() * sizeof(float));
+}
+
+inline bool readCentroids(const std::string& path, Centroids& c) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) return false;
+
+    char magic[8];
+    uint32_t features = 0;
+    in.read(magic, 8);
+    in.read(reinterpret_cast<char*>(&features), sizeof(features));
+    in.read(reinterpret_cast<char*>(&c.k), sizeof(c.k));
+    in.read(reinterpret_cast<char*>(&c.dim), sizeof(c.dim));
+    if (!in || std::memcmp(magic, "MGCENT01", 8) != 0) return false;
+
+    c.features = static_cast<Features>(features);
+    c.data.resize(static_cast<size_t>(c.k) * c.dim);
+    in.read(reinterpret_cast<char*>(c.data.data()), c.data.size() * sizeof(float));
+    return static_cast<bool>(in);
+}
+
+// ---------------------- Collection statistics summary ----------------------
+
+struct ShardSummary {
+    std::vector<int32_t> numDocs;                      // per shard
+    std::vector<std::unordered_map<int, int>> df;      // per shard: lemmaId -> local df
+};
+
+inline void writeSummary(const std::string& path, const ShardSummary& s) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot create " + path);
+    }
+    int32_t numShards = static_cast<int32_t>(s.numDocs.size());
+    out.write(reinterpret_cast<const char*>(&numShards), sizeof(numShards));
+    for (int32_t k = 0; k < numShards; k++) {
+        std::vector<std::pair<int32_t, int32_t>> entries(s.df[k].begin(), s.df[k].end());
+        std::sort(entries.begin(), entries.end());
+        int32_t n = static_cast<int32_t>(entries.size());
+        out.write(reinterpret_cast<const char*>(&s.numDocs[k]), sizeof(int32_t));
+        out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+        out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(entries[0]));
+    }
+}
+
+inline bool readSummary(const std::string& path, ShardSummary& s) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) return false;
+
+    int32_t numShards = 0;
+    in.read(reinterpret_cast<char*>(&numShards), sizeof(numShards));
+    s.numDocs.assign(numShards, 0);
+    s.df.assign(numShards, {});
+    for (int32_t k = 0; k < numShards && in; k++) {
+        int32_t n = 0;
+        in.read(reinterpret_cast<char*>(&s.numDocs[k]), sizeof(int32_t));
+        in.read(reinterpret_cast<char*>(&n), sizeof(n));
+        std::vector<std::pair<int32_t, int32_t>> entries(n);
+        in.read(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(entries[0]));
+        s.df[k].reserve(n);
+        for (const auto& [lemma, df] : entries) s.df[k][lemma] = df;
+    }
+    return static_cast<bool>(in);
+}
+
+// ---------------------- Shard ranking ----------------------
+
+struct ShardScore {
+    int shard;
+    double score;
+};
+
+// Collection-statistics ranking (see top of file), best first. terms holds
+// (lemmaId, global df).
+inline std::vector<ShardScore> rankShardsByDf(const ShardSummary& summary,
+                                              const std::vector<std::pair<int, int>>& terms,
+                                              bool andMode, int64_t totalDocs) {
+    std::vector<ShardScore> ranked;
+    for (size_t k = 0; k < summary.numDocs.size(); k++) {
+        double n = std::max(1, summary.numDocs[k]);
+        double score = andMode ? n : 0.0;
+        for (const auto& [lemma, globalDf] : terms) {
+            auto it = summary.df[k].find(lemma);
+            int localDf = it != summary.df[k].end() ? it->second : 0;
+            if (andMode) {
+                score *= localDf / n;
+            } else {
+                score += localDf * std::log(1.0 + static_cast<double>(totalDocs) / std::max(1, globalDf));
+            }
+        }
+        ranked.push_back({static_cast<int>(k), score});
+    }
+    std::stable_sort(ranked.begin(), ranked.end(),
+                     [](const ShardScore& a, const ShardScore& b) { return a.score > b.score; });
+    return ranked;
+}
+
+inline std::vector<ShardScore> rankShardsByCentroid(const Centroids& centroids, const SparseVec& query) {
+    std::vector<ShardScore> ranked;
+    for (uint32_t c = 0; c < centroids.k; c++) {
+        ranked.push_back({static_cast<int>(c), dot(query, centroids.row(c))});
+    }
+    std::stable_sort(ranked.begin(), ranked.end(),
+                     [](const ShardScore& a, const ShardScore& b) { return a.score > b.score; });
+    return ranked;
+}
+
+} // namespace shard_cluster
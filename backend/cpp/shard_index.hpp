@@ -0,0 +1,280 @@
+#pragma once
+
+/*
+ * Document-Partitioned Shard Index
+ *
+ * shardBuilder splits the forward index into N shards by document. Every
+ * shard is a self-contained mini index that one shardServer process serves;
+ * a searchCoordinator fans queries out to all shards and merges their top-K.
+ *
+ * Directory layout (indexes/<shards_dir>/):
+ *   global_stats.json    {"num_shards", "num_docs", "avg_doc_length", "partition"}
+ *   global_df.bin        [numEntries:4] numEntries x [lemmaId:4][df:4]
+ *   shard_<k>/
+ *     barrel_<b>.bin/.idx   same format as barrels_binary (see barrels_binary.cpp)
+ *     doc_lengths.bin       [numDocs:4] numDocs x [docId:20][length:4]
+ *     stats.json            {"shard", "num_docs", "total_terms", "num_terms"}
+ *
+ * Shard barrels use the same HOT/WARM/COLD assignment as barrels.cpp, computed
+ * from the global df, so a term lives in the same barrel number on every shard.
+ *
+ * BM25 on a shard uses the global N, df and average document length sent by
+ * the coordinator, so a document scores the same no matter which shard holds
+ * it and per-shard top-K lists can be merged directly.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace shard_index {
+
+constexpr int DOC_ID_SIZE = 20;
+constexpr int NUM_BARRELS = 10;
+
+// BM25 parameters (same as search.cpp)
+constexpr double BM25_K1 = 1.5;
+constexpr double BM25_B = 0.75;
+
+struct Posting {
+    char docId[DOC_ID_SIZE];
+    int32_t tf;
+};
+
+struct IndexEntry {
+    int64_t offset;
+    int64_t length;
+};
+
+// Same HOT/WARM/COLD rule as barrels.cpp
+inline int barrelForTerm(int lemmaId, int df) {
+    if (df > 10000) return 0;
+    if (df > 1000) return 1 + (lemmaId % 6);
+    return 7 + (lemmaId % 3);
+}
+
+// Same saturation and length norm as search.cpp. IDF uses the non-negative
+// log(1 + (N - df + 0.5) / (df + 0.5)) form: shards score with the real corpus
+// size, where terms in more than half the documents would otherwise go negative.
+inline double bm25(int tf, int df, int docLength, int64_t totalDocs, double avgDocLength) {
+    if (tf == 0 || df == 0) return 0.0;
+    double idf = std::log(1.0 + (static_cast<double>(totalDocs - df) + 0.5) / (static_cast<double>(df) + 0.5));
+    double lengthNorm = 1.0 - BM25_B + BM25_B * (static_cast<double>(docLength) / avgDocLength);
+    return idf * (tf * (BM25_K1 + 1.0)) / (tf + BM25_K1 * lengthNorm);
+}
+
+inline std::string shardDirName(int shard) {
+    return "shard_" + std::to_string(shard);
+}
+
+// ---------------------- Global statistics ----------------------
+
+inline void writeGlobalDf(const std::string& path, const std::unordered_map<int, int>& df) {
+    std::vector<std::pair<int32_t, int32_t>> entries(df.begin(), df.end());
+    std::sort(entries.begin(), entries.end());
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot create " + path);
+    }
+    int32_t n = static_cast<int32_t>(entries.size());
+    out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+    for (const auto& [lemmaId, count] : entries) {
+        out.write(reinterpret_cast<const char*>(&lemmaId), sizeof(lemmaId));
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    }
+}
+
+inline std::unordered_map<int, int> readGlobalDf(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        throw std::runtime_error("Cannot open " + path + " (run shardBuilder first)");
+    }
+    int32_t n = 0;
+    in.read(reinterpret_cast<char*>(&n), sizeof(n));
+
+    std::unordered_map<int, int> df;
+    df.reserve(n);
+    for (int32_t i = 0; i < n; i++) {
+        int32_t lemmaId, count;
+        in.read(reinterpret_cast<char*>(&lemmaId), sizeof(lemmaId));
+        in.read(reinterpret_cast<char*>(&count), sizeof(count));
+        df[lemmaId] = count;
+    }
+    if (!in) {
+        throw std::runtime_error("Truncated global df table: " + path);
+    }
+    return df;
+}
+
+// ---------------------- Shard writer ----------------------
+
+// Collects one shard's postings in memory and writes its barrels.
+class ShardWriter {
+public:
+    void addDocument(const std::string& docId, const std::unordered_map<int, int>& termFreqs, int length) {
+        Posting p;
+        std::memset(p.docId, 0, DOC_ID_SIZE);
+        std::strncpy(p.docId, docId.c_str(), DOC_ID_SIZE - 1);
+
+        for (const auto& [lemmaId, tf] : termFreqs) {
+            p.tf = tf;
+            postings[lemmaId].push_back(p);
+        }
+
+        Posting d = p;
+        d.tf = length;
+        docLengths.push_back(d);
+        totalTerms += length;
+    }
+
+    size_t numDocs() const { return docLengths.size(); }
+    size_t numTerms() const { return postings.size(); }
+
+    // lemmaId -> number of this shard's documents containing it
+    std::unordered_map<int, int> localDf() const {
+        std::unordered_map<int, int> df;
+        df.reserve(postings.size());
+        for (const auto& [lemmaId, list] : postings) {
+            df[lemmaId] = static_cast<int>(list.size());
+        }
+        return df;
+    }
+
+    void write(const std::string& dir, int shard, const std::unordered_map<int, int>& globalDf) const {
+        // Group terms by barrel, in lemma order for reproducible files
+        std::vector<std::vector<int>> barrelTerms(NUM_BARRELS);
+        for (const auto& [lemmaId, list] : postings) {
+            auto it = globalDf.find(lemmaId);
+            int df = (it != globalDf.end()) ? it->second : static_cast<int>(list.size());
+            barrelTerms[barrelForTerm(lemmaId, df)].push_back(lemmaId);
+        }
+
+        for (int b = 0; b < NUM_BARRELS; b++) {
+            std::sort(barrelTerms[b].begin(), barrelTerms[b].end());
+            std::string base = dir + "/barrel_" + std::to_string(b);
+            std::ofstream bin(base + ".bin", std::ios::binary);
+            std::ofstream idx(base + ".idx", std::ios::binary);
+            if (!bin.is_open() || !idx.is_open()) {
+                throw std::runtime_error("Cannot write barrel files under " + dir);
+            }
+
+            int32_t numEntries = static_cast<int32_t>(barrelTerms[b].size());
+            idx.write(reinterpret_cast<const char*>(&numEntries), sizeof(numEntries));
+
+            int64_t offset = 0;
+            for (int lemmaId : barrelTerms[b]) {
+                const std::vector<Posting>& list = postings.at(lemmaId);
+                int32_t id = lemmaId;
+                int32_t df = static_cast<int32_t>(list.size());  // shard-local df
+                int32_t numDocs = df;
+
+                bin.write(reinterpret_cast<const char*>(&id), sizeof(id));
+                bin.write(reinterpret_cast<const char*>(&df), sizeof(df));
+                bin.write(reinterpret_cast<const char*>(&numDocs), sizeof(numDocs));
+                bin.write(reinterpret_cast<const char*>(list.data()), list.size() * sizeof(Posting));
+
+                int64_t length = 12 + static_cast<int64_t>(list.size() * sizeof(Posting));
+                idx.write(reinterpret_cast<const char*>(&id), sizeof(id));
+                idx.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+                idx.write(reinterpret_cast<const char*>(&length), sizeof(length));
+                offset += length;
+            }
+        }
+
+        std::ofstream lengths(dir + "/doc_lengths.bin", std::ios::binary);
+        int32_t n = static_cast<int32_t>(docLengths.size());
+        lengths.write(reinterpret_cast<const char*>(&n), sizeof(n));
+        lengths.write(reinterpret_cast<const char*>(docLengths.data()), docLengths.size() * sizeof(Posting));
+
+        std::ofstream stats(dir + "/stats.json");
+        stats << "{\n"
+              << "    \"shard\" : " << shard << ",\n"
+              << "    \"num_docs\" : " << docLengths.size() << ",\n"
+              << "    \"total_terms\" : " << totalTerms << ",\n"
+              << "    \"num_terms\" : " << postings.size() << "\n"
+              << "}\n";
+    }
+
+private:
+    std::unordered_map<int, std::vector<Posting>> postings;
+    std::vector<Posting> docLengths;  // tf field holds the document length
+    int64_t totalTerms = 0;
+};
+
+// ---------------------- Shard reader ----------------------
+
+// Read-only view of one shard directory. The barrel offset tables and doc
+// lengths are loaded once; postings are read per request with a fresh
+// ifstream, so one ShardReader can serve concurrent requests.
+class ShardReader {
+public:
+    explicit ShardReader(const std::string& dir) : dir(dir) {
+        for (int b = 0; b < NUM_BARRELS; b++) {
+            std::ifstream idx(dir + "/barrel_" + std::to_string(b) + ".idx", std::ios::binary);
+            if (!idx.is_open()) continue;
+
+            int32_t numEntries = 0;
+            idx.read(reinterpret_cast<char*>(&numEntries), sizeof(numEntries));
+            for (int32_t i = 0; i < numEntries; i++) {
+                int32_t lemmaId;
+                IndexEntry e;
+                idx.read(reinterpret_cast<char*>(&lemmaId), sizeof(lemmaId));
+                idx.read(reinterpret_cast<char*>(&e.offset), sizeof(e.offset));
+                idx.read(reinterpret_cast<char*>(&e.length), sizeof(e.length));
+                terms[lemmaId] = {b, e};
+            }
+        }
+
+        std::ifstream lengths(dir + "/doc_lengths.bin", std::ios::binary);
+        if (!lengths.is_open()) {
+            throw std::runtime_error("Not a shard directory (missing doc_lengths.bin): " + dir);
+        }
+        int32_t n = 0;
+        lengths.read(reinterpret_cast<char*>(&n), sizeof(n));
+        std::vector<Posting> entries(n);
+        lengths.read(reinterpret_cast<char*>(entries.data()), n * sizeof(Posting));
+        docLengths.reserve(n);
+        for (const Posting& p : entries) {
+            docLengths[std::string(p.docId, std::find(p.docId, p.docId + DOC_ID_SIZE, '\0'))] = p.tf;
+        }
+    }
+
+    size_t numDocs() const { return docLengths.size(); }
+    size_t numTerms() const { return terms.size(); }
+
+    int docLength(const std::string& docId, int fallback) const {
+        auto it = docLengths.find(docId);
+        return it != docLengths.end() ? it->second : fallback;
+    }
+
+    // Reads the shard's postings for a term. Returns false if the shard has none.
+    bool readPostings(int lemmaId, std::vector<Posting>& out) const {
+        auto it = terms.find(lemmaId);
+        if (it == terms.end()) return false;
+
+        const auto& [barrel, entry] = it->second;
+        std::ifstream bin(dir + "/barrel_" + std::to_string(barrel) + ".bin", std::ios::binary);
+        if (!bin.is_open()) return false;
+
+        bin.seekg(entry.offset);
+        int32_t header[3];
+        bin.read(reinterpret_cast<char*>(header), sizeof(header));
+        out.resize(header[2]);
+        bin.read(reinterpret_cast<char*>(out.data()), out.size() * sizeof(Posting));
+        return static_cast<bool>(bin);
+    }
+
+private:
+    std::string dir;
+    std::unordered_map<int, std::pair<int, IndexEntry>> terms;  // lemmaId -> (barrel, entry)
+    std::unordered_map<std::string, int> docLengths;
+};
+
+} // namespace shard_index
@@ -0,0 +1,135 @@
+#pragma once
+
+/*
+ * Shard Wire Protocol
+ *
+ * Line-based text over TCP, one request per connection (see net.hpp).
+ *
+ * Request:
+ *   SEARCH <topK> <AND|OR> <totalDocs> <avgDocLength> <numTerms> <lemmaId>:<df> ...
+ *   PING
+ *
+ * Response to SEARCH:
+ *   OK <numHits> <numMatched> <postingsScanned>
+ *   <docId> <score> <matchedTerms> <tf1,tf2,...>     (numHits lines, best first)
+ *   END
+ * Response to PING:
+ *   PONG <shard> <numDocs>
+ * Any failure:
+ *   ERR <message>
+ *
+ * numMatched counts every document on the shard that passed the AND/OR
+ * filter, not just the top-K sent back.
+ *
+ * df and totalDocs are corpus-wide values chosen by the coordinator, so every
+ * shard scores with the same IDF.
+ */
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace shard_protocol {
+
+struct Query {
+    int topK = 20;
+    bool andMode = true;
+    int64_t totalDocs = 0;
+    double avgDocLength = 0.0;
+    std::vector<std::pair<int, int>> terms;  // (lemmaId, global df)
+};
+
+struct Hit {
+    std::string docId;
+    double score = 0.0;
+    int matchedTerms = 0;
+    std::vector<int> termFreqs;  // one per query term, in request order
+};
+
+struct Response {
+    bool ok = false;
+    std::string error;
+    std::vector<Hit> hits;
+    int64_t numMatched = 0;
+    int64_t postingsScanned = 0;
+};
+
+// Parses all of [first, last) as a decimal int; false on anything else
+// (no exceptions, so one bad request cannot take a server thread down)
+inline bool parseInt(const char* first, const char* last, int& value) {
+    auto [end, ec] = std::from_chars(first, last, value);
+    return ec == std::errc() && end == last && first != last;
+}
+
+inline std::string formatQuery(const Query& q) {
+    std::ostringstream out;
+    out << "SEARCH " << q.topK << " " << (q.andMode ? "AND" : "OR") << " "
+        << q.totalDocs << " " << q.avgDocLength << " " << q.terms.size();
+    for (const auto& [lemmaId, df] : q.terms) {
+        out << " " << lemmaId << ":" << df;
+    }
+    out << "\n";
+    return out.str();
+}
+
+// Parses a SEARCH line (without the trailing '\n'). Returns false if malformed.
+inline bool parseQuery(const std::string& line, Query& q) {
+    std::istringstream in(line);
+    std::string verb, mode;
+    size_t numTerms = 0;
+    if (!(in >> verb >> q.topK >> mode >> q.totalDocs >> q.avgDocLength >> numTerms) || verb != "SEARCH") {
+        return false;
+    }
+    q.andMode = (mode != "OR");
+
+    q.terms.clear();
+    for (size_t i = 0; i < numTerms; i++) {
+        std::string term;
+        if (!(in >> term)) return false;
+        size_t colon = term.find(':');
+        if (colon == std::string::npos) return false;
+        int lemmaId, df;
+        const char* text = term.data();
+        if (!parseInt(text, text + colon, lemmaId) || !parseInt(text + colon + 1, text + term.size(), df)) {
+            return false;
+        }
+        q.terms.emplace_back(lemmaId, df);
+    }
+    return q.topK > 0 && q.totalDocs > 0 && q.avgDocLength > 0.0;
+}
+
+inline std::string formatHit(const Hit& h) {
+    char score[32];
+    std::snprintf(score, sizeof(score), "%.9g", h.score);
+
+    std::string out = h.docId + " " + score + " " + std::to_string(h.matchedTerms) + " ";
+    for (size_t i = 0; i < h.termFreqs.size(); i++) {
+        if (i > 0) out += ",";
+        out += std::to_string(h.termFreqs[i]);
+    }
+    out += "\n";
+    return out;
+}
+
+inline bool parseHit(const std::string& line, Hit& h) {
+    std::istringstream in(line);
+    std::string tfs;
+    if (!(in >> h.docId >> h.score >> h.matchedTerms >> tfs)) return false;
+
+    h.termFreqs.clear();
+    std::istringstream tfIn(tfs);
+    std::string tf;
+    while (std::getline(tfIn, tf, ',')) {
+        if (tf.empty()) continue;
+        int value;
+        if (!parseInt(tf.data(), tf.data() + tf.size(), value)) return false;
+        h.termFreqs.push_back(value);
+    }
+    return true;
+}
+
+} // namespace shard_protocol
@@ -0,0 +1,141 @@
+#pragma once
+
+/*
+ * Query-Biased Snippets
+ *
+ * Cuts a short, highlighted excerpt out of a result's stored text (see
+ * doc_store.hpp) around the densest cluster of query terms, instead of
+ * always showing the start of the abstract.
+ *
+ * Matching is done on lemma IDs from the record's token-offset index, so
+ * inflected forms and semantic expansions match without re-tokenizing the
+ * text. A window of `windowTokens` consecutive tokens is scored by the sum
+ * of the weights of the distinct terms it contains, plus a small bonus for
+ * repeats; the best window is cut at token boundaries and every matched
+ * token is wrapped in highlight markers.
+ *
+ * Each call has a time budget. When it runs out, the best window found so
+ * far is used (or the lead of the text if nothing matched yet), so one very
+ * long document cannot stall the result page.
+ *
+ * Callers generate snippets only for the final top-K results, after ranking.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "doc_store.hpp"
+#include "json.hpp"
+
+namespace snippet {
+
+// lemmaId -> weight (original query terms 1.0, expansions less)
+using TermWeights = std::unordered_map<int32_t, float>;
+
+struct Options {
+    size_t windowTokens = 32;
+    std::chrono::microseconds budget{2000};
+    std::string open = "**";   // highlight markers (api.py / the frontend render these)
+    std::string close = "**";
+};
+
+// Reads "snippet_window_tokens" and "snippet_budget_us" from config.json.
+inline Options optionsFromConfig(const nlohmann::json& config) {
+    Options opt;
+    opt.windowTokens = config.value("snippet_window_tokens", opt.windowTokens);
+    opt.budget = std::chrono::microseconds(config.value("snippet_budget_us", static_cast<long long>(opt.budget.count())));
+    return opt;
+}
+
+inline std::string generate(const doc_store::DocRecord& rec, const TermWeights& terms, const Options& opt) {
+    using Clock = std::chrono::steady_clock;
+    const auto deadline = Clock::now() + opt.budget;
+
+    const std::string& text = rec.snippetText();
+    const std::vector<doc_store::TokenSpan>& tokens = rec.tokens;
+    const size_t n = tokens.size();
+    const size_t window = opt.windowTokens > 0 ? opt.windowTokens : 1;
+    if (n == 0) return "";
+
+    // Positions of query-term tokens, in text order
+    std::vector<size_t> hits;
+    std::vector<float> hitWeights;
+    for (size_t i = 0; i < n; i++) {
+        if ((i & 255) == 255 && Clock::now() > deadline) break;
+        auto it = terms.find(tokens[i].lemmaId);
+        if (it != terms.end()) {
+            hits.push_back(i);
+            hitWeights.push_back(it->second);
+        }
+    }
+
+    // Slide a window over the hits: [hits[a], hits[b]] spans < window tokens
+    size_t bestFirst = 0;
+    size_t bestLast = 0;
+    double bestScore = -1.0;
+    std::unordered_map<int32_t, int> inWindow;
+    double score = 0.0;
+
+    for (size_t a = 0, b = 0; b < hits.size(); b++) {
+        if ((b & 15) == 15 && Clock::now() > deadline) break;
+
+        int32_t lemma = tokens[hits[b]].lemmaId;
+        score += (inWindow[lemma]++ == 0) ? hitWeights[b] : 0.25 * hitWeights[b];
+
+        while (hits[b] - hits[a] >= window) {
+            int32_t old = tokens[hits[a]].lemmaId;
+            score -= (--inWindow[old] == 0) ? hitWeights[a] : 0.25 * hitWeights[a];
+            a++;
+        }
+
+        if (score > bestScore + 1e-9) {
+            bestScore = score;
+            bestFirst = hits[a];
+            bestLast = hits[b];
+        }
+    }
+
+    // Center the winning cluster in a full-size window (lead of the text if no hits)
+    size_t begin = 0;
+    if (bestScore > 0.0) {
+        size_t span = bestLast - bestFirst + 1;
+        size_t pad = (window > span) ? (window - span) / 2 : 0;
+        begin = (bestFirst > pad) ? bestFirst - pad : 0;
+    }
+    size_t end = std::min(n, begin + window);
+    if (end - begin < window && end == n) {
+        begin = (n > window) ? n - window : 0;
+    }
+
+    std::string out;
+    out.reserve((tokens[end - 1].start + tokens[end - 1].length - tokens[begin].start) + 32);
+    if (begin > 0) out += "... ";
+
+    size_t pos = tokens[begin].start;
+    for (size_t i = begin; i < end; i++) {
+        const doc_store::TokenSpan& t = tokens[i];
+        out.append(text, pos, t.start - pos);
+        bool hit = terms.count(t.lemmaId) > 0;
+        if (hit) out += opt.open;
+        out.append(text, t.start, t.length);
+        if (hit) out += opt.close;
+        pos = t.start + t.length;
+    }
+    if (end < n) {
+        out += " ...";
+    } else {
+        out.append(text, pos, std::string::npos);  // closing punctuation
+    }
+
+    // One line for the result printer
+    for (char& c : out) {
+        if (c == '\n' || c == '\r' || c == '\t') c = ' ';
+    }
+    return out;
+}
+
+} // namespace snippet
@@ -0,0 +1,166 @@
+#pragma once
+
+/*
+ * Shared ASCII Tokenizer
+ *
+ * One normalization for both sides of the engine: forwardIndex uses it to
+ * turn document text into lemma IDs, and search / search_semantic use it to
+ * split queries, so a word is always spelled the same way at index and query
+ * time.
+ *
+ * Rules (same as clean_and_tokenize in py/lexicon.py, which builds the
+ * vocabulary):
+ * - a token is a maximal run of [A-Za-z0-9]
+ * - every other byte (space, punctuation, UTF-8 continuation bytes) separates
+ * - ASCII letters are lowercased
+ *
+ * Bytes are classified and lowercased 16 at a time with SSE2 (always present
+ * on x86-64), producing a 64-bit "is alnum" mask per 64-byte block. Token
+ * boundaries are then found with count-trailing-zeros on that mask, so the
+ * per-byte loop disappears. Tokens are handed out as string_views into a
+ * buffer owned by the Tokenizer; reuse one Tokenizer per thread and no
+ * allocation happens once the buffer has grown to the largest input.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MINIGOOGLE_TOKENIZER_SSE2 1
+#endif
+
+class Tokenizer {
+public:
+    // Calls fn(std::string_view token) for every token in text.
+    // Views point into the internal buffer and stay valid until the next call.
+    template <typename Fn>
+    void forEachToken(std::string_view text, Fn&& fn) {
+        const size_t n = text.size();
+        const size_t blocks = (n + 63) / 64;
+        buffer.resize(blocks * 64);
+
+        const char* src = text.data();
+        char* dst = &buffer[0];
+
+        bool inToken = false;
+        size_t start = 0;
+
+        for (size_t b = 0; b < blocks; b++) {
+            const size_t base = b * 64;
+            uint64_t mask = classifyBlock(src + base, dst + base, n - base);
+
+            size_t pos = 0;
+            while (pos < 64) {
+                if (inToken) {
+                    uint64_t rest = ~mask >> pos;
+                    if (rest == 0) break;  // token continues into next block
+                    pos += ctz64(rest);
+                    fn(std::string_view(dst + start, base + pos - start));
+                    inToken = false;
+                } else {
+                    uint64_t rest = mask >> pos;
+                    if (rest == 0) break;
+                    pos += ctz64(rest);
+                    start = base + pos;
+                    inToken = true;
+                }
+            }
+        }
+
+        if (inToken) {
+            fn(std::string_view(dst + start, n - start));
+        }
+    }
+
+    // Same as forEachToken, but also passes the token's byte offset in text:
+    // fn(size_t offset, std::string_view token). Used to build snippet offsets.
+    template <typename Fn>
+    void forEachTokenAt(std::string_view text, Fn&& fn) {
+        forEachToken(text, [&](std::string_view tok) {
+            fn(static_cast<size_t>(tok.data() - buffer.data()), tok);
+        });
+    }
+
+    // Convenience for callers that want owned strings (query parsing).
+    std::vector<std::string> tokenize(std::string_view text) {
+        std::vector<std::string> tokens;
+        forEachToken(text, [&](std::string_view tok) { tokens.emplace_back(tok); });
+        return tokens;
+    }
+
+private:
+    std::string buffer;
+
+    static inline size_t ctz64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<size_t>(__builtin_ctzll(x));
+#else
+        size_t n = 0;
+        while (!(x & 1)) { x >>= 1; n++; }
+        return n;
+#endif
+    }
+
+    static inline bool isAlnumAscii(unsigned char c) {
+        return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z');
+    }
+
+    // Lowercases up to 64 bytes of src into dst and returns a bitmask with
+    // bit i set when src[i] is [A-Za-z0-9]. Bytes past `avail` read as separators.
+    static inline uint64_t classifyBlock(const char* src, char* dst, size_t avail) {
+        if (avail < 64) {
+            // Tail: copy into a zero-padded scratch block and classify that
+            alignas(16) char tail[64] = {0};
+            std::memcpy(tail, src, avail);
+            return classifyFull(tail, dst);
+        }
+        return classifyFull(src, dst);
+    }
+
+#ifdef MINIGOOGLE_TOKENIZER_SSE2
+    static inline uint64_t classifyFull(const char* src, char* dst) {
+        const __m128i upperLo = _mm_set1_epi8('A' - 1);
+        const __m128i upperHi = _mm_set1_epi8('Z' + 1);
+        const __m128i lowerLo = _mm_set1_epi8('a' - 1);
+        const __m128i lowerHi = _mm_set1_epi8('z' + 1);
+        const __m128i digitLo = _mm_set1_epi8('0' - 1);
+        const __m128i digitHi = _mm_set1_epi8('9' + 1);
+        const __m128i caseBit = _mm_set1_epi8(0x20);
+
+        uint64_t mask = 0;
+        for (int i = 0; i < 4; i++) {
+            __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 16));
+
+            // Signed compares: bytes >= 0x80 are negative and fall outside every range
+            __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(c, upperLo), _mm_cmplt_epi8(c, upperHi));
+            __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(c, lowerLo), _mm_cmplt_epi8(c, lowerHi));
+            __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, digitLo), _mm_cmplt_epi8(c, digitHi));
+            __m128i alnum = _mm_or_si128(_mm_or_si128(upper, lower), digit);
+
+            __m128i lowered = _mm_or_si128(c, _mm_and_si128(upper, caseBit));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 16), _mm_and_si128(lowered, alnum));
+
+            mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(alnum))) << (i * 16);
+        }
+        return mask;
+    }
+#else
+    static inline uint64_t classifyFull(const char* src, char* dst) {
+        uint64_t mask = 0;
+        for (int i = 0; i < 64; i++) {
+            unsigned char c = static_cast<unsigned char>(src[i]);
+            if (isAlnumAscii(c)) {
+                dst[i] = static_cast<char>((c >= 'A' && c <= 'Z') ? (c | 0x20) : c);
+                mask |= uint64_t(1) << i;
+            } else {
+                dst[i] = 0;
+            }
+        }
+        return mask;
+    }
+#endif
+};
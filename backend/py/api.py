@@ -4,7 +4,7 @@ MiniGoogle Semantic Search API
 FastAPI service with semantic search, autocomplete, and PageRank.
 
 Endpoints:
-    GET  /search?q=<query>&mode=<and|or>&semantic=<true|false>
+    GET  /search?q=<query>&mode=<and|or>&semantic=<true|false>&hybrid=<true|false>
     GET  /autocomplete?prefix=<prefix>
     GET  /similar?word=<word>
     GET  /health
@@ -49,6 +49,7 @@ class SearchResult(BaseModel):
     title: Optional[str] = None
     authors: Optional[List[str]] = None
     abstract: Optional[str] = None
+    snippet: Optional[str] = None
     tfidf_score: Optional[float] = None
     pagerank_score: Optional[float] = None
     matched_terms: Optional[int] = None
@@ -214,24 +215,78 @@ async def startup_event():
     else:
         print("Warning: N-gram index not found. Run ngram_builder.py first for multi-word autocomplete.")
 
-    # Load document metadata
-    DOC_METADATA = load_doc_metadata()
-    if callable(DOC_METADATA):
-        print("Document metadata: Using on-the-fly generation (mock mode)")
-    elif DOC_METADATA:
-        print(f"Loaded metadata for {len(DOC_METADATA)} documents")
+    # Titles, authors and abstracts come from the C++ document store
+    # (indexes/doc_store.bin). document_metadata.json is only loaded on demand
+    # for results the store does not cover (e.g. newly uploaded documents).
+    doc_store = Path(__file__).parent.resolve().parent / "indexes" / "doc_store.bin"
+    if doc_store.exists():
+        print(f"Document metadata: {doc_store}")
     else:
-        print("Warning: Document metadata not available")
+        print("Document metadata: doc_store.bin not found, using document_metadata.json / mock fallback")
+
+def log_query(query: str):
+    """Append a multi-word query to indexes/query_log.txt.
+
+    pairBuilder reads this log to pick the term pairs worth precomputing.
+    """
+    if len(query.split()) < 2:
+        return
+    log_file = Path(__file__).parent.resolve().parent / "indexes" / "query_log.txt"
+    try:
+        with open(log_file, 'a', encoding='utf-8') as f:
+            f.write(" ".join(query.split()) + "\n")
+    except OSError:
+        pass
 
 # ==================== Output Parsers ====================
 
+METADATA_LINE = re.compile(r'\s{3}(Title|Authors|Abstract|Snippet): ?(.*)$')
+FACET_LINE = re.compile(r'\[Facet (\w+): ?(.*)\]$')
+FACET_VALUE = re.compile(r'(.+?)=(~?)(\d+)(?:, |$)')
+HYBRID_RANKS = re.compile(r'\| Lexical: (\d+|-) \| Vector: (\d+|-)')
+
+def parse_facet_line(line: str, facets: dict) -> bool:
+    """Parse a '[Facet year: 2020=410, 2019=~300]' line ('~' = sampled count)."""
+    match = FACET_LINE.match(line)
+    if not match:
+        return False
+    facets[match.group(1)] = [
+        {"value": value, "count": int(count), "sampled": bool(tilde)}
+        for value, tilde, count in FACET_VALUE.findall(match.group(2))
+    ]
+    return True
+
+def parse_metadata_line(line: str, results: list) -> bool:
+    """Attach a '   Title: / Authors: / Abstract: / Snippet:' line to the last result.
+
+    Snippets mark query terms as **term**.
+    """
+    match = METADATA_LINE.match(line)
+    if not match or not results:
+        return False
+
+    field, value = match.group(1), match.group(2)
+    if field == "Title":
+        results[-1]["title"] = value
+    elif field == "Authors":
+        results[-1]["authors"] = [a for a in value.split("; ") if a]
+    elif field == "Snippet":
+        results[-1]["snippet"] = value
+    else:
+        results[-1]["abstract"] = value
+    return True
+
 def enrich_result_with_metadata(result: dict) -> dict:
-    """Add title, authors, and abstract to a search result."""
+    """Add title, authors, and abstract to a search result the engine did not annotate."""
+    global DOC_METADATA
     doc_id = result.get("doc_id", "")
 
-    if not doc_id:
+    if not doc_id or "title" in result:
         return result
 
+    if DOC_METADATA is None:
+        DOC_METADATA = load_doc_metadata()
+
     # Get metadata
     if callable(DOC_METADATA):
         # Generate on-the-fly (mock mode)
@@ -262,6 +317,9 @@ def parse_semantic_search_output(output: str) -> dict:
     in_expansion = False
 
     for line in lines:
+        if parse_metadata_line(line, results):
+            continue
+
         # Mode detection
         if "AND mode" in line:
             mode = "AND"
@@ -296,7 +354,7 @@ def parse_semantic_search_output(output: str) -> dict:
         # "1. DocID: PMC7326321 | Score: 4.1198 | TF-IDF: 3.5 | PageRank: 0.6 | Matched: 2/2"
         if line and line[0].isdigit() and ". DocID:" in line:
             match = re.match(
-                r'(\d+)\. DocID: (\S+) \| Score: ([\d.]+) \| TF-IDF: ([\d.]+) \| PageRank: ([\d.]+) \| Matched: (\d+)/(\d+)',
+                r'(\d+)\. DocID: (\S+) \| Score: (-?[\d.]+) \| TF-IDF: ([\d.]+) \| PageRank: ([\d.]+) \| Matched: (\d+)/(\d+)',
                 line
             )
             if match:
@@ -309,6 +367,11 @@ def parse_semantic_search_output(output: str) -> dict:
                     "matched_terms": int(match.group(6)),
                     "total_terms": int(match.group(7))
                 })
+                # Hybrid mode: rank in each fused list ("-" = not in it)
+                ranks = HYBRID_RANKS.search(line)
+                if ranks:
+                    results[-1]["lexical_rank"] = None if ranks.group(1) == "-" else int(ranks.group(1))
+                    results[-1]["vector_rank"] = None if ranks.group(2) == "-" else int(ranks.group(2))
 
     # Enrich results with metadata
     enriched_results = [enrich_result_with_metadata(r) for r in results]
@@ -384,10 +447,14 @@ def parse_basic_search_output(output: str, is_multi: bool) -> dict:
     df = None
     lemma_id = None
     barrel = None
+    facets = {}
 
     lines = output.strip().split('\n')
 
     for line in lines:
+        if parse_metadata_line(line, results) or parse_facet_line(line, facets):
+            continue
+
         if "AND mode" in line:
             mode = "AND"
         elif "OR mode" in line:
@@ -444,13 +511,14 @@ def parse_basic_search_output(output: str, is_multi: bool) -> dict:
         "document_frequency": df,
         "search_time_ms": search_time,
         "result_count": len(enriched_results),
-        "results": enriched_results
+        "results": enriched_results,
+        "facets": facets
     }
 
 # ==================== Search Functions ====================
 
-def run_semantic_search(query: str, mode: str = "and") -> dict:
-    """Run semantic search."""
+def run_semantic_search(query: str, mode: str = "and", hybrid: bool = False) -> dict:
+    """Run semantic search; hybrid fuses lexical and document-vector results."""
     if not SEMANTIC_SEARCH_EXECUTABLE:
         return {
             "success": False,
@@ -464,6 +532,8 @@ def run_semantic_search(query: str, mode: str = "and") -> dict:
         cmd.append("--or")
     else:
         cmd.append("--and")
+    if hybrid:
+        cmd.append("--hybrid")
 
     try:
         result = subprocess.run(cmd, capture_output=True, text=True, timeout=30)
@@ -480,6 +550,7 @@ def run_semantic_search(query: str, mode: str = "and") -> dict:
         parsed["success"] = True
         parsed["query"] = query
         parsed["semantic"] = True
+        parsed["hybrid"] = hybrid
 
         return parsed
 
@@ -488,8 +559,8 @@ def run_semantic_search(query: str, mode: str = "and") -> dict:
     except Exception as e:
         return {"success": False, "error": str(e), "query": query, "query_type": "semantic"}
 
-def run_basic_search(query: str, mode: str = "and") -> dict:
-    """Run basic keyword search."""
+def run_basic_search(query: str, mode: str = "and", facets: Optional[str] = None) -> dict:
+    """Run basic keyword search; facets is a comma-separated attribute list."""
     if not SEARCH_EXECUTABLE:
         return {
             "success": False,
@@ -503,6 +574,8 @@ def run_basic_search(query: str, mode: str = "and") -> dict:
         cmd.append("--or")
     else:
         cmd.append("--and")
+    if facets:
+        cmd += ["--facets", facets]
 
     try:
         result = subprocess.run(cmd, capture_output=True, text=True, timeout=30)
@@ -732,7 +805,9 @@ def run_similar(word: str) -> dict:
 async def search(
     q: str = Query(..., description="Search query", min_length=1),
     mode: QueryMode = Query(QueryMode.AND, description="AND/OR mode"),
-    semantic: bool = Query(True, description="Enable semantic search")
+    semantic: bool = Query(True, description="Enable semantic search"),
+    hybrid: bool = Query(False, description="Fuse keyword and document-vector results"),
+    facets: Optional[str] = Query(None, description="Facet counts over all matches, e.g. 'year,journal'")
 ):
     """
     Search for documents.
@@ -740,13 +815,19 @@ async def search(
     - **q**: Search query (required)
     - **mode**: 'and' or 'or' for multi-word queries
     - **semantic**: Enable semantic search with query expansion (default: true)
+    - **hybrid**: with semantic, fuse keyword results with nearest document vectors
+      (reciprocal-rank fusion) instead of expanding the query; needs indexes/dense
+      (./run.sh --build-doc-vectors)
+    - **facets**: attributes to count over every match (year, journal, license, author);
+      uses the keyword search, which needs indexes/attributes (./run.sh --build-attributes)
     """
     query = q.strip()
+    log_query(query)
 
-    if semantic and SEMANTIC_SEARCH_EXECUTABLE:
-        result = run_semantic_search(query, mode.value)
+    if semantic and SEMANTIC_SEARCH_EXECUTABLE and not facets:
+        result = run_semantic_search(query, mode.value, hybrid)
     else:
-        result = run_basic_search(query, mode.value)
+        result = run_basic_search(query, mode.value, facets)
 
     if not result["success"]:
         raise HTTPException(status_code=500, detail=result.get("error", "Search failed"))
@@ -906,9 +987,9 @@ async def upload_document(
         )
 
         if result["success"]:
-            # Reload metadata in memory
+            # Drop cached metadata; reloaded on the next fallback lookup
             global DOC_METADATA
-            DOC_METADATA = load_doc_metadata()
+            DOC_METADATA = None
 
             return DocumentUploadResponse(
                 success=True,
@@ -966,9 +1047,9 @@ async def upload_document_text(doc: DocumentTextRequest):
         )
 
         if result["success"]:
-            # Reload metadata
+            # Drop cached metadata; reloaded on the next fallback lookup
             global DOC_METADATA
-            DOC_METADATA = load_doc_metadata()
+            DOC_METADATA = None
 
             return DocumentUploadResponse(
                 success=True,
@@ -393,7 +393,8 @@ class DocumentIndexer:
                     offset = bin_file.tell()
                     
                     df = posting.get("df", 0)
-                    docs = posting.get("docs", [])
+                    # Doc ID order, like barrels_binary (search merges over it)
+                    docs = sorted(posting.get("docs", []), key=lambda d: d["doc_id"].encode('utf-8')[:20])
                     num_docs = len(docs)
                     
                     # Write header: [lemma_id:4][df:4][num_docs:4]
@@ -260,12 +260,20 @@ def build_trie_index(paths, lexicon_data):
     return prefix_index
 
 def compute_document_scores(paths):
-    """Compute simple PageRank-like scores for documents."""
+    """Compute simple PageRank-like scores for documents.
+
+    Fallback for collections without a citation graph: search_semantic
+    prefers the citation PageRank in pagerank.bin (built by pageRank).
+    """
     embeddings_dir = paths["embeddings"]
     scores_path = embeddings_dir / "doc_scores.json"
 
     print("\nComputing document authority scores...")
 
+    if (paths["indexes"] / "pagerank.bin").exists():
+        print("  Citation PageRank found (pagerank.bin), skipping heuristic scores")
+        return {}
+
     # Load forward index to get document statistics
     forward_index_path = paths["indexes"] / "forward_index.txt"
 
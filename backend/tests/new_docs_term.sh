@@ -0,0 +1,64 @@
+#!/bin/bash
+#
+# A query term that exists only in the new-docs barrel (barrel 10) must not
+# be dropped: AND with a term from the main barrels must match nothing but
+# the added document, and OR must still return it.
+#
+# Runs search against a scratch copy of backend/indexes, so the index must
+# be built (./run.sh) and search compiled first.
+#
+# Usage (from the repository root):
+#   backend/tests/new_docs_term.sh
+
+set -u
+
+BACKEND_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+PYTHON="$(command -v python3 || command -v python)"
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+
+fail() {
+    echo "FAIL: $1"
+    exit 1
+}
+
+[ -x "$BACKEND_DIR/cpp/build/search" ] || fail "backend/cpp/build/search not built"
+[ -d "$BACKEND_DIR/indexes" ] || fail "backend/indexes not built"
+
+# search finds config.json and the indexes relative to its own location
+mkdir -p "$WORK/backend/cpp/build"
+cp "$BACKEND_DIR/config.json" "$WORK/backend/"
+cp -r "$BACKEND_DIR/indexes" "$WORK/backend/"
+cp "$BACKEND_DIR/cpp/build/search" "$WORK/backend/cpp/build/"
+SEARCH="$WORK/backend/cpp/build/search"
+
+# "zorbulax" is new to the lexicon, so it is looked up in barrel 10 only;
+# "lung" is a main-barrel term the added document does not contain
+"$PYTHON" - "$WORK/backend" "$BACKEND_DIR/py" <<'EOF' > /dev/null || fail "could not add the test document"
+import sys
+sys.path.insert(0, sys.argv[2])
+from document_indexer import DocumentIndexer
+result = DocumentIndexer(sys.argv[1]).index_document(
+    doc_id="PMCNEWDOCSTEST", title="Zorbulax trial", body="zorbulax covid zorbulax")
+sys.exit(0 if result["success"] else 1)
+EOF
+
+cd "$WORK/backend/cpp"
+for algorithm in "" merge; do
+    args=("zorbulax lung")
+    [ -n "$algorithm" ] && args+=(--algorithm "$algorithm")
+    out="$("$SEARCH" "${args[@]}" 2>/dev/null)" || fail "search ${args[*]} exited with an error"
+    echo "$out" | grep -q "No documents found matching ALL" || fail "AND ${args[*]} ignored the new-docs term"
+done
+
+for algorithm in "" wand; do
+    args=("zorbulax lung" --or)
+    [ -n "$algorithm" ] && args+=(--algorithm "$algorithm")
+    out="$("$SEARCH" "${args[@]}" 2>/dev/null)" || fail "search ${args[*]} exited with an error"
+    echo "$out" | grep -q "DocID: PMCNEWDOCSTEST" || fail "OR ${args[*]} lost the new-docs document"
+done
+
+out="$("$SEARCH" "zorbulax covid" 2>/dev/null)" || fail "search zorbulax covid exited with an error"
+echo "$out" | grep -q "DocID: PMCNEWDOCSTEST" || fail "AND zorbulax covid missed the new-docs document"
+
+echo "PASS: new_docs_term"
@@ -3,6 +3,12 @@ import './App.css'
 
 const API_BASE = '/api'
 
+// Snippets from the engine mark query terms as **term**
+function renderSnippet(snippet) {
+  return snippet.split('**').map((part, i) =>
+    i % 2 === 1 ? <mark key={i}>{part}</mark> : part
+  )
+}
 
 function App() {
   const [query, setQuery] = useState('')
@@ -409,8 +415,10 @@ function App() {
                       </div>
                     )}
 
-                    {/* Abstract snippet */}
-                    {result.abstract && (
+                    {/* Query-biased snippet, falling back to the abstract */}
+                    {result.snippet ? (
+                      <p className="result-abstract">{renderSnippet(result.snippet)}</p>
+                    ) : result.abstract && (
                       <p className="result-abstract">{result.abstract}</p>
                     )}
 
@@ -140,7 +140,8 @@ exit /b
 echo === Building C++ Index Executables ===
 if not exist "%CPP_BUILD_DIR%" mkdir "%CPP_BUILD_DIR%"
 
-g++ -O2 -std=c++17 -o "%CPP_BUILD_DIR%\forwardIndex.exe" "%BACKEND_DIR%\cpp\forwardIndex.cpp" || exit /b 1
+g++ -O2 -std=c++17 -pthread -o "%CPP_BUILD_DIR%\forwardIndex.exe" "%BACKEND_DIR%\cpp\forwardIndex.cpp" || exit /b 1
+g++ -O2 -std=c++17 -o "%CPP_BUILD_DIR%\packCorpus.exe" "%BACKEND_DIR%\cpp\packCorpus.cpp" || exit /b 1
 g++ -O2 -std=c++17 -o "%CPP_BUILD_DIR%\invertedIndex.exe" "%BACKEND_DIR%\cpp\invertedIndex.cpp" || exit /b 1
 g++ -O2 -std=c++17 -o "%CPP_BUILD_DIR%\barrels.exe" "%BACKEND_DIR%\cpp\barrels.cpp" || exit /b 1
 
@@ -59,6 +59,16 @@ detect_compiler() {
     echo -e "${GREEN}Using C++ Compiler:${RESET} g++"
 }
 
+# Optional zstd support for corpus packs and the document store
+# (corpus_pack.hpp, doc_store.hpp)
+detect_zstd() {
+    ZSTD_FLAGS=""
+    if echo '#include <zstd.h>' | g++ -E -x c++ - &>/dev/null; then
+        ZSTD_FLAGS="-DMINIGOOGLE_WITH_ZSTD -lzstd"
+        echo -e "${GREEN}zstd found:${RESET} corpus packs and the document store will be compressed"
+    fi
+}
+
 setup_venv() {
     echo -e "${BLUE}=== Setting up Python virtual environment ===${RESET}"
     if [ ! -d "$SCRIPT_DIR/.venv" ]; then
@@ -142,8 +152,19 @@ build_cpp_indexes() {
     echo -e "${BLUE}=== Building C++ Index Executables ===${RESET}"
     mkdir -p "$CPP_BUILD_DIR"
 
+    detect_zstd
+
     echo -e "${YELLOW}Compiling Forward Index...${RESET}"
-    g++ -O2 -o "$CPP_BUILD_DIR/forwardIndex" "$BACKEND_DIR/cpp/forwardIndex.cpp" -std=c++17 || { echo -e "${RED}Forward index compilation failed.${RESET}"; exit 1; }
+    g++ -O2 -o "$CPP_BUILD_DIR/forwardIndex" "$BACKEND_DIR/cpp/forwardIndex.cpp" -std=c++17 -pthread $ZSTD_FLAGS || { echo -e "${RED}Forward index compilation failed.${RESET}"; exit 1; }
+
+    echo -e "${YELLOW}Compiling Document Reorder...${RESET}"
+    g++ -O2 -o "$CPP_BUILD_DIR/reorderDocs" "$BACKEND_DIR/cpp/reorderDocs.cpp" -std=c++17 -pthread $ZSTD_FLAGS || { echo -e "${RED}Document reorder compilation failed.${RESET}"; exit 1; }
+
+    echo -e "${YELLOW}Compiling PageRank...${RESET}"
+    g++ -O2 -o "$CPP_BUILD_DIR/pageRank" "$BACKEND_DIR/cpp/pageRank.cpp" -std=c++17 -pthread || { echo -e "${RED}PageRank compilation failed.${RESET}"; exit 1; }
+
+    echo -e "${YELLOW}Compiling Corpus Packer...${RESET}"
+    g++ -O2 -o "$CPP_BUILD_DIR/packCorpus" "$BACKEND_DIR/cpp/packCorpus.cpp" -std=c++17 $ZSTD_FLAGS || { echo -e "${RED}Corpus packer compilation failed.${RESET}"; exit 1; }
 
     echo -e "${YELLOW}Compiling Inverted Index...${RESET}"
     g++ -O2 -o "$CPP_BUILD_DIR/invertedIndex" "$BACKEND_DIR/cpp/invertedIndex.cpp" -std=c++17 || { echo -e "${RED}Inverted index compilation failed.${RESET}"; exit 1; }
@@ -154,12 +175,41 @@ build_cpp_indexes() {
     echo -e "${GREEN}C++ executables compiled.${RESET}"
 }
 
+# doc_order from config.json: "pmc" (PMC ID order), "bp" (graph bisection)
+# or "pagerank" (descending PageRank)
+doc_order() {
+    grep -o '"doc_order"[^,}]*' "$BACKEND_DIR/config.json" | grep -o '"[a-z]*"$' | tr -d '"'
+}
+
+# True if an HNSW or IVF-PQ index exists; reorderDocs deletes them (they hold docIDs)
+has_vector_index() {
+    local dense_dir
+    dense_dir="$(grep -o '"dense_dir"[^,}]*' "$BACKEND_DIR/config.json" | grep -o '"[^"]*"$' | tr -d '"')"
+    dense_dir="$INDEXES_DIR/${dense_dir:-dense}"
+    [ -f "$dense_dir/hnsw.bin" ] || [ -f "$dense_dir/ivfpq.bin" ]
+}
+
 run_cpp_indexes() {
     echo -e "${BLUE}=== Running C++ Index Builders ===${RESET}"
 
     echo -e "${YELLOW}Building Forward Index...${RESET}"
     "$CPP_BUILD_DIR/forwardIndex" || { echo -e "${RED}Forward index run failed.${RESET}"; exit 1; }
 
+    echo -e "${YELLOW}Computing Citation PageRank...${RESET}"
+    "$CPP_BUILD_DIR/pageRank" || { echo -e "${RED}PageRank run failed.${RESET}"; exit 1; }
+
+    local order
+    order="$(doc_order)"
+    if [ "$order" = "bp" ] || [ "$order" = "pagerank" ]; then
+        local vectors=0
+        has_vector_index && vectors=1
+        echo -e "${YELLOW}Reordering Documents...${RESET}"
+        "$CPP_BUILD_DIR/reorderDocs" --method "$order" || { echo -e "${RED}Document reorder failed.${RESET}"; exit 1; }
+        if [ $vectors -eq 1 ]; then
+            build_doc_vectors
+        fi
+    fi
+
     echo -e "${YELLOW}Building Inverted Index...${RESET}"
     "$CPP_BUILD_DIR/invertedIndex" || { echo -e "${RED}Inverted index run failed.${RESET}"; exit 1; }
 
@@ -173,11 +223,13 @@ build_search_executables() {
     echo -e "${BLUE}=== Building Search Executables ===${RESET}"
     mkdir -p "$CPP_BUILD_DIR"
 
+    detect_zstd
+
     echo -e "${YELLOW}Compiling Search...${RESET}"
-    g++ -O2 -o "$CPP_BUILD_DIR/search" "$BACKEND_DIR/cpp/search.cpp" -std=c++17 || { echo -e "${RED}Search compilation failed.${RESET}"; exit 1; }
+    g++ -O2 -o "$CPP_BUILD_DIR/search" "$BACKEND_DIR/cpp/search.cpp" -std=c++17 $ZSTD_FLAGS || { echo -e "${RED}Search compilation failed.${RESET}"; exit 1; }
 
     echo -e "${YELLOW}Compiling Semantic Search...${RESET}"
-    g++ -O2 -o "$CPP_BUILD_DIR/search_semantic" "$BACKEND_DIR/cpp/search_semantic.cpp" -std=c++17 || { echo -e "${RED}Semantic search compilation failed.${RESET}"; exit 1; }
+    g++ -O2 -o "$CPP_BUILD_DIR/search_semantic" "$BACKEND_DIR/cpp/search_semantic.cpp" -std=c++17 -pthread $ZSTD_FLAGS || { echo -e "${RED}Semantic search compilation failed.${RESET}"; exit 1; }
 
     echo -e "${GREEN}Search executables compiled.${RESET}"
 }
@@ -196,6 +248,138 @@ build_ngrams() {
     echo -e "${GREEN}N-gram index built successfully.${RESET}"
 }
 
+build_shards() {
+    echo -e "${BLUE}=== Building Document Shards ===${RESET}"
+    mkdir -p "$CPP_BUILD_DIR"
+
+    detect_zstd
+
+    echo -e "${YELLOW}Compiling Shard Builder, Shard Server and Coordinator...${RESET}"
+    g++ -O2 -o "$CPP_BUILD_DIR/shardBuilder" "$BACKEND_DIR/cpp/shardBuilder.cpp" -std=c++17 || { echo -e "${RED}Shard builder compilation failed.${RESET}"; exit 1; }
+    g++ -O2 -o "$CPP_BUILD_DIR/shardServer" "$BACKEND_DIR/cpp/shardServer.cpp" -std=c++17 -pthread || { echo -e "${RED}Shard server compilation failed.${RESET}"; exit 1; }
+    g++ -O2 -o "$CPP_BUILD_DIR/searchCoordinator" "$BACKEND_DIR/cpp/searchCoordinator.cpp" -std=c++17 -pthread $ZSTD_FLAGS || { echo -e "${RED}Coordinator compilation failed.${RESET}"; exit 1; }
+
+    (cd "$BACKEND_DIR/cpp" && "$CPP_BUILD_DIR/shardBuilder") || { echo -e "${RED}Shard build failed.${RESET}"; exit 1; }
+    echo -e "${GREEN}Shards built.${RESET}"
+}
+
+# Precomputes the intersections of frequent term pairs (query log or bigrams.json)
+build_pairs() {
+    echo -e "${BLUE}=== Building Pair Index ===${RESET}"
+    mkdir -p "$CPP_BUILD_DIR"
+
+    echo -e "${YELLOW}Compiling Pair Builder...${RESET}"
+    g++ -O2 -o "$CPP_BUILD_DIR/pairBuilder" "$BACKEND_DIR/cpp/pairBuilder.cpp" -std=c++17 || { echo -e "${RED}Pair builder compilation failed.${RESET}"; exit 1; }
+
+    (cd "$BACKEND_DIR/cpp" && "$CPP_BUILD_DIR/pairBuilder") || { echo -e "${RED}Pair index build failed.${RESET}"; exit 1; }
+    echo -e "${GREEN}Pair index built.${RESET}"
+}
+
+# Per-document year/journal/license columns from metadata.csv, for search filters
+build_attributes() {
+    echo -e "${BLUE}=== Building Attribute Store ===${RESET}"
+    mkdir -p "$CPP_BUILD_DIR"
+
+    echo -e "${YELLOW}Compiling Attribute Builder...${RESET}"
+    g++ -O2 -o "$CPP_BUILD_DIR/attributeBuilder" "$BACKEND_DIR/cpp/attributeBuilder.cpp" -std=c++17 || { echo -e "${RED}Attribute builder compilation failed.${RESET}"; exit 1; }
+
+    (cd "$BACKEND_DIR/cpp" && "$CPP_BUILD_DIR/attributeBuilder") || { echo -e "${RED}Attribute store build failed.${RESET}"; exit 1; }
+    echo -e "${GREEN}Attribute store built.${RESET}"
+}
+
+reorder_docs() {
+    echo -e "${BLUE}=== Reordering Documents ===${RESET}"
+    mkdir -p "$CPP_BUILD_DIR"
+
+    detect_zstd
+
+    echo -e "${YELLOW}Compiling Document Reorder...${RESET}"
+    g++ -O2 -o "$CPP_BUILD_DIR/reorderDocs" "$BACKEND_DIR/cpp/reorderDocs.cpp" -std=c++17 -pthread $ZSTD_FLAGS || { echo -e "${RED}Document reorder compilation failed.${RESET}"; exit 1; }
+
+    # Graph bisection unless config.json asks for PageRank order
+    local order
+    order="$(doc_order)"
+    [ "$order" = "pagerank" ] || order="bp"
+    local vectors=0
+    has_vector_index && vectors=1
+    (cd "$BACKEND_DIR/cpp" && "$CPP_BUILD_DIR/reorderDocs" --method "$order") || { echo -e "${RED}Document reorder failed.${RESET}"; exit 1; }
+    echo -e "${GREEN}Documents reordered.${RESET}"
+    if [ $vectors -eq 1 ]; then
+        build_doc_vectors
+    fi
+}
+
+# Postings/ns of the BM25, TF-IDF and accumulation kernels at each SIMD level
+bench_kernels() {
+    echo -e "${BLUE}=== Benchmarking Scoring Kernels ===${RESET}"
+    mkdir -p "$CPP_BUILD_DIR"
+
+    echo -e "${YELLOW}Compiling Kernel Benchmark...${RESET}"
+    g++ -O2 -o "$CPP_BUILD_DIR/kernelBench" "$BACKEND_DIR/cpp/kernelBench.cpp" -std=c++17 || { echo -e "${RED}Kernel benchmark compilation failed.${RESET}"; exit 1; }
+
+    (cd "$BACKEND_DIR/cpp" && "$CPP_BUILD_DIR/kernelBench") || { echo -e "${RED}Kernel benchmark failed.${RESET}"; exit 1; }
+}
+
+# Every script in backend/tests, against the built index and executables
+run_tests() {
+    echo -e "${BLUE}=== Running Tests ===${RESET}"
+    local failed=0
+    for t in "$BACKEND_DIR"/tests/*.sh; do
+        "$t" || failed=1
+    done
+    [ $failed -eq 0 ] || { echo -e "${RED}Tests failed.${RESET}"; exit 1; }
+    echo -e "${GREEN}All tests passed.${RESET}"
+}
+
+# Dense document vectors and their HNSW graph, for search_semantic --hybrid
+build_doc_vectors() {
+    echo -e "${BLUE}=== Building Document Vectors ===${RESET}"
+    mkdir -p "$CPP_BUILD_DIR"
+
+    echo -e "${YELLOW}Compiling Document Vector Builder...${RESET}"
+    g++ -O2 -o "$CPP_BUILD_DIR/docVectorBuilder" "$BACKEND_DIR/cpp/docVectorBuilder.cpp" -std=c++17 || { echo -e "${RED}Document vector builder compilation failed.${RESET}"; exit 1; }
+
+    (cd "$BACKEND_DIR/cpp" && "$CPP_BUILD_DIR/docVectorBuilder") || { echo -e "${RED}Document vector build failed.${RESET}"; exit 1; }
+    echo -e "${GREEN}Document vectors built.${RESET}"
+}
+
+# Starts shard_replicas shardServers per shard in the background
+# (ports shard_base_port + replica * shard_replica_port_stride + shard)
+start_shards() {
+    local shards_dir="$INDEXES_DIR/shards"
+    if [ ! -f "$shards_dir/global_stats.json" ]; then
+        echo -e "${RED}Error: No shards found. Run './run.sh --build-shards' first.${RESET}"
+        return 1
+    fi
+
+    stop_shards
+    local num_shards
+    num_shards=$(grep -o '"num_shards"[^,}]*' "$shards_dir/global_stats.json" | grep -o '[0-9]*$')
+
+    local num_replicas
+    num_replicas=$(grep -o '"shard_replicas"[^,}]*' "$BACKEND_DIR/config.json" | grep -o '[0-9]*$')
+    num_replicas=${num_replicas:-1}
+
+    echo -e "${BLUE}=== Starting ${num_shards} Shards x ${num_replicas} Replicas ===${RESET}"
+    for ((r = 0; r < num_replicas; r++)); do
+        for ((k = 0; k < num_shards; k++)); do
+            (cd "$BACKEND_DIR/cpp" && exec "$CPP_BUILD_DIR/shardServer" --shard "$k" --replica "$r") > "$shards_dir/shard_${k}_r${r}.log" 2>&1 &
+            echo $! >> "$shards_dir/servers.pid"
+        done
+    done
+    echo -e "${GREEN}Shard servers running (logs in $shards_dir). Query with:${RESET}"
+    echo "  $CPP_BUILD_DIR/searchCoordinator \"covid vaccine\""
+}
+
+stop_shards() {
+    local pid_file="$INDEXES_DIR/shards/servers.pid"
+    if [ -f "$pid_file" ]; then
+        xargs kill 2>/dev/null < "$pid_file"
+        rm -f "$pid_file"
+        echo -e "${YELLOW}Stopped shard servers.${RESET}"
+    fi
+}
+
 start_backend() {
     echo -e "${BLUE}=== Starting Backend API ===${RESET}"
 
@@ -373,6 +557,39 @@ if [ $# -gt 0 ]; then
         --check)
             check_indexes
             ;;
+        --build-shards)
+            detect_compiler
+            build_shards
+            ;;
+        --build-pairs)
+            detect_compiler
+            build_pairs
+            ;;
+        --build-attributes)
+            detect_compiler
+            build_attributes
+            ;;
+        --build-doc-vectors)
+            detect_compiler
+            build_doc_vectors
+            ;;
+        --reorder-docs)
+            detect_compiler
+            reorder_docs
+            ;;
+        --bench-kernels)
+            detect_compiler
+            bench_kernels
+            ;;
+        --test)
+            run_tests
+            ;;
+        --shards)
+            start_shards
+            ;;
+        --stop-shards)
+            stop_shards
+            ;;
         --help)
             echo "Usage: ./run.sh [option]"
             echo ""
@@ -382,6 +599,15 @@ if [ $# -gt 0 ]; then
             echo "  --backend   Start backend API only"
             echo "  --frontend  Start frontend only"
             echo "  --check     Check index files status"
+            echo "  --build-shards  Split the forward index into shards (num_shards in config.json)"
+            echo "  --build-pairs   Precompute frequent term pairs (query log or bigrams.json)"
+            echo "  --build-attributes  Year/journal/license columns from metadata.csv (search filters)"
+            echo "  --build-doc-vectors Document vectors + HNSW index (needs embeddings; semantic --hybrid)"
+            echo "  --reorder-docs  Renumber documents by graph bisection, or by PageRank if doc_order is \"pagerank\""
+            echo "  --bench-kernels Time the SIMD scoring kernels (postings/ns per instruction set)"
+            echo "  --test          Run backend/tests against the built index"
+            echo "  --shards        Start local shard servers (shard_replicas per shard)"
+            echo "  --stop-shards   Stop the local shard servers"
             echo "  --help      Show this help"
             echo ""
             echo "Without options, shows interactive menu."